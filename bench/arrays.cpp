@@ -0,0 +1,150 @@
+#include "bench.h"
+
+#include "array.h"
+#include "interpreter.h"
+#include "native.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+/**
+ * Number of elements of the arrays.
+ */
+constexpr std::size_t LENGTH = 1 << 18;
+
+/**
+ * Number of times the bulk cases go over the arrays.
+ */
+constexpr std::size_t REPEATS = 100;
+
+/**
+ * The `array(n)` native of the scripts.
+ *
+ * @param length Number of elements.
+ * @return n zeros.
+ */
+std::vector<double> zeros(std::size_t length) {
+    return std::vector<double>(length);
+}
+
+/**
+ * Parse and resolve a script.
+ *
+ * @param src The source code.
+ * @param diagnostics Receives the errors.
+ * @return The program, or nullptr if it has errors.
+ */
+std::shared_ptr<Program> compile(const std::string& src, Diagnostics& diagnostics) {
+    Parser parser(Scanner(src, diagnostics).scanTokens(), diagnostics);
+    std::shared_ptr<Program> program = parser.parseProgram();
+    if (program) {
+        Resolver(diagnostics).resolve(*program);
+    }
+
+    return diagnostics.hadError() ? nullptr : program;
+}
+
+/**
+ * Time a script over two arrays `a` and `b` of LENGTH elements, cycling through 0, 1, 2 and 3, on the tree
+ * walker and on the closure tier.
+ *
+ * @param name Name of the case.
+ * @param body Statements computing `s`, which the script then prints.
+ * @param items Number of elements the body goes over.
+ * @param expected The value of `s`.
+ * @return 0 if every run printed the expected value, otherwise the exit code of the failure.
+ */
+int measure(std::string_view name, std::string_view body, std::size_t items, double expected) {
+    const auto prelude = std::format("var a = array({});\n"
+                                     "var k = 0;\n"
+                                     "for (var i = 0; i < {}; i = i + 1) {{\n"
+                                     "  a[i] = k;\n"
+                                     "  k = k + 1;\n"
+                                     "  if (k == 4) k = 0;\n"
+                                     "}}\n"
+                                     "var b = a + a - a;\n",
+                                     LENGTH, LENGTH);
+    const auto src = std::format("var s = 0;\n"
+                                 "{}"
+                                 "print s;\n",
+                                 body);
+
+    std::ostringstream errors;
+    Diagnostics diagnostics(errors);
+    auto setup = compile(prelude, diagnostics);
+    auto program = compile(src, diagnostics);
+    if (!setup || !program) {
+        std::print("{}", errors.str());
+        return 65;
+    }
+
+    std::println("{} ({} elements)", name, items);
+
+    const auto result = Interpreter::stringify(expected);
+    for (bool tiering : {false, true}) {
+        StringSink output;
+        Interpreter interpreter(diagnostics, output);
+        interpreter.setTierThreshold(tiering ? Interpreter::DEFAULT_TIER_THRESHOLD : 0);
+        interpreter.defineNative(NativeFunction::bind("array", &zeros));
+        interpreter.defineNative(NativeFunction::bind("sum", &Array::sum));
+        interpreter.defineNative(NativeFunction::bind("dot", &Array::dot));
+        interpreter.interpret(setup);
+
+        auto label = tiering ? "  closure tier" : "  tree walker";
+        (void)bench::run(label, items, [&] { interpreter.interpret(program); }, "element");
+
+        auto text = output.take();
+        if (diagnostics.hadRuntimeError() || text.substr(0, text.find('\n')) != result) {
+            std::println("  wrong result: {}{}", text.substr(0, text.find('\n')), errors.str());
+            return 70;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+/**
+ * Times scripts over arrays of 2^18 numbers: a loop reading every element, which gets each one as a plain
+ * number and allocates nothing, against the built-in reductions and elementwise operators, which run SSE2 loops
+ * over the unboxed elements. The gap between the first two cases is the cost of interpreting one `s = s + a[i]`.
+ */
+int main() {
+    // Each group of four elements holds 0, 1, 2 and 3, whose sum is 6 and sum of squares 14.
+    constexpr auto GROUPS = static_cast<double>(LENGTH / 4);
+    constexpr auto TIMES = static_cast<double>(REPEATS);
+
+    const auto loop = std::format("for (var i = 0; i < {}; i = i + 1) s = s + a[i];\n", LENGTH);
+    if (int code = measure("element loop", loop, LENGTH, 6 * GROUPS); code != 0) {
+        return code;
+    }
+
+    const auto sum = std::format("for (var r = 0; r < {}; r = r + 1) s = s + sum(a);\n", REPEATS);
+    if (int code = measure("sum(a)", sum, LENGTH * REPEATS, 6 * GROUPS * TIMES); code != 0) {
+        return code;
+    }
+
+    const auto dot = std::format("for (var r = 0; r < {}; r = r + 1) s = s + dot(a, b);\n", REPEATS);
+    if (int code = measure("dot(a, b)", dot, LENGTH * REPEATS, 14 * GROUPS * TIMES); code != 0) {
+        return code;
+    }
+
+    const auto elementwise = std::format("var c;\n"
+                                         "for (var r = 0; r < {}; r = r + 1) c = a * b + a;\n"
+                                         "s = sum(c);\n",
+                                         REPEATS);
+    return measure("a * b + a", elementwise, LENGTH * REPEATS, 20 * GROUPS);
+}
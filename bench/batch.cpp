@@ -0,0 +1,65 @@
+#include "bench.h"
+
+#include "batch.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <print>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * Compares per-row interpretation against batch evaluation of the same formulas.
+ */
+int main() {
+    constexpr std::size_t ROWS = 1 << 20;
+
+    const std::string formulas[] = {
+        "x * 2 + y",
+        "(x - y) * (x + y) / 3",
+        "x > y",
+        "!(x * 2 <= y) == (y != 0)",
+    };
+
+    std::vector<double> xs(ROWS);
+    std::vector<double> ys(ROWS);
+    for (std::size_t i = 0; i < ROWS; i++) {
+        xs[i] = static_cast<double>(i % 1000);
+        ys[i] = static_cast<double>((i * 7) % 1000);
+    }
+    const std::span<const double> columns[] = {xs, ys};
+
+    Diagnostics diagnostics;
+    StringSink output;
+
+    for (const auto& formula : formulas) {
+        Scanner scanner(formula, diagnostics);
+        auto tokens = scanner.scanTokens();
+        Parser parser(tokens, diagnostics);
+        auto expr = parser.parse();
+        if (!expr) {
+            return 65;
+        }
+
+        std::println("{}", formula);
+
+        Interpreter interpreter(diagnostics, output);
+        double perRow = bench::run("  per-row Interpreter::eval", ROWS, [&] {
+            for (std::size_t i = 0; i < ROWS; i++) {
+                interpreter.define("x", xs[i]);
+                interpreter.define("y", ys[i]);
+                bench::keep(interpreter.eval(*expr));
+            }
+        });
+
+        BatchProgram program(*expr, {"x", "y"});
+        double batch = bench::run("  BatchProgram::run", ROWS, [&] { bench::keep(program.run(columns, ROWS)); });
+
+        std::println("  speedup {:.1f}x", batch / perRow);
+    }
+
+    return 0;
+}
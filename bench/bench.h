@@ -0,0 +1,210 @@
+#pragma once
+
+#include "allocator.h"
+#include "perf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+
+// Route every allocation through MemoryScope, so the harness can count them.
+// Each benchmark is a single translation unit including this header once.
+void* operator new(std::size_t size) {
+    return MemoryScope::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return MemoryScope::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+    try {
+        return MemoryScope::allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+    try {
+        return MemoryScope::allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* block) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete[](void* block) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete(void* block, std::size_t /*size*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete[](void* block, std::size_t /*size*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete(void* block, const std::nothrow_t& /*tag*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t& /*tag*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+/**
+ * Minimal benchmark harness shared by the executables in bench/.
+ */
+namespace bench {
+
+/**
+ * Number of timed repetitions per case; the fastest is reported.
+ */
+constexpr int REPETITIONS = 5;
+
+/**
+ * Prevent the compiler from optimizing away a computed value.
+ *
+ * @param value The value to keep.
+ */
+template <typename T> void keep(const T& value) {
+#if defined(_MSC_VER)
+    static const volatile void* sink;
+    sink = &value;
+#else
+    asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+/**
+ * Allocator taking memory straight from malloc, bypassing the counting operator new above, for baselines that
+ * must not pay its header and thread-local lookup per allocation. Its allocations are not counted.
+ */
+template <typename T> struct Unhooked {
+    using value_type = T;
+
+    Unhooked() noexcept = default;
+
+    /**
+     * Constructs an allocator for another type, as containers do for their nodes.
+     */
+    template <typename U> Unhooked(const Unhooked<U>& /*other*/) noexcept {}
+
+    /**
+     * Allocate memory for objects.
+     *
+     * @param count Number of objects.
+     * @return The memory.
+     * @throws std::bad_alloc if malloc fails.
+     */
+    [[nodiscard]] T* allocate(std::size_t count) {
+        if (auto* block = std::malloc(count * sizeof(T))) {
+            return static_cast<T*>(block);
+        }
+        throw std::bad_alloc();
+    }
+
+    /**
+     * Free memory returned by allocate.
+     *
+     * @param block The memory.
+     */
+    void deallocate(T* block, std::size_t /*count*/) noexcept {
+        std::free(block);
+    }
+
+    /**
+     * Allocators are stateless, so any can free what another allocated.
+     */
+    template <typename U> bool operator==(const Unhooked<U>& /*other*/) const noexcept {
+        return true;
+    }
+};
+
+/**
+ * Format a count per item, or n/a if it was not counted.
+ *
+ * @param count The count.
+ * @param items Number of items.
+ * @return The formatted ratio.
+ */
+inline std::string perItem(std::optional<std::uint64_t> count, std::size_t items) {
+    if (!count) {
+        return "n/a";
+    }
+
+    return std::format("{:.3f}", static_cast<double>(*count) / static_cast<double>(items));
+}
+
+/**
+ * Time a case and print its throughput, then the hardware events and allocations of its fastest repetition
+ * per item: IPC, cycles, instructions, branch misses, L1D and LLC misses, allocations and bytes allocated.
+ *
+ * @param name Name of the case.
+ * @param items Number of items processed per call of fn.
+ * @param fn The code to time.
+ * @param unit Name of an item, e.g. token or node.
+ * @return The best throughput in items per second.
+ */
+template <typename Fn> double run(std::string_view name, std::size_t items, Fn&& fn, std::string_view unit = "item") {
+    using Clock = std::chrono::steady_clock;
+
+    // Warm-up, so lazy initialization and tiering are not measured.
+    fn();
+
+    PerfCounters perf;
+
+    double best = 0;
+    EventCounts events;
+    MemoryCounters memory;
+    for (int i = 0; i < REPETITIONS; i++) {
+        MemoryCounters counters;
+        MemoryScope scope(nullptr, &counters);
+
+        perf.start();
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        auto counts = perf.stop();
+
+        double throughput = static_cast<double>(items) / elapsed.count();
+        if (throughput > best) {
+            best = throughput;
+            events = counts;
+            memory = counters;
+        }
+    }
+
+    std::println("{:<40} {:>14.0f} {}s/s", name, best, unit);
+
+    const auto& cycles = events[static_cast<std::size_t>(Event::CYCLES)];
+    const auto& instructions = events[static_cast<std::size_t>(Event::INSTRUCTIONS)];
+    std::string ipc = cycles && instructions && *cycles > 0
+                          ? std::format("{:.2f}", static_cast<double>(*instructions) / static_cast<double>(*cycles))
+                          : "n/a";
+
+    std::println("    per {}: IPC {}, cycles {}, instructions {}, branch misses {}, L1D misses {}, LLC misses {}, "
+                 "allocations {}, bytes {}",
+                 unit, ipc, perItem(cycles, items), perItem(instructions, items),
+                 perItem(events[static_cast<std::size_t>(Event::BRANCH_MISSES)], items),
+                 perItem(events[static_cast<std::size_t>(Event::L1D_MISSES)], items),
+                 perItem(events[static_cast<std::size_t>(Event::LLC_MISSES)], items),
+                 perItem(memory.allocations, items), perItem(memory.bytes, items));
+
+    return best;
+}
+
+} // namespace bench
@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+
+namespace {
+
+/**
+ * Number of calls made by the naive recursive fib(n), 2 * fib(n + 1) - 1.
+ *
+ * @param n The argument.
+ * @return The number of calls.
+ */
+std::size_t fibCalls(int n) {
+    std::size_t a = 0;
+    std::size_t b = 1;
+    for (int i = 0; i <= n; i++) {
+        b = a + b;
+        a = b - a;
+    }
+
+    return 2 * a - 1;
+}
+
+} // namespace
+
+/**
+ * Times the recursive fib(30), made of about 2.7 million calls, on the tree walker and on the closure tier.
+ * Frames live on the preallocated value stack, so the allocations per call must stay at 0.
+ * Pass the time in seconds clox takes for the same script on this machine, e.g. `bench_calls 0.25`,
+ * to print how far behind it each tier is.
+ */
+int main(int argc, char* argv[]) {
+    constexpr int N = 30;
+
+    const auto src = std::format("fun fib(n) {{ if (n < 2) return n; return fib(n - 1) + fib(n - 2); }}\n"
+                                 "print fib({});\n",
+                                 N);
+    const auto calls = fibCalls(N);
+    const double clox = argc > 1 ? std::strtod(argv[1], nullptr) : 0;
+
+    std::ostringstream errors;
+    Diagnostics diagnostics(errors);
+    Parser parser(Scanner(src, diagnostics).scanTokens(), diagnostics);
+    std::shared_ptr<Program> program = parser.parseProgram();
+    if (program) {
+        Resolver(diagnostics).resolve(*program);
+    }
+    if (!program || diagnostics.hadError()) {
+        std::print("{}", errors.str());
+        return 65;
+    }
+
+    std::println("fib({}) ({} calls)", N, calls);
+
+    for (bool tiering : {false, true}) {
+        StringSink output;
+        Interpreter interpreter(diagnostics, output);
+        interpreter.setTierThreshold(tiering ? Interpreter::DEFAULT_TIER_THRESHOLD : 0);
+
+        auto label = tiering ? "  closure tier" : "  tree walker";
+        auto rate = bench::run(label, calls, [&] { interpreter.interpret(program); }, "call");
+
+        auto text = output.take();
+        if (diagnostics.hadRuntimeError() || text.substr(0, text.find('\n')) != "832040") {
+            std::println("  wrong result: {}{}", text.substr(0, text.find('\n')), errors.str());
+            return 70;
+        }
+
+        auto seconds = static_cast<double>(calls) / rate;
+        if (clox > 0) {
+            std::println("  {:.3f} s, {:.2f}x the time of clox", seconds, seconds / clox);
+        } else {
+            std::println("  {:.3f} s", seconds);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/**
+ * An object-heavy program and what it must print.
+ */
+struct Case {
+    /**
+     * Name of the case.
+     */
+    std::string_view name;
+
+    /**
+     * Source code of the program.
+     */
+    std::string src;
+
+    /**
+     * Number of items the program processes.
+     */
+    std::size_t items;
+
+    /**
+     * Unit of the items.
+     */
+    std::string_view unit;
+
+    /**
+     * First line the program must print.
+     */
+    std::string expected;
+};
+
+/**
+ * Time a program on the tree walker and on the closure tier.
+ *
+ * @param test The program.
+ * @return 0 if both runs printed the expected result, otherwise the exit code of the failure.
+ */
+int measure(const Case& test) {
+    std::ostringstream errors;
+    Diagnostics diagnostics(errors);
+    Parser parser(Scanner(test.src, diagnostics).scanTokens(), diagnostics);
+    std::shared_ptr<Program> program = parser.parseProgram();
+    if (program) {
+        Resolver(diagnostics).resolve(*program);
+    }
+    if (!program || diagnostics.hadError()) {
+        std::print("{}", errors.str());
+        return 65;
+    }
+
+    std::println("{} ({} {}s)", test.name, test.items, test.unit);
+
+    for (bool tiering : {false, true}) {
+        StringSink output;
+        Interpreter interpreter(diagnostics, output);
+        interpreter.setTierThreshold(tiering ? Interpreter::DEFAULT_TIER_THRESHOLD : 0);
+
+        auto label = tiering ? "  closure tier" : "  tree walker";
+        (void)bench::run(label, test.items, [&] { interpreter.interpret(program); }, test.unit);
+
+        auto text = output.take();
+        if (diagnostics.hadRuntimeError() || text.substr(0, text.find('\n')) != test.expected) {
+            std::println("  wrong result: {}{}", text.substr(0, text.find('\n')), errors.str());
+            return 70;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+/**
+ * Times the "zoo" and "instantiation" programs of Crafting Interpreters on the tree walker and on the closure tier.
+ * Field reads, method calls and initializer calls hit the inline caches of their sites, so no name is hashed
+ * per access, and the only allocation per instantiation is the instance itself.
+ */
+int main() {
+    constexpr std::size_t ROUNDS = 100000;
+    constexpr std::size_t INSTANCES = 500000;
+
+    const Case zoo{
+        .name = "zoo",
+        .src = std::format("class Zoo {{\n"
+                           "  init() {{\n"
+                           "    this.aardvark = 1; this.baboon = 1; this.cat = 1;\n"
+                           "    this.donkey = 1; this.elephant = 1; this.fox = 1;\n"
+                           "  }}\n"
+                           "  ant() {{ return this.aardvark; }}\n"
+                           "  banana() {{ return this.baboon; }}\n"
+                           "  tuna() {{ return this.cat; }}\n"
+                           "  hay() {{ return this.donkey; }}\n"
+                           "  grass() {{ return this.elephant; }}\n"
+                           "  mouse() {{ return this.fox; }}\n"
+                           "}}\n"
+                           "var zoo = Zoo();\n"
+                           "var sum = 0;\n"
+                           "while (sum < {}) {{\n"
+                           "  sum = sum + zoo.ant() + zoo.banana() + zoo.tuna()\n"
+                           "    + zoo.hay() + zoo.grass() + zoo.mouse();\n"
+                           "}}\n"
+                           "print sum;\n",
+                           6 * ROUNDS),
+        .items = 6 * ROUNDS,
+        .unit = "method call",
+        .expected = std::format("{}", 6 * ROUNDS),
+    };
+
+    const Case instantiation{
+        .name = "instantiation",
+        .src = std::format("class Foo {{ init() {{}} }}\n"
+                           "var i = 0;\n"
+                           "while (i < {}) {{\n"
+                           "  Foo(); Foo(); Foo(); Foo(); Foo();\n"
+                           "  i = i + 5;\n"
+                           "}}\n"
+                           "print i;\n",
+                           INSTANCES),
+        .items = INSTANCES,
+        .unit = "instance",
+        .expected = std::format("{}", INSTANCES),
+    };
+
+    for (const auto* test : {&zoo, &instantiation}) {
+        if (int code = measure(*test); code != 0) {
+            return code;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <memory>
+#include <print>
+#include <string>
+
+namespace {
+
+/**
+ * Build a left-leaning sum of the given number of terms, as deep as it is long.
+ *
+ * @param terms Number of terms.
+ * @return The source code.
+ */
+std::string chain(std::size_t terms) {
+    std::string src = "x";
+    for (std::size_t i = 1; i < terms; i++) {
+        src += i % 2 == 0 ? " + x" : " - -1";
+    }
+
+    return src;
+}
+
+} // namespace
+
+/**
+ * Compares the explicit-stack evaluator against plain recursion, from typical to very deep trees.
+ */
+int main() {
+    struct Case {
+        std::string name;
+        std::string src;
+        std::size_t evaluations;
+        bool recursive;
+    };
+
+    const Case cases[] = {
+        {"formula", "(x * 2 + 1) / (x - 0.5) > 3 == !(x < 10)", 1 << 20, true},
+        {"chain of 200", chain(200), 1 << 12, true},
+        {"chain of 5000", chain(5000), 1 << 8, true},
+        // Recursion overflows the native stack long before this depth.
+        {"chain of 500000", chain(500000), 4, false},
+    };
+
+    Diagnostics diagnostics;
+    StringSink output;
+
+    for (const auto& c : cases) {
+        Scanner scanner(c.src, diagnostics);
+        Parser parser(scanner.scanTokens(), diagnostics);
+        std::shared_ptr<const Expr> expr = parser.parse();
+        if (!expr) {
+            return 65;
+        }
+
+        std::println("{} (height {})", c.name, expr->height());
+
+        for (bool explicitStack : {false, true}) {
+            if (!explicitStack && !c.recursive) {
+                continue;
+            }
+
+            Interpreter interpreter(diagnostics, output);
+            interpreter.setTierThreshold(0);
+            interpreter.setExplicitStack(explicitStack);
+            interpreter.define("x", 3.0);
+
+            bench::run(explicitStack ? "  explicit stack" : "  recursion", c.evaluations, [&] {
+                for (std::size_t i = 0; i < c.evaluations; i++) {
+                    bench::keep(interpreter.eval(*expr));
+                }
+            });
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/**
+ * Stress test for concurrent engines: N threads, each with its own diagnostics and interpreter,
+ * evaluate one shared program. Throughput should scale close to linearly with the thread count.
+ */
+int main() {
+    constexpr std::size_t EVALUATIONS = 1 << 18;
+
+    std::ostringstream errors;
+    Diagnostics diagnostics(errors);
+    Scanner scanner("(x * 2 + 1) / (x - 0.5) > 3 == !(x < 10)", diagnostics);
+    Parser parser(scanner.scanTokens(), diagnostics);
+    std::shared_ptr<const Expr> program = parser.parse();
+    if (!program) {
+        return 65;
+    }
+
+    auto hardware = std::max(1U, std::thread::hardware_concurrency());
+    double single = 0;
+
+    for (unsigned threads = 1; threads <= hardware; threads *= 2) {
+        auto name = std::format("{} engine(s)", threads);
+        double rate = bench::run(name, EVALUATIONS * threads, [&] {
+            std::vector<std::jthread> workers;
+            for (unsigned t = 0; t < threads; t++) {
+                workers.emplace_back([&program] {
+                    std::ostringstream engineErrors;
+                    Diagnostics engineDiagnostics(engineErrors);
+                    StringSink engineOutput;
+                    Interpreter interpreter(engineDiagnostics, engineOutput);
+                    for (std::size_t i = 0; i < EVALUATIONS; i++) {
+                        interpreter.define("x", static_cast<double>(i % 100));
+                        bench::keep(interpreter.eval(*program));
+                    }
+                });
+            }
+        });
+
+        if (threads == 1) {
+            single = rate;
+        }
+        std::println("  scaling {:.2f}x of {}", rate / single, threads);
+    }
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "bench.h"
+
+#include "heap.h"
+#include "map.h"
+#include "text.h"
+
+#include <algorithm>
+#include <any>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <numeric>
+#include <print>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/**
+ * Number of keys of the cases with number keys.
+ */
+constexpr std::size_t NUMBER_KEYS = 10'000'000;
+
+/**
+ * Number of keys of the cases with string keys.
+ */
+constexpr std::size_t STRING_KEYS = 1'000'000;
+
+/**
+ * The reference map of number keys. Its nodes come from malloc rather than the harness's counting operator new,
+ * which would add a header and a thread-local lookup to each of its 10 million node allocations while Map mostly
+ * grows one vector.
+ */
+using NumberReference = std::unordered_map<double, double, std::hash<double>, std::equal_to<double>,
+                                           bench::Unhooked<std::pair<const double, double>>>;
+
+/**
+ * The reference map of string keys, its nodes from malloc as for NumberReference. The keys are short enough for
+ * std::string to hold them inline.
+ */
+using StringReference = std::unordered_map<std::string, double, std::hash<std::string>, std::equal_to<std::string>,
+                                           bench::Unhooked<std::pair<const std::string, double>>>;
+
+/**
+ * Seed of the order of the lookups, fixed so runs are comparable.
+ */
+constexpr unsigned SEED = 42;
+
+/**
+ * Shuffle keys, so lookups go all over the table instead of following the insertion order.
+ *
+ * @param keys The keys.
+ * @return The keys in a random order.
+ */
+template <typename T> std::vector<T> shuffled(std::vector<T> keys) {
+    std::mt19937 engine(SEED);
+    std::ranges::shuffle(keys, engine);
+
+    return keys;
+}
+
+/**
+ * Time one case on a Map and on a std::unordered_map, and print the speedup.
+ *
+ * @param name Name of the case.
+ * @param items Number of keys the case goes over.
+ * @param map The case on a Map, returning its checksum.
+ * @param reference The case on a std::unordered_map, returning its checksum.
+ * @return True if both returned the same checksum.
+ */
+template <typename MapCase, typename ReferenceCase>
+bool compare(std::string_view name, std::size_t items, MapCase&& map, ReferenceCase&& reference) {
+    std::println("{} ({} keys)", name, items);
+
+    double checksum = 0;
+    double expected = 0;
+    auto rate = bench::run("  Map", items, [&] { checksum = map(); }, "key");
+    auto baseline = bench::run("  std::unordered_map", items, [&] { expected = reference(); }, "key");
+    std::println("  speedup {:.2f}x", rate / baseline);
+
+    if (checksum != expected) {
+        std::println("  checksums differ: {} and {}", checksum, expected);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Time maps from the integers below NUMBER_KEYS to themselves: inserting the keys in order, looking them all up
+ * in a random order, looking up as many absent keys, and iterating.
+ *
+ * @return 0 if both maps agree, otherwise 70.
+ */
+int numbers() {
+    std::vector<double> keys(NUMBER_KEYS);
+    std::iota(keys.begin(), keys.end(), 0.0);
+    const auto hits = shuffled(keys);
+    std::vector<double> misses(hits.size());
+    std::ranges::transform(hits, misses.begin(), [](double key) { return key + 0.5; });
+
+    Heap heap;
+    auto ok = compare(
+        "insert number keys", NUMBER_KEYS,
+        [&] {
+            Map map;
+            for (auto key : keys) {
+                map.set(heap, key, key);
+            }
+            return static_cast<double>(map.length());
+        },
+        [&] {
+            NumberReference map;
+            for (auto key : keys) {
+                map.emplace(key, key);
+            }
+            return static_cast<double>(map.size());
+        });
+
+    Map map;
+    NumberReference reference;
+    for (auto key : keys) {
+        map.set(heap, key, key);
+        reference.emplace(key, key);
+    }
+
+    ok &= compare(
+        "look up number keys", NUMBER_KEYS,
+        [&] {
+            double sum = 0;
+            for (auto key : hits) {
+                sum += std::any_cast<double>(*map.get(key));
+            }
+            return sum;
+        },
+        [&] {
+            double sum = 0;
+            for (auto key : hits) {
+                sum += reference.find(key)->second;
+            }
+            return sum;
+        });
+
+    ok &= compare(
+        "look up absent number keys", NUMBER_KEYS,
+        [&] {
+            double found = 0;
+            for (auto key : misses) {
+                found += map.get(key) != nullptr ? 1 : 0;
+            }
+            return found;
+        },
+        [&] {
+            double found = 0;
+            for (auto key : misses) {
+                found += reference.contains(key) ? 1 : 0;
+            }
+            return found;
+        });
+
+    ok &= compare(
+        "iterate number keys", NUMBER_KEYS,
+        [&] {
+            double sum = 0;
+            map.forEach([&](const std::any& /*key*/, const std::any& value) { sum += std::any_cast<double>(value); });
+            return sum;
+        },
+        [&] {
+            double sum = 0;
+            for (const auto& [key, value] : reference) {
+                sum += value;
+            }
+            return sum;
+        });
+
+    return ok ? 0 : 70;
+}
+
+/**
+ * Time looking up string keys, each given as another string object holding the same characters, as a script
+ * building its keys at run time would. The objects cache their hash on the first lookup, which the warm-up run
+ * makes, while std::hash goes over the characters of every key std::unordered_map looks up.
+ *
+ * @return 0 if both maps agree, otherwise 70.
+ */
+int strings() {
+    Heap heap;
+    Map map;
+    StringReference reference;
+    std::vector<String*> keys;
+    for (std::size_t i = 0; i < STRING_KEYS; i++) {
+        auto name = std::format("key-{}", i);
+        map.set(heap, heap.make<String>(name), static_cast<double>(i));
+        reference.emplace(name, static_cast<double>(i));
+        keys.push_back(heap.make<String>(std::move(name)));
+    }
+
+    keys = shuffled(std::move(keys));
+
+    auto ok = compare(
+        "look up string keys", STRING_KEYS,
+        [&] {
+            double sum = 0;
+            for (auto* key : keys) {
+                sum += std::any_cast<double>(*map.get(key));
+            }
+            return sum;
+        },
+        [&] {
+            double sum = 0;
+            for (const auto* key : keys) {
+                sum += reference.find(key->value())->second;
+            }
+            return sum;
+        });
+
+    return ok ? 0 : 70;
+}
+
+} // namespace
+
+/**
+ * Compares the map of the scripts against std::unordered_map, at 10 million number keys and a million string
+ * keys. Both hash tables grow from empty as the keys are inserted; Map probes 16 control bytes at once and
+ * keeps its entries in one vector, where std::unordered_map chases a pointer to a node per key.
+ */
+int main() {
+    if (int code = numbers(); code != 0) {
+        return code;
+    }
+
+    return strings();
+}
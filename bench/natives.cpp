@@ -0,0 +1,107 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "native.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/**
+ * Number of calls made by each case.
+ */
+constexpr std::size_t CALLS = 500000;
+
+/**
+ * The native function called by the benchmark.
+ *
+ * @param x The value.
+ * @param lo The lower bound.
+ * @param hi The upper bound.
+ * @return x clamped to [lo, hi].
+ */
+double clamp(double x, double lo, double hi) {
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+/**
+ * Time a loop calling clamp, defined natively or in Tox, on the tree walker and on the closure tier.
+ *
+ * @param name Name of the case.
+ * @param prelude Tox code defining clamp, empty to bind the native one.
+ * @return 0 if every run printed the expected sum, otherwise the exit code of the failure.
+ */
+int measure(std::string_view name, std::string_view prelude) {
+    const auto src = std::format("{}"
+                                 "var sum = 0;\n"
+                                 "for (var i = 0; i < {}; i = i + 1) {{\n"
+                                 "  sum = sum + clamp(i, 0, 1);\n"
+                                 "}}\n"
+                                 "print sum;\n",
+                                 prelude, CALLS);
+
+    std::ostringstream errors;
+    Diagnostics diagnostics(errors);
+    Parser parser(Scanner(src, diagnostics).scanTokens(), diagnostics);
+    std::shared_ptr<Program> program = parser.parseProgram();
+    if (program) {
+        Resolver(diagnostics).resolve(*program);
+    }
+    if (!program || diagnostics.hadError()) {
+        std::print("{}", errors.str());
+        return 65;
+    }
+
+    std::println("{} ({} calls)", name, CALLS);
+
+    const auto expected = std::format("{}", CALLS - 1);
+    for (bool tiering : {false, true}) {
+        StringSink output;
+        Interpreter interpreter(diagnostics, output);
+        interpreter.setTierThreshold(tiering ? Interpreter::DEFAULT_TIER_THRESHOLD : 0);
+        if (prelude.empty()) {
+            interpreter.defineNative(NativeFunction::bind("clamp", &clamp));
+        }
+
+        auto label = tiering ? "  closure tier" : "  tree walker";
+        (void)bench::run(label, CALLS, [&] { interpreter.interpret(program); }, "call");
+
+        auto text = output.take();
+        if (diagnostics.hadRuntimeError() || text.substr(0, text.find('\n')) != expected) {
+            std::println("  wrong result: {}{}", text.substr(0, text.find('\n')), errors.str());
+            return 70;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+/**
+ * Times a loop calling `clamp(i, 0, 1)`, bound from C++ with NativeFunction::bind, against the same loop calling
+ * clamp written in Tox. The thunk of the native function reads its three numbers straight from the value stack
+ * and needs no frame, so a native call must cost less than a Tox one and allocate nothing.
+ */
+int main() {
+    constexpr std::string_view TOX_CLAMP = "fun clamp(x, lo, hi) {\n"
+                                           "  if (x < lo) return lo;\n"
+                                           "  if (x > hi) return hi;\n"
+                                           "  return x;\n"
+                                           "}\n";
+
+    if (int code = measure("native clamp", ""); code != 0) {
+        return code;
+    }
+
+    return measure("Tox clamp", TOX_CLAMP);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+/**
+ * Hardware events counted around each benchmark repetition.
+ */
+enum class Event : std::uint8_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+};
+
+/**
+ * Number of hardware events.
+ */
+constexpr std::size_t EVENT_COUNT = 5;
+
+/**
+ * Counts of each hardware event, empty for events the machine or kernel does not expose.
+ */
+using EventCounts = std::array<std::optional<std::uint64_t>, EVENT_COUNT>;
+
+/**
+ * User-space hardware counters of the calling thread, read with Linux perf_event_open.
+ * Events that cannot be opened, e.g. in containers, on virtual machines or with a strict perf_event_paranoid,
+ * are left out, so the harness degrades to timing alone.
+ */
+class PerfCounters {
+private:
+    /**
+     * File descriptor of each event, -1 if unavailable.
+     */
+    std::array<int, EVENT_COUNT> m_fds{};
+
+public:
+    /**
+     * Opens every available event, disabled.
+     */
+    PerfCounters() {
+        m_fds.fill(-1);
+
+#if defined(__linux__)
+        constexpr auto cache = [](std::uint64_t id, std::uint64_t result) {
+            return id | (PERF_COUNT_HW_CACHE_OP_READ << 8U) | (result << 16U);
+        };
+
+        const std::array<std::pair<std::uint32_t, std::uint64_t>, EVENT_COUNT> events = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        }};
+
+        for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            m_fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    /**
+     * Closes the events.
+     */
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * Check whether any event could be opened.
+     *
+     * @return True if at least one event is counted.
+     */
+    [[nodiscard]] bool available() const noexcept {
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Reset and start every event.
+     */
+    void start() noexcept {
+#if defined(__linux__)
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /**
+     * Stop every event and read its count.
+     *
+     * @return The counts since start.
+     */
+    [[nodiscard]] EventCounts stop() noexcept {
+        EventCounts counts;
+
+#if defined(__linux__)
+        for (std::size_t i = 0; i < EVENT_COUNT; i++) {
+            if (m_fds[i] < 0) {
+                continue;
+            }
+
+            ioctl(m_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+            std::uint64_t count = 0;
+            if (read(m_fds[i], &count, sizeof(count)) == sizeof(count)) {
+                counts[i] = count;
+            }
+        }
+#endif
+
+        return counts;
+    }
+};
+
+} // namespace bench
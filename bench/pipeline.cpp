@@ -0,0 +1,65 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <memory>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * Build a balanced sum of formulas, so the tree stays shallow however many terms it has.
+ *
+ * @param terms Number of formulas.
+ * @return The source code.
+ */
+std::string balanced(std::size_t terms) {
+    if (terms == 1) {
+        return "(x * 2 + 1) / (y - 0.5) - -x";
+    }
+
+    return "(" + balanced(terms / 2) + " + " + balanced(terms - terms / 2) + ")";
+}
+
+} // namespace
+
+/**
+ * Measures the scanner per token, the parser per node and the tree walker per node, with hardware counters
+ * where the machine exposes them.
+ */
+int main() {
+    constexpr std::size_t TERMS = 1 << 14;
+
+    Diagnostics diagnostics;
+    StringSink output;
+
+    auto src = balanced(TERMS);
+    auto tokens = Scanner(src, diagnostics).scanTokens();
+
+    Parser parser(tokens, diagnostics);
+    std::shared_ptr<const Expr> expr = parser.parse();
+    if (!expr) {
+        return 65;
+    }
+
+    auto nodes = parser.nodes();
+    std::println("{} bytes, {} tokens, {} nodes (height {})", src.size(), tokens.size(), nodes, expr->height());
+
+    bench::run("scan", tokens.size(), [&] { bench::keep(Scanner(src, diagnostics).scanTokens()); }, "token");
+
+    bench::run("parse", nodes, [&] { bench::keep(Parser(tokens, diagnostics).parse()); }, "node");
+
+    Interpreter interpreter(diagnostics, output);
+    interpreter.setTierThreshold(0);
+    interpreter.define("x", 3.0);
+    interpreter.define("y", 2.0);
+
+    bench::run("eval", nodes, [&] { bench::keep(interpreter.eval(*expr)); }, "node");
+
+    return 0;
+}
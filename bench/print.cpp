@@ -0,0 +1,113 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "sink.h"
+
+#include <any>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <format>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * Read back everything written to a temporary file.
+ *
+ * @param file The file.
+ * @return The file contents.
+ */
+std::string contents(std::FILE* file) {
+    std::fflush(file);
+    std::rewind(file);
+
+    std::string text;
+    char buffer[4096];
+    std::size_t n = 0;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+
+    return text;
+}
+
+/**
+ * Convert a value to text through std::format, as results were printed before the sink.
+ *
+ * @param value The value to convert.
+ * @return The text.
+ */
+std::string reference(const std::any& value) {
+    if (const auto* number = std::any_cast<double>(&value)) {
+        return std::format("{:g}", *number);
+    }
+
+    return Interpreter::stringify(value);
+}
+
+} // namespace
+
+/**
+ * Compares printing results with std::format and std::println against the buffered sink,
+ * and checks both print the same bytes.
+ */
+int main() {
+    constexpr std::size_t VALUES = 1 << 20;
+
+    std::vector<std::any> values;
+    values.reserve(VALUES);
+    for (std::size_t i = 0; i < VALUES; i++) {
+        switch (i % 4) {
+        case 0:
+            values.emplace_back(static_cast<double>(i) / 7.0);
+            break;
+        case 1:
+            values.emplace_back(std::ldexp(static_cast<double>(i), static_cast<int>(i % 200) - 100));
+            break;
+        case 2:
+            values.emplace_back(i % 3 == 0);
+            break;
+        default:
+            values.emplace_back(-static_cast<double>(i));
+            break;
+        }
+    }
+    values.emplace_back(HUGE_VAL);
+    values.emplace_back(-HUGE_VAL);
+    values.emplace_back(std::nan(""));
+    values.emplace_back(0.0);
+    values.emplace_back(-0.0);
+
+    std::FILE* expected = std::tmpfile();
+    std::FILE* actual = std::tmpfile();
+    if (expected == nullptr || actual == nullptr) {
+        return 1;
+    }
+
+    bench::run("std::println(std::format)", values.size(), [&] {
+        std::rewind(expected);
+        for (const auto& value : values) {
+            std::println(expected, "{}", reference(value));
+        }
+    });
+
+    bench::run("FileSink", values.size(), [&] {
+        std::rewind(actual);
+        FileSink sink(actual);
+        for (const auto& value : values) {
+            Interpreter::write(sink, value);
+            sink.put('\n');
+        }
+    });
+
+    if (contents(expected) != contents(actual)) {
+        std::println(stderr, "output differs");
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+/**
+ * Number of characters of the string each case builds.
+ */
+constexpr std::size_t LENGTH = 10'000'000;
+
+/**
+ * Time a script appending a chunk to a string until it holds 10 MB, then printing it, which flattens the rope.
+ *
+ * @param size Number of characters appended per iteration, a multiple of 10 dividing LENGTH.
+ * @return 0 if every run printed the whole string, otherwise the exit code of the failure.
+ */
+int measure(std::size_t size) {
+    std::string chunk;
+    while (chunk.size() < size) {
+        chunk += "0123456789";
+    }
+
+    const auto appends = LENGTH / size;
+    const auto src = std::format("var s = \"\";\n"
+                                 "for (var i = 0; i < {}; i = i + 1) {{\n"
+                                 "  s = s + \"{}\";\n"
+                                 "}}\n"
+                                 "print s;\n",
+                                 appends, chunk);
+
+    std::ostringstream errors;
+    Diagnostics diagnostics(errors);
+    Parser parser(Scanner(src, diagnostics).scanTokens(), diagnostics);
+    std::shared_ptr<Program> program = parser.parseProgram();
+    if (program) {
+        Resolver(diagnostics).resolve(*program);
+    }
+    if (!program || diagnostics.hadError()) {
+        std::print("{}", errors.str());
+        return 65;
+    }
+
+    std::println("{}-byte appends ({} appends)", size, appends);
+
+    for (bool tiering : {false, true}) {
+        StringSink output;
+        Interpreter interpreter(diagnostics, output);
+        interpreter.setTierThreshold(tiering ? Interpreter::DEFAULT_TIER_THRESHOLD : 0);
+
+        auto label = tiering ? "  closure tier" : "  tree walker";
+        (void)bench::run(label, appends, [&] { interpreter.interpret(program); }, "append");
+
+        auto text = output.take();
+        auto line = std::string_view(text).substr(0, text.find('\n'));
+        if (diagnostics.hadRuntimeError() || line.size() != LENGTH || !line.starts_with(chunk)) {
+            std::println("  wrong result: {} characters{}", line.size(), errors.str());
+            return 70;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+/**
+ * Times scripts building a 10 MB string by appending in a loop, on the tree walker and on the closure tier.
+ * Concatenation makes a rope node instead of copying what was built so far, so the time per append stays flat
+ * as the string grows, and the single copy happens when the string is printed.
+ */
+int main() {
+    for (std::size_t size : {10, 100}) {
+        if (int code = measure(size); code != 0) {
+            return code;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "bench.h"
+
+#include "sink.h"
+#include "tox.h"
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+/**
+ * Number of tasks the spawn cases spawn.
+ */
+constexpr std::size_t TASKS = 20'000;
+
+/**
+ * Number of round trips of the ping-pong case.
+ */
+constexpr std::size_t ROUND_TRIPS = 100'000;
+
+/**
+ * Number of tasks of the fan-out case, each computing fib(FIB).
+ */
+constexpr std::size_t WORKERS = 8;
+
+/**
+ * Argument of fib in the fan-out case.
+ */
+constexpr int FIB = 24;
+
+/**
+ * Format a number as a script prints it.
+ *
+ * @param value The number.
+ * @return The text.
+ */
+std::string number(double value) {
+    char buffer[OutputSink::NUMBER_SIZE];
+    return {buffer, OutputSink::formatNumber(buffer, value)};
+}
+
+/**
+ * Time a script, with tasks on the pool and in deterministic mode.
+ *
+ * @param name Name of the case.
+ * @param items Number of items the script processes.
+ * @param src The script.
+ * @param expected Its expected output.
+ * @param unit Name of an item.
+ * @return 0 if every run printed the expected output, otherwise the exit code of the failure.
+ */
+int measure(std::string_view name, std::size_t items, const std::string& src, std::string_view expected,
+            std::string_view unit) {
+    std::println("{}", name);
+
+    for (bool deterministic : {false, true}) {
+        StringSink output;
+        std::ostringstream errors;
+        Tox tox(output, errors);
+        tox.setDeterministic(deterministic);
+
+        auto program = tox.parse(src);
+        if (!program) {
+            std::print("{}", errors.str());
+            return 65;
+        }
+
+        auto label = deterministic ? std::string("  deterministic")
+                                   : std::format("  pool of {} workers", std::thread::hardware_concurrency());
+        auto rate = bench::run(label, items, [&] { tox.run(program); }, unit);
+        std::println("    {:.2f} us per {}", 1e6 / rate, unit);
+
+        output.flush();
+        auto text = output.take();
+        if (tox.diagnostics().hadRuntimeError() || text.substr(0, text.find('\n')) != expected) {
+            std::println("  wrong result: {}{}", text.substr(0, text.find('\n')), errors.str());
+            return 70;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+/**
+ * Times the tasks of a script: spawning tasks that do nothing, spawning tasks that each send one message, a
+ * ping-pong over two channels of capacity 1, and fanning fib out to tasks, with tasks on the work-stealing pool and
+ * in deterministic mode on the main thread. Each task has its own interpreter, heap and fiber stack, so spawning
+ * costs far more than a call; the empty tasks show that cost alone, and deterministic mode counts the allocations
+ * of the tasks too, since they run on the main thread. A round trip switches twice, through the pool or straight on
+ * the main thread. The fan-out scales with the cores, which deterministic mode leaves unused.
+ */
+int main() {
+    const auto idle = std::format("fun idle() {{}}\n"
+                                  "var spawned = 0;\n"
+                                  "for (var i = 0; i < {}; i = i + 1) {{ spawn idle(); spawned = spawned + 1; }}\n"
+                                  "print spawned;\n",
+                                  TASKS);
+    if (int code = measure("spawn", TASKS, idle, number(static_cast<double>(TASKS)), "task"); code != 0) {
+        return code;
+    }
+
+    const auto spawn = std::format("fun square(x, out) {{ send(out, x * x); }}\n"
+                                   "var out = channel(64);\n"
+                                   "for (var i = 0; i < {0}; i = i + 1) spawn square(i, out);\n"
+                                   "var total = 0;\n"
+                                   "for (var i = 0; i < {0}; i = i + 1) total = total + recv(out);\n"
+                                   "print total;\n",
+                                   TASKS);
+    const auto n = static_cast<double>(TASKS);
+    if (int code = measure("spawn and send", TASKS, spawn, number((n - 1) * n * (2 * n - 1) / 6), "task");
+        code != 0) {
+        return code;
+    }
+
+    const auto pingPong = std::format("fun pong(inbox, outbox) {{\n"
+                                      "  var v = recv(inbox);\n"
+                                      "  while (v != nil) {{ send(outbox, v + 1); v = recv(inbox); }}\n"
+                                      "}}\n"
+                                      "var a = channel(1);\n"
+                                      "var b = channel(1);\n"
+                                      "spawn pong(a, b);\n"
+                                      "var v = 0;\n"
+                                      "for (var i = 0; i < {0}; i = i + 1) {{ send(a, v); v = recv(b); }}\n"
+                                      "send(a, nil);\n"
+                                      "print v;\n",
+                                      ROUND_TRIPS);
+    if (int code =
+            measure("ping-pong", ROUND_TRIPS, pingPong, number(static_cast<double>(ROUND_TRIPS)), "round trip");
+        code != 0) {
+        return code;
+    }
+
+    const auto fanOut = std::format("fun fib(n) {{ if (n < 2) return n; return fib(n - 1) + fib(n - 2); }}\n"
+                                    "fun work(n, out) {{ send(out, fib(n)); }}\n"
+                                    "var out = channel({0});\n"
+                                    "for (var i = 0; i < {0}; i = i + 1) spawn work({1}, out);\n"
+                                    "var total = 0;\n"
+                                    "for (var i = 0; i < {0}; i = i + 1) total = total + recv(out);\n"
+                                    "print total;\n",
+                                    WORKERS, FIB);
+    return measure("fan-out of fib", WORKERS, fanOut, number(static_cast<double>(WORKERS) * 46368), "task");
+}
@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include "interpreter.h"
+#include "parser.h"
+#include "resolver.h"
+#include "scanner.h"
+
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace {
+
+/**
+ * Parse a script, optionally resolving its variables to slots.
+ *
+ * @param src The source code.
+ * @param diagnostics Context receiving syntax errors.
+ * @param resolve True to assign slots, false to leave every variable to the name-keyed global table.
+ * @return The program, or nullptr on error.
+ */
+std::shared_ptr<const Program> compile(const std::string& src, Diagnostics& diagnostics, bool resolve) {
+    Parser parser(Scanner(src, diagnostics).scanTokens(), diagnostics);
+    auto program = parser.parseProgram();
+    if (program && resolve) {
+        Resolver(diagnostics).resolve(*program);
+    }
+
+    if (diagnostics.hadError()) {
+        return nullptr;
+    }
+
+    return program;
+}
+
+} // namespace
+
+/**
+ * Compares variable access through resolver-assigned slots with lookups by name, on loops that read and write
+ * a few variables per iteration. Unresolved programs store every variable, block locals included, in the
+ * name-keyed global table, which is how all variables were stored before the resolver. Tiering is off, so
+ * both run on the tree walker.
+ */
+int main() {
+    constexpr std::size_t ITERATIONS = 100'000;
+
+    const auto loop = std::format("var a = 0; var b = 1; var i = 0;\n"
+                                  "while (i < {}) {{ var t = a + b; a = b; b = t - a * 0.5; i = i + 1; }}\n"
+                                  "print a + b;\n",
+                                  ITERATIONS);
+    const auto scripts = {
+        std::pair{"globals", loop},
+        std::pair{"locals", "{ " + loop + " }"},
+    };
+
+    for (const auto& [name, src] : scripts) {
+        std::println("{} ({} iterations)", name, ITERATIONS);
+
+        std::string expected;
+        double rates[2] = {};
+        for (bool resolve : {false, true}) {
+            std::ostringstream errors;
+            Diagnostics diagnostics(errors);
+            auto program = compile(src, diagnostics, resolve);
+            if (!program) {
+                std::print("{}", errors.str());
+                return 65;
+            }
+
+            StringSink output;
+            Interpreter interpreter(diagnostics, output);
+            interpreter.setTierThreshold(0);
+
+            auto label = resolve ? "  slots" : "  name map";
+            rates[resolve ? 1 : 0] =
+                bench::run(label, ITERATIONS, [&] { interpreter.interpret(program); }, "iteration");
+
+            // Every repetition prints the same line, which must match between both storages.
+            auto text = output.take();
+            auto line = text.substr(0, text.find('\n'));
+            if (diagnostics.hadRuntimeError() || line.empty() || (!expected.empty() && line != expected)) {
+                std::println("  outputs differ: {}", errors.str());
+                return 70;
+            }
+            expected = line;
+        }
+
+        std::println("  speedup {:.2f}x", rates[1] / rates[0]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+
+/**
+ * Allocation counters of one phase.
+ */
+struct MemoryCounters {
+    /**
+     * Number of allocations.
+     */
+    std::uint64_t allocations = 0;
+
+    /**
+     * Number of bytes allocated.
+     */
+    std::uint64_t bytes = 0;
+
+    /**
+     * Number of deallocations.
+     */
+    std::uint64_t deallocations = 0;
+
+    /**
+     * Number of bytes deallocated, including blocks allocated before the phase.
+     */
+    std::uint64_t freed = 0;
+
+    /**
+     * Highest number of bytes the phase held at once, net of its deallocations.
+     */
+    std::uint64_t peak = 0;
+};
+
+/**
+ * Allocation counters of each phase of running source code.
+ */
+struct MemoryStats {
+    /**
+     * Scanning source code into tokens.
+     */
+    MemoryCounters scan;
+
+    /**
+     * Parsing tokens into a tree.
+     */
+    MemoryCounters parse;
+
+    /**
+     * Evaluating the tree and printing the result.
+     */
+    MemoryCounters eval;
+
+    /**
+     * Write a table of the counters of each phase.
+     *
+     * @param stream The stream to write to.
+     */
+    void print(std::ostream& stream) const;
+};
+
+/**
+ * Routes the allocations of the calling thread to a memory resource and counts them, while the scope is alive.
+ * AST nodes always allocate through the innermost scope. Programs that replace the global operator new with
+ * allocate and deallocate, as the tox executable does, route every allocation, including tokens and values.
+ * Each block records the resource it came from, so it may be freed on any thread, inside or outside a scope; the
+ * resource is then called from that thread. Blocks cross threads whenever a script spawns tasks, since a message
+ * allocated on the thread running the script is freed by the task receiving it, so a resource used while tasks run
+ * must be thread-safe, as std::pmr::synchronized_pool_resource is and std::pmr::monotonic_buffer_resource is not.
+ *
+ * Routing costs every allocation a 16-byte header and a thread-local lookup, counted or not: the tox executable
+ * pays it whether or not --mem-stats is given.
+ */
+class MemoryScope {
+private:
+    /**
+     * Resource allocating blocks, nullptr for malloc.
+     */
+    std::pmr::memory_resource* m_resource;
+
+    /**
+     * Counters receiving the allocations, may be null.
+     */
+    MemoryCounters* m_counters;
+
+    /**
+     * Bytes held by the scope, net of its deallocations.
+     */
+    std::int64_t m_live = 0;
+
+    /**
+     * The enclosing scope, restored on destruction.
+     */
+    MemoryScope* m_previous;
+
+public:
+    /**
+     * Enters a scope on the calling thread.
+     *
+     * @param resource Resource allocating blocks, which must outlive every block; nullptr keeps the enclosing
+     *                 scope's resource, or malloc outside any scope.
+     * @param counters Counters receiving the allocations, may be null.
+     */
+    MemoryScope(std::pmr::memory_resource* resource, MemoryCounters* counters) noexcept;
+
+    /**
+     * Leaves the scope, restoring the enclosing one.
+     */
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+    /**
+     * Allocate a block through the innermost scope of the calling thread.
+     *
+     * @param size Size of the block in bytes.
+     * @return The block, aligned for any fundamental type.
+     * @throws std::bad_alloc if the allocation fails.
+     */
+    [[nodiscard]] static void* allocate(std::size_t size);
+
+    /**
+     * Deallocate a block returned by allocate, through the resource it came from.
+     *
+     * @param block The block, may be null.
+     */
+    static void deallocate(void* block) noexcept;
+};
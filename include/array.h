@@ -0,0 +1,193 @@
+#pragma once
+
+#include "heap.h"
+#include "object.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+
+/**
+ * A numeric array value: a fixed number of doubles stored unboxed in one aligned block, so bulk operations
+ * run over plain memory and reading an element makes no object. Arrays are mutable and compared by identity,
+ * like instances.
+ *
+ * The bulk operations are vectorized with SSE2, which every x86-64 compiler targets by default, and fall back
+ * to scalar loops elsewhere. Reductions keep several partial results, so they also overlap the latency of
+ * their additions.
+ */
+class Array : public Object {
+public:
+    /**
+     * Alignment of the elements, a cache line.
+     */
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    /**
+     * Largest number of elements of an array a script makes with `array(n)`, 2 GiB of doubles.
+     */
+    static constexpr std::size_t MAX_LENGTH = std::size_t{1} << 28;
+
+private:
+    /**
+     * Deleter of the aligned elements.
+     */
+    struct Free {
+        /**
+         * Free the elements.
+         *
+         * @param data The elements.
+         */
+        void operator()(double* data) const noexcept {
+            ::operator delete[](data, std::align_val_t{ALIGNMENT});
+        }
+    };
+
+    /**
+     * The elements.
+     */
+    std::unique_ptr<double[], Free> m_data;
+
+    /**
+     * Number of elements.
+     */
+    std::size_t m_length;
+
+    /**
+     * Allocate uninitialized, aligned storage for elements.
+     *
+     * @param length Number of elements.
+     * @return The storage, freed by Free.
+     */
+    [[nodiscard]] static double* allocate(std::size_t length);
+
+public:
+    /**
+     * Constructs an array of zeros.
+     *
+     * @param length Number of elements.
+     */
+    explicit Array(std::size_t length);
+
+    /**
+     * Constructs an array holding a copy of the given elements.
+     *
+     * @param values The elements.
+     */
+    explicit Array(std::span<const double> values);
+
+    /**
+     * Get the number of elements.
+     *
+     * @return The length.
+     */
+    [[nodiscard]] std::size_t length() const noexcept {
+        return m_length;
+    }
+
+    /**
+     * Get the elements.
+     *
+     * @return The elements.
+     */
+    [[nodiscard]] std::span<double> values() noexcept {
+        return {m_data.get(), m_length};
+    }
+
+    /**
+     * Get the elements.
+     *
+     * @return The elements.
+     */
+    [[nodiscard]] std::span<const double> values() const noexcept {
+        return {m_data.get(), m_length};
+    }
+
+    /**
+     * Arrays refer to no other object.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& /*heap*/) const override {}
+
+    /**
+     * Get the memory the array holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Array) + m_length * sizeof(double);
+    }
+
+    /**
+     * Add up elements.
+     *
+     * @param values The elements.
+     * @return The sum, 0 for no element.
+     */
+    [[nodiscard]] static double sum(std::span<const double> values) noexcept;
+
+    /**
+     * Compute the dot product of two vectors of the same length.
+     *
+     * @param left The first vector.
+     * @param right The second vector, as long as the first.
+     * @return The sum of the products of their elements.
+     */
+    [[nodiscard]] static double dot(std::span<const double> left, std::span<const double> right) noexcept;
+
+    /**
+     * Find the smallest element.
+     *
+     * @param values The elements.
+     * @return The smallest, NaN if any element is NaN, infinity for no element.
+     */
+    [[nodiscard]] static double min(std::span<const double> values) noexcept;
+
+    /**
+     * Find the largest element.
+     *
+     * @param values The elements.
+     * @return The largest, NaN if any element is NaN, minus infinity for no element.
+     */
+    [[nodiscard]] static double max(std::span<const double> values) noexcept;
+
+    /**
+     * Add two vectors element by element.
+     *
+     * @param left The first vector.
+     * @param right The second vector, as long as the first.
+     * @param result The sums, as long as the first.
+     */
+    static void add(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept;
+
+    /**
+     * Subtract two vectors element by element.
+     *
+     * @param left The first vector.
+     * @param right The second vector, as long as the first.
+     * @param result The differences, as long as the first.
+     */
+    static void subtract(std::span<const double> left, std::span<const double> right,
+                         std::span<double> result) noexcept;
+
+    /**
+     * Multiply two vectors element by element.
+     *
+     * @param left The first vector.
+     * @param right The second vector, as long as the first.
+     * @param result The products, as long as the first.
+     */
+    static void multiply(std::span<const double> left, std::span<const double> right,
+                         std::span<double> result) noexcept;
+
+    /**
+     * Divide two vectors element by element.
+     *
+     * @param left The dividends.
+     * @param right The divisors, as many as the dividends.
+     * @param result The quotients, as many as the dividends.
+     */
+    static void divide(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept;
+};
@@ -1,17 +1,35 @@
 #pragma once
 
+#include "allocator.h"
+#include "shape.h"
 #include "token.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 // Forward declarations.
+class CompiledExpr;
 class Expr;
+class ArrayLit;
+class Assign;
 class Binary;
+class Call;
+class Get;
 class Grouping;
+class Index;
 class Lit;
+class Logical;
+class Set;
+class SetIndex;
+class Super;
+class This;
 class Unary;
+class Variable;
 
 /**
  * Expression Visitor interface for the Visitor pattern.
@@ -24,6 +42,20 @@ public:
      */
     virtual ~ExprVisitor() = default;
 
+    /**
+     * Visit methods for the array literal expression type.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    virtual void visitArrayLiteralExpr(const ArrayLit& expr) = 0;
+
+    /**
+     * Visit methods for the assignment expression type.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    virtual void visitAssignExpr(const Assign& expr) = 0;
+
     /**
      * Visit methods for the binary expression type.
      *
@@ -31,6 +63,20 @@ public:
      */
     virtual void visitBinaryExpr(const Binary& expr) = 0;
 
+    /**
+     * Visit methods for the call expression type.
+     *
+     * @param expr The call expression to visit.
+     */
+    virtual void visitCallExpr(const Call& expr) = 0;
+
+    /**
+     * Visit methods for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    virtual void visitGetExpr(const Get& expr) = 0;
+
     /**
      * Visit methods for the grouping expression type.
      *
@@ -38,6 +84,13 @@ public:
      */
     virtual void visitGroupingExpr(const Grouping& expr) = 0;
 
+    /**
+     * Visit methods for the index expression type.
+     *
+     * @param expr The index expression to visit.
+     */
+    virtual void visitIndexExpr(const Index& expr) = 0;
+
     /**
      * Visit methods for the literal expression type.
      *
@@ -45,12 +98,54 @@ public:
      */
     virtual void visitLiteralExpr(const Lit& expr) = 0;
 
+    /**
+     * Visit methods for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    virtual void visitLogicalExpr(const Logical& expr) = 0;
+
+    /**
+     * Visit methods for the property set expression type.
+     *
+     * @param expr The property set expression to visit.
+     */
+    virtual void visitSetExpr(const Set& expr) = 0;
+
+    /**
+     * Visit methods for the element set expression type.
+     *
+     * @param expr The element set expression to visit.
+     */
+    virtual void visitSetIndexExpr(const SetIndex& expr) = 0;
+
+    /**
+     * Visit methods for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    virtual void visitSuperExpr(const Super& expr) = 0;
+
+    /**
+     * Visit methods for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    virtual void visitThisExpr(const This& expr) = 0;
+
     /**
      * Visit methods for the unary expression type.
      *
      * @param expr The unary expression to visit.
      */
     virtual void visitUnaryExpr(const Unary& expr) = 0;
+
+    /**
+     * Visit methods for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    virtual void visitVariableExpr(const Variable& expr) = 0;
 };
 
 /**
@@ -73,6 +168,20 @@ public:
      */
     [[nodiscard]] std::string print(const Expr& expr);
 
+    /**
+     * Visit method for the array literal expression type.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override;
+
+    /**
+     * Visit method for the assignment expression type.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override;
+
     /**
      * Visit method for the binary expression type.
      *
@@ -80,6 +189,20 @@ public:
      */
     void visitBinaryExpr(const Binary& expr) override;
 
+    /**
+     * Visit method for the call expression type.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit methods for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override;
+
     /**
      * Visit method for the grouping expression type.
      *
@@ -87,6 +210,13 @@ public:
      */
     void visitGroupingExpr(const Grouping& expr) override;
 
+    /**
+     * Visit method for the index expression type.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override;
+
     /**
      * Visit method for the literal expression type.
      *
@@ -94,130 +224,239 @@ public:
      */
     void visitLiteralExpr(const Lit& expr) override;
 
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override;
+
+    /**
+     * Visit methods for the property set expression type.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override;
+
+    /**
+     * Visit method for the element set expression type.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override;
+
+    /**
+     * Visit methods for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override;
+
+    /**
+     * Visit methods for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override;
+
     /**
      * Visit method for the unary expression type.
      *
      * @param expr The unary expression to visit.
      */
     void visitUnaryExpr(const Unary& expr) override;
+
+    /**
+     * Visit method for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override;
 };
 
 /**
- * Abstract base class for all expression types in the AST.
+ * Storage of a variable, assigned by the Resolver before the tree is shared.
  */
-class Expr {
-public:
+struct Binding {
     /**
-     * Virtual destructor to ensure proper cleanup of derived classes.
+     * Kinds of storage.
      */
-    virtual ~Expr() = default;
+    enum class Kind : std::uint8_t {
+        // Not resolved: looked up by name in the global table at run time.
+        UNRESOLVED,
+
+        // A slot of the global table of the program.
+        GLOBAL,
+
+        // A slot of a call frame.
+        LOCAL,
+
+        // A slot of a call frame holding a cell, for a local that closures capture.
+        CELL,
+
+        // An upvalue of the running closure: a cell shared with the frame declaring the variable.
+        UPVALUE,
+    };
 
     /**
-     * Accept method for the Visitor pattern.
-     *
-     * @param visitor The expression visitor.
+     * Kind of storage.
      */
-    virtual void accept(ExprVisitor& visitor) const = 0;
-};
+    Kind kind = Kind::UNRESOLVED;
 
-/**
- * Expression pointer type for managing expression objects.
- */
-using ExprPtr = std::unique_ptr<Expr>;
+    /**
+     * Number of function boundaries between the use and the declaration: 0 for locals, at least 1 for upvalues.
+     */
+    std::uint32_t depth = 0;
+
+    /**
+     * Index of the slot in its frame or in the global table, or of the upvalue in the running closure.
+     */
+    std::uint32_t slot = 0;
+};
 
 /**
- * Binary expression class representing binary operations.
+ * Execution tier bookkeeping attached to every expression node.
+ * Counts evaluations and holds the compiled form once the node has been promoted.
  */
-class Binary : public Expr {
+class TierState {
 private:
     /**
-     * Left operand of the binary expression.
+     * Number of tree-walking evaluations of the node.
      */
-    ExprPtr m_left;
+    std::atomic<std::uint32_t> m_hits = 0;
 
     /**
-     * Operator token of the binary expression.
+     * Flag, whether the node has been queued for compilation.
      */
-    Token m_op;
+    std::atomic<bool> m_queued = false;
 
-    /*
-     * Right operand of the binary expression.
+    /**
+     * The compiled form, published once by the compiler thread.
      */
-    ExprPtr m_right;
+    std::atomic<const CompiledExpr*> m_compiled = nullptr;
+
+    /**
+     * Owner of the compiled form.
+     */
+    std::unique_ptr<const CompiledExpr> m_owned;
 
 public:
     /**
-     * Constructor for the Binary expression.
-     *
-     * @param left  The left operand expression.
-     * @param op    The operator token.
-     * @param right The right operand expression.
+     * Default constructor.
      */
-    Binary(ExprPtr left, Token op, ExprPtr right)
-        : m_left(std::move(left)), m_op(std::move(op)), m_right(std::move(right)) {}
+    TierState();
 
     /**
-     * Get the left operand expression.
+     * Destructor.
+     */
+    ~TierState();
+
+    TierState(const TierState&) = delete;
+    TierState& operator=(const TierState&) = delete;
+
+    /**
+     * Count an evaluation of the node.
+     * Concurrent evaluations may lose counts, which only delays promotion.
      *
-     * @return The left operand expression.
+     * @return The updated evaluation count.
      */
-    [[nodiscard]] const Expr& left() const noexcept {
-        return *m_left;
+    std::uint32_t hit() noexcept {
+        auto hits = m_hits.load(std::memory_order_relaxed) + 1;
+        m_hits.store(hits, std::memory_order_relaxed);
+
+        return hits;
     }
 
     /**
-     * Get the operator token.
+     * Claim the node for compilation.
      *
-     * @return The operator token.
+     * @return True if the caller is the first to claim it, false otherwise.
      */
-    [[nodiscard]] const Token& op() const noexcept {
-        return m_op;
+    [[nodiscard]] bool tryQueue() noexcept {
+        return !m_queued.load(std::memory_order_relaxed) && !m_queued.exchange(true, std::memory_order_acq_rel);
     }
 
     /**
-     * Get the right operand expression.
+     * Get the compiled form of the node.
      *
-     * @return The right operand expression.
+     * @return The compiled form, or nullptr if the node has not been promoted yet.
      */
-    [[nodiscard]] const Expr& right() const noexcept {
-        return *m_right;
+    [[nodiscard]] const CompiledExpr* compiled() const noexcept {
+        return m_compiled.load(std::memory_order_acquire);
     }
 
     /**
-     * Accept method for the Visitor pattern.
+     * Publish the compiled form of the node. Must be called at most once.
      *
-     * @param visitor The expression visitor.
+     * @param compiled The compiled form.
      */
-    void accept(ExprVisitor& visitor) const override {
-        visitor.visitBinaryExpr(*this);
-    }
+    void publish(std::unique_ptr<const CompiledExpr> compiled) noexcept;
 };
 
 /**
- * Grouping expression class representing grouped expressions.
+ * Abstract base class for all expression types in the AST.
  */
-class Grouping : public Expr {
+class Expr {
 private:
     /**
-     * The expression contained within the grouping.
+     * Execution tier state of the node.
      */
-    ExprPtr m_expression;
+    mutable TierState m_tier;
+
+    /**
+     * Number of nodes on the longest path from this node down to a leaf.
+     */
+    std::uint32_t m_height;
+
+protected:
+    /**
+     * Constructor.
+     *
+     * @param height Height of the node, 1 for leaves.
+     */
+    explicit Expr(std::uint32_t height = 1) noexcept : m_height(height) {}
+
+    /**
+     * Destroy a child without recursing, so destroying a deep tree cannot overflow the native stack.
+     * Nested calls made while a tree is being destroyed defer their child to a work list.
+     *
+     * @param child The child to destroy.
+     */
+    static void dispose(std::unique_ptr<Expr> child) noexcept;
 
 public:
     /**
-     * Constructor for the Grouping expression.
+     * Virtual destructor to ensure proper cleanup of derived classes.
+     */
+    virtual ~Expr() = default;
+
+    /**
+     * Allocate a node through the memory scope of the calling thread.
      *
-     * @param expression The expression to be grouped.
+     * @param size Size of the node in bytes.
+     * @return The storage.
+     * @throws std::bad_alloc if the allocation fails.
      */
-    explicit Grouping(ExprPtr expression) : m_expression(std::move(expression)) {}
+    [[nodiscard]] static void* operator new(std::size_t size) {
+        return MemoryScope::allocate(size);
+    }
 
     /**
-     * Get the contained expression.
+     * Deallocate a node through the resource it came from.
      *
-     * @return The contained expression.
+     * @param block The storage.
      */
-    [[nodiscard]] const Expr& expression() const noexcept {
-        return *m_expression;
+    static void operator delete(void* block) noexcept {
+        MemoryScope::deallocate(block);
+    }
+
+    /**
+     * Get the height of the node.
+     *
+     * @return The number of nodes on the longest path down to a leaf.
+     */
+    [[nodiscard]] std::uint32_t height() const noexcept {
+        return m_height;
     }
 
     /**
@@ -225,34 +464,88 @@ public:
      *
      * @param visitor The expression visitor.
      */
-    void accept(ExprVisitor& visitor) const override {
-        visitor.visitGroupingExpr(*this);
+    virtual void accept(ExprVisitor& visitor) const = 0;
+
+    /**
+     * Get the execution tier state of the node.
+     *
+     * @return The tier state.
+     */
+    [[nodiscard]] TierState& tier() const noexcept {
+        return m_tier;
     }
 };
 
 /**
- * Literal expression class representing literal values.
+ * Expression pointer type for managing expression objects.
  */
-class Lit : public Expr {
+using ExprPtr = std::unique_ptr<Expr>;
+
+/**
+ * Array literal expression class representing a new array of the given elements.
+ */
+class ArrayLit : public Expr {
 private:
     /**
-     * The literal value.
+     * The opening bracket, for error reporting.
      */
-    Literal m_value;
+    Token m_bracket;
+
+    /**
+     * The elements.
+     */
+    std::vector<ExprPtr> m_elements;
+
+    /**
+     * Height of the tallest of the elements.
+     *
+     * @param elements The elements.
+     * @return The height, 0 for no element.
+     */
+    [[nodiscard]] static std::uint32_t tallest(const std::vector<ExprPtr>& elements) noexcept {
+        std::uint32_t height = 0;
+        for (const auto& element : elements) {
+            height = std::max(height, element->height());
+        }
+
+        return height;
+    }
 
 public:
     /**
-     * Constructor for the Literal expression.
+     * Constructor for the ArrayLit expression.
+     *
+     * @param bracket  The opening bracket.
+     * @param elements The elements.
      */
-    explicit Lit(Literal value) : m_value(std::move(value)) {}
+    ArrayLit(Token bracket, std::vector<ExprPtr> elements)
+        : Expr(1 + tallest(elements)), m_bracket(std::move(bracket)), m_elements(std::move(elements)) {}
 
     /**
-     * Get the literal value.
+     * Destructor.
+     */
+    ~ArrayLit() override {
+        for (auto& element : m_elements) {
+            dispose(std::move(element));
+        }
+    }
+
+    /**
+     * Get the opening bracket.
      *
-     * @return The literal value.
+     * @return The bracket token.
      */
-    [[nodiscard]] const Literal& value() const noexcept {
-        return m_value;
+    [[nodiscard]] const Token& bracket() const noexcept {
+        return m_bracket;
+    }
+
+    /**
+     * Get the elements.
+     *
+     * @return The element expressions.
+     */
+    [[nodiscard]] const std::vector<ExprPtr>& elements() const noexcept {
+        return m_elements;
     }
 
     /**
@@ -261,58 +554,1091 @@ public:
      * @param visitor The expression visitor.
      */
     void accept(ExprVisitor& visitor) const override {
-        visitor.visitLiteralExpr(*this);
+        visitor.visitArrayLiteralExpr(*this);
     }
 };
 
 /**
- * Unary expression class representing unary operations.
+ * Assignment expression class representing a store to a variable.
  */
-class Unary : public Expr {
+class Assign : public Expr {
 private:
     /**
-     * Operator token of the unary expression.
+     * Name token of the variable.
      */
-    Token m_op;
+    Token m_name;
 
     /**
-     * Operand of the unary expression.
+     * The assigned value.
      */
-    ExprPtr m_right;
+    ExprPtr m_value;
+
+    /**
+     * Storage of the variable, set by the resolver.
+     */
+    mutable Binding m_binding;
 
 public:
     /**
-     * Constructor for the Unary expression.
+     * Constructor for the Assign expression.
      *
-     * @param op    The operator token.
-     * @param right The operand expression.
+     * @param name  The name token.
+     * @param value The assigned value.
      */
-    Unary(Token op, ExprPtr right) : m_op(std::move(op)), m_right(std::move(right)) {}
+    Assign(Token name, ExprPtr value)
+        : Expr(1 + value->height()), m_name(std::move(name)), m_value(std::move(value)) {}
 
     /**
-     * Get the operator token.
+     * Destructor.
+     */
+    ~Assign() override {
+        dispose(std::move(m_value));
+    }
+
+    /**
+     * Get the name token.
      *
-     * @return The operator token.
+     * @return The name token.
      */
-    [[nodiscard]] const Token& op() const noexcept {
-        return m_op;
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
     }
 
     /**
-     * Get the operand expression.
+     * Get the assigned value.
      *
-     * @return The operand expression.
+     * @return The value expression.
      */
-    [[nodiscard]] const Expr& right() const noexcept {
-        return *m_right;
+    [[nodiscard]] const Expr& value() const noexcept {
+        return *m_value;
     }
 
     /**
-     * Accept method for the Visitor pattern.
+     * Get the storage of the variable.
      *
-     * @param visitor The expression visitor.
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
      */
-    void accept(ExprVisitor& visitor) const override {
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of the variable. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures the variable.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitAssignExpr(*this);
+    }
+};
+
+/**
+ * Binary expression class representing binary operations.
+ */
+class Binary : public Expr {
+private:
+    /**
+     * Left operand of the binary expression.
+     */
+    ExprPtr m_left;
+
+    /**
+     * Operator token of the binary expression.
+     */
+    Token m_op;
+
+    /*
+     * Right operand of the binary expression.
+     */
+    ExprPtr m_right;
+
+public:
+    /**
+     * Constructor for the Binary expression.
+     *
+     * @param left  The left operand expression.
+     * @param op    The operator token.
+     * @param right The right operand expression.
+     */
+    Binary(ExprPtr left, Token op, ExprPtr right)
+        : Expr(1 + std::max(left->height(), right->height())), m_left(std::move(left)), m_op(std::move(op)),
+          m_right(std::move(right)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Binary() override {
+        dispose(std::move(m_left));
+        dispose(std::move(m_right));
+    }
+
+    /**
+     * Get the left operand expression.
+     *
+     * @return The left operand expression.
+     */
+    [[nodiscard]] const Expr& left() const noexcept {
+        return *m_left;
+    }
+
+    /**
+     * Get the operator token.
+     *
+     * @return The operator token.
+     */
+    [[nodiscard]] const Token& op() const noexcept {
+        return m_op;
+    }
+
+    /**
+     * Get the right operand expression.
+     *
+     * @return The right operand expression.
+     */
+    [[nodiscard]] const Expr& right() const noexcept {
+        return *m_right;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitBinaryExpr(*this);
+    }
+};
+
+/**
+ * Call expression class representing a call of a function with arguments.
+ */
+class Call : public Expr {
+private:
+    /**
+     * The called expression.
+     */
+    ExprPtr m_callee;
+
+    /**
+     * The closing parenthesis, for error reporting.
+     */
+    Token m_paren;
+
+    /**
+     * The arguments.
+     */
+    std::vector<ExprPtr> m_arguments;
+
+    /**
+     * The callee if it is a property get, so a method is called without binding it to its receiver.
+     */
+    const Get* m_method;
+
+    /**
+     * The callee if it is a superclass method, so it is called without binding it to its receiver.
+     */
+    const Super* m_superMethod;
+
+    /**
+     * Height of the tallest of a callee and its arguments.
+     *
+     * @param callee The called expression.
+     * @param arguments The arguments.
+     * @return The height.
+     */
+    [[nodiscard]] static std::uint32_t tallest(const Expr& callee, const std::vector<ExprPtr>& arguments) noexcept {
+        auto height = callee.height();
+        for (const auto& argument : arguments) {
+            height = std::max(height, argument->height());
+        }
+
+        return height;
+    }
+
+public:
+    /**
+     * Constructor for the Call expression.
+     *
+     * @param callee    The called expression.
+     * @param paren     The closing parenthesis.
+     * @param arguments The arguments.
+     */
+    Call(ExprPtr callee, Token paren, std::vector<ExprPtr> arguments);
+
+    /**
+     * Destructor.
+     */
+    ~Call() override {
+        dispose(std::move(m_callee));
+        for (auto& argument : m_arguments) {
+            dispose(std::move(argument));
+        }
+    }
+
+    /**
+     * Get the called expression.
+     *
+     * @return The callee.
+     */
+    [[nodiscard]] const Expr& callee() const noexcept {
+        return *m_callee;
+    }
+
+    /**
+     * Get the closing parenthesis.
+     *
+     * @return The parenthesis token.
+     */
+    [[nodiscard]] const Token& paren() const noexcept {
+        return m_paren;
+    }
+
+    /**
+     * Get the arguments.
+     *
+     * @return The argument expressions.
+     */
+    [[nodiscard]] const std::vector<ExprPtr>& arguments() const noexcept {
+        return m_arguments;
+    }
+
+    /**
+     * Get the callee if the call is a method call.
+     *
+     * @return The property get, or nullptr if the callee is another expression.
+     */
+    [[nodiscard]] const Get* method() const noexcept {
+        return m_method;
+    }
+
+    /**
+     * Get the callee if the call is a superclass method call.
+     *
+     * @return The super expression, or nullptr if the callee is another expression.
+     */
+    [[nodiscard]] const Super* superMethod() const noexcept {
+        return m_superMethod;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitCallExpr(*this);
+    }
+};
+
+/**
+ * Property get expression class representing a read of a field or a method of an instance.
+ */
+class Get : public Expr {
+private:
+    /**
+     * The expression evaluating to the instance.
+     */
+    ExprPtr m_object;
+
+    /**
+     * Name token of the property.
+     */
+    Token m_name;
+
+    /**
+     * Where the property was found for the shapes seen at this site.
+     */
+    InlineCache m_cache;
+
+public:
+    /**
+     * Constructor for the Get expression.
+     *
+     * @param object The expression evaluating to the instance.
+     * @param name   The name token of the property.
+     */
+    Get(ExprPtr object, Token name)
+        : Expr(1 + object->height()), m_object(std::move(object)), m_name(std::move(name)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Get() override {
+        dispose(std::move(m_object));
+    }
+
+    /**
+     * Get the expression evaluating to the instance.
+     *
+     * @return The object expression.
+     */
+    [[nodiscard]] const Expr& object() const noexcept {
+        return *m_object;
+    }
+
+    /**
+     * Take the expression evaluating to the instance, when the parser turns the get into an assignment target.
+     *
+     * @return The object expression, leaving the node empty.
+     */
+    [[nodiscard]] ExprPtr releaseObject() noexcept {
+        return std::move(m_object);
+    }
+
+    /**
+     * Get the name token of the property.
+     *
+     * @return The name token.
+     */
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the inline cache of the site.
+     *
+     * @return The cache.
+     */
+    [[nodiscard]] const InlineCache& cache() const noexcept {
+        return m_cache;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitGetExpr(*this);
+    }
+};
+
+/**
+ * Grouping expression class representing grouped expressions.
+ */
+class Grouping : public Expr {
+private:
+    /**
+     * The expression contained within the grouping.
+     */
+    ExprPtr m_expression;
+
+public:
+    /**
+     * Constructor for the Grouping expression.
+     *
+     * @param expression The expression to be grouped.
+     */
+    explicit Grouping(ExprPtr expression) : Expr(1 + expression->height()), m_expression(std::move(expression)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Grouping() override {
+        dispose(std::move(m_expression));
+    }
+
+    /**
+     * Get the contained expression.
+     *
+     * @return The contained expression.
+     */
+    [[nodiscard]] const Expr& expression() const noexcept {
+        return *m_expression;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitGroupingExpr(*this);
+    }
+};
+
+/**
+ * Index expression class representing a read of an element of an array.
+ */
+class Index : public Expr {
+private:
+    /**
+     * The expression evaluating to the array.
+     */
+    ExprPtr m_object;
+
+    /**
+     * The closing bracket, for error reporting.
+     */
+    Token m_bracket;
+
+    /**
+     * The expression evaluating to the index.
+     */
+    ExprPtr m_index;
+
+public:
+    /**
+     * Constructor for the Index expression.
+     *
+     * @param object  The expression evaluating to the array.
+     * @param bracket The closing bracket.
+     * @param index   The expression evaluating to the index.
+     */
+    Index(ExprPtr object, Token bracket, ExprPtr index)
+        : Expr(1 + std::max(object->height(), index->height())), m_object(std::move(object)),
+          m_bracket(std::move(bracket)), m_index(std::move(index)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Index() override {
+        dispose(std::move(m_object));
+        dispose(std::move(m_index));
+    }
+
+    /**
+     * Get the expression evaluating to the array.
+     *
+     * @return The object expression.
+     */
+    [[nodiscard]] const Expr& object() const noexcept {
+        return *m_object;
+    }
+
+    /**
+     * Take the expression evaluating to the array, when the parser turns the index into an assignment target.
+     *
+     * @return The object expression, leaving the node empty.
+     */
+    [[nodiscard]] ExprPtr releaseObject() noexcept {
+        return std::move(m_object);
+    }
+
+    /**
+     * Get the closing bracket.
+     *
+     * @return The bracket token.
+     */
+    [[nodiscard]] const Token& bracket() const noexcept {
+        return m_bracket;
+    }
+
+    /**
+     * Get the expression evaluating to the index.
+     *
+     * @return The index expression.
+     */
+    [[nodiscard]] const Expr& index() const noexcept {
+        return *m_index;
+    }
+
+    /**
+     * Take the expression evaluating to the index, when the parser turns the index into an assignment target.
+     *
+     * @return The index expression, leaving the node empty.
+     */
+    [[nodiscard]] ExprPtr releaseIndex() noexcept {
+        return std::move(m_index);
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitIndexExpr(*this);
+    }
+};
+
+/**
+ * Literal expression class representing literal values.
+ */
+class Lit : public Expr {
+private:
+    /**
+     * The literal value.
+     */
+    Literal m_value;
+
+public:
+    /**
+     * Constructor for the Literal expression.
+     */
+    explicit Lit(Literal value) : m_value(std::move(value)) {}
+
+    /**
+     * Get the literal value.
+     *
+     * @return The literal value.
+     */
+    [[nodiscard]] const Literal& value() const noexcept {
+        return m_value;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitLiteralExpr(*this);
+    }
+};
+
+/**
+ * Logical expression class representing the short-circuiting `and` and `or` operators.
+ */
+class Logical : public Expr {
+private:
+    /**
+     * Left operand of the logical expression.
+     */
+    ExprPtr m_left;
+
+    /**
+     * Operator token of the logical expression.
+     */
+    Token m_op;
+
+    /**
+     * Right operand of the logical expression, only evaluated if the left one does not decide the result.
+     */
+    ExprPtr m_right;
+
+public:
+    /**
+     * Constructor for the Logical expression.
+     *
+     * @param left  The left operand expression.
+     * @param op    The operator token.
+     * @param right The right operand expression.
+     */
+    Logical(ExprPtr left, Token op, ExprPtr right)
+        : Expr(1 + std::max(left->height(), right->height())), m_left(std::move(left)), m_op(std::move(op)),
+          m_right(std::move(right)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Logical() override {
+        dispose(std::move(m_left));
+        dispose(std::move(m_right));
+    }
+
+    /**
+     * Get the left operand expression.
+     *
+     * @return The left operand expression.
+     */
+    [[nodiscard]] const Expr& left() const noexcept {
+        return *m_left;
+    }
+
+    /**
+     * Get the operator token.
+     *
+     * @return The operator token, AND or OR.
+     */
+    [[nodiscard]] const Token& op() const noexcept {
+        return m_op;
+    }
+
+    /**
+     * Get the right operand expression.
+     *
+     * @return The right operand expression.
+     */
+    [[nodiscard]] const Expr& right() const noexcept {
+        return *m_right;
+    }
+
+    /**
+     * Check whether the left operand alone decides the result.
+     *
+     * @param truthy Truthiness of the left operand.
+     * @return True if the left operand is the result and the right one is skipped.
+     */
+    [[nodiscard]] bool shortCircuits(bool truthy) const noexcept {
+        return m_op.type == TokenType::OR ? truthy : !truthy;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitLogicalExpr(*this);
+    }
+};
+
+/**
+ * Property set expression class representing a store to a field of an instance.
+ */
+class Set : public Expr {
+private:
+    /**
+     * The expression evaluating to the instance.
+     */
+    ExprPtr m_object;
+
+    /**
+     * Name token of the field.
+     */
+    Token m_name;
+
+    /**
+     * The assigned expression.
+     */
+    ExprPtr m_value;
+
+    /**
+     * Where the field is, or which transition adds it, for the shapes seen at this site.
+     */
+    InlineCache m_cache;
+
+public:
+    /**
+     * Constructor for the Set expression.
+     *
+     * @param object The expression evaluating to the instance.
+     * @param name   The name token of the field.
+     * @param value  The assigned expression.
+     */
+    Set(ExprPtr object, Token name, ExprPtr value)
+        : Expr(1 + std::max(object->height(), value->height())), m_object(std::move(object)),
+          m_name(std::move(name)), m_value(std::move(value)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Set() override {
+        dispose(std::move(m_object));
+        dispose(std::move(m_value));
+    }
+
+    /**
+     * Get the expression evaluating to the instance.
+     *
+     * @return The object expression.
+     */
+    [[nodiscard]] const Expr& object() const noexcept {
+        return *m_object;
+    }
+
+    /**
+     * Get the name token of the field.
+     *
+     * @return The name token.
+     */
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the assigned expression.
+     *
+     * @return The value expression.
+     */
+    [[nodiscard]] const Expr& value() const noexcept {
+        return *m_value;
+    }
+
+    /**
+     * Get the inline cache of the site.
+     *
+     * @return The cache.
+     */
+    [[nodiscard]] const InlineCache& cache() const noexcept {
+        return m_cache;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitSetExpr(*this);
+    }
+};
+
+/**
+ * Element set expression class representing a store to an element of an array.
+ */
+class SetIndex : public Expr {
+private:
+    /**
+     * The expression evaluating to the array.
+     */
+    ExprPtr m_object;
+
+    /**
+     * The closing bracket, for error reporting.
+     */
+    Token m_bracket;
+
+    /**
+     * The expression evaluating to the index.
+     */
+    ExprPtr m_index;
+
+    /**
+     * The assigned expression.
+     */
+    ExprPtr m_value;
+
+public:
+    /**
+     * Constructor for the SetIndex expression.
+     *
+     * @param object  The expression evaluating to the array.
+     * @param bracket The closing bracket.
+     * @param index   The expression evaluating to the index.
+     * @param value   The assigned expression.
+     */
+    SetIndex(ExprPtr object, Token bracket, ExprPtr index, ExprPtr value)
+        : Expr(1 + std::max({object->height(), index->height(), value->height()})), m_object(std::move(object)),
+          m_bracket(std::move(bracket)), m_index(std::move(index)), m_value(std::move(value)) {}
+
+    /**
+     * Destructor.
+     */
+    ~SetIndex() override {
+        dispose(std::move(m_object));
+        dispose(std::move(m_index));
+        dispose(std::move(m_value));
+    }
+
+    /**
+     * Get the expression evaluating to the array.
+     *
+     * @return The object expression.
+     */
+    [[nodiscard]] const Expr& object() const noexcept {
+        return *m_object;
+    }
+
+    /**
+     * Get the closing bracket.
+     *
+     * @return The bracket token.
+     */
+    [[nodiscard]] const Token& bracket() const noexcept {
+        return m_bracket;
+    }
+
+    /**
+     * Get the expression evaluating to the index.
+     *
+     * @return The index expression.
+     */
+    [[nodiscard]] const Expr& index() const noexcept {
+        return *m_index;
+    }
+
+    /**
+     * Get the assigned expression.
+     *
+     * @return The value expression.
+     */
+    [[nodiscard]] const Expr& value() const noexcept {
+        return *m_value;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitSetIndexExpr(*this);
+    }
+};
+
+/**
+ * Super expression class representing a method of the superclass of the class declaring the running method.
+ */
+class Super : public Expr {
+private:
+    /**
+     * The `super` keyword.
+     */
+    Token m_keyword;
+
+    /**
+     * Name token of the method.
+     */
+    Token m_method;
+
+    /**
+     * Storage of `this`, the receiver the method is bound to, set by the resolver.
+     */
+    mutable Binding m_binding;
+
+    /**
+     * Index of the method in the superclass, for the declaring classes seen at this site.
+     */
+    InlineCache m_cache;
+
+public:
+    /**
+     * Constructor for the Super expression.
+     *
+     * @param keyword The `super` keyword.
+     * @param method  The name token of the method.
+     */
+    Super(Token keyword, Token method) : m_keyword(std::move(keyword)), m_method(std::move(method)) {}
+
+    /**
+     * Get the `super` keyword.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the name token of the method.
+     *
+     * @return The method name token.
+     */
+    [[nodiscard]] const Token& method() const noexcept {
+        return m_method;
+    }
+
+    /**
+     * Get the storage of `this`.
+     *
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
+     */
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of `this`. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures `this`.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Get the inline cache of the site.
+     *
+     * @return The cache.
+     */
+    [[nodiscard]] const InlineCache& cache() const noexcept {
+        return m_cache;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitSuperExpr(*this);
+    }
+};
+
+/**
+ * This expression class representing the receiver of the running method.
+ */
+class This : public Expr {
+private:
+    /**
+     * The `this` keyword.
+     */
+    Token m_keyword;
+
+    /**
+     * Storage of the receiver, set by the resolver.
+     */
+    mutable Binding m_binding;
+
+public:
+    /**
+     * Constructor for the This expression.
+     *
+     * @param keyword The `this` keyword.
+     */
+    explicit This(Token keyword) : m_keyword(std::move(keyword)) {}
+
+    /**
+     * Get the `this` keyword.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the storage of the receiver.
+     *
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
+     */
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of the receiver. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures `this`.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitThisExpr(*this);
+    }
+};
+
+/**
+ * Unary expression class representing unary operations.
+ */
+class Unary : public Expr {
+private:
+    /**
+     * Operator token of the unary expression.
+     */
+    Token m_op;
+
+    /**
+     * Operand of the unary expression.
+     */
+    ExprPtr m_right;
+
+public:
+    /**
+     * Constructor for the Unary expression.
+     *
+     * @param op    The operator token.
+     * @param right The operand expression.
+     */
+    Unary(Token op, ExprPtr right) : Expr(1 + right->height()), m_op(std::move(op)), m_right(std::move(right)) {}
+
+    /**
+     * Destructor.
+     */
+    ~Unary() override {
+        dispose(std::move(m_right));
+    }
+
+    /**
+     * Get the operator token.
+     *
+     * @return The operator token.
+     */
+    [[nodiscard]] const Token& op() const noexcept {
+        return m_op;
+    }
+
+    /**
+     * Get the operand expression.
+     *
+     * @return The operand expression.
+     */
+    [[nodiscard]] const Expr& right() const noexcept {
+        return *m_right;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
         visitor.visitUnaryExpr(*this);
     }
 };
+
+/**
+ * Variable expression class representing a reference to a named value.
+ */
+class Variable : public Expr {
+private:
+    /**
+     * Name token of the variable.
+     */
+    Token m_name;
+
+    /**
+     * Storage of the variable, set by the resolver.
+     */
+    mutable Binding m_binding;
+
+public:
+    /**
+     * Constructor for the Variable expression.
+     *
+     * @param name The name token.
+     */
+    explicit Variable(Token name) : m_name(std::move(name)) {}
+
+    /**
+     * Get the name token.
+     *
+     * @return The name token.
+     */
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the storage of the variable.
+     *
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
+     */
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of the variable. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures the variable.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The expression visitor.
+     */
+    void accept(ExprVisitor& visitor) const override {
+        visitor.visitVariableExpr(*this);
+    }
+};
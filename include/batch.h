@@ -0,0 +1,426 @@
+#pragma once
+
+#include "ast.h"
+#include "interpreter.h"
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * Result of evaluating an expression over a batch of rows.
+ */
+class BatchResult {
+public:
+    /**
+     * Shapes of a batch result.
+     */
+    enum class Kind : std::uint8_t {
+        // The same value for every row.
+        CONSTANT,
+
+        // One number per row.
+        NUMBER,
+
+        // One boolean per row.
+        BOOL,
+    };
+
+private:
+    /**
+     * Shape of the result.
+     */
+    Kind m_kind;
+
+    /**
+     * Number of rows.
+     */
+    std::size_t m_rows;
+
+    /**
+     * Value of every row, for Kind::CONSTANT.
+     */
+    std::any m_constant;
+
+    /**
+     * Value of each row, for Kind::NUMBER.
+     */
+    std::vector<double> m_numbers;
+
+    /**
+     * Value of each row as 0 or 1, for Kind::BOOL.
+     */
+    std::vector<std::uint8_t> m_booleans;
+
+    friend class BatchProgram;
+
+public:
+    /**
+     * Constructs an empty result of the given shape.
+     *
+     * @param kind Shape of the result.
+     * @param rows Number of rows.
+     */
+    BatchResult(Kind kind, std::size_t rows) : m_kind(kind), m_rows(rows) {}
+
+    /**
+     * Get the shape of the result.
+     *
+     * @return The shape.
+     */
+    [[nodiscard]] Kind kind() const noexcept {
+        return m_kind;
+    }
+
+    /**
+     * Get the number of rows.
+     *
+     * @return The number of rows.
+     */
+    [[nodiscard]] std::size_t size() const noexcept {
+        return m_rows;
+    }
+
+    /**
+     * Get the value shared by every row. A string belongs to the program that produced the result.
+     *
+     * @return The value, empty unless the result is Kind::CONSTANT.
+     */
+    [[nodiscard]] const std::any& constant() const noexcept {
+        return m_constant;
+    }
+
+    /**
+     * Get the value of each row.
+     *
+     * @return The numbers, empty unless the result is Kind::NUMBER.
+     */
+    [[nodiscard]] std::span<const double> numbers() const noexcept {
+        return m_numbers;
+    }
+
+    /**
+     * Get the value of each row as 0 or 1.
+     *
+     * @return The booleans, empty unless the result is Kind::BOOL.
+     */
+    [[nodiscard]] std::span<const std::uint8_t> booleans() const noexcept {
+        return m_booleans;
+    }
+
+    /**
+     * Get the value of a row, as Interpreter::eval would return it.
+     *
+     * @param row The row index.
+     * @return The value of the row.
+     */
+    [[nodiscard]] std::any at(std::size_t row) const;
+
+    /**
+     * Get the selection vector of the result.
+     *
+     * @return The indices of the rows whose value is truthy, in ascending order.
+     */
+    [[nodiscard]] std::vector<std::uint32_t> selection() const;
+};
+
+/**
+ * An expression compiled for vectorized evaluation over columns of numbers.
+ * Variables refer to input columns. Evaluation walks the compiled code once per block of rows,
+ * running a tight loop per node that the compiler can vectorize, instead of walking the tree once per row.
+ * Since every column holds numbers, operand types are known at compile time: constant subtrees are folded
+ * with the interpreter's own rules, and type errors are raised before any row is evaluated.
+ * Logical operators are decided at compile time where the left operand's truthiness is, and otherwise
+ * combine booleans row by row; runtime errors of their right operand are raised even for rows it would skip.
+ * Assignments are not supported, since columns are read-only.
+ */
+class BatchProgram : public ExprVisitor {
+public:
+    /**
+     * Number of rows evaluated per pass over the compiled code.
+     */
+    static constexpr std::size_t BLOCK_SIZE = 1024;
+
+private:
+    /**
+     * Location of the value of a node.
+     */
+    struct Slot {
+        /**
+         * Shapes of a slot.
+         */
+        enum class Shape : std::uint8_t {
+            // A constant, indexing m_constants.
+            SCALAR,
+
+            // An input column, indexing the columns.
+            COLUMN,
+
+            // A number register, indexing the number registers.
+            NUMBERS,
+
+            // A boolean register, indexing the boolean registers.
+            BOOLEANS,
+        };
+
+        /**
+         * Shape of the slot.
+         */
+        Shape shape = Shape::SCALAR;
+
+        /**
+         * Index of the constant, column or register.
+         */
+        std::size_t index = 0;
+    };
+
+    /**
+     * A vector operation writing one register.
+     */
+    struct Instruction {
+        /**
+         * The operator.
+         */
+        TokenType op;
+
+        /**
+         * Left operand, unused for unary operators.
+         */
+        Slot left;
+
+        /**
+         * Right (or only) operand.
+         */
+        Slot right;
+
+        /**
+         * The register receiving the result.
+         */
+        Slot target;
+
+        /**
+         * Whether the operator is unary.
+         */
+        bool unary = false;
+
+        /**
+         * Whether an equality compares booleans rather than numbers.
+         */
+        bool booleans = false;
+    };
+
+    /**
+     * Names of the input columns.
+     */
+    std::vector<std::string> m_columns;
+
+    /**
+     * Heap of the string constants.
+     */
+    Heap m_heap;
+
+    /**
+     * Constant values.
+     */
+    std::vector<std::any> m_constants;
+
+    /**
+     * Compiled code, in evaluation order.
+     */
+    std::vector<Instruction> m_code;
+
+    /**
+     * Number of number registers.
+     */
+    std::size_t m_numberRegisters = 0;
+
+    /**
+     * Number of boolean registers.
+     */
+    std::size_t m_booleanRegisters = 0;
+
+    /**
+     * Slot holding the result of the last visited expression.
+     */
+    Slot m_result;
+
+    /**
+     * The first runtime error of the expression, raised when a non-empty batch is evaluated.
+     */
+    std::optional<RuntimeError> m_error;
+
+public:
+    /**
+     * Compile an expression for batch evaluation.
+     *
+     * @param expr The expression to compile.
+     * @param columns Names of the input columns, in the order they are passed to run.
+     */
+    BatchProgram(const Expr& expr, std::vector<std::string> columns);
+
+    /**
+     * Evaluate the expression over a batch of rows.
+     *
+     * @param columns The input columns, each holding at least `rows` numbers.
+     * @param rows The number of rows.
+     * @return The value of each row.
+     * @throws RuntimeError if the expression fails and the batch is not empty.
+     * @throws std::invalid_argument if the columns do not match the compiled names or are too short.
+     */
+    [[nodiscard]] BatchResult run(std::span<const std::span<const double>> columns, std::size_t rows) const;
+
+    /**
+     * Visit method for the array literal expression type, which fails.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override;
+
+    /**
+     * Visit method for the assignment expression type, which fails.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override;
+
+    /**
+     * Visit method for the binary expression type.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override;
+
+    /**
+     * Visit method for the call expression type.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit method for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override;
+
+    /**
+     * Visit method for the grouping expression type.
+     *
+     * @param expr The grouping expression to visit.
+     */
+    void visitGroupingExpr(const Grouping& expr) override {
+        expr.expression().accept(*this);
+    }
+
+    /**
+     * Visit method for the index expression type, which fails.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override;
+
+    /**
+     * Visit method for the literal expression type.
+     *
+     * @param expr The literal expression to visit.
+     */
+    void visitLiteralExpr(const Lit& expr) override;
+
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override;
+
+    /**
+     * Visit method for the property set expression type.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override;
+
+    /**
+     * Visit method for the element set expression type, which fails.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override;
+
+    /**
+     * Visit method for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override;
+
+    /**
+     * Visit method for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override;
+
+    /**
+     * Visit method for the unary expression type.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override;
+
+    /**
+     * Visit method for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override;
+
+private:
+    /**
+     * Add a constant slot.
+     *
+     * @param value The constant value.
+     * @return The slot.
+     */
+    [[nodiscard]] Slot constant(std::any value);
+
+    /**
+     * Add an instruction writing a fresh register.
+     *
+     * @param op The operator.
+     * @param left The left operand.
+     * @param right The right operand.
+     * @param shape Shape of the register, Slot::Shape::NUMBERS or Slot::Shape::BOOLEANS.
+     * @return The register slot.
+     */
+    [[nodiscard]] Slot emit(TokenType op, Slot left, Slot right, Slot::Shape shape);
+
+    /**
+     * Record a runtime error, keeping the first one as the interpreter would.
+     *
+     * @param error The runtime error.
+     * @return A placeholder slot for the failed node.
+     */
+    [[nodiscard]] Slot fail(const RuntimeError& error);
+
+    /**
+     * Get the value kind of a slot, as OperandTypes::kindOf would classify its values.
+     *
+     * @param slot The slot.
+     * @return The kind bit.
+     */
+    [[nodiscard]] std::uint8_t kindOf(const Slot& slot) const;
+
+    /**
+     * Get a value standing in for every value of a slot, to check operand types once per node.
+     *
+     * @param slot The slot.
+     * @return The constant of a scalar slot, otherwise an arbitrary value of the slot's kind.
+     */
+    [[nodiscard]] std::any sample(const Slot& slot) const;
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "heap.h"
+#include "object.h"
+
+#include <any>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Forward declarations.
+class ChannelBuffer;
+class Map;
+class Waiter;
+
+/**
+ * A value copied out of the heap of one task, to be rebuilt on the heap of another. Tasks share no heap, so
+ * values cross between them by copy: nil, booleans, numbers, strings, arrays and maps of such values. A channel
+ * crosses as a new handle on the same buffer. Functions, classes and instances stay in the task that made them.
+ */
+class Message {
+private:
+    /**
+     * The copied value. A map is held as its keys and values, alternating, in insertion order.
+     */
+    std::variant<std::monostate, bool, double, std::string, std::vector<double>, std::vector<Message>,
+                 std::shared_ptr<ChannelBuffer>>
+        m_value;
+
+public:
+    /**
+     * Constructs a nil message.
+     */
+    Message() = default;
+
+    /**
+     * Copy a value out of its heap.
+     *
+     * @param value The value.
+     * @return The message.
+     * @throws NativeError if the value, or a value in a map, cannot be sent, or a map is nested in itself.
+     */
+    [[nodiscard]] static Message pack(const std::any& value);
+
+    /**
+     * Rebuild the value on a heap.
+     *
+     * @param heap The heap to allocate strings, arrays, maps and channels on.
+     * @return The value.
+     */
+    [[nodiscard]] std::any unpack(Heap& heap) const;
+
+private:
+    /**
+     * Copy a value out of its heap.
+     *
+     * @param value The value.
+     * @param open The maps being copied, enclosing this value.
+     * @return The message.
+     * @throws NativeError if the value cannot be sent.
+     */
+    [[nodiscard]] static Message pack(const std::any& value, std::vector<const Map*>& open);
+};
+
+/**
+ * The buffer of a channel, shared by the handles every task holding the channel has: a bounded ring of messages,
+ * and the tasks blocked sending to it while it is full or receiving from it while it is empty.
+ *
+ * The ring is the bounded multi-producer multi-consumer queue of Dmitry Vyukov: each slot has a sequence number
+ * telling whether it is ready to be written or read at a given position, so a send or a receive that need not
+ * block claims its position with one compare-and-swap and takes no lock. Only blocking takes the mutex, to
+ * register with the waiting tasks, and so does waking one, which senders and receivers skip while none waits.
+ */
+class ChannelBuffer {
+public:
+    /**
+     * Largest capacity of a channel, bounding the ring a script may allocate.
+     */
+    static constexpr std::size_t MAX_CAPACITY = std::size_t{1} << 20;
+
+private:
+    /**
+     * A slot of the ring.
+     */
+    struct Slot {
+        /**
+         * Twice the position the slot is next written at, or that plus one once written and until read. Doubling
+         * tells a written slot from a free one even in a ring of a single slot.
+         */
+        std::atomic<std::size_t> sequence;
+
+        /**
+         * The message, nil while the slot is free.
+         */
+        Message message;
+    };
+
+    /**
+     * Alignment keeping the positions of senders and receivers on cache lines of their own.
+     */
+    static constexpr std::size_t LINE = 64;
+
+    /**
+     * The ring.
+     */
+    std::unique_ptr<Slot[]> m_slots;
+
+    /**
+     * Number of slots.
+     */
+    std::size_t m_capacity;
+
+    /**
+     * Position of the next send.
+     */
+    alignas(LINE) std::atomic<std::size_t> m_head = 0;
+
+    /**
+     * Position of the next receive.
+     */
+    alignas(LINE) std::atomic<std::size_t> m_tail = 0;
+
+    /**
+     * Number of blocked senders, read without the lock to skip waking when none waits.
+     */
+    alignas(LINE) std::atomic<std::size_t> m_sending = 0;
+
+    /**
+     * Number of blocked receivers, read without the lock to skip waking when none waits.
+     */
+    std::atomic<std::size_t> m_receiving = 0;
+
+    /**
+     * Guards the waiters.
+     */
+    std::mutex m_mutex;
+
+    /**
+     * Senders blocked while the ring is full, in the order they blocked.
+     */
+    std::deque<Waiter*> m_senders;
+
+    /**
+     * Receivers blocked while the ring is empty, in the order they blocked.
+     */
+    std::deque<Waiter*> m_receivers;
+
+public:
+    /**
+     * Constructs an empty channel buffer.
+     *
+     * @param capacity Number of messages it holds before sending blocks, from 1 to MAX_CAPACITY.
+     */
+    explicit ChannelBuffer(std::size_t capacity);
+
+    /**
+     * Get the number of messages the buffer holds before sending blocks.
+     *
+     * @return The capacity.
+     */
+    [[nodiscard]] std::size_t capacity() const noexcept {
+        return m_capacity;
+    }
+
+    /**
+     * Send a message, blocking while the buffer is full.
+     *
+     * @param message The message.
+     * @throws NativeError if every task is blocked, so the buffer will never have room.
+     */
+    void send(Message message);
+
+    /**
+     * Receive the oldest message, blocking while the buffer is empty.
+     *
+     * @return The message.
+     * @throws NativeError if every task is blocked, so the buffer will never have a message.
+     */
+    [[nodiscard]] Message receive();
+
+private:
+    /**
+     * Append a message unless the ring is full.
+     *
+     * @param message The message, moved from only if appended.
+     * @return True if the message was appended.
+     */
+    bool tryPush(Message& message) noexcept;
+
+    /**
+     * Take the oldest message unless the ring is empty.
+     *
+     * @param message Receives the message.
+     * @return True if a message was taken.
+     */
+    bool tryPop(Message& message) noexcept;
+
+    /**
+     * Wake the first of some waiters, if any, after making progress they may be waiting for.
+     *
+     * @param waiters The waiters.
+     * @param count Their number.
+     */
+    void wakeOne(std::deque<Waiter*>& waiters, std::atomic<std::size_t>& count);
+
+    /**
+     * Register a waiter, before retrying the operation it waits to complete and blocking. Must be called with the
+     * mutex held.
+     *
+     * @param waiters The waiters to register with.
+     * @param count Their number.
+     * @param waiter The waiter.
+     */
+    static void enlist(std::deque<Waiter*>& waiters, std::atomic<std::size_t>& count, Waiter& waiter);
+
+    /**
+     * Unregister a waiter, unless whoever woke it already did. Must be called with the mutex held.
+     *
+     * @param waiters The waiters it registered with.
+     * @param count Their number.
+     * @param waiter The waiter.
+     */
+    static void delist(std::deque<Waiter*>& waiters, std::atomic<std::size_t>& count, Waiter& waiter);
+};
+
+/**
+ * A channel value: a handle on a channel buffer, which tasks send each other messages through. Handles are
+ * compared by identity; a channel received from another task is a new handle on the same buffer.
+ */
+class Channel : public Object {
+private:
+    /**
+     * The buffer.
+     */
+    std::shared_ptr<ChannelBuffer> m_buffer;
+
+public:
+    /**
+     * Constructs a handle.
+     *
+     * @param buffer The buffer.
+     */
+    explicit Channel(std::shared_ptr<ChannelBuffer> buffer) : m_buffer(std::move(buffer)) {}
+
+    /**
+     * Get the buffer.
+     *
+     * @return The buffer.
+     */
+    [[nodiscard]] const std::shared_ptr<ChannelBuffer>& buffer() const noexcept {
+        return m_buffer;
+    }
+
+    /**
+     * Channels refer to no other object of the heap.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& /*heap*/) const override {}
+
+    /**
+     * Get the memory the handle holds. The buffer is shared with other heaps and not counted.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Channel);
+    }
+};
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "closure.h"
+#include "heap.h"
+#include "object.h"
+#include "shape.h"
+#include "token.h"
+
+#include <algorithm>
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * A class value: its methods, inherited ones included, and the root shape of its instances.
+ * Methods are flattened into one table when the class is declared, so an inline cache entry is an index into it
+ * and a miss never walks the superclass chain.
+ */
+class ClassObject : public Object {
+private:
+    /**
+     * Identifier of the class, never reused, which caches of `super` lookups are keyed by.
+     */
+    std::uint64_t m_id;
+
+    /**
+     * Name of the class.
+     */
+    std::string m_name;
+
+    /**
+     * The superclass, may be null.
+     */
+    ClassObject* m_superclass;
+
+    /**
+     * Inherited methods followed by the new methods of the class, overrides replacing what they override.
+     */
+    std::vector<Closure*> m_methods;
+
+    /**
+     * Index of each method in the table, only consulted on cache misses.
+     * Uses transparent hash, so lookups by string_view build no string.
+     */
+    std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>> m_index;
+
+    /**
+     * The `init` method, may be null.
+     */
+    const Closure* m_initializer = nullptr;
+
+    /**
+     * Shape of a new instance, without fields, and through its transitions every shape of the instances.
+     */
+    std::unique_ptr<Shape> m_shape;
+
+    /**
+     * Number of fields instances have ended up with, reserved up front for new ones.
+     */
+    std::uint32_t m_fieldHint = 0;
+
+public:
+    /**
+     * Constructs a class inheriting the methods of its superclass.
+     *
+     * @param name Name of the class.
+     * @param superclass The superclass, may be null.
+     */
+    ClassObject(std::string name, ClassObject* superclass);
+
+    /**
+     * Get the identifier of the class.
+     *
+     * @return The identifier.
+     */
+    [[nodiscard]] std::uint64_t id() const noexcept {
+        return m_id;
+    }
+
+    /**
+     * Get the name of the class.
+     *
+     * @return The name.
+     */
+    [[nodiscard]] const std::string& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the superclass.
+     *
+     * @return The superclass, may be null.
+     */
+    [[nodiscard]] const ClassObject* superclass() const noexcept {
+        return m_superclass;
+    }
+
+    /**
+     * Get the shape of a new instance.
+     *
+     * @return The root shape.
+     */
+    [[nodiscard]] Shape& shape() const noexcept {
+        return *m_shape;
+    }
+
+    /**
+     * Get the number of fields to reserve for a new instance.
+     *
+     * @return The number of fields.
+     */
+    [[nodiscard]] std::uint32_t fieldHint() const noexcept {
+        return m_fieldHint;
+    }
+
+    /**
+     * Record that an instance grew to a number of fields.
+     *
+     * @param fields The number of fields.
+     */
+    void grow(std::uint32_t fields) noexcept {
+        m_fieldHint = std::max(m_fieldHint, fields);
+    }
+
+    /**
+     * Define a method of the class, overriding any inherited method of the same name.
+     *
+     * @param method The method.
+     */
+    void define(Closure* method);
+
+    /**
+     * Find a method, inherited or not.
+     *
+     * @param name The method name.
+     * @return The index of the method in the table, or nothing if the class has no such method.
+     */
+    [[nodiscard]] std::optional<std::uint32_t> find(std::string_view name) const;
+
+    /**
+     * Get a method.
+     *
+     * @param index Index of the method in the table.
+     * @return The method.
+     */
+    [[nodiscard]] Closure* method(std::uint32_t index) const noexcept {
+        return m_methods[index];
+    }
+
+    /**
+     * Get the initializer.
+     *
+     * @return The `init` method, or nullptr if the class has none.
+     */
+    [[nodiscard]] const Closure* initializer() const noexcept {
+        return m_initializer;
+    }
+
+    /**
+     * Mark the superclass and the methods.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override;
+
+    /**
+     * Get the memory the class holds, shapes excluded.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(ClassObject) + m_methods.capacity() * sizeof(Closure*);
+    }
+};
+
+/**
+ * An instance of a class: its class, its shape and its fields, stored densely at the offsets the shape assigns.
+ */
+class Instance : public Object {
+private:
+    /**
+     * The class.
+     */
+    ClassObject* m_class;
+
+    /**
+     * The shape, naming the fields, owned by the class.
+     */
+    Shape* m_shape;
+
+    /**
+     * The fields, indexed by offset.
+     */
+    std::vector<std::any> m_fields;
+
+public:
+    /**
+     * Constructs an instance without fields.
+     *
+     * @param klass The class.
+     */
+    explicit Instance(ClassObject* klass) : m_class(klass), m_shape(&m_class->shape()) {
+        m_fields.reserve(m_class->fieldHint());
+    }
+
+    /**
+     * Get the class.
+     *
+     * @return The class.
+     */
+    [[nodiscard]] const ClassObject& klass() const noexcept {
+        return *m_class;
+    }
+
+    /**
+     * Get the shape.
+     *
+     * @return The shape.
+     */
+    [[nodiscard]] Shape& shape() const noexcept {
+        return *m_shape;
+    }
+
+    /**
+     * Get a field.
+     *
+     * @param offset Offset of the field in the shape.
+     * @return The value of the field.
+     */
+    [[nodiscard]] std::any& field(std::uint32_t offset) noexcept {
+        return m_fields[offset];
+    }
+
+    /**
+     * Add a field, moving the instance to the shape reached by adding it.
+     *
+     * @param shape The child shape of the current shape.
+     * @param value The value of the field.
+     */
+    void add(Shape& shape, std::any value) {
+        m_fields.push_back(std::move(value));
+        m_shape = &shape;
+        m_class->grow(m_shape->size());
+    }
+
+    /**
+     * Mark the class and the values of the fields.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override {
+        heap.mark(m_class);
+        for (const auto& field : m_fields) {
+            heap.mark(field);
+        }
+    }
+
+    /**
+     * Get the memory the instance holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Instance) + m_fields.capacity() * sizeof(std::any);
+    }
+};
+
+/**
+ * A method read as a value, bound to the instance it was read from.
+ */
+class BoundMethod : public Object {
+private:
+    /**
+     * The instance, passed as `this`.
+     */
+    Instance* m_receiver;
+
+    /**
+     * The method.
+     */
+    Closure* m_method;
+
+public:
+    /**
+     * Constructs a bound method.
+     *
+     * @param receiver The instance.
+     * @param method The method.
+     */
+    BoundMethod(Instance* receiver, Closure* method) : m_receiver(receiver), m_method(method) {}
+
+    /**
+     * Get the instance the method is bound to.
+     *
+     * @return The receiver.
+     */
+    [[nodiscard]] Instance* receiver() const noexcept {
+        return m_receiver;
+    }
+
+    /**
+     * Get the method.
+     *
+     * @return The method.
+     */
+    [[nodiscard]] const Closure& method() const noexcept {
+        return *m_method;
+    }
+
+    /**
+     * Mark the instance and the method.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override {
+        heap.mark(m_receiver);
+        heap.mark(m_method);
+    }
+
+    /**
+     * Get the memory the bound method holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(BoundMethod);
+    }
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "heap.h"
+#include "object.h"
+#include "stmt.h"
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Forward declarations.
+class ClassObject;
+
+/**
+ * Global slots of a program, pointing into the global table of the interpreter running it.
+ */
+using GlobalSlots = std::vector<std::any*>;
+
+/**
+ * Box holding a variable that closures capture, shared by the frame declaring it and every closure using it.
+ * Variables nobody captures stay unboxed in their frame slot.
+ */
+class Cell : public Object {
+private:
+    /**
+     * The value of the variable.
+     */
+    std::any m_value;
+
+public:
+    /**
+     * Constructs a cell.
+     *
+     * @param value The initial value.
+     */
+    explicit Cell(std::any value) : m_value(std::move(value)) {}
+
+    /**
+     * Get the value of the variable.
+     *
+     * @return The value.
+     */
+    [[nodiscard]] std::any& value() noexcept {
+        return m_value;
+    }
+
+    /**
+     * Mark the value of the variable.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override {
+        heap.mark(m_value);
+    }
+
+    /**
+     * Get the memory the cell holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Cell);
+    }
+};
+
+/**
+ * A function value: a function declaration with the variables it captured when it was declared.
+ * Captures are a flat array holding only the variables the body uses, so a closure never keeps a whole
+ * enclosing frame alive, and an upvalue is read with one index whatever the nesting depth.
+ */
+class Closure : public Object {
+private:
+    /**
+     * Owner of the program declaring the function.
+     */
+    std::shared_ptr<const Program> m_program;
+
+    /**
+     * The declaration.
+     */
+    const Function& m_function;
+
+    /**
+     * Global slots of the program declaring the function, which its body was resolved against.
+     */
+    std::shared_ptr<const GlobalSlots> m_globals;
+
+    /**
+     * The captured variables, in the order of the captures of the declaration.
+     */
+    std::vector<Cell*> m_upvalues;
+
+    /**
+     * Class declaring the method the function is, or is nested in, whose superclass `super` refers to.
+     */
+    const ClassObject* m_home;
+
+public:
+    /**
+     * Constructs a closure.
+     *
+     * @param program Owner of the program declaring the function.
+     * @param function The declaration, owned by the program.
+     * @param globals Global slots of the program.
+     * @param upvalues The captured variables.
+     * @param home Class declaring the method the function is or is nested in, nullptr outside classes.
+     */
+    Closure(std::shared_ptr<const Program> program, const Function& function,
+            std::shared_ptr<const GlobalSlots> globals, std::vector<Cell*> upvalues, const ClassObject* home)
+        : m_program(std::move(program)), m_function(function), m_globals(std::move(globals)),
+          m_upvalues(std::move(upvalues)), m_home(home) {}
+
+    /**
+     * Get the owner of the program declaring the function.
+     *
+     * @return The program.
+     */
+    [[nodiscard]] const std::shared_ptr<const Program>& program() const noexcept {
+        return m_program;
+    }
+
+    /**
+     * Get the declaration.
+     *
+     * @return The function declaration.
+     */
+    [[nodiscard]] const Function& function() const noexcept {
+        return m_function;
+    }
+
+    /**
+     * Get the global slots the body was resolved against.
+     *
+     * @return The global slots.
+     */
+    [[nodiscard]] const std::shared_ptr<const GlobalSlots>& globals() const noexcept {
+        return m_globals;
+    }
+
+    /**
+     * Get a captured variable.
+     *
+     * @param index Index of the upvalue.
+     * @return The cell of the variable.
+     */
+    [[nodiscard]] Cell* upvalue(std::uint32_t index) const noexcept {
+        return m_upvalues[index];
+    }
+
+    /**
+     * Get the class declaring the method the function is, or is nested in.
+     *
+     * @return The class, or nullptr outside classes.
+     */
+    [[nodiscard]] const ClassObject* home() const noexcept {
+        return m_home;
+    }
+
+    /**
+     * Mark the captured variables and the class.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override;
+
+    /**
+     * Get the memory the closure holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Closure) + m_upvalues.capacity() * sizeof(Cell*);
+    }
+};
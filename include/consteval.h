@@ -0,0 +1,664 @@
+#pragma once
+
+#include "parser.h"
+#include "scanner.h"
+#include "token.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace tox {
+
+/**
+ * Error raised by a snippet during constant evaluation.
+ * Thrown from a consteval context it is not a constant expression, so it fails the C++ build.
+ */
+struct ConstEvalError {
+    /**
+     * The error message.
+     */
+    std::string_view message;
+
+    /**
+     * Line number in the snippet where the error occurred.
+     */
+    std::size_t line;
+};
+
+/**
+ * Result of a compile-time evaluation: nil, a boolean or a number.
+ */
+class ConstValue {
+public:
+    /**
+     * Kinds of constant values.
+     */
+    enum class Kind : std::uint8_t { NIL, BOOL, NUMBER };
+
+private:
+    /**
+     * Kind of the value.
+     */
+    Kind m_kind = Kind::NIL;
+
+    /**
+     * Boolean payload, valid for Kind::BOOL.
+     */
+    bool m_boolean = false;
+
+    /**
+     * Number payload, valid for Kind::NUMBER.
+     */
+    double m_number = 0.0;
+
+public:
+    /**
+     * Constructs a nil value.
+     */
+    constexpr ConstValue() = default;
+
+    /**
+     * Constructs a boolean value.
+     *
+     * @param boolean The boolean payload.
+     */
+    constexpr explicit ConstValue(bool boolean) : m_kind(Kind::BOOL), m_boolean(boolean) {}
+
+    /**
+     * Constructs a number value.
+     *
+     * @param number The number payload.
+     */
+    constexpr explicit ConstValue(double number) : m_kind(Kind::NUMBER), m_number(number) {}
+
+    /**
+     * Get the kind of the value.
+     *
+     * @return The kind.
+     */
+    [[nodiscard]] constexpr Kind kind() const noexcept {
+        return m_kind;
+    }
+
+    /**
+     * Check if the value is nil.
+     *
+     * @return True if the value is nil, false otherwise.
+     */
+    [[nodiscard]] constexpr bool isNil() const noexcept {
+        return m_kind == Kind::NIL;
+    }
+
+    /**
+     * Get the boolean payload.
+     *
+     * @return The boolean, false if the value is not a boolean.
+     */
+    [[nodiscard]] constexpr bool asBool() const noexcept {
+        return m_boolean;
+    }
+
+    /**
+     * Get the number payload.
+     *
+     * @return The number, 0 if the value is not a number.
+     */
+    [[nodiscard]] constexpr double asNumber() const noexcept {
+        return m_number;
+    }
+};
+
+namespace detail {
+
+/**
+ * Token produced by the constant scanner, viewing into the snippet.
+ */
+struct ConstToken {
+    /**
+     * Type of the token.
+     */
+    TokenType type = TokenType::END_OF_FILE;
+
+    /**
+     * Lexeme (text) of the token.
+     */
+    std::string_view lexeme;
+
+    /**
+     * Line number where the token appears.
+     */
+    std::size_t line = 1;
+};
+
+/**
+ * Intermediate value during constant evaluation. Strings may appear here,
+ * but cannot outlive the evaluation.
+ */
+struct ConstOperand {
+    /**
+     * Kind of the operand.
+     */
+    enum class Kind : std::uint8_t { NIL, BOOL, NUMBER, STRING } kind = Kind::NIL;
+
+    /**
+     * Boolean payload.
+     */
+    bool boolean = false;
+
+    /**
+     * Number payload.
+     */
+    double number = 0.0;
+
+    /**
+     * String payload.
+     */
+    std::string string;
+};
+
+/**
+ * Fused scanner, parser and evaluator for the expression grammar, usable in constant evaluation.
+ * Scans with the constexpr parts of Scanner (punctuation, literal extents, the keyword table) and matches the
+ * operator sets of Parser at each precedence level, but evaluates while parsing instead of building an AST.
+ */
+class ConstEvaluator {
+private:
+    /**
+     * Largest integer a double holds exactly.
+     */
+    static constexpr std::uint64_t MAX_EXACT_MANTISSA = std::uint64_t{1} << 53U;
+
+    /**
+     * Exactly representable powers of ten, for correctly rounded number literals.
+     */
+    static constexpr std::array<double, 23> POWERS_OF_TEN = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    /**
+     * Snippet to evaluate.
+     */
+    std::string_view m_source;
+
+    /**
+     * Current position in the snippet.
+     */
+    std::size_t m_current = 0;
+
+    /**
+     * Current line number in the snippet.
+     */
+    std::size_t m_line = 1;
+
+    /**
+     * Lookahead token.
+     */
+    ConstToken m_peek;
+
+    /**
+     * Last consumed token.
+     */
+    ConstToken m_previous;
+
+public:
+    /**
+     * Constructor for the evaluator.
+     *
+     * @param source The snippet to evaluate.
+     */
+    constexpr explicit ConstEvaluator(std::string_view source) : m_source(source) {
+        m_peek = scanToken();
+    }
+
+    /**
+     * Evaluate the snippet. Unlike Parser::parse, trailing tokens are an error.
+     *
+     * @return The value of the snippet.
+     */
+    [[nodiscard]] constexpr ConstValue evaluate() {
+        auto value = equality();
+        if (m_peek.type != TokenType::END_OF_FILE) {
+            throw error(m_peek, "Expect end of expression.");
+        }
+
+        switch (value.kind) {
+        case ConstOperand::Kind::BOOL:
+            return ConstValue(value.boolean);
+        case ConstOperand::Kind::NUMBER:
+            return ConstValue(value.number);
+        case ConstOperand::Kind::STRING:
+            throw error(m_previous, "String results cannot leave constant evaluation.");
+        default:
+            return {};
+        }
+    }
+
+private:
+    /**
+     * Parse and evaluate an equality expression.
+     *
+     * @return The value of the expression.
+     */
+    [[nodiscard]] constexpr ConstOperand equality() {
+        auto left = comparison();
+
+        while (matchAny(Parser::EQUALITY_OPERATORS)) {
+            auto op = m_previous;
+            auto right = comparison();
+            left = boolean(isEqual(left, right) == (op.type == TokenType::EQUAL_EQUAL));
+        }
+
+        return left;
+    }
+
+    /**
+     * Parse and evaluate a comparison expression.
+     *
+     * @return The value of the expression.
+     */
+    [[nodiscard]] constexpr ConstOperand comparison() {
+        auto left = term();
+
+        while (matchAny(Parser::COMPARISON_OPERATORS)) {
+            auto op = m_previous;
+            auto right = term();
+            checkNumberOperands(op, left, right);
+
+            switch (op.type) {
+            case TokenType::GREATER:
+                left = boolean(left.number > right.number);
+                break;
+            case TokenType::GREATER_EQUAL:
+                left = boolean(left.number >= right.number);
+                break;
+            case TokenType::LESS:
+                left = boolean(left.number < right.number);
+                break;
+            default:
+                left = boolean(left.number <= right.number);
+                break;
+            }
+        }
+
+        return left;
+    }
+
+    /**
+     * Parse and evaluate a term expression.
+     *
+     * @return The value of the expression.
+     */
+    [[nodiscard]] constexpr ConstOperand term() {
+        auto left = factor();
+
+        while (matchAny(Parser::TERM_OPERATORS)) {
+            auto op = m_previous;
+            auto right = factor();
+
+            if (op.type == TokenType::PLUS && left.kind == ConstOperand::Kind::STRING &&
+                right.kind == ConstOperand::Kind::STRING) {
+                left.string += right.string;
+            } else if (op.type == TokenType::PLUS && (left.kind != ConstOperand::Kind::NUMBER ||
+                                                      right.kind != ConstOperand::Kind::NUMBER)) {
+                throw error(op, "Operands must be two numbers or two strings.");
+            } else {
+                checkNumberOperands(op, left, right);
+                left.number = op.type == TokenType::PLUS ? left.number + right.number : left.number - right.number;
+            }
+        }
+
+        return left;
+    }
+
+    /**
+     * Parse and evaluate a factor expression.
+     *
+     * @return The value of the expression.
+     */
+    [[nodiscard]] constexpr ConstOperand factor() {
+        auto left = unary();
+
+        while (matchAny(Parser::FACTOR_OPERATORS)) {
+            auto op = m_previous;
+            auto right = unary();
+            checkNumberOperands(op, left, right);
+            left.number = op.type == TokenType::STAR ? left.number * right.number : divide(left.number, right.number);
+        }
+
+        return left;
+    }
+
+    /**
+     * Parse and evaluate a unary expression.
+     *
+     * @return The value of the expression.
+     */
+    [[nodiscard]] constexpr ConstOperand unary() {
+        if (matchAny(Parser::UNARY_OPERATORS)) {
+            auto op = m_previous;
+            auto right = unary();
+
+            if (op.type == TokenType::BANG) {
+                return boolean(!isTruthy(right));
+            }
+            if (right.kind != ConstOperand::Kind::NUMBER) {
+                throw error(op, "Operand must be a number.");
+            }
+            right.number = -right.number;
+
+            return right;
+        }
+
+        return primary();
+    }
+
+    /**
+     * Parse and evaluate a primary expression.
+     *
+     * @return The value of the expression.
+     */
+    [[nodiscard]] constexpr ConstOperand primary() {
+        if (match(TokenType::FALSE)) {
+            return boolean(false);
+        }
+        if (match(TokenType::TRUE)) {
+            return boolean(true);
+        }
+        if (match(TokenType::NIL)) {
+            return {};
+        }
+        if (match(TokenType::NUMBER)) {
+            ConstOperand value;
+            value.kind = ConstOperand::Kind::NUMBER;
+            value.number = number(m_previous);
+
+            return value;
+        }
+        if (match(TokenType::STRING)) {
+            // Trim the surrounding quotes.
+            ConstOperand value;
+            value.kind = ConstOperand::Kind::STRING;
+            value.string = m_previous.lexeme.substr(1, m_previous.lexeme.size() - 2);
+
+            return value;
+        }
+        if (match(TokenType::LEFT_PAREN)) {
+            auto value = equality();
+            if (!match(TokenType::RIGHT_PAREN)) {
+                throw error(m_peek, "Expect ')' after expression.");
+            }
+
+            return value;
+        }
+
+        throw error(m_peek, "Expect expression.");
+    }
+
+    /**
+     * Scans the next token, following Scanner::scanToken.
+     *
+     * @return The scanned token.
+     */
+    [[nodiscard]] constexpr ConstToken scanToken() {
+        while (m_current < m_source.size()) {
+            auto start = m_current;
+            char c = m_source[m_current++];
+
+            char next = m_current < m_source.size() ? m_source[m_current] : '\0';
+            if (auto punctuation = Scanner::punctuation(c, next)) {
+                m_current += punctuation->length - 1;
+                return token(punctuation->type, start);
+            }
+
+            switch (c) {
+            case '/':
+                // Not punctuation, so a comment, which goes until the end of the line.
+                while (m_current < m_source.size() && m_source[m_current] != '\n') {
+                    m_current++;
+                }
+
+                break;
+            case ' ':
+            case '\r':
+            case '\t':
+                // Ignore whitespace.
+                break;
+            case '\n':
+                m_line++;
+                break;
+            case '"':
+                while (m_current < m_source.size() && m_source[m_current] != '"') {
+                    if (m_source[m_current++] == '\n') {
+                        m_line++;
+                    }
+                }
+                if (m_current >= m_source.size()) {
+                    throw ConstEvalError{.message = "Unterminated string.", .line = m_line};
+                }
+
+                // The closing ".
+                m_current++;
+
+                return token(TokenType::STRING, start);
+            default:
+                if (Scanner::isDigit(c)) {
+                    m_current = Scanner::numberEnd(m_source, m_current);
+                    return token(TokenType::NUMBER, start);
+                }
+                if (Scanner::isAlpha(c)) {
+                    m_current = Scanner::identifierEnd(m_source, m_current);
+                    return token(Scanner::keyword(m_source.substr(start, m_current - start)), start);
+                }
+
+                throw ConstEvalError{.message = "Unexpected character.", .line = m_line};
+            }
+        }
+
+        return {.type = TokenType::END_OF_FILE, .lexeme = {}, .line = m_line};
+    }
+
+    /**
+     * Converts a number literal exactly as std::from_chars would, or rejects it.
+     * Only literals whose digits fit in 53 bits with at most 22 fraction digits are supported,
+     * since for those a single correctly rounded division gives the exact result.
+     *
+     * @param token The number token.
+     * @return The value of the literal.
+     */
+    [[nodiscard]] static constexpr double number(const ConstToken& token) {
+        std::uint64_t mantissa = 0;
+        std::size_t fractionDigits = 0;
+        bool fraction = false;
+
+        for (char c : token.lexeme) {
+            if (c == '.') {
+                fraction = true;
+                continue;
+            }
+
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+            if (mantissa > MAX_EXACT_MANTISSA) {
+                throw error(token, "Number literal is too precise for constant evaluation.");
+            }
+            if (fraction) {
+                fractionDigits++;
+            }
+        }
+
+        if (fractionDigits >= POWERS_OF_TEN.size()) {
+            throw error(token, "Number literal is too precise for constant evaluation.");
+        }
+
+        return static_cast<double>(mantissa) / POWERS_OF_TEN.at(fractionDigits);
+    }
+
+    /**
+     * Divides two numbers. Division by zero is not a constant expression in C++,
+     * so it is spelled out to give the same infinities as at runtime.
+     *
+     * @param a The dividend.
+     * @param b The divisor.
+     * @return The quotient.
+     */
+    [[nodiscard]] static constexpr double divide(double a, double b) {
+        if (b != 0.0) {
+            return a / b;
+        }
+        if (a == 0.0 || a != a) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        bool negative = (std::bit_cast<std::uint64_t>(a) >> 63U) != (std::bit_cast<std::uint64_t>(b) >> 63U);
+
+        return negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+    }
+
+    /**
+     * Determine the truthiness of an operand, following Interpreter::isTruthy.
+     *
+     * @param value The operand.
+     * @return True if the operand is considered "truthy", false otherwise.
+     */
+    [[nodiscard]] static constexpr bool isTruthy(const ConstOperand& value) {
+        if (value.kind == ConstOperand::Kind::NIL) {
+            return false;
+        }
+        if (value.kind == ConstOperand::Kind::BOOL) {
+            return value.boolean;
+        }
+
+        return true;
+    }
+
+    /**
+     * Check if two operands are equal, following Interpreter::isEqual.
+     *
+     * @param a The first operand.
+     * @param b The second operand.
+     * @return True if the operands are equal, false otherwise.
+     */
+    [[nodiscard]] static constexpr bool isEqual(const ConstOperand& a, const ConstOperand& b) {
+        if (a.kind != b.kind) {
+            return false;
+        }
+
+        switch (a.kind) {
+        case ConstOperand::Kind::BOOL:
+            return a.boolean == b.boolean;
+        case ConstOperand::Kind::NUMBER:
+            return a.number == b.number;
+        case ConstOperand::Kind::STRING:
+            return a.string == b.string;
+        default:
+            return true;
+        }
+    }
+
+    /**
+     * Check that both operands are numbers.
+     *
+     * @param op The operator token for error reporting.
+     * @param left The left operand.
+     * @param right The right operand.
+     */
+    static constexpr void checkNumberOperands(const ConstToken& op, const ConstOperand& left,
+                                              const ConstOperand& right) {
+        if (left.kind != ConstOperand::Kind::NUMBER || right.kind != ConstOperand::Kind::NUMBER) {
+            throw error(op, "Operands must be numbers.");
+        }
+    }
+
+    /**
+     * Make a boolean operand.
+     *
+     * @param value The boolean.
+     * @return The operand.
+     */
+    [[nodiscard]] static constexpr ConstOperand boolean(bool value) {
+        ConstOperand operand;
+        operand.kind = ConstOperand::Kind::BOOL;
+        operand.boolean = value;
+
+        return operand;
+    }
+
+    /**
+     * Make an error at a token.
+     *
+     * @param token The token where the error occurred.
+     * @param message The error message.
+     * @return The error to throw.
+     */
+    [[nodiscard]] static constexpr ConstEvalError error(const ConstToken& token, std::string_view message) {
+        return {.message = message, .line = token.line};
+    }
+
+    /**
+     * Make a token spanning from start to the current position.
+     *
+     * @param type Type of the token.
+     * @param start Position where the token starts.
+     * @return The token.
+     */
+    [[nodiscard]] constexpr ConstToken token(TokenType type, std::size_t start) const {
+        return {.type = type, .lexeme = m_source.substr(start, m_current - start), .line = m_line};
+    }
+
+    /**
+     * Matches the lookahead token against multiple types.
+     *
+     * @param types The token types to match against.
+     * @return True if a match was found and the evaluator advanced, false otherwise.
+     */
+    template <typename... Types>
+    [[nodiscard]] constexpr bool match(Types... types) {
+        if (((m_peek.type == types) || ...)) {
+            m_previous = m_peek;
+            m_peek = scanToken();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Matches the lookahead token against a set of operators of Parser.
+     *
+     * @param types The token types to match against.
+     * @return True if a match was found and the evaluator advanced, false otherwise.
+     */
+    template <std::size_t N>
+    [[nodiscard]] constexpr bool matchAny(const std::array<TokenType, N>& types) {
+        for (auto type : types) {
+            if (m_peek.type == type) {
+                m_previous = m_peek;
+                m_peek = scanToken();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Evaluate a Tox expression while compiling the C++ program.
+ * Scan, parse and runtime errors are not constant expressions, so they fail the build.
+ *
+ * Example: `static_assert(tox::constEval("(1 + 2) * 3").asNumber() == 9);`
+ *
+ * @param source The expression to evaluate.
+ * @return The value of the expression.
+ */
+[[nodiscard]] consteval ConstValue constEval(std::string_view source) {
+    return detail::ConstEvaluator(source).evaluate();
+}
+
+} // namespace tox
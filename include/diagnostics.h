@@ -0,0 +1,128 @@
+#pragma once
+
+#include "token.h"
+
+#include <cstddef>
+#include <iostream>
+#include <ostream>
+#include <string_view>
+
+// Forward declarations.
+class RuntimeError;
+
+/**
+ * Error reporting context of one Tox instance.
+ * Holds the error flags of the current run and the stream errors are written to,
+ * so instances on different threads never share state.
+ */
+class Diagnostics {
+private:
+    /**
+     * Stream receiving the error messages.
+     */
+    std::ostream* m_stream;
+
+    /**
+     * Flag, whether a syntax error has occurred.
+     */
+    bool m_hadError = false;
+
+    /**
+     * Flag, whether a runtime error has occurred.
+     */
+    bool m_hadRuntimeError = false;
+
+    /**
+     * Number of syntax errors reported, never reset.
+     */
+    std::size_t m_errors = 0;
+
+    /**
+     * Number of runtime errors reported, never reset.
+     */
+    std::size_t m_runtimeErrors = 0;
+
+public:
+    /**
+     * Constructs a diagnostics context.
+     *
+     * @param stream Stream receiving the error messages, which must outlive the context.
+     */
+    explicit Diagnostics(std::ostream& stream = std::cerr) : m_stream(&stream) {}
+
+    /**
+     * Check whether a syntax error has occurred.
+     *
+     * @return True if an error has been reported since the last reset.
+     */
+    [[nodiscard]] bool hadError() const noexcept {
+        return m_hadError;
+    }
+
+    /**
+     * Check whether a runtime error has occurred.
+     *
+     * @return True if a runtime error has been reported since the last reset.
+     */
+    [[nodiscard]] bool hadRuntimeError() const noexcept {
+        return m_hadRuntimeError;
+    }
+
+    /**
+     * Get the number of syntax errors reported over the lifetime of the context.
+     *
+     * @return The number of syntax errors.
+     */
+    [[nodiscard]] std::size_t errors() const noexcept {
+        return m_errors;
+    }
+
+    /**
+     * Get the number of runtime errors reported over the lifetime of the context.
+     *
+     * @return The number of runtime errors.
+     */
+    [[nodiscard]] std::size_t runtimeErrors() const noexcept {
+        return m_runtimeErrors;
+    }
+
+    /**
+     * Clears the error flags, e.g. between REPL lines.
+     */
+    void reset() noexcept {
+        m_hadError = false;
+        m_hadRuntimeError = false;
+    }
+
+    /**
+     * Reports an error at a specific line.
+     *
+     * @param line Line number where the error occurred.
+     * @param msg Error message.
+     */
+    void error(std::size_t line, std::string_view msg);
+
+    /**
+     * Reports an error at a specific token.
+     *
+     * @param token Token where the error occurred.
+     * @param msg Error message.
+     */
+    void error(const Token& token, std::string_view msg);
+
+    /**
+     * Reports a runtime error.
+     *
+     * @param error The runtime error to report.
+     */
+    void runtimeError(const RuntimeError& error);
+
+    /**
+     * Reports an error at a specific line and location.
+     *
+     * @param line Line number where the error occurred.
+     * @param where Location within the line.
+     * @param msg Error message.
+     */
+    void report(std::size_t line, std::string_view where, std::string_view msg);
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "ast.h"
+
+#include <cstddef>
+#include <format>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * C++ emitter implementation using the ExprVisitor interface.
+ * Translates an expression into a standalone C++ translation unit that links against the tox runtime.
+ * Every node becomes one statement, so operands are evaluated left to right as in the interpreter,
+ * and operators go through the interpreter's own semantics, so results and runtime errors match. The only
+ * globals of an emitted program are the native functions every script sees.
+ */
+class CppEmitter : public ExprVisitor {
+private:
+    /**
+     * Names of the native functions the emitted program sees as globals.
+     */
+    std::vector<std::string> m_natives;
+
+    /**
+     * String stream to build the operator token declarations.
+     */
+    std::ostringstream m_tokens;
+
+    /**
+     * String stream to build the declarations of the globals the program uses, at the top of its function.
+     */
+    std::ostringstream m_globals;
+
+    /**
+     * Names of the variables holding the globals declared so far, by global name.
+     */
+    std::unordered_map<std::string, std::string> m_globalNames;
+
+    /**
+     * String stream to build the body of the program function.
+     */
+    std::ostringstream m_body;
+
+    /**
+     * Number of operator tokens declared so far.
+     */
+    std::size_t m_tokenCount = 0;
+
+    /**
+     * Number of values declared so far.
+     */
+    std::size_t m_valueCount = 0;
+
+    /**
+     * Name of the variable holding the result of the last visited expression.
+     */
+    std::string m_result;
+
+public:
+    /**
+     * Constructs an emitter.
+     *
+     * @param natives Names of the native functions the emitted program sees as globals.
+     */
+    explicit CppEmitter(std::vector<std::string> natives) : m_natives(std::move(natives)) {}
+
+    /**
+     * Emit a translation unit evaluating an expression and printing its result.
+     *
+     * @param expr The expression to emit.
+     * @param name Name of the source file, used in the header comment.
+     * @return The C++ source code.
+     */
+    [[nodiscard]] std::string emit(const Expr& expr, std::string_view name);
+
+    /**
+     * Visit method for the array literal expression type.
+     * The array is made first, then each element is stored once evaluated, as in the interpreter.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override;
+
+    /**
+     * Visit method for the assignment expression type.
+     * The value is evaluated, then assigned to the global of a native function, or the assignment fails like a
+     * read would.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override;
+
+    /**
+     * Visit method for the binary expression type.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override;
+
+    /**
+     * Visit method for the call expression type.
+     * Native functions are the only callable values of a single-expression program, so the callee and arguments
+     * are evaluated, then handed to Interpreter::callNative, which fails for any other callee.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit method for the property get expression type.
+     * No expression evaluates to an instance on its own, so the get fails once the object is evaluated.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override;
+
+    /**
+     * Visit method for the grouping expression type.
+     *
+     * @param expr The grouping expression to visit.
+     */
+    void visitGroupingExpr(const Grouping& expr) override;
+
+    /**
+     * Visit method for the index expression type.
+     * The object must be an array or a map before the index is evaluated, as in the interpreter.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override;
+
+    /**
+     * Visit method for the literal expression type.
+     *
+     * @param expr The literal expression to visit.
+     */
+    void visitLiteralExpr(const Lit& expr) override;
+
+    /**
+     * Visit method for the logical expression type.
+     * The right operand becomes a nested block, only entered if the left one does not decide the result.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override;
+
+    /**
+     * Visit method for the property set expression type.
+     * The object is evaluated, then the set fails before the value is, as in the interpreter.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override;
+
+    /**
+     * Visit method for the element set expression type.
+     * The object and the index are checked before the value is evaluated, as in the interpreter.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override;
+
+    /**
+     * Visit method for the super expression type, which always fails outside of a class.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override {
+        declareError(expr.keyword(), "Can't use 'super' outside of a class.");
+    }
+
+    /**
+     * Visit method for the this expression type, read like an undefined variable outside of a class.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override {
+        declareUndefined(expr.keyword());
+    }
+
+    /**
+     * Visit method for the unary expression type.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override;
+
+    /**
+     * Visit method for the variable expression type.
+     * The global of a native function is copied, so a later assignment does not change the value read; every
+     * other variable is undefined at runtime.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override;
+
+private:
+    /**
+     * Declare a constant for an operator token, so runtime errors report its line.
+     *
+     * @param token The operator token.
+     * @return Name of the declared constant.
+     */
+    [[nodiscard]] std::string declareToken(const Token& token);
+
+    /**
+     * Declare a value holding the result of an initializer expression.
+     *
+     * @param init The C++ initializer expression.
+     */
+    void declareValue(std::string_view init);
+
+    /**
+     * Get the variable holding a global, declaring it on first use.
+     *
+     * @param name The name of the global.
+     * @return Name of the variable, or nullptr if no native function has the name.
+     */
+    [[nodiscard]] const std::string* global(const std::string& name);
+
+    /**
+     * Declare a value whose initializer throws a runtime error.
+     *
+     * @param token The token the error is reported at.
+     * @param message The error message.
+     */
+    void declareError(const Token& token, std::string_view message);
+
+    /**
+     * Declare a value whose initializer throws the runtime error of an undefined variable.
+     *
+     * @param name The name token of the variable.
+     */
+    void declareUndefined(const Token& name) {
+        declareError(name, std::format("Undefined variable '{}'.", name.lexeme));
+    }
+
+    /**
+     * Quote a string as a C++ string literal.
+     *
+     * @param value The string to quote.
+     * @return The quoted and escaped string.
+     */
+    [[nodiscard]] static std::string quote(std::string_view value);
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "token.h"
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+/**
+ * Operand value kinds observed at a single operator node.
+ */
+struct OperandTypes {
+    /**
+     * Kind bit for nil operands.
+     */
+    static constexpr std::uint8_t NIL = 1U << 0U;
+
+    /**
+     * Kind bit for boolean operands.
+     */
+    static constexpr std::uint8_t BOOL = 1U << 1U;
+
+    /**
+     * Kind bit for number operands.
+     */
+    static constexpr std::uint8_t NUMBER = 1U << 2U;
+
+    /**
+     * Kind bit for string operands.
+     */
+    static constexpr std::uint8_t STRING = 1U << 3U;
+
+    /**
+     * Kinds observed for the left operand. Unused for unary operators.
+     */
+    std::uint8_t left = 0;
+
+    /**
+     * Kinds observed for the right (or only) operand.
+     */
+    std::uint8_t right = 0;
+
+    /**
+     * Get the kind bit of a value.
+     *
+     * @param value The value to classify.
+     * @return The kind bit, or 0 for unknown types.
+     */
+    [[nodiscard]] static std::uint8_t kindOf(const std::any& value) noexcept;
+
+    /**
+     * Check if both operands have only ever been of the given kind.
+     *
+     * @param kind The kind bit to check.
+     * @return True if both operands are monomorphic of that kind.
+     */
+    [[nodiscard]] constexpr bool both(std::uint8_t kind) const noexcept {
+        return left == kind && right == kind;
+    }
+};
+
+/**
+ * Type-feedback profile of operand kinds, keyed by the source location of each operator.
+ * Recorded while a script runs and loaded on the next run to pre-specialize evaluation.
+ */
+class TypeProfile {
+private:
+    /**
+     * Observed operand kinds by (line, column) of the operator token.
+     */
+    std::map<std::pair<std::size_t, std::size_t>, OperandTypes> m_nodes;
+
+public:
+    /**
+     * Record the operand of a unary operator.
+     *
+     * @param op The operator token.
+     * @param right The operand value.
+     */
+    void record(const Token& op, const std::any& right);
+
+    /**
+     * Record the operands of a binary operator.
+     *
+     * @param op The operator token.
+     * @param left The left operand value.
+     * @param right The right operand value.
+     */
+    void record(const Token& op, const std::any& left, const std::any& right);
+
+    /**
+     * Look up the feedback for an operator.
+     *
+     * @param op The operator token.
+     * @return The observed operand kinds, or nullptr if the operator has not been observed.
+     */
+    [[nodiscard]] const OperandTypes* lookup(const Token& op) const;
+
+    /**
+     * Write the profile to a file.
+     *
+     * @param path Path to the profile file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * Read a profile from a file.
+     *
+     * @param path Path to the profile file.
+     * @return The loaded profile.
+     * @throws std::runtime_error if the file cannot be read or is malformed.
+     */
+    [[nodiscard]] static TypeProfile load(const std::string& path);
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+
+#ifndef _WIN32
+#include <ucontext.h>
+#endif
+
+/**
+ * A function running on a native stack of its own, which it can leave midway and later be resumed on, by the
+ * thread that started it or by another. The stack is reserved up front and committed by the system as it is
+ * touched, so a fiber that stays shallow costs a few pages however large its reservation.
+ *
+ * Fibers switch with ucontext on POSIX systems and with the fiber API of Windows.
+ */
+class Fiber {
+public:
+    /**
+     * The function a fiber runs. It must not throw.
+     */
+    using Entry = void (*)(void* argument);
+
+private:
+#ifdef _WIN32
+    /**
+     * The fiber, as created by CreateFiberEx.
+     */
+    void* m_fiber = nullptr;
+
+    /**
+     * The fiber of the thread that resumed this one, switched back to on suspending.
+     */
+    void* m_caller = nullptr;
+#else
+    /**
+     * Registers of the fiber, saved while it is suspended.
+     */
+    ucontext_t m_context{};
+
+    /**
+     * Registers of the thread that resumed the fiber, restored on suspending.
+     */
+    ucontext_t m_caller{};
+
+    /**
+     * The reserved stack, its lowest page a guard.
+     */
+    void* m_stack = nullptr;
+
+    /**
+     * Size of the reserved stack, in bytes.
+     */
+    std::size_t m_stackSize = 0;
+
+    /**
+     * Lowest address of the stack of the thread that resumed the fiber, told to AddressSanitizer on suspending.
+     */
+    const void* m_callerStack = nullptr;
+
+    /**
+     * Size of the stack of the thread that resumed the fiber.
+     */
+    std::size_t m_callerStackSize = 0;
+#endif
+
+    /**
+     * The function to run.
+     */
+    Entry m_entry;
+
+    /**
+     * Argument of the function.
+     */
+    void* m_argument;
+
+    /**
+     * Flag, whether the function has returned.
+     */
+    bool m_done = false;
+
+public:
+    /**
+     * Constructs a fiber, which runs nothing until resumed.
+     *
+     * @param stackSize Size of the stack to reserve, in bytes.
+     * @param entry The function to run.
+     * @param argument Argument of the function.
+     * @throws std::bad_alloc if the stack cannot be reserved.
+     */
+    Fiber(std::size_t stackSize, Entry entry, void* argument);
+
+    /**
+     * Destructor. Frees the stack without unwinding it, so the fiber must have returned or hold nothing to
+     * destroy.
+     */
+    ~Fiber();
+
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
+    /**
+     * Run the fiber until it suspends or returns. Must be called from outside the fiber.
+     */
+    void resume();
+
+    /**
+     * Switch back to the thread that resumed the fiber. Must be called from the fiber.
+     */
+    void suspend();
+
+    /**
+     * Check whether the function has returned.
+     *
+     * @return True if the fiber is done.
+     */
+    [[nodiscard]] bool done() const noexcept {
+        return m_done;
+    }
+
+private:
+    /**
+     * Run the function of a fiber, then switch back for good.
+     *
+     * @param fiber The fiber.
+     */
+    [[noreturn]] static void run(Fiber& fiber) noexcept;
+};
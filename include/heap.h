@@ -0,0 +1,264 @@
+#pragma once
+
+#include "object.h"
+
+#include <algorithm>
+#include <any>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+/**
+ * Counters of the collections of a heap.
+ */
+struct HeapStats {
+    /**
+     * Number of collections.
+     */
+    std::uint64_t collections = 0;
+
+    /**
+     * Number of objects allocated.
+     */
+    std::uint64_t allocated = 0;
+
+    /**
+     * Number of objects freed by collections.
+     */
+    std::uint64_t freed = 0;
+
+    /**
+     * Number of bytes held by the objects alive after the last collection.
+     */
+    std::size_t liveBytes = 0;
+
+    /**
+     * Highest number of bytes the heap held before a collection.
+     */
+    std::size_t peakBytes = 0;
+
+    /**
+     * Time spent collecting.
+     */
+    std::chrono::nanoseconds pause{};
+
+    /**
+     * Longest collection.
+     */
+    std::chrono::nanoseconds maxPause{};
+
+    /**
+     * Write the counters as a table.
+     *
+     * @param stream The stream to write to.
+     */
+    void print(std::ostream& stream) const;
+};
+
+/**
+ * Owner of the objects of one interpreter, freeing the unreachable ones with a precise mark-sweep collector.
+ * Allocating never collects: the owner checks due() where every live value is reachable from its roots,
+ * marks the roots, and the heap traces and sweeps from them. The next collection is due once the heap
+ * has grown by the growth factor over what survived the last one.
+ */
+class Heap {
+public:
+    /**
+     * Number of bytes the heap may hold before its first collection.
+     */
+    static constexpr std::size_t INITIAL_THRESHOLD = std::size_t{1} << 20;
+
+    /**
+     * Default ratio between the size that triggers a collection and the size that survived the last one.
+     */
+    static constexpr double DEFAULT_GROWTH = 2.0;
+
+private:
+    /**
+     * Every object of the heap, most recent first.
+     */
+    Object* m_objects = nullptr;
+
+    /**
+     * Marked objects whose references are not traced yet.
+     */
+    std::vector<const Object*> m_gray;
+
+    /**
+     * Number of bytes held by the survivors of the last collection and the objects allocated since.
+     */
+    std::size_t m_bytes = 0;
+
+    /**
+     * Number of bytes past which a collection is due.
+     */
+    std::size_t m_threshold = INITIAL_THRESHOLD;
+
+    /**
+     * Ratio between the next threshold and the size that survived a collection.
+     */
+    double m_growth = DEFAULT_GROWTH;
+
+    /**
+     * Flag, whether a collection is due after every allocation.
+     */
+    bool m_stress = false;
+
+    /**
+     * Counters of the collections.
+     */
+    HeapStats m_stats;
+
+public:
+    /**
+     * Constructs an empty heap.
+     */
+    Heap() = default;
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    /**
+     * Destructor, freeing every object.
+     */
+    ~Heap();
+
+    /**
+     * Allocate an object on the heap.
+     *
+     * @tparam T The type of the object, derived from Object.
+     * @param args Arguments of its constructor.
+     * @return The object, alive until a collection finds it unreachable.
+     */
+    template <typename T, typename... Args>
+    [[nodiscard]] T* make(Args&&... args) {
+        auto* object = new T(std::forward<Args>(args)...);
+        object->m_next = m_objects;
+        m_objects = object;
+
+        m_bytes += object->size();
+        m_stats.allocated++;
+
+        return object;
+    }
+
+    /**
+     * Count memory an object acquired after it was made, such as the table of a growing map, towards the next
+     * collection.
+     *
+     * @param bytes Number of bytes acquired.
+     */
+    void account(std::size_t bytes) noexcept {
+        m_bytes += bytes;
+    }
+
+    /**
+     * Check whether the heap has grown enough to collect.
+     *
+     * @return True if a collection is due.
+     */
+    [[nodiscard]] bool due() const noexcept {
+        return m_bytes > m_threshold;
+    }
+
+    /**
+     * Set how much the heap may grow between collections.
+     *
+     * @param growth Ratio between the size that triggers a collection and the size that survived the last
+     *               one, at least 1.
+     */
+    void setGrowth(double growth) noexcept {
+        m_growth = growth < 1 ? 1 : growth;
+    }
+
+    /**
+     * Set whether a collection is due after every allocation, to find values the roots miss. Turning stress off
+     * restores the threshold the growth factor sets.
+     *
+     * @param stress True to collect as often as possible.
+     */
+    void setStress(bool stress) noexcept {
+        m_stress = stress;
+        m_threshold = threshold(m_stats.liveBytes);
+    }
+
+    /**
+     * Get the counters of the collections.
+     *
+     * @return The counters.
+     */
+    [[nodiscard]] const HeapStats& stats() const noexcept {
+        return m_stats;
+    }
+
+    /**
+     * Mark an object reachable.
+     *
+     * @param object The object, may be null.
+     */
+    void mark(const Object* object) {
+        if (object == nullptr || object->m_marked) {
+            return;
+        }
+
+        object->m_marked = true;
+        m_gray.push_back(object);
+    }
+
+    /**
+     * Mark the object a value refers to reachable, if any.
+     *
+     * @param value The value.
+     */
+    void mark(const std::any& value) {
+        mark(object(value));
+    }
+
+    /**
+     * Get the object a value refers to.
+     *
+     * @param value The value.
+     * @return The object, or null for a number, a boolean or nil.
+     */
+    [[nodiscard]] static const Object* object(const std::any& value);
+
+    /**
+     * Free every object unreachable from the roots.
+     *
+     * @param roots Callable marking the roots, given the heap.
+     */
+    template <typename Roots>
+    void collect(Roots&& roots) {
+        auto start = std::chrono::steady_clock::now();
+
+        roots(*this);
+        trace();
+        sweep(std::chrono::steady_clock::now() - start);
+    }
+
+private:
+    /**
+     * Trace the references of the marked objects until none is left unvisited.
+     */
+    void trace();
+
+    /**
+     * Free the unmarked objects, clear the marks of the others, and set the next threshold.
+     *
+     * @param marking Time spent marking, added to the pause.
+     */
+    void sweep(std::chrono::nanoseconds marking);
+
+    /**
+     * Compute the number of bytes past which a collection is due.
+     *
+     * @param live Number of bytes that survived the last collection.
+     * @return The threshold: the live bytes in stress mode, otherwise grown by the growth factor.
+     */
+    [[nodiscard]] std::size_t threshold(std::size_t live) const noexcept {
+        return m_stress ? live : std::max(INITIAL_THRESHOLD, static_cast<std::size_t>(live * m_growth));
+    }
+};
@@ -1,13 +1,33 @@
 #pragma once
 
+#include "array.h"
 #include "ast.h"
+#include "channel.h"
+#include "class.h"
+#include "closure.h"
+#include "diagnostics.h"
+#include "feedback.h"
+#include "heap.h"
+#include "map.h"
+#include "native.h"
+#include "object.h"
+#include "sink.h"
+#include "stmt.h"
+#include "text.h"
+#include "tier.h"
 
+#include <algorithm>
 #include <any>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <utility>
-
-// Forward declarations.
-class Tox;
+#include <vector>
 
 /**
  * Exception class for runtime errors during interpretation.
@@ -39,36 +59,846 @@ public:
 };
 
 /**
- * Interpreter class for evaluating expressions.
+ * Interpreter class for executing statements and evaluating expressions.
+ * An interpreter is used by one thread at a time; the trees it evaluates may be shared with other interpreters.
+ * Resolved variables live in flat slot arrays, unresolved ones are looked up by name in the global table.
+ * Call frames are windows of one value stack allocated up front: a caller pushes the arguments right where
+ * the parameter slots of the callee begin, so a call allocates nothing and copies no argument.
+ * Properties are found through the inline caches of the accessing nodes, keyed by the shape of the instance,
+ * so a field access is an index into the instance's field array once the site has seen its shape.
+ * Strings, closures and instances live on the interpreter's heap. Collections only run between statements,
+ * when the value stack, the globals and the values pinned by the expressions in progress hold every live value.
  */
-class Interpreter : public ExprVisitor {
+class Interpreter : public ExprVisitor, public StmtVisitor {
+    friend class ClosureCompiler;
+
+public:
+    /**
+     * Default number of evaluations after which a subtree is promoted to the closure tier.
+     */
+    static constexpr std::uint32_t DEFAULT_TIER_THRESHOLD = 100;
+
+    /**
+     * Height up to which subtrees are evaluated by native recursion, which is the fastest way.
+     * Taller trees are walked with an explicit stack, and are never promoted to the closure tier.
+     */
+    static constexpr std::uint32_t RECURSION_HEIGHT = 256;
+
+    /**
+     * Default maximum nesting depth of an evaluated tree.
+     */
+    static constexpr std::uint32_t DEFAULT_MAX_DEPTH = 1'000'000;
+
+    /**
+     * Number of slots the value stack holding every call frame starts with. It doubles whenever a call or an
+     * argument needs more, so a spawned task that stays shallow keeps a stack of a kilobyte.
+     */
+    static constexpr std::uint32_t INITIAL_STACK_SLOTS = 64;
+
+    /**
+     * Number of slots the value stack may grow to.
+     */
+    static constexpr std::uint32_t STACK_SLOTS = 16'384;
+
+    /**
+     * Maximum number of calls in progress.
+     */
+    static constexpr std::uint32_t MAX_CALLS = 1'000;
+
+    /**
+     * Native stack, in bytes, that the calls of a program may use below the frame interpreting it.
+     * Calls recurse natively, and a frame may itself recurse up to RECURSION_HEIGHT nodes deep, so calls are
+     * refused past this budget rather than trusting MAX_CALLS alone to keep the thread's stack from overflowing.
+     */
+    static constexpr std::size_t NATIVE_STACK_SIZE = std::size_t{4} << 20;
+
 private:
+    /**
+     * Context receiving runtime errors.
+     */
+    Diagnostics& m_diagnostics;
+
+    /**
+     * Sink receiving printed results.
+     */
+    OutputSink& m_output;
+
+    /**
+     * Heap of the objects values refer to.
+     */
+    Heap m_heap;
+
     /**
      * The result of the last evaluated expression.
      */
     std::any m_result;
 
+    /**
+     * Global variables by name. An empty value marks a name a program refers to but never defined.
+     * Nodes keep their address as the table grows, so the global slots of a program can point into it.
+     */
+    std::unordered_map<std::string, std::any, StringHash, std::equal_to<>> m_globals;
+
+    /**
+     * Global slots of the program being interpreted, pointing into the global table.
+     */
+    std::shared_ptr<const GlobalSlots> m_programGlobals;
+
+    /**
+     * Global slots the running code was resolved against: those of the program declaring the running
+     * closure, else those of the program being interpreted.
+     */
+    const GlobalSlots* m_globalSlots = nullptr;
+
+    /**
+     * Value stack. The program's frame starts at the bottom, each call's frame right above its caller's. Growing
+     * it moves every slot, so no reference into it may be held across a push or a call.
+     */
+    std::vector<std::any> m_stack;
+
+    /**
+     * First slot of the running frame.
+     */
+    std::uint32_t m_base = 0;
+
+    /**
+     * First free slot of the stack, above the running frame and the arguments pushed so far.
+     */
+    std::uint32_t m_top = 0;
+
+    /**
+     * Number of calls in progress.
+     */
+    std::uint32_t m_calls = 0;
+
+    /**
+     * Lowest native stack address a call may start at, 0 before the first interpretation.
+     */
+    std::uintptr_t m_stackLimit = 0;
+
+    /**
+     * The running closure, null in the program's frame.
+     */
+    const Closure* m_closure = nullptr;
+
+    /**
+     * Flag, whether a return statement is unwinding the statements of the running call.
+     */
+    bool m_returning = false;
+
+    /**
+     * Value of the return statement being unwound.
+     */
+    std::any m_returnValue;
+
+    /**
+     * Operand values of the explicit-stack walkers in progress, which the collector scans.
+     */
+    std::vector<const std::vector<std::any>*> m_operandStacks;
+
+    /**
+     * Owner of the program being interpreted, shared with background compilations.
+     */
+    std::shared_ptr<const Program> m_root;
+
+    /**
+     * Number of evaluations after which a subtree is promoted, 0 disables tiering.
+     */
+    std::uint32_t m_tierThreshold = DEFAULT_TIER_THRESHOLD;
+
+    /**
+     * Type feedback from a previous run, used to specialize compiled subtrees.
+     */
+    std::shared_ptr<const TypeProfile> m_profile;
+
+    /**
+     * Profile receiving the operand types observed by this run, may be null.
+     */
+    std::shared_ptr<TypeProfile> m_recorder;
+
+    /**
+     * Background compiler for hot subtrees.
+     */
+    TierCompiler m_tierCompiler;
+
+    /**
+     * Maximum nesting depth of an evaluated tree, enforced by the explicit-stack walker.
+     */
+    std::uint32_t m_maxDepth = DEFAULT_MAX_DEPTH;
+
+    /**
+     * Flag, whether tall trees are walked with an explicit stack.
+     */
+    bool m_explicitStack = true;
+
+    /**
+     * Height above which a tree is handed to the explicit-stack walker.
+     */
+    std::uint32_t m_deepHeight = RECURSION_HEIGHT;
+
 public:
+    /**
+     * Constructs an interpreter.
+     *
+     * @param diagnostics Context receiving runtime errors.
+     * @param output Sink receiving printed results. It is flushed by its owner.
+     */
+    Interpreter(Diagnostics& diagnostics, OutputSink& output)
+        : m_diagnostics(diagnostics), m_output(output), m_stack(INITIAL_STACK_SLOTS) {}
+
     /**
      * Interpret an expression and print the result.
+     * Hot subtrees are not promoted, since the caller keeps sole ownership of the tree.
      *
      * @param expr The expression to interpret.
      */
     void interpret(const Expr& expr);
 
+    /**
+     * Execute a shared program. Its global slots are bound to the global table by name, so globals persist
+     * across programs, as on the lines of the REPL.
+     * Subtrees evaluated more often than the tier threshold are compiled in the background.
+     *
+     * @param program The resolved program to execute.
+     */
+    void interpret(std::shared_ptr<const Program> program);
+
+    /**
+     * Run a function of a shared program as a task: declare the functions and classes of the program, but run
+     * none of its other statements, then call the function on its arguments.
+     *
+     * @param program The resolved program declaring the function.
+     * @param function The function, which captures no variable.
+     * @param paren The closing parenthesis of the spawned call, for error reporting.
+     * @param arguments The arguments, unpacked on the heap of the interpreter.
+     * @throws RuntimeError if the function, or a declaration, raises one.
+     */
+    void interpret(std::shared_ptr<const Program> program, const Function& function, const Token& paren,
+                   std::span<const Message> arguments);
+
+    /**
+     * Define a global variable, replacing any previous value.
+     *
+     * @param name The variable name.
+     * @param value The value.
+     */
+    void define(const std::string& name, std::any value) {
+        m_globals.insert_or_assign(name, std::move(value));
+    }
+
+    /**
+     * Define a native function as a global variable, replacing any previous value.
+     *
+     * @param function The binding, whose name is the name of the variable.
+     */
+    void defineNative(NativeFunction function) {
+        auto name = function.name;
+        define(name, m_heap.make<Native>(std::move(function)));
+    }
+
+    /**
+     * Get the heap of the objects values refer to.
+     *
+     * @return The heap.
+     */
+    [[nodiscard]] Heap& heap() noexcept {
+        return m_heap;
+    }
+
+    /**
+     * Set the number of evaluations after which a subtree is promoted to the closure tier.
+     *
+     * @param threshold The evaluation count, 0 disables tiering, including pre-specialization from a type profile.
+     */
+    void setTierThreshold(std::uint32_t threshold) noexcept {
+        m_tierThreshold = threshold;
+    }
+
+    /**
+     * Set whether trees taller than RECURSION_HEIGHT are walked with an explicit, heap-allocated stack.
+     * Without it, every tree is evaluated by native recursion, which overflows the stack on very deep trees.
+     *
+     * @param enabled True to use the explicit stack (the default), false to always recurse.
+     */
+    void setExplicitStack(bool enabled) noexcept {
+        m_explicitStack = enabled;
+        updateDeepHeight();
+    }
+
+    /**
+     * Set the maximum nesting depth of an evaluated tree.
+     * Reaching a node nested deeper raises a RuntimeError. Only enforced with the explicit stack.
+     *
+     * @param depth The maximum depth, at least 1.
+     */
+    void setMaxDepth(std::uint32_t depth) noexcept {
+        m_maxDepth = std::max<std::uint32_t>(depth, 1);
+        updateDeepHeight();
+    }
+
+    /**
+     * Set the type feedback used to specialize evaluation.
+     * Shared trees are compiled against the profile as soon as they are interpreted.
+     *
+     * @param profile The type profile, or nullptr to evaluate generically.
+     */
+    void setTypeProfile(std::shared_ptr<const TypeProfile> profile) noexcept {
+        m_profile = std::move(profile);
+    }
+
+    /**
+     * Record the operand types observed by unary and binary operators.
+     * Promotion is paused while recording, so every evaluation is observed.
+     *
+     * @param recorder The profile to record into, or nullptr to stop recording.
+     */
+    void recordTypes(std::shared_ptr<TypeProfile> recorder) noexcept {
+        m_recorder = std::move(recorder);
+    }
+
     /**
      * Evaluates a given expression and returns the result.
+     * Runs the compiled form if the expression has been promoted.
      *
      * @param expr The expression to evaluate.
      * @return The result of the evaluation as std::any.
      */
     [[nodiscard]] std::any eval(const Expr& expr) {
+        if (expr.height() > m_deepHeight) {
+            return evalDeep(expr);
+        }
+
+        if (const auto* compiled = expr.tier().compiled()) {
+            return (*compiled)(*this);
+        }
+
+        if (m_tierThreshold != 0 && expr.tier().hit() >= m_tierThreshold) {
+            promote(expr);
+        }
+
         expr.accept(*this);
 
         return m_result;
     }
 
+    /**
+     * Read a variable from the storage it was resolved to.
+     *
+     * @param name The name token of the variable.
+     * @param binding The storage of the variable.
+     * @return The value of the variable.
+     * @throws RuntimeError if the variable is global and not defined.
+     */
+    [[nodiscard]] const std::any& variable(const Token& name, const Binding& binding) const {
+        switch (binding.kind) {
+        case Binding::Kind::LOCAL:
+            return m_stack[m_base + binding.slot];
+        case Binding::Kind::CELL:
+            return cell(binding.slot).value();
+        case Binding::Kind::UPVALUE:
+            return m_closure->upvalue(binding.slot)->value();
+        case Binding::Kind::GLOBAL:
+            if (const auto& value = *(*m_globalSlots)[binding.slot]; value.has_value()) {
+                return value;
+            }
+
+            throw undefined(name);
+        default:
+            return lookup(name);
+        }
+    }
+
+    /**
+     * Assign a variable in the storage it was resolved to.
+     *
+     * @param name The name token of the variable.
+     * @param binding The storage of the variable.
+     * @param value The value.
+     * @throws RuntimeError if the variable is global and not defined.
+     */
+    void assign(const Token& name, const Binding& binding, std::any value) {
+        switch (binding.kind) {
+        case Binding::Kind::LOCAL:
+            m_stack[m_base + binding.slot] = std::move(value);
+            break;
+        case Binding::Kind::CELL:
+            cell(binding.slot).value() = std::move(value);
+            break;
+        case Binding::Kind::UPVALUE:
+            m_closure->upvalue(binding.slot)->value() = std::move(value);
+            break;
+        case Binding::Kind::GLOBAL:
+            if (auto& target = *(*m_globalSlots)[binding.slot]; target.has_value()) {
+                target = std::move(value);
+                break;
+            }
+
+            throw undefined(name);
+        default:
+            lookup(name) = std::move(value);
+            break;
+        }
+    }
+
+    /**
+     * Push an argument of a call onto the value stack, above the running frame.
+     *
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param value The argument.
+     * @throws RuntimeError if the stack is full.
+     */
+    void push(const Token& paren, std::any value) {
+        if (m_top == m_stack.size()) {
+            grow(paren, m_top + 1);
+        }
+
+        m_stack[m_top++] = std::move(value);
+    }
+
+    /**
+     * Push a called value, which keeps it reachable during the call, then what it expects below its arguments:
+     * the instance a bound method is bound to, or a new instance of a class. Other values expect nothing.
+     * Must precede pushing the arguments of any call of a value.
+     *
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param callee The called value.
+     * @throws RuntimeError if the stack is full.
+     */
+    void pushCallee(const Token& paren, const std::any& callee);
+
+    /**
+     * Look up the callee of a method call `object.name(...)` and push what it expects below the arguments.
+     * A method is not bound: the instance itself is pushed as its receiver.
+     *
+     * @param expr The property get of the callee.
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param object The object, replaced by the value of the property when it is a field.
+     * @return The method, or nullptr if the property is a field, pushed by pushCallee and to be called like any
+     *         other value.
+     * @throws RuntimeError if the object is not an instance, it has no such property, or the stack is full.
+     */
+    [[nodiscard]] const Closure* prepareInvoke(const Get& expr, const Token& paren, std::any& object);
+
+    /**
+     * Look up the callee of a call `super.name(...)` and push the receiver of the running method below the
+     * arguments, so the method is called without binding it.
+     *
+     * @param expr The super expression of the callee.
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @return The method.
+     * @throws RuntimeError if the superclass has no such method, or the stack is full.
+     */
+    [[nodiscard]] const Closure& prepareInvoke(const Super& expr, const Token& paren);
+
+    /**
+     * Call a value with the arguments last pushed onto the value stack, which become the first slots of the
+     * callee's frame, after what pushCallee pushed. The arguments and the callee are popped when the call returns.
+     *
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param callee The called value.
+     * @param arity The number of arguments pushed.
+     * @return The returned value, nil if the function ends without a return statement, the new instance for
+     *         a class.
+     * @throws RuntimeError if the value is not callable, the arity does not match, the stack overflows, or
+     *         the body raises an error.
+     */
+    [[nodiscard]] std::any call(const Token& paren, const std::any& callee, std::uint32_t arity);
+
+    /**
+     * Call a function with the arguments last pushed onto the value stack, after the receiver for a method.
+     *
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param closure The function, kept reachable by the caller during the call.
+     * @param arity The number of arguments pushed.
+     * @return The returned value, nil if the function ends without a return statement, the receiver for an
+     *         initializer.
+     * @throws RuntimeError if the arity does not match, the stack overflows, or the body raises an error.
+     */
+    [[nodiscard]] std::any call(const Token& paren, const Closure& closure, std::uint32_t arity);
+
+    /**
+     * Call a native function with the arguments last pushed onto the value stack, popping them.
+     *
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param function The binding.
+     * @param arity The number of arguments pushed.
+     * @return The returned value.
+     * @throws RuntimeError if the arity does not match, an argument has the wrong type or the function raises a
+     *         NativeError.
+     */
+    [[nodiscard]] std::any call(const Token& paren, const NativeFunction& function, std::uint32_t arity);
+
+    /**
+     * Call a native function with evaluated arguments.
+     *
+     * @param heap The heap the function allocates on.
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param function The binding.
+     * @param arguments The arguments.
+     * @return The returned value.
+     * @throws RuntimeError if the arity does not match, an argument has the wrong type or the function raises a
+     *         NativeError.
+     */
+    [[nodiscard]] static std::any callNative(Heap& heap, const Token& paren, const NativeFunction& function,
+                                             std::span<const std::any> arguments);
+
+    /**
+     * Call an evaluated callee with evaluated arguments, for programs translated by `tox --emit-cpp`, in which
+     * natives are the only values that can be called.
+     *
+     * @param heap The heap the function allocates on.
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param callee The callee.
+     * @param arguments The arguments.
+     * @return The returned value.
+     * @throws RuntimeError if the callee is not a native function, or calling it raises an error.
+     */
+    [[nodiscard]] static std::any callNative(Heap& heap, const Token& paren, const std::any& callee,
+                                             std::span<const std::any> arguments);
+
+    /**
+     * Read a property of an evaluated object through the inline cache of the get. A method is bound to the
+     * instance.
+     *
+     * @param expr The property get.
+     * @param object The object.
+     * @return The value of the field, or the bound method.
+     * @throws RuntimeError if the object is not an instance or it has no such property.
+     */
+    [[nodiscard]] std::any property(const Get& expr, const std::any& object);
+
+    /**
+     * Get the instance whose field a property set assigns.
+     *
+     * @param expr The property set.
+     * @param object The evaluated object.
+     * @return The instance.
+     * @throws RuntimeError if the object is not an instance.
+     */
+    [[nodiscard]] static Instance& fields(const Set& expr, const std::any& object);
+
+    /**
+     * Assign a field of an instance through the inline cache of the set, adding the field if it is new.
+     *
+     * @param expr The property set.
+     * @param instance The instance.
+     * @param value The value.
+     */
+    static void setField(const Set& expr, Instance& instance, std::any value);
+
+    /**
+     * Check that an index reads or assigns something indexable.
+     *
+     * @param bracket The closing bracket of the index, for error reporting.
+     * @param object The evaluated object.
+     * @throws RuntimeError if the object is neither an array nor a map.
+     */
+    static void subscript(const Token& bracket, const std::any& object);
+
+    /**
+     * Check that an index designates an element of an array or may be a key of a map, before the value
+     * assigned to it is evaluated.
+     *
+     * @param bracket The closing bracket of the index, for error reporting.
+     * @param object The evaluated object, an array or a map.
+     * @param index The evaluated index.
+     * @throws RuntimeError if the index is not an integer in bounds of the array, or is nil or NaN for a map.
+     */
+    static void checkIndex(const Token& bracket, const std::any& object, const std::any& index);
+
+    /**
+     * Read the element of an array or the value of a key of a map.
+     *
+     * @param bracket The closing bracket of the index, for error reporting.
+     * @param object The evaluated object, an array or a map.
+     * @param index The evaluated index.
+     * @return The element as a number, the value of the key, or nil if the map has no such key.
+     * @throws RuntimeError if the index does not designate an element of the array.
+     */
+    [[nodiscard]] static std::any load(const Token& bracket, const std::any& object, const std::any& index);
+
+    /**
+     * Assign the element of an array or the value of a key of a map.
+     *
+     * @param heap The heap of the map, charged for its growth.
+     * @param bracket The closing bracket of the index, for error reporting.
+     * @param object The evaluated object, an array or a map.
+     * @param index The evaluated index, checked by checkIndex.
+     * @param value The evaluated value.
+     * @return The value.
+     * @throws RuntimeError if the value is not a number stored into an array.
+     */
+    static std::any store(Heap& heap, const Token& bracket, const std::any& object, const std::any& index,
+                          std::any value);
+
+    /**
+     * Get the position of the element an index designates.
+     *
+     * @param bracket The closing bracket of the index, for error reporting.
+     * @param array The array.
+     * @param index The evaluated index.
+     * @return The position of the element.
+     * @throws RuntimeError if the index is not an integer or is out of bounds.
+     */
+    [[nodiscard]] static std::size_t offset(const Token& bracket, const Array& array, const std::any& index);
+
+    /**
+     * Get the number stored into an element of an array.
+     *
+     * @param bracket The bracket of the index or of the literal, for error reporting.
+     * @param value The evaluated value.
+     * @return The number.
+     * @throws RuntimeError if the value is not a number.
+     */
+    [[nodiscard]] static double element(const Token& bracket, const std::any& value) {
+        if (const auto* number = std::any_cast<double>(&value)) {
+            return *number;
+        }
+
+        throw RuntimeError(bracket, "Array elements must be numbers.");
+    }
+
+    /**
+     * Find the method `super` refers to in the running method, through the cache of the super expression.
+     *
+     * @param expr The super expression.
+     * @return The method of the superclass of the class declaring the running method.
+     * @throws RuntimeError if the superclass has no such method.
+     */
+    [[nodiscard]] Closure* superMethod(const Super& expr) const;
+
+    /**
+     * Bind the method `super` refers to in the running method to the receiver of the running method.
+     *
+     * @param expr The super expression.
+     * @return The bound method.
+     * @throws RuntimeError if the superclass has no such method.
+     */
+    [[nodiscard]] std::any boundSuperMethod(const Super& expr);
+
+    /**
+     * Apply a unary operator to an evaluated operand.
+     *
+     * @param op The operator token.
+     * @param right The operand.
+     * @return The result of the operation.
+     * @throws RuntimeError if the operand has the wrong type.
+     */
+    [[nodiscard]] static std::any unary(const Token& op, const std::any& right);
+
+    /**
+     * Apply a binary operator to evaluated operands.
+     *
+     * @param heap Heap receiving a concatenated string.
+     * @param op The operator token.
+     * @param left The left operand.
+     * @param right The right operand.
+     * @return The result of the operation.
+     * @throws RuntimeError if the operands have the wrong types.
+     */
+    [[nodiscard]] static std::any binary(Heap& heap, const Token& op, const std::any& left, const std::any& right);
+
+    /**
+     * Convert a std::any value to its string representation.
+     *
+     * @param value The value to stringify.
+     */
+    [[nodiscard]] static std::string stringify(const std::any& value);
+
+    /**
+     * Write a std::any value to a sink, as stringify would convert it, without building a string.
+     *
+     * @param sink The sink to write to.
+     * @param value The value to write.
+     */
+    static void write(OutputSink& sink, const std::any& value);
+
+    /**
+     * Determine the truthiness of a value.
+     *
+     * @param value The value to evaluate.
+     * @return True if the value is considered "truthy", false otherwise.
+     */
+    [[nodiscard]] static bool isTruthy(const std::any& value);
+
 private:
+    /**
+     * Queue a hot subtree of the current tree for background compilation.
+     *
+     * @param expr The subtree to promote.
+     */
+    void promote(const Expr& expr);
+
+    /**
+     * Recompute the height above which trees are handed to the explicit-stack walker.
+     */
+    void updateDeepHeight() noexcept {
+        m_deepHeight = m_explicitStack ? std::min(RECURSION_HEIGHT, m_maxDepth) : UINT32_MAX;
+    }
+
+protected:
+    /**
+     * Evaluate a tree too tall for native recursion, with an explicit stack of pending nodes.
+     * Subtrees short enough are still evaluated by recursion. Results, runtime errors and recorded
+     * operand types are the same as with recursion.
+     *
+     * @param expr The expression to evaluate.
+     * @return The result of the evaluation.
+     * @throws RuntimeError if evaluation fails or a node is nested deeper than the maximum depth.
+     */
+    [[nodiscard]] virtual std::any evalDeep(const Expr& expr);
+
+    /**
+     * Execute a statement, collecting first if the heap is due, since no value is in flight between statements.
+     *
+     * @param stmt The statement to execute.
+     * @throws RuntimeError if evaluating one of its expressions fails.
+     */
+    void execute(const Stmt& stmt) {
+        if (m_heap.due()) {
+            collect();
+        }
+
+        stmt.accept(*this);
+    }
+
+    /**
+     * Keep a value only a native local holds reachable, while evaluating an expression that may collect,
+     * by pushing it onto the value stack. Numbers refer to no object and are not pushed.
+     *
+     * @param token Token of the evaluated node, for error reporting.
+     * @param value The value.
+     * @return True if the value was pushed, to be given to unpin.
+     * @throws RuntimeError if the stack is full.
+     */
+    [[nodiscard]] bool pin(const Token& token, const std::any& value) {
+        if (value.type() == typeid(double)) {
+            return false;
+        }
+
+        push(token, value);
+        return true;
+    }
+
+    /**
+     * Pop a value pushed by pin.
+     *
+     * @param pinned What pin returned.
+     */
+    void unpin(bool pinned) noexcept {
+        m_top -= pinned ? 1 : 0;
+    }
+
+    /**
+     * Visit method for the block statement type.
+     *
+     * @param stmt The block statement to visit.
+     */
+    void visitBlockStmt(const Block& stmt) override {
+        for (const auto& statement : stmt.statements()) {
+            execute(*statement);
+            if (m_returning) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Visit method for the class declaration type.
+     *
+     * @param stmt The class declaration to visit.
+     */
+    void visitClassStmt(const Class& stmt) override;
+
+    /**
+     * Visit method for the expression statement type.
+     *
+     * @param stmt The expression statement to visit.
+     */
+    void visitExpressionStmt(const Expression& stmt) override {
+        (void)eval(stmt.expression());
+    }
+
+    /**
+     * Visit method for the function declaration type.
+     *
+     * @param stmt The function declaration to visit.
+     */
+    void visitFunctionStmt(const Function& stmt) override;
+
+    /**
+     * Visit method for the if statement type.
+     *
+     * @param stmt The if statement to visit.
+     */
+    void visitIfStmt(const If& stmt) override;
+
+    /**
+     * Visit method for the print statement type.
+     *
+     * @param stmt The print statement to visit.
+     */
+    void visitPrintStmt(const Print& stmt) override;
+
+    /**
+     * Visit method for the return statement type. Sets the value and flags the enclosing statements to stop,
+     * up to the call, rather than throwing.
+     *
+     * @param stmt The return statement to visit.
+     */
+    void visitReturnStmt(const Return& stmt) override {
+        m_returnValue = stmt.value() != nullptr ? eval(*stmt.value()) : std::any(std::monostate{});
+        m_returning = true;
+    }
+
+    /**
+     * Visit method for the spawn statement type. Copies the arguments and hands the call to the scheduler of the
+     * script, so it runs as a task of its own.
+     *
+     * @param stmt The spawn statement to visit.
+     */
+    void visitSpawnStmt(const Spawn& stmt) override;
+
+    /**
+     * Visit method for the variable declaration type.
+     *
+     * @param stmt The variable declaration to visit.
+     */
+    void visitVarStmt(const Var& stmt) override;
+
+    /**
+     * Visit method for the while statement type.
+     *
+     * @param stmt The while statement to visit.
+     */
+    void visitWhileStmt(const While& stmt) override {
+        while (isTruthy(eval(stmt.condition()))) {
+            execute(stmt.body());
+            if (m_returning) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Visit method for the array literal expression type. The array is made first and pinned, and each element
+     * is stored unboxed as soon as it is evaluated.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override;
+
+    /**
+     * Visit method for the assignment expression type.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override {
+        auto value = eval(expr.value());
+        assign(expr.name(), expr.binding(), value);
+        m_result = std::move(value);
+    }
+
     /**
      * Visit method for the binary expression type.
      *
@@ -76,6 +906,22 @@ private:
      */
     void visitBinaryExpr(const Binary& expr) override;
 
+    /**
+     * Visit method for the call expression type. Arguments are evaluated straight onto the value stack.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit method for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override {
+        m_result = property(expr, eval(expr.object()));
+    }
+
     /**
      * Visit method for the grouping expression type.
      *
@@ -85,6 +931,21 @@ private:
         m_result = eval(expr.expression());
     }
 
+    /**
+     * Visit method for the index expression type. The object must be an array or a map before the index is
+     * evaluated, and stays pinned meanwhile. An element is read as a plain number.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override {
+        auto object = eval(expr.object());
+        subscript(expr.bracket(), object);
+        auto pinned = pin(expr.bracket(), object);
+        auto index = eval(expr.index());
+        unpin(pinned);
+        m_result = load(expr.bracket(), object, index);
+    }
+
     /**
      * Visit method for the literal expression type.
      *
@@ -92,6 +953,69 @@ private:
      */
     void visitLiteralExpr(const Lit& expr) override;
 
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override {
+        auto left = eval(expr.left());
+        m_result = expr.shortCircuits(isTruthy(left)) ? std::move(left) : eval(expr.right());
+    }
+
+    /**
+     * Visit method for the property set expression type. The object must be an instance before the value is
+     * evaluated, and stays pinned meanwhile.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override {
+        auto object = eval(expr.object());
+        auto& instance = fields(expr, object);
+        auto pinned = pin(expr.name(), object);
+        auto value = eval(expr.value());
+        unpin(pinned);
+        setField(expr, instance, value);
+        m_result = std::move(value);
+    }
+
+    /**
+     * Visit method for the element set expression type. The object must be an array or a map before the index
+     * is evaluated, and the index must be valid before the value is; both stay pinned meanwhile.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override {
+        auto object = eval(expr.object());
+        subscript(expr.bracket(), object);
+        auto pinned = pin(expr.bracket(), object);
+        auto index = eval(expr.index());
+        checkIndex(expr.bracket(), object, index);
+        auto pinnedIndex = pin(expr.bracket(), index);
+        auto value = eval(expr.value());
+        unpin(pinnedIndex);
+        unpin(pinned);
+        m_result = store(m_heap, expr.bracket(), object, index, std::move(value));
+    }
+
+    /**
+     * Visit method for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override {
+        m_result = boundSuperMethod(expr);
+    }
+
+    /**
+     * Visit method for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override {
+        m_result = variable(expr.keyword(), expr.binding());
+    }
+
     /**
      * Visit method for the unary expression type.
      *
@@ -99,6 +1023,123 @@ private:
      */
     void visitUnaryExpr(const Unary& expr) override;
 
+    /**
+     * Visit method for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override {
+        m_result = variable(expr.name(), expr.binding());
+    }
+
+private:
+    /**
+     * Get the cell of a captured local of the running frame.
+     *
+     * @param slot The slot holding the cell.
+     * @return The cell.
+     */
+    [[nodiscard]] Cell& cell(std::uint32_t slot) const noexcept {
+        return **std::any_cast<Cell*>(&m_stack[m_base + slot]);
+    }
+
+    /**
+     * Grow the value stack to hold a number of slots, at least doubling it, up to STACK_SLOTS.
+     *
+     * @param paren The closing parenthesis of the call needing the slots, for error reporting.
+     * @param slots The number of slots.
+     * @throws RuntimeError if more than STACK_SLOTS are needed.
+     */
+    void grow(const Token& paren, std::size_t slots);
+
+    /**
+     * Store the initial value of a declared variable, boxing it if closures capture it.
+     *
+     * @param name The name token of the variable.
+     * @param binding The storage of the variable.
+     * @param value The value.
+     */
+    void declare(const Token& name, const Binding& binding, std::any value);
+
+    /**
+     * Create the closure of a function declared in the running frame, capturing the variables it uses.
+     *
+     * @param stmt The function declaration.
+     * @param home Class declaring the method the function is or is nested in, nullptr outside classes.
+     * @return The closure.
+     */
+    [[nodiscard]] Closure* closure(const Function& stmt, const ClassObject* home);
+
+    /**
+     * Find where a property of an instance lives, through the inline cache of the accessing node.
+     *
+     * @param cache The inline cache.
+     * @param name The name token of the property.
+     * @param instance The instance.
+     * @return The field offset or method index.
+     * @throws RuntimeError if the instance has no such property.
+     */
+    [[nodiscard]] static InlineCache::Entry findProperty(const InlineCache& cache, const Token& name,
+                                                         const Instance& instance);
+
+    /**
+     * Free the objects no root reaches: the value stack up to the running frame's top, the globals, the last
+     * result and return value, the running closure and the operands of the explicit-stack walkers.
+     */
+    void collect();
+
+    /**
+     * Bind a program to the globals and set up its frame, before running its statements.
+     *
+     * @param program The resolved program.
+     */
+    void enter(std::shared_ptr<const Program> program);
+
+    /**
+     * Clear the frame of the program entered and release it.
+     */
+    void leave() noexcept;
+
+    /**
+     * Drop the frames of the calls a runtime error interrupted, back to the program's frame.
+     */
+    void unwind() noexcept;
+
+    /**
+     * Set the lowest native stack address a call may start at, NATIVE_STACK_SIZE below the caller's frame.
+     */
+    void limitNativeStack() noexcept {
+        char marker = 0;
+        auto here = reinterpret_cast<std::uintptr_t>(&marker);
+        m_stackLimit = here > NATIVE_STACK_SIZE ? here - NATIVE_STACK_SIZE : 0;
+    }
+
+    /**
+     * Look up the value of a global variable by name.
+     *
+     * @param name The name token of the variable.
+     * @return The value of the variable.
+     * @throws RuntimeError if the variable is not defined.
+     */
+    [[nodiscard]] const std::any& lookup(const Token& name) const;
+
+    /**
+     * Look up the storage of a global variable by name.
+     *
+     * @param name The name token of the variable.
+     * @return The storage of the variable.
+     * @throws RuntimeError if the variable is not defined.
+     */
+    [[nodiscard]] std::any& lookup(const Token& name);
+
+    /**
+     * Create the error raised by a reference to an undefined variable.
+     *
+     * @param name The name token of the variable.
+     * @return The error.
+     */
+    [[nodiscard]] static RuntimeError undefined(const Token& name);
+
     /**
      * Check if the operand is a number (double).
      *
@@ -130,14 +1171,6 @@ private:
         throw RuntimeError(op, "Operands must be numbers.");
     }
 
-    /**
-     * Determine the truthiness of a value.
-     *
-     * @param value The value to evaluate.
-     * @return True if the value is considered "truthy", false otherwise.
-     */
-    [[nodiscard]] static bool isTruthy(const std::any& value);
-
     /**
      * Check if two std::any values are equal.
      *
@@ -146,11 +1179,4 @@ private:
      * @return True if the values are equal, false otherwise.
      */
     [[nodiscard]] static bool isEqual(const std::any& a, const std::any& b);
-
-    /**
-     * Convert a std::any value to its string representation.
-     *
-     * @param value The value to stringify.
-     */
-    [[nodiscard]] static std::string stringify(const std::any& value);
 };
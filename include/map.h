@@ -0,0 +1,243 @@
+#pragma once
+
+#include "heap.h"
+#include "object.h"
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * A map value, associating keys of any type but nil to values. Keys compare as `==` does: numbers and
+ * booleans by value, strings by their characters, other objects by identity. Maps are mutable and compared by
+ * identity, like instances, and iterate in insertion order.
+ *
+ * The entries are kept in insertion order in one vector, and an open-addressing table in the style of
+ * SwissTable indexes them: each slot has a control byte holding 7 bits of the hash of its key, and a probe
+ * checks a group of 16 control bytes at once with SSE2, comparing keys only for the slots whose byte matches.
+ * Deleting leaves a tombstone in the table and a hole in the entries, both dropped when the table is next
+ * rebuilt. The map remembers where the last deleted key was, so iterating may delete the current key.
+ */
+class Map : public Object {
+public:
+    /**
+     * Number of control bytes a probe checks at once.
+     */
+    static constexpr std::size_t GROUP_WIDTH = 16;
+
+private:
+    /**
+     * A key and its value, aligned so that reading one touches a single cache line.
+     */
+    struct alignas(2 * sizeof(std::any)) Entry {
+        /**
+         * The key, empty once deleted.
+         */
+        std::any key;
+
+        /**
+         * The value.
+         */
+        std::any value;
+    };
+
+    /**
+     * A group of slots of the table. The indexes follow the control bytes, so a probe finding a matching byte
+     * reads the index next to the line it loaded rather than from another array.
+     */
+    struct Group {
+        /**
+         * Control byte of each slot: empty, deleted, or the low 7 bits of the hash of its key.
+         */
+        std::int8_t control[GROUP_WIDTH];
+
+        /**
+         * Index in the entries of the key of each full slot.
+         */
+        std::uint32_t entries[GROUP_WIDTH];
+    };
+
+    /**
+     * The entries in insertion order, deleted ones included until the table is rebuilt.
+     */
+    std::vector<Entry> m_entries;
+
+    /**
+     * The table, a power of two of groups, empty until the first key.
+     */
+    std::vector<Group> m_groups;
+
+    /**
+     * Number of keys.
+     */
+    std::size_t m_length = 0;
+
+    /**
+     * The key last deleted, empty if none, kept so that next() can still go past it.
+     */
+    std::any m_removed;
+
+    /**
+     * Position in the entries from which to look for the key following m_removed.
+     */
+    std::size_t m_afterRemoved = 0;
+
+public:
+    /**
+     * Constructs an empty map, which allocates no table until its first key.
+     */
+    Map() = default;
+
+    /**
+     * Check whether a value may be a key, that is, is neither nil nor NaN.
+     *
+     * @param key The value.
+     * @return True if the value may be a key.
+     */
+    [[nodiscard]] static bool hashable(const std::any& key) noexcept;
+
+    /**
+     * Hash a key. Numbers hash their bits, with -0 hashed as 0 since they are equal; strings hash their
+     * characters once and cache it; other objects hash their address.
+     *
+     * @param key The key, hashable.
+     * @return The hash.
+     */
+    [[nodiscard]] static std::uint64_t hash(const std::any& key);
+
+    /**
+     * Get the number of keys.
+     *
+     * @return The length.
+     */
+    [[nodiscard]] std::size_t length() const noexcept {
+        return m_length;
+    }
+
+    /**
+     * Find the value of a key.
+     *
+     * @param key The key.
+     * @return The value, or null if the map has no such key.
+     */
+    [[nodiscard]] const std::any* get(const std::any& key) const;
+
+    /**
+     * Associate a value to a key, replacing its value in place if the map has the key, otherwise appending it.
+     *
+     * @param heap The heap of the map, charged for the memory the map grows by.
+     * @param key The key, hashable.
+     * @param value The value.
+     */
+    void set(Heap& heap, const std::any& key, std::any value);
+
+    /**
+     * Delete a key and its value.
+     *
+     * @param key The key.
+     * @return True if the map had the key.
+     */
+    bool remove(const std::any& key);
+
+    /**
+     * Get the key following another in insertion order. The previous key may also be the key last deleted, so a
+     * loop may delete each key it visits; any other key the map no longer has is not found.
+     *
+     * @param key The previous key, or nil for the first one.
+     * @return The following key, nil after the last one, or nothing if the map has no such previous key.
+     */
+    [[nodiscard]] std::optional<std::any> next(const std::any& key) const;
+
+    /**
+     * Call a function on every key and its value, in insertion order.
+     *
+     * @param visitor Callable taking a key and its value.
+     */
+    template <typename Visitor> void forEach(Visitor&& visitor) const {
+        for (const auto& entry : m_entries) {
+            if (entry.key.has_value()) {
+                visitor(entry.key, entry.value);
+            }
+        }
+    }
+
+    /**
+     * Mark the keys and values.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override;
+
+    /**
+     * Get the memory the map holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Map) + m_entries.capacity() * sizeof(Entry) + m_groups.capacity() * sizeof(Group);
+    }
+
+private:
+    /**
+     * Get the number of slots of the table.
+     *
+     * @return The number of slots, a multiple of GROUP_WIDTH.
+     */
+    [[nodiscard]] std::size_t slots() const noexcept {
+        return m_groups.size() * GROUP_WIDTH;
+    }
+
+    /**
+     * Get the control byte of a slot.
+     *
+     * @param slot The slot.
+     * @return The control byte.
+     */
+    [[nodiscard]] std::int8_t& control(std::size_t slot) noexcept {
+        return m_groups[slot / GROUP_WIDTH].control[slot % GROUP_WIDTH];
+    }
+
+    /**
+     * Get the index of the entry a full slot holds.
+     *
+     * @param slot The slot.
+     * @return The index in the entries.
+     */
+    [[nodiscard]] std::uint32_t& entry(std::size_t slot) noexcept {
+        return m_groups[slot / GROUP_WIDTH].entries[slot % GROUP_WIDTH];
+    }
+
+    /**
+     * Get the index of the entry a full slot holds.
+     *
+     * @param slot The slot.
+     * @return The index in the entries.
+     */
+    [[nodiscard]] std::uint32_t entry(std::size_t slot) const noexcept {
+        return m_groups[slot / GROUP_WIDTH].entries[slot % GROUP_WIDTH];
+    }
+
+    /**
+     * Find the slot of a key.
+     *
+     * @param key The key, hashable.
+     * @param hash Hash of the key.
+     * @return The slot, or the number of slots if the map has no such key.
+     */
+    [[nodiscard]] std::size_t find(const std::any& key, std::uint64_t hash) const;
+
+    /**
+     * Find a free slot, empty or deleted, for a new key.
+     *
+     * @param hash Hash of the key.
+     * @return The slot.
+     */
+    [[nodiscard]] std::size_t vacancy(std::uint64_t hash) const;
+
+    /**
+     * Drop the deleted entries and rebuild the table with room for at least twice the keys.
+     */
+    void rehash();
+};
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "array.h"
+#include "channel.h"
+#include "heap.h"
+#include "map.h"
+#include "object.h"
+#include "text.h"
+#include "token.h"
+
+#include <any>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * Error raised by a native function, reported as a runtime error at the call.
+ */
+class NativeError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * A C++ function callable from Tox, with the thunk converting between Tox values and its parameter and return
+ * types. The thunk is instantiated for the signature of the function when it is bound, so a call only checks
+ * the type of each argument and reads it out of the value stack, with no argument vector nor boxed callable.
+ *
+ * Parameters may be floating-point (a number), integral (a number without fraction, in range), bool,
+ * std::string or std::string_view (a string, the view valid for the call), std::span<const double> (the
+ * elements of an array, valid for the call), Map* (a map), Channel* (a channel) and std::any (any value). The
+ * same types may be returned, except that an array is returned as a std::vector<double>, and void returns nil.
+ * A function may throw NativeError to raise a runtime error at its call.
+ */
+struct NativeFunction {
+    /**
+     * Function converting the arguments, calling the bound function and converting its result.
+     */
+    using Thunk = std::any (*)(Heap& heap, const Token& paren, const NativeFunction& function,
+                               std::span<const std::any> arguments);
+
+    /**
+     * Name of the function, for printing and error messages.
+     */
+    std::string name;
+
+    /**
+     * Number of parameters.
+     */
+    std::uint32_t arity;
+
+    /**
+     * Thunk instantiated for the signature of the function.
+     */
+    Thunk thunk;
+
+    /**
+     * The bound function, cast back to its own type by the thunk.
+     */
+    void (*function)();
+
+    /**
+     * Bind a C++ function.
+     *
+     * @tparam R The return type.
+     * @tparam Args The parameter types.
+     * @param name Name of the function.
+     * @param function The function.
+     * @return The binding.
+     */
+    template <typename R, typename... Args>
+    [[nodiscard]] static NativeFunction bind(std::string name, R (*function)(Args...)) {
+        return {
+            .name = std::move(name),
+            .arity = sizeof...(Args),
+            .thunk = &invoke<R, Args...>,
+            .function = reinterpret_cast<void (*)()>(function),
+        };
+    }
+
+    /**
+     * Raise the error of an argument of the wrong type.
+     *
+     * @param paren The closing parenthesis of the call.
+     * @param index Index of the argument.
+     * @param kind Kind of value the parameter takes, with its article, e.g. "a number".
+     * @throws RuntimeError always.
+     */
+    [[noreturn]] void mismatch(const Token& paren, std::size_t index, std::string_view kind) const;
+
+private:
+    /**
+     * Convert an argument to the type of its parameter.
+     *
+     * @tparam T The parameter type.
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param index Index of the argument.
+     * @param value The argument.
+     * @return The converted argument.
+     * @throws RuntimeError if the argument has the wrong type.
+     */
+    template <typename T>
+    [[nodiscard]] std::remove_cvref_t<T> argument(const Token& paren, std::size_t index, const std::any& value) const {
+        using U = std::remove_cvref_t<T>;
+
+        if constexpr (std::is_same_v<U, std::any>) {
+            return value;
+        } else if constexpr (std::is_same_v<U, bool>) {
+            if (const auto* boolean = std::any_cast<bool>(&value)) {
+                return *boolean;
+            }
+            mismatch(paren, index, "a boolean");
+        } else if constexpr (std::is_integral_v<U>) {
+            // The maximum of a 64-bit type rounds up to a power of two as a double, so compare strictly against
+            // that power instead; the minimum is a power of two, exact either way.
+            const auto* number = std::any_cast<double>(&value);
+            if (number != nullptr && std::trunc(*number) == *number &&
+                *number >= static_cast<double>(std::numeric_limits<U>::lowest()) &&
+                *number < std::ldexp(1.0, std::numeric_limits<U>::digits)) {
+                return static_cast<U>(*number);
+            }
+            mismatch(paren, index, "an integer");
+        } else if constexpr (std::is_floating_point_v<U>) {
+            if (const auto* number = std::any_cast<double>(&value)) {
+                return static_cast<U>(*number);
+            }
+            mismatch(paren, index, "a number");
+        } else if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>) {
+            if (const auto* string = std::any_cast<String*>(&value)) {
+                return U((*string)->value());
+            }
+            mismatch(paren, index, "a string");
+        } else if constexpr (std::is_same_v<U, std::span<const double>>) {
+            if (const auto* array = std::any_cast<Array*>(&value)) {
+                return std::as_const(**array).values();
+            }
+            mismatch(paren, index, "an array");
+        } else if constexpr (std::is_same_v<U, Map*>) {
+            if (const auto* map = std::any_cast<Map*>(&value)) {
+                return *map;
+            }
+            mismatch(paren, index, "a map");
+        } else if constexpr (std::is_same_v<U, Channel*>) {
+            if (const auto* channel = std::any_cast<Channel*>(&value)) {
+                return *channel;
+            }
+            mismatch(paren, index, "a channel");
+        } else {
+            static_assert(sizeof(U) == 0, "Unsupported parameter type of a native function.");
+        }
+    }
+
+    /**
+     * Convert the result of the function to a Tox value.
+     *
+     * @tparam R The return type.
+     * @param heap The heap to allocate strings and arrays on.
+     * @param value The result.
+     * @return The Tox value.
+     */
+    template <typename R> [[nodiscard]] static std::any result(Heap& heap, R&& value) {
+        using U = std::remove_cvref_t<R>;
+
+        if constexpr (std::is_same_v<U, std::any>) {
+            return std::forward<R>(value);
+        } else if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, Map*> || std::is_same_v<U, Channel*>) {
+            return value;
+        } else if constexpr (std::is_arithmetic_v<U>) {
+            return static_cast<double>(value);
+        } else if constexpr (std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>) {
+            return heap.make<String>(std::string(std::forward<R>(value)));
+        } else if constexpr (std::is_same_v<U, std::vector<double>>) {
+            return heap.make<Array>(std::span<const double>(value));
+        } else {
+            static_assert(sizeof(U) == 0, "Unsupported return type of a native function.");
+        }
+    }
+
+    /**
+     * Thunk of a function of the given signature.
+     *
+     * @tparam R The return type.
+     * @tparam Args The parameter types.
+     * @param heap The heap to allocate the result on.
+     * @param paren The closing parenthesis of the call, for error reporting.
+     * @param function The binding.
+     * @param arguments The arguments, as many as the parameters.
+     * @return The result.
+     * @throws RuntimeError if an argument has the wrong type.
+     * @throws NativeError if the function raises one.
+     */
+    template <typename R, typename... Args>
+    static std::any invoke(Heap& heap, const Token& paren, const NativeFunction& function,
+                           std::span<const std::any> arguments) {
+        auto* target = reinterpret_cast<R (*)(Args...)>(function.function);
+
+        return [&]<std::size_t... I>(std::index_sequence<I...>) -> std::any {
+            // Braced initialization converts the arguments in order, so the first mismatch is reported.
+            std::tuple<std::remove_cvref_t<Args>...> values{function.argument<Args>(paren, I, arguments[I])...};
+            if constexpr (std::is_void_v<R>) {
+                std::apply(target, std::move(values));
+                return std::monostate{};
+            } else {
+                return result(heap, std::apply(target, std::move(values)));
+            }
+        }(std::index_sequence_for<Args...>{});
+    }
+};
+
+/**
+ * A native function as a Tox value.
+ */
+class Native : public Object {
+private:
+    /**
+     * The binding.
+     */
+    NativeFunction m_function;
+
+public:
+    /**
+     * Constructs a native function.
+     *
+     * @param function The binding.
+     */
+    explicit Native(NativeFunction function) : m_function(std::move(function)) {}
+
+    /**
+     * Get the binding.
+     *
+     * @return The binding.
+     */
+    [[nodiscard]] const NativeFunction& function() const noexcept {
+        return m_function;
+    }
+
+    /**
+     * Native functions refer to no other object.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& /*heap*/) const override {}
+
+    /**
+     * Get the memory the native function holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(Native) + m_function.name.capacity();
+    }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+// Forward declarations.
+class Heap;
+
+/**
+ * Base class of the heap objects Tox values refer to, such as strings, closures and instances.
+ * Objects belong to the heap of the interpreter that made them, which frees them once they are unreachable.
+ * Values hold plain pointers to them, which std::any stores in place, so copying a value never copies
+ * the object nor touches a reference count.
+ */
+class Object {
+    friend class Heap;
+
+private:
+    /**
+     * Next object of the heap, which links every object it owns.
+     */
+    Object* m_next = nullptr;
+
+    /**
+     * Flag, whether the running collection has reached the object.
+     */
+    mutable bool m_marked = false;
+
+public:
+    /**
+     * Constructs an object, owned by no heap yet.
+     */
+    Object() = default;
+
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+
+    /**
+     * Virtual destructor to ensure proper cleanup of derived classes.
+     */
+    virtual ~Object() = default;
+
+    /**
+     * Mark the objects this object refers to, so that they survive the collection.
+     *
+     * @param heap The heap being collected.
+     */
+    virtual void trace(Heap& heap) const = 0;
+
+    /**
+     * Get the memory the object holds, its own storage included, which paces the collections.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] virtual std::size_t size() const noexcept = 0;
+};
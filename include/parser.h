@@ -1,14 +1,17 @@
 #pragma once
 
 #include "ast.h"
+#include "diagnostics.h"
+#include "stmt.h"
 #include "token.h"
 
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
-// Forward declarations.
-class Tox;
-
 /**
  * Exception class for parse errors during parsing.
  */
@@ -26,6 +29,44 @@ public:
  * Parser for tokens to create an abstract syntax tree (AST).
  */
 class Parser {
+public:
+    /**
+     * Maximum nesting of parenthesized expressions and of statements, which the parser handles by recursion.
+     */
+    static constexpr std::size_t MAX_NESTING = 512;
+
+    /**
+     * Maximum number of parameters of a function and of arguments of a call.
+     */
+    static constexpr std::size_t MAX_ARGUMENTS = 255;
+
+    /**
+     * Operators of equality expressions. Parsing and constant evaluation match the operators of each precedence
+     * level against the same sets.
+     */
+    static constexpr std::array<TokenType, 2> EQUALITY_OPERATORS = {TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL};
+
+    /**
+     * Operators of comparison expressions.
+     */
+    static constexpr std::array<TokenType, 4> COMPARISON_OPERATORS = {TokenType::GREATER, TokenType::GREATER_EQUAL,
+                                                                      TokenType::LESS, TokenType::LESS_EQUAL};
+
+    /**
+     * Operators of term expressions.
+     */
+    static constexpr std::array<TokenType, 2> TERM_OPERATORS = {TokenType::MINUS, TokenType::PLUS};
+
+    /**
+     * Operators of factor expressions.
+     */
+    static constexpr std::array<TokenType, 2> FACTOR_OPERATORS = {TokenType::SLASH, TokenType::STAR};
+
+    /**
+     * Prefix operators of unary expressions.
+     */
+    static constexpr std::array<TokenType, 2> UNARY_OPERATORS = {TokenType::BANG, TokenType::MINUS};
+
 private:
     /**
      * List of tokens to parse.
@@ -37,13 +78,30 @@ private:
      */
     std::size_t m_current = 0;
 
+    /**
+     * Current nesting of parenthesized expressions and statements.
+     */
+    std::size_t m_nesting = 0;
+
+    /**
+     * Number of nodes created.
+     */
+    std::size_t m_nodes = 0;
+
+    /**
+     * Context receiving syntax errors.
+     */
+    Diagnostics& m_diagnostics;
+
 public:
     /**
      * Constructor for the Parser.
      *
      * @param tokens The list of tokens to parse.
+     * @param diagnostics Context receiving syntax errors.
      */
-    explicit Parser(std::vector<Token> tokens) : m_tokens(std::move(tokens)) {}
+    Parser(std::vector<Token> tokens, Diagnostics& diagnostics)
+        : m_tokens(std::move(tokens)), m_diagnostics(diagnostics) {}
 
     /**
      * Parse the tokens and return the expression.
@@ -52,16 +110,161 @@ public:
      */
     [[nodiscard]] ExprPtr parse();
 
+    /**
+     * Parse the tokens as a list of statements. After a syntax error, the parser skips to the next statement
+     * and carries on, so that one run reports every error. A trailing expression without a semicolon is printed,
+     * so a script holding a single expression behaves as it did before statements existed.
+     *
+     * @return The unresolved program, or nullptr if parsing failed.
+     */
+    [[nodiscard]] std::unique_ptr<Program> parseProgram();
+
+    /**
+     * Get the number of nodes created by parse or parseProgram, including those of a tree discarded on error.
+     *
+     * @return The number of nodes.
+     */
+    [[nodiscard]] std::size_t nodes() const noexcept {
+        return m_nodes;
+    }
+
 private:
+    /**
+     * Create a node.
+     *
+     * @param args Arguments of the node constructor.
+     * @return The node.
+     */
+    template <typename T, typename... Args>
+    [[nodiscard]] std::unique_ptr<T> make(Args&&... args) {
+        m_nodes++;
+
+        return std::make_unique<T>(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Parse a declaration or statement, synchronizing after a syntax error.
+     *
+     * @return The parsed statement, or nullptr after a syntax error.
+     */
+    [[nodiscard]] StmtPtr declaration();
+
+    /**
+     * Parse a variable declaration, after its `var` keyword.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr varDeclaration();
+
+    /**
+     * Parse a class declaration, after its `class` keyword.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr classDeclaration();
+
+    /**
+     * Parse a function declaration after its `fun` keyword, or a method of a class body.
+     *
+     * @param kind Kind of function.
+     * @return The parsed declaration.
+     */
+    [[nodiscard]] std::unique_ptr<Function> function(Function::Kind kind);
+
+    /**
+     * Parse a statement.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr statement();
+
+    /**
+     * Parse the body of a block, if, while or for statement, one level deeper.
+     *
+     * @param token The token opening the statement, for error reporting.
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr nested(const Token& token);
+
+    /**
+     * Parse the statements of a block, after its opening brace.
+     *
+     * @return The parsed statements.
+     */
+    [[nodiscard]] std::vector<StmtPtr> block();
+
+    /**
+     * Parse an if statement, after its `if` keyword.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr ifStatement();
+
+    /**
+     * Parse a while statement, after its `while` keyword.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr whileStatement();
+
+    /**
+     * Parse a for statement, after its `for` keyword, desugared into a while loop in a block.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr forStatement();
+
+    /**
+     * Parse a return statement, after its `return` keyword.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr returnStatement();
+
+    /**
+     * Parse a spawn statement, after its `spawn` keyword.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr spawnStatement();
+
+    /**
+     * Parse an expression statement, or the trailing expression of a program.
+     *
+     * @return The parsed statement.
+     */
+    [[nodiscard]] StmtPtr expressionStatement();
+
     /**
      * Parse an expression.
      *
      * @return The parsed expression.
      */
     [[nodiscard]] ExprPtr expression() {
-        return equality();
+        return assignment();
     }
 
+    /**
+     * Parse an assignment expression.
+     *
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr assignment();
+
+    /**
+     * Parse a logical or expression.
+     *
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr logicalOr();
+
+    /**
+     * Parse a logical and expression.
+     *
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr logicalAnd();
+
     /**
      * Parse an equality expression.
      *
@@ -97,6 +300,36 @@ private:
      */
     [[nodiscard]] ExprPtr unary();
 
+    /**
+     * Parse a chain of calls, property gets and indexes, or a primary expression if there is none.
+     *
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr call();
+
+    /**
+     * Parse the arguments of a call, after its opening parenthesis.
+     *
+     * @param callee The called expression.
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr finishCall(ExprPtr callee);
+
+    /**
+     * Parse the index of an element, after its opening bracket.
+     *
+     * @param object The indexed expression.
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr finishIndex(ExprPtr object);
+
+    /**
+     * Parse the elements of an array literal, after its opening bracket.
+     *
+     * @return The parsed expression.
+     */
+    [[nodiscard]] ExprPtr arrayLiteral();
+
     /**
      * Parse a primary expression.
      *
@@ -124,6 +357,23 @@ private:
         return false;
     }
 
+    /**
+     * Matches the current token against a set of operators.
+     *
+     * @param types The token types to match against.
+     * @return True if a match was found and the parser advanced, false otherwise.
+     */
+    template <std::size_t N>
+    bool matchAny(const std::array<TokenType, N>& types) {
+        for (auto type : types) {
+            if (check(type)) {
+                advance();
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * Advance to the next token and return the previous one.
      *
@@ -153,7 +403,7 @@ private:
      * @param msg The error message.
      * @return A ParseError exception.
      */
-    static ParseError error(const Token& token, const std::string& msg);
+    ParseError error(const Token& token, const std::string& msg);
 
     /**
      * Check if the current token matches the given type.
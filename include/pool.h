@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed-size thread pool with one task queue per worker.
+ * Workers take tasks from the back of their own queue and, when it is empty, steal from the front of the others,
+ * so uneven tasks spread across the pool without a single contended queue.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * A unit of work. Tasks must not throw.
+     */
+    using Task = std::function<void()>;
+
+private:
+    /**
+     * Task queue of one worker.
+     */
+    struct Queue {
+        /**
+         * Guards the tasks.
+         */
+        std::mutex mutex;
+
+        /**
+         * Pending tasks; the owner works at the back, thieves at the front.
+         */
+        std::deque<Task> tasks;
+    };
+
+    /**
+     * One queue per worker.
+     */
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    /**
+     * Number of tasks sitting in the queues.
+     */
+    std::atomic<std::size_t> m_queued = 0;
+
+    /**
+     * Number of submitted tasks not yet finished.
+     */
+    std::atomic<std::size_t> m_pending = 0;
+
+    /**
+     * Queue receiving the next task submitted from outside the pool.
+     */
+    std::atomic<std::size_t> m_next = 0;
+
+    /**
+     * Guards sleeping and waking.
+     */
+    std::mutex m_mutex;
+
+    /**
+     * Signals idle workers that a task was queued.
+     */
+    std::condition_variable_any m_ready;
+
+    /**
+     * Signals waiters that every task has finished.
+     */
+    std::condition_variable m_idle;
+
+    /**
+     * The worker threads. Declared last so they are joined before the queues are destroyed.
+     */
+    std::vector<std::jthread> m_workers;
+
+public:
+    /**
+     * Constructs a pool and starts its workers.
+     *
+     * @param threads Number of worker threads, 0 for one per hardware thread.
+     */
+    explicit WorkStealingPool(std::size_t threads = 0);
+
+    /**
+     * Destructor. Finishes the queued tasks, then joins the workers.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * Get the number of worker threads.
+     *
+     * @return The number of workers.
+     */
+    [[nodiscard]] std::size_t size() const noexcept {
+        return m_workers.size();
+    }
+
+    /**
+     * Submit a task. Tasks submitted by a worker go to its own queue, others are spread round-robin.
+     *
+     * @param task The task to run.
+     */
+    void submit(Task task);
+
+    /**
+     * Block until every submitted task has finished.
+     */
+    void wait();
+
+private:
+    /**
+     * Main loop of a worker thread.
+     *
+     * @param stop Stop token of the worker.
+     * @param index Index of the worker's queue.
+     */
+    void work(std::stop_token stop, std::size_t index);
+
+    /**
+     * Take a task, from the back of the worker's own queue or else from the front of another.
+     *
+     * @param index Index of the worker's queue.
+     * @param task Receives the task.
+     * @return True if a task was taken.
+     */
+    bool take(std::size_t index, Task& task);
+};
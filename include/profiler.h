@@ -0,0 +1,371 @@
+#pragma once
+
+#include "interpreter.h"
+#include "token.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Execution counters of one Tox instance: time spent per phase, and evaluations and self time
+ * per node kind and per operator. Filled in by a ProfilingInterpreter and printed at exit by `tox --profile`.
+ */
+class ExecutionProfile {
+public:
+    /**
+     * Clock timing every measurement.
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Phases of running a script.
+     */
+    enum class Phase : std::uint8_t {
+        // Scanning source code into tokens.
+        SCAN,
+
+        // Parsing tokens into a tree.
+        PARSE,
+
+        // Evaluating the tree and printing the result.
+        EVAL,
+    };
+
+    /**
+     * Kinds of evaluated nodes.
+     */
+    enum class Node : std::uint8_t {
+        ARRAY,
+        ASSIGN,
+        BINARY,
+        CALL,
+        GET,
+        GROUPING,
+        INDEX,
+        LITERAL,
+        LOGICAL,
+        SET,
+        SET_INDEX,
+        SUPER,
+        THIS,
+        UNARY,
+        VARIABLE,
+
+        // A tree too tall for recursion, stepped through by the explicit-stack walker.
+        DEEP_WALK,
+    };
+
+    /**
+     * Number of events and the time they took.
+     */
+    struct Counter {
+        /**
+         * Number of events.
+         */
+        std::uint64_t count = 0;
+
+        /**
+         * Cumulative time.
+         */
+        Clock::duration time{};
+
+        /**
+         * Record one event.
+         *
+         * @param elapsed The time it took.
+         */
+        void add(Clock::duration elapsed) noexcept {
+            count++;
+            time += elapsed;
+        }
+    };
+
+private:
+    /**
+     * Number of phases.
+     */
+    static constexpr std::size_t PHASE_COUNT = 3;
+
+    /**
+     * Number of node kinds.
+     */
+    static constexpr std::size_t NODE_COUNT = 16;
+
+    /**
+     * Number of counters covering every token type.
+     */
+    static constexpr std::size_t OPERATOR_COUNT = std::numeric_limits<std::underlying_type_t<TokenType>>::max() + 1;
+
+    /**
+     * Counters by phase.
+     */
+    std::array<Counter, PHASE_COUNT> m_phases{};
+
+    /**
+     * Self time counters by node kind.
+     */
+    std::array<Counter, NODE_COUNT> m_nodes{};
+
+    /**
+     * Self time counters by operator token type.
+     */
+    std::array<Counter, OPERATOR_COUNT> m_operators{};
+
+    /**
+     * Number of runtime errors thrown.
+     */
+    std::uint64_t m_runtimeErrors = 0;
+
+public:
+    /**
+     * Record the time spent in a phase.
+     *
+     * @param phase The phase.
+     * @param elapsed The time it took.
+     */
+    void addPhase(Phase phase, Clock::duration elapsed) noexcept {
+        m_phases[static_cast<std::size_t>(phase)].add(elapsed);
+    }
+
+    /**
+     * Record the evaluation of a node.
+     *
+     * @param node The node kind.
+     * @param self Time spent in the node itself, excluding its children.
+     */
+    void addNode(Node node, Clock::duration self) noexcept {
+        m_nodes[static_cast<std::size_t>(node)].add(self);
+    }
+
+    /**
+     * Record the application of an operator.
+     *
+     * @param op The operator token type.
+     * @param self Time spent in the node itself, excluding its operands.
+     */
+    void addOperator(TokenType op, Clock::duration self) noexcept {
+        m_operators[static_cast<std::size_t>(op)].add(self);
+    }
+
+    /**
+     * Record a thrown runtime error.
+     */
+    void addRuntimeError() noexcept {
+        m_runtimeErrors++;
+    }
+
+    /**
+     * Get the counter of a phase.
+     *
+     * @param phase The phase.
+     * @return The counter.
+     */
+    [[nodiscard]] const Counter& phase(Phase phase) const noexcept {
+        return m_phases[static_cast<std::size_t>(phase)];
+    }
+
+    /**
+     * Get the counter of a node kind.
+     *
+     * @param node The node kind.
+     * @return The counter.
+     */
+    [[nodiscard]] const Counter& node(Node node) const noexcept {
+        return m_nodes[static_cast<std::size_t>(node)];
+    }
+
+    /**
+     * Get the counter of an operator.
+     *
+     * @param op The operator token type.
+     * @return The counter.
+     */
+    [[nodiscard]] const Counter& op(TokenType op) const noexcept {
+        return m_operators[static_cast<std::size_t>(op)];
+    }
+
+    /**
+     * Get the number of runtime errors thrown.
+     *
+     * @return The number of runtime errors.
+     */
+    [[nodiscard]] std::uint64_t runtimeErrors() const noexcept {
+        return m_runtimeErrors;
+    }
+
+    /**
+     * Write a report of the phases, then of the node kinds and operators sorted by descending self time.
+     *
+     * @param stream The stream to write to.
+     */
+    void print(std::ostream& stream) const;
+};
+
+/**
+ * Interpreter counting and timing every node it evaluates into an ExecutionProfile.
+ * A separate class, so that the plain Interpreter pays nothing for profiling: it is only measured when
+ * constructed as a ProfilingInterpreter. Tiering is disabled, since compiled subtrees are not visited.
+ */
+class ProfilingInterpreter : public Interpreter {
+private:
+    /**
+     * Profile receiving the counters.
+     */
+    ExecutionProfile& m_profile;
+
+    /**
+     * Time spent in the children of each node being measured, innermost last.
+     */
+    std::vector<ExecutionProfile::Clock::duration> m_children;
+
+    /**
+     * The last counted runtime error, so that an error unwinding through several nodes is counted once.
+     */
+    const RuntimeError* m_lastError = nullptr;
+
+public:
+    /**
+     * Constructs a profiling interpreter.
+     *
+     * @param diagnostics Context receiving runtime errors.
+     * @param output Sink receiving printed results.
+     * @param profile Profile receiving the counters, which must outlive the interpreter.
+     */
+    ProfilingInterpreter(Diagnostics& diagnostics, OutputSink& output, ExecutionProfile& profile)
+        : Interpreter(diagnostics, output), m_profile(profile) {
+        setTierThreshold(0);
+    }
+
+protected:
+    /**
+     * Visit method for the array literal expression type.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override;
+
+    /**
+     * Visit method for the assignment expression type.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override;
+
+    /**
+     * Visit method for the binary expression type.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override;
+
+    /**
+     * Visit method for the call expression type, measured with the whole body of the callee as children.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit method for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override;
+
+    /**
+     * Visit method for the grouping expression type.
+     *
+     * @param expr The grouping expression to visit.
+     */
+    void visitGroupingExpr(const Grouping& expr) override;
+
+    /**
+     * Visit method for the index expression type.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override;
+
+    /**
+     * Visit method for the literal expression type.
+     *
+     * @param expr The literal expression to visit.
+     */
+    void visitLiteralExpr(const Lit& expr) override;
+
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override;
+
+    /**
+     * Visit method for the property set expression type.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override;
+
+    /**
+     * Visit method for the element set expression type.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override;
+
+    /**
+     * Visit method for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override;
+
+    /**
+     * Visit method for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override;
+
+    /**
+     * Visit method for the unary expression type.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override;
+
+    /**
+     * Visit method for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override;
+
+    /**
+     * Evaluate a tree too tall for native recursion, measured as one DEEP_WALK node.
+     *
+     * @param expr The expression to evaluate.
+     * @return The result of the evaluation.
+     * @throws RuntimeError if evaluation fails or a node is nested deeper than the maximum depth.
+     */
+    [[nodiscard]] std::any evalDeep(const Expr& expr) override;
+
+private:
+    /**
+     * Run the evaluation of a node and record its self time.
+     *
+     * @param node The node kind.
+     * @param op The operator token, or nullptr for nodes without one.
+     * @param evaluate Evaluates the node.
+     * @throws RuntimeError if evaluation fails, after counting the error.
+     */
+    template <typename F>
+    void measure(ExecutionProfile::Node node, const Token* op, F&& evaluate);
+};
@@ -0,0 +1,441 @@
+#pragma once
+
+#include "ast.h"
+#include "diagnostics.h"
+#include "stmt.h"
+#include "token.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Static pass run between parsing and evaluation, assigning every variable its storage.
+ * Top-level variables get a slot of the program's global table, block-scoped ones a slot of the frame
+ * they live in, so that the interpreter indexes flat arrays instead of hashing names at run time.
+ * Slots of sibling blocks are reused, so a frame is as large as its deepest nest of live variables.
+ * A function reading a local of an enclosing function captures it as an upvalue, and the local is
+ * boxed in a cell, which only happens to variables that some closure actually uses.
+ * The receiver of a method is a local named `this` in slot 0 of its frame, captured like any other.
+ */
+class Resolver : public ExprVisitor, public StmtVisitor {
+private:
+    /**
+     * A variable declared in a block scope.
+     */
+    struct Local {
+        /**
+         * Slot of the variable in its frame.
+         */
+        std::uint32_t slot;
+
+        /**
+         * Flag, whether the initializer has been resolved, so the variable may be read.
+         */
+        bool defined;
+
+        /**
+         * Flag, whether an inner function captures the variable.
+         */
+        bool captured = false;
+
+        /**
+         * Bindings of the declaration and of the references from its own frame, which become cells
+         * if the variable turns out to be captured.
+         */
+        std::vector<Binding*> uses;
+    };
+
+    /**
+     * Variables of a block scope by name.
+     */
+    using Scope = std::unordered_map<std::string, Local, StringHash, std::equal_to<>>;
+
+    /**
+     * A call frame being laid out: the program's own, or a function's.
+     */
+    struct Frame {
+        /**
+         * Index of the first block scope of the frame.
+         */
+        std::size_t scopes = 0;
+
+        /**
+         * Next free slot of the frame.
+         */
+        std::uint32_t nextSlot = 0;
+
+        /**
+         * Number of slots the frame needs.
+         */
+        std::uint32_t slots = 0;
+
+        /**
+         * Variables of the enclosing frames captured by the function, in upvalue order.
+         */
+        std::vector<Capture> captures;
+
+        /**
+         * Kind of the function, FUNCTION for the program's frame.
+         */
+        Function::Kind kind = Function::Kind::FUNCTION;
+    };
+
+    /**
+     * Kinds of class bodies a node can be in.
+     */
+    enum class ClassKind : std::uint8_t {
+        // Outside classes.
+        NONE,
+
+        // In a class without superclass.
+        CLASS,
+
+        // In a class with a superclass.
+        SUBCLASS,
+    };
+
+    /**
+     * Context receiving resolution errors.
+     */
+    Diagnostics& m_diagnostics;
+
+    /**
+     * Block scopes being resolved, innermost last. Empty at the top level.
+     */
+    std::vector<Scope> m_scopes;
+
+    /**
+     * Global slots by name.
+     */
+    std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>> m_globalSlots;
+
+    /**
+     * Names of the global variables, indexed by global slot.
+     */
+    std::vector<std::string> m_globals;
+
+    /**
+     * Frames being laid out, innermost last. The program's frame comes first.
+     */
+    std::vector<Frame> m_frames;
+
+    /**
+     * Kind of the innermost class body being resolved.
+     */
+    ClassKind m_class = ClassKind::NONE;
+
+    /**
+     * Expressions left to resolve. Expression trees may be too tall to recurse into.
+     */
+    std::vector<const Expr*> m_pending;
+
+public:
+    /**
+     * Constructs a resolver.
+     *
+     * @param diagnostics Context receiving resolution errors, reported as syntax errors.
+     */
+    explicit Resolver(Diagnostics& diagnostics) : m_diagnostics(diagnostics) {}
+
+    /**
+     * Resolve every variable of a program and lay out its storage. Must run before the program is shared.
+     *
+     * @param program The program to resolve.
+     */
+    void resolve(Program& program);
+
+private:
+    /**
+     * Resolve the variables of a statement.
+     *
+     * @param stmt The statement.
+     */
+    void resolve(const Stmt& stmt) {
+        stmt.accept(*this);
+    }
+
+    /**
+     * Resolve the variables of an expression tree, with an explicit stack.
+     *
+     * @param expr The root of the tree.
+     */
+    void resolve(const Expr& expr);
+
+    /**
+     * Bind a variable reference to its storage: the innermost block scope declaring it, else the global table.
+     *
+     * @param name The name token.
+     * @param binding The binding of the referencing node.
+     * @param reading True if the reference reads the variable.
+     */
+    void reference(const Token& name, Binding& binding, bool reading);
+
+    /**
+     * Declare a variable in the innermost block scope, in a new slot of the innermost frame.
+     *
+     * @param name The name token.
+     * @param defined True if the variable may be read right away.
+     * @return The variable.
+     */
+    Local& declare(const Token& name, bool defined);
+
+    /**
+     * Get the upvalue of a function through which it reads a local of an enclosing frame,
+     * capturing the local in every function in between.
+     *
+     * @param frame Index of the frame of the function.
+     * @param owner Index of the frame declaring the local.
+     * @param slot Slot of the local in its frame.
+     * @return The index of the upvalue.
+     */
+    [[nodiscard]] std::uint32_t capture(std::size_t frame, std::size_t owner, std::uint32_t slot);
+
+    /**
+     * Find the frame a block scope belongs to.
+     *
+     * @param scope Index of the scope.
+     * @return The index of the frame.
+     */
+    [[nodiscard]] std::size_t frameOf(std::size_t scope) const noexcept;
+
+    /**
+     * Lay out the frame of a function or method and resolve its body. The name is declared by the caller.
+     *
+     * @param stmt The declaration.
+     */
+    void function(const Function& stmt);
+
+    /**
+     * Close the innermost block scope, turning the bindings of its captured variables into cells.
+     */
+    void endScope();
+
+    /**
+     * Get the global slot of a name, adding it to the table on first use.
+     *
+     * @param name The variable name.
+     * @return The binding.
+     */
+    [[nodiscard]] Binding global(const std::string& name);
+
+    /**
+     * Visit method for the block statement type.
+     *
+     * @param stmt The block statement to visit.
+     */
+    void visitBlockStmt(const Block& stmt) override;
+
+    /**
+     * Visit method for the class declaration type.
+     *
+     * @param stmt The class declaration to visit.
+     */
+    void visitClassStmt(const Class& stmt) override;
+
+    /**
+     * Visit method for the expression statement type.
+     *
+     * @param stmt The expression statement to visit.
+     */
+    void visitExpressionStmt(const Expression& stmt) override {
+        resolve(stmt.expression());
+    }
+
+    /**
+     * Visit method for the function declaration type.
+     *
+     * @param stmt The function declaration to visit.
+     */
+    void visitFunctionStmt(const Function& stmt) override;
+
+    /**
+     * Visit method for the if statement type.
+     *
+     * @param stmt The if statement to visit.
+     */
+    void visitIfStmt(const If& stmt) override;
+
+    /**
+     * Visit method for the print statement type.
+     *
+     * @param stmt The print statement to visit.
+     */
+    void visitPrintStmt(const Print& stmt) override {
+        resolve(stmt.expression());
+    }
+
+    /**
+     * Visit method for the return statement type.
+     *
+     * @param stmt The return statement to visit.
+     */
+    void visitReturnStmt(const Return& stmt) override;
+
+    /**
+     * Visit method for the spawn statement type.
+     *
+     * @param stmt The spawn statement to visit.
+     */
+    void visitSpawnStmt(const Spawn& stmt) override {
+        resolve(stmt.call());
+    }
+
+    /**
+     * Visit method for the variable declaration type.
+     *
+     * @param stmt The variable declaration to visit.
+     */
+    void visitVarStmt(const Var& stmt) override;
+
+    /**
+     * Visit method for the while statement type.
+     *
+     * @param stmt The while statement to visit.
+     */
+    void visitWhileStmt(const While& stmt) override {
+        resolve(stmt.condition());
+        resolve(stmt.body());
+    }
+
+    /**
+     * Visit method for the array literal expression type.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override {
+        for (const auto& element : expr.elements()) {
+            m_pending.push_back(element.get());
+        }
+    }
+
+    /**
+     * Visit method for the assignment expression type.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override;
+
+    /**
+     * Visit method for the binary expression type.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override {
+        m_pending.push_back(&expr.left());
+        m_pending.push_back(&expr.right());
+    }
+
+    /**
+     * Visit method for the call expression type.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override {
+        m_pending.push_back(&expr.callee());
+        for (const auto& argument : expr.arguments()) {
+            m_pending.push_back(argument.get());
+        }
+    }
+
+    /**
+     * Visit method for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override {
+        m_pending.push_back(&expr.object());
+    }
+
+    /**
+     * Visit method for the grouping expression type.
+     *
+     * @param expr The grouping expression to visit.
+     */
+    void visitGroupingExpr(const Grouping& expr) override {
+        m_pending.push_back(&expr.expression());
+    }
+
+    /**
+     * Visit method for the index expression type.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override {
+        m_pending.push_back(&expr.object());
+        m_pending.push_back(&expr.index());
+    }
+
+    /**
+     * Visit method for the literal expression type.
+     *
+     * @param expr The literal expression to visit.
+     */
+    void visitLiteralExpr(const Lit& /*expr*/) override {}
+
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override {
+        m_pending.push_back(&expr.left());
+        m_pending.push_back(&expr.right());
+    }
+
+    /**
+     * Visit method for the property set expression type.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override {
+        m_pending.push_back(&expr.object());
+        m_pending.push_back(&expr.value());
+    }
+
+    /**
+     * Visit method for the element set expression type.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override {
+        m_pending.push_back(&expr.object());
+        m_pending.push_back(&expr.index());
+        m_pending.push_back(&expr.value());
+    }
+
+    /**
+     * Visit method for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override;
+
+    /**
+     * Visit method for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override;
+
+    /**
+     * Visit method for the unary expression type.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override {
+        m_pending.push_back(&expr.right());
+    }
+
+    /**
+     * Visit method for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override {
+        reference(expr.name(), expr.bind({}), true);
+    }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Forward declarations.
+class TraceRecorder;
+
+/**
+ * Outcome of running one script.
+ */
+struct ScriptResult {
+    /**
+     * Path of the script.
+     */
+    std::string path;
+
+    /**
+     * Text the script printed.
+     */
+    std::string output;
+
+    /**
+     * Error messages the script reported.
+     */
+    std::string errors;
+
+    /**
+     * Exit code the script would have as a standalone run.
+     */
+    int exitCode = 0;
+};
+
+/**
+ * Runs many scripts concurrently in one process, one Tox instance per script, on a work-stealing pool.
+ */
+class ScriptRunner {
+private:
+    /**
+     * The pool running the scripts.
+     */
+    WorkStealingPool m_pool;
+
+    /**
+     * Maximum nesting depth of evaluated expressions, 0 for the interpreter's default.
+     */
+    std::uint32_t m_maxDepth = 0;
+
+    /**
+     * Recorder receiving the phases of each script, may be null.
+     */
+    TraceRecorder* m_tracer = nullptr;
+
+public:
+    /**
+     * Constructs a runner.
+     *
+     * @param jobs Number of scripts run at once, 0 for one per hardware thread.
+     */
+    explicit ScriptRunner(std::size_t jobs) : m_pool(jobs) {}
+
+    /**
+     * Get the number of scripts run at once.
+     *
+     * @return The number of worker threads.
+     */
+    [[nodiscard]] std::size_t jobs() const noexcept {
+        return m_pool.size();
+    }
+
+    /**
+     * Set the maximum nesting depth of evaluated expressions for every script.
+     *
+     * @param depth The maximum depth, 0 for the interpreter's default.
+     */
+    void setMaxDepth(std::uint32_t depth) noexcept {
+        m_maxDepth = depth;
+    }
+
+    /**
+     * Record a trace event for each script and each of its phases.
+     *
+     * @param tracer The recorder, which must outlive the runs, or nullptr to stop tracing.
+     */
+    void setTracer(TraceRecorder* tracer) noexcept {
+        m_tracer = tracer;
+    }
+
+    /**
+     * Run scripts and collect their output.
+     *
+     * @param paths Paths of the scripts.
+     * @return One result per script, in the order of the paths.
+     */
+    [[nodiscard]] std::vector<ScriptResult> run(const std::vector<std::string>& paths);
+
+    /**
+     * Read a list file naming one script per line. Blank lines and lines starting with '#' are skipped.
+     *
+     * @param path Path to the list file.
+     * @return The script paths.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    [[nodiscard]] static std::vector<std::string> readList(const std::string& path);
+
+    /**
+     * Aggregate the exit codes of several scripts.
+     *
+     * @param results The script results.
+     * @return 0 if every script succeeded, otherwise the highest exit code.
+     */
+    [[nodiscard]] static int exitCode(const std::vector<ScriptResult>& results);
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "interpreter.h"
+#include "token.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Sampling profiler aggregating the operator stacks of an interpreter into folded stacks,
+ * the `frame;frame;frame count` text read by flame graph tools.
+ * A timer thread only bumps a tick counter; the interpreter thread notices pending ticks when it enters
+ * or leaves an operator node and charges them to its current stack, so no state is shared but the counter.
+ */
+class StackSampler {
+public:
+    /**
+     * Default time between samples.
+     */
+    static constexpr std::chrono::microseconds DEFAULT_INTERVAL{1000};
+
+private:
+    /**
+     * Ticks of the timer thread since construction.
+     */
+    std::atomic<std::uint64_t> m_ticks{0};
+
+    /**
+     * Ticks already charged or discarded by the interpreter thread.
+     */
+    std::uint64_t m_seen = 0;
+
+    /**
+     * Sample counts by folded stack.
+     */
+    std::map<std::string, std::uint64_t> m_stacks;
+
+    /**
+     * Timer thread, declared last so it stops before the counters are destroyed.
+     */
+    std::jthread m_timer;
+
+public:
+    /**
+     * Constructs a sampler and starts its timer thread.
+     *
+     * @param interval Time between samples.
+     */
+    explicit StackSampler(std::chrono::microseconds interval = DEFAULT_INTERVAL);
+
+    /**
+     * Check whether the timer ticked since the last call to charge or discard.
+     *
+     * @return True if samples are pending.
+     */
+    [[nodiscard]] bool due() const noexcept {
+        return m_ticks.load(std::memory_order_relaxed) != m_seen;
+    }
+
+    /**
+     * Charge the pending samples to a stack.
+     *
+     * @param frames Operator tokens of the stack, outermost first; nullptr stands for the explicit-stack walker.
+     */
+    void charge(std::span<const Token* const> frames);
+
+    /**
+     * Drop the pending samples, taken while nothing was being evaluated.
+     */
+    void discard() noexcept {
+        m_seen = m_ticks.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the number of samples charged so far.
+     *
+     * @return The number of samples.
+     */
+    [[nodiscard]] std::uint64_t samples() const noexcept;
+
+    /**
+     * Write the samples as folded stacks, one stack per line.
+     *
+     * @param stream The stream to write to.
+     */
+    void write(std::ostream& stream) const;
+
+    /**
+     * Write the samples as folded stacks to a file.
+     *
+     * @param path Path to the output file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void save(const std::string& path) const;
+};
+
+/**
+ * Interpreter keeping the stack of operator nodes it is evaluating, for a StackSampler.
+ * Only operator nodes, calls and if, print and loop statements are tracked, so a sample taken in a literal or
+ * variable is charged to its operator. Subtrees promoted to the closure tier are charged to the node that
+ * evaluates them. A call is named after its callee when the callee is a variable, as in `fib line 3`.
+ */
+class SamplingInterpreter : public Interpreter {
+private:
+    /**
+     * Sampler receiving the samples.
+     */
+    StackSampler& m_sampler;
+
+    /**
+     * Operator tokens of the nodes being evaluated, innermost last.
+     */
+    std::vector<const Token*> m_frames;
+
+public:
+    /**
+     * Constructs a sampling interpreter.
+     *
+     * @param diagnostics Context receiving runtime errors.
+     * @param output Sink receiving printed results.
+     * @param sampler Sampler receiving the samples, which must outlive the interpreter.
+     */
+    SamplingInterpreter(Diagnostics& diagnostics, OutputSink& output, StackSampler& sampler)
+        : Interpreter(diagnostics, output), m_sampler(sampler) {}
+
+protected:
+    /**
+     * Visit method for the if statement type.
+     *
+     * @param stmt The if statement to visit.
+     */
+    void visitIfStmt(const If& stmt) override;
+
+    /**
+     * Visit method for the print statement type.
+     *
+     * @param stmt The print statement to visit.
+     */
+    void visitPrintStmt(const Print& stmt) override;
+
+    /**
+     * Visit method for the while statement type.
+     *
+     * @param stmt The while statement to visit.
+     */
+    void visitWhileStmt(const While& stmt) override;
+
+    /**
+     * Visit method for the binary expression type.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override;
+
+    /**
+     * Visit method for the call expression type.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override;
+
+    /**
+     * Visit method for the unary expression type.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override;
+
+    /**
+     * Evaluate a tree too tall for native recursion, tracked as one frame.
+     *
+     * @param expr The expression to evaluate.
+     * @return The result of the evaluation.
+     * @throws RuntimeError if evaluation fails or a node is nested deeper than the maximum depth.
+     */
+    [[nodiscard]] std::any evalDeep(const Expr& expr) override;
+
+private:
+    /**
+     * Run the evaluation of a node with its frame pushed. Samples pending on entry are charged to the
+     * enclosing stack, samples pending on exit to the stack including the node.
+     *
+     * @param op Operator token of the node, or nullptr for the explicit-stack walker.
+     * @param evaluate Evaluates the node.
+     */
+    template <typename F>
+    void track(const Token* op, F&& evaluate);
+
+    /**
+     * Charge pending samples to the current stack, or drop them if nothing is being evaluated.
+     */
+    void sample();
+};
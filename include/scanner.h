@@ -1,50 +1,56 @@
 #pragma once
 
+#include "diagnostics.h"
 #include "token.h"
 
+#include <array>
+#include <cstddef>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 /**
- * Transparent hash functor for string_view lookups in unordered_map.
+ * Scanner for source code.
  */
-struct StringHash {
-    using is_transparent = void;
-
+class Scanner {
+public:
     /**
-     * Hash function for std::string_view.
-     *
-     * @param sv The string view to hash.
-     * @return The hash value.
+     * A punctuation token: one character, or two for the comparison operators followed by '='.
      */
-    [[nodiscard]] std::size_t operator()(std::string_view sv) const noexcept {
-        return std::hash<std::string_view>{}(sv);
-    }
+    struct Punctuation {
+        /**
+         * Type of the token.
+         */
+        TokenType type;
+
+        /**
+         * Number of characters of the token.
+         */
+        std::size_t length;
+    };
 
     /**
-     * Hash function for std::string.
-     *
-     * @param s The string to hash.
-     * @return The hash value.
+     * Keywords and their token types. Scanning and constant evaluation both look keywords up in this table.
      */
-    [[nodiscard]] std::size_t operator()(const std::string& s) const noexcept {
-        return std::hash<std::string_view>{}(s);
-    }
-};
+    static constexpr std::array<std::pair<std::string_view, TokenType>, 17> KEYWORDS = {{
+        {"and", TokenType::AND},       {"class", TokenType::CLASS},   {"else", TokenType::ELSE},
+        {"false", TokenType::FALSE},   {"for", TokenType::FOR},       {"fun", TokenType::FUN},
+        {"if", TokenType::IF},         {"nil", TokenType::NIL},       {"or", TokenType::OR},
+        {"print", TokenType::PRINT},   {"return", TokenType::RETURN}, {"spawn", TokenType::SPAWN},
+        {"super", TokenType::SUPER},   {"this", TokenType::THIS},     {"true", TokenType::TRUE},
+        {"var", TokenType::VAR},       {"while", TokenType::WHILE},
+    }};
 
-/**
- * Scanner for source code.
- */
-class Scanner {
-public:
     /**
      * Default constructor.
      *
      * @param source Source code to scan.
+     * @param diagnostics Context receiving scan errors.
      */
-    explicit Scanner(std::string source);
+    Scanner(std::string source, Diagnostics& diagnostics);
 
     /**
      * Scans the source code and returns a list of tokens.
@@ -53,9 +59,153 @@ public:
      */
     [[nodiscard]] std::vector<Token> scanTokens();
 
+    /**
+     * Checks if a character is a digit.
+     *
+     * @param c Character to check.
+     * @return True if the character is a digit, false otherwise.
+     */
+    [[nodiscard]] static constexpr bool isDigit(char c) noexcept {
+        return c >= '0' && c <= '9';
+    }
+
+    /**
+     * Checks if a character is an alphabetic letter or underscore.
+     *
+     * @param c Character to check
+     * @return True if the character is alphabetic or underscore, false otherwise.
+     */
+    [[nodiscard]] static constexpr bool isAlpha(char c) noexcept {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    /**
+     * Checks if a character is alphanumeric (letter or digit).
+     *
+     * @param c Character to check
+     * @return True if the character is alphanumeric, false otherwise.
+     */
+    [[nodiscard]] static constexpr bool isAlphaNumeric(char c) noexcept {
+        return isAlpha(c) || isDigit(c);
+    }
+
+    /**
+     * Get the punctuation token a character starts. A '/' followed by another starts a comment, not a token.
+     *
+     * @param c The character.
+     * @param next The character following it, '\0' at the end of the source.
+     * @return The token, or std::nullopt if the character starts no punctuation token.
+     */
+    [[nodiscard]] static constexpr std::optional<Punctuation> punctuation(char c, char next) noexcept {
+        auto single = [](TokenType type) { return Punctuation{.type = type, .length = 1}; };
+        auto compound = [next](TokenType equal, TokenType alone) {
+            return next == '=' ? Punctuation{.type = equal, .length = 2} : Punctuation{.type = alone, .length = 1};
+        };
+
+        switch (c) {
+        case '(':
+            return single(TokenType::LEFT_PAREN);
+        case ')':
+            return single(TokenType::RIGHT_PAREN);
+        case '{':
+            return single(TokenType::LEFT_BRACE);
+        case '}':
+            return single(TokenType::RIGHT_BRACE);
+        case '[':
+            return single(TokenType::LEFT_BRACKET);
+        case ']':
+            return single(TokenType::RIGHT_BRACKET);
+        case ',':
+            return single(TokenType::COMMA);
+        case '.':
+            return single(TokenType::DOT);
+        case '-':
+            return single(TokenType::MINUS);
+        case '+':
+            return single(TokenType::PLUS);
+        case ';':
+            return single(TokenType::SEMICOLON);
+        case '*':
+            return single(TokenType::STAR);
+        case '/':
+            if (next == '/') {
+                return std::nullopt;
+            }
+            return single(TokenType::SLASH);
+        case '!':
+            return compound(TokenType::BANG_EQUAL, TokenType::BANG);
+        case '=':
+            return compound(TokenType::EQUAL_EQUAL, TokenType::EQUAL);
+        case '<':
+            return compound(TokenType::LESS_EQUAL, TokenType::LESS);
+        case '>':
+            return compound(TokenType::GREATER_EQUAL, TokenType::GREATER);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    /**
+     * Find the end of a number literal: its integer digits, then a '.' and fraction digits if any follow.
+     *
+     * @param source The source code.
+     * @param current Position after the first digit.
+     * @return Position after the literal.
+     */
+    [[nodiscard]] static constexpr std::size_t numberEnd(std::string_view source, std::size_t current) noexcept {
+        auto digitAt = [source](std::size_t i) { return i < source.size() && isDigit(source[i]); };
+
+        while (digitAt(current)) {
+            current++;
+        }
+
+        // A "." only belongs to the literal if digits follow it.
+        if (current < source.size() && source[current] == '.' && digitAt(current + 1)) {
+            current++;
+
+            while (digitAt(current)) {
+                current++;
+            }
+        }
+
+        return current;
+    }
+
+    /**
+     * Find the end of an identifier or keyword.
+     *
+     * @param source The source code.
+     * @param current Position after the first character.
+     * @return Position after the identifier.
+     */
+    [[nodiscard]] static constexpr std::size_t identifierEnd(std::string_view source, std::size_t current) noexcept {
+        while (current < source.size() && isAlphaNumeric(source[current])) {
+            current++;
+        }
+
+        return current;
+    }
+
+    /**
+     * Map an identifier to its keyword type by a linear search of KEYWORDS, for constant evaluation. The scanner
+     * looks keywords up in a hash table built from the same table.
+     *
+     * @param text The identifier text.
+     * @return The keyword type, or TokenType::IDENTIFIER.
+     */
+    [[nodiscard]] static constexpr TokenType keyword(std::string_view text) noexcept {
+        for (const auto& [name, type] : KEYWORDS) {
+            if (name == text) {
+                return type;
+            }
+        }
+
+        return TokenType::IDENTIFIER;
+    }
+
 private:
     /**
-     * Mapping of keywords to their corresponding token types.
+     * Mapping of keywords to their corresponding token types, built from KEYWORDS.
      * Uses transparent hash for efficient string_view lookups.
      */
     static const std::unordered_map<std::string, TokenType, StringHash, std::equal_to<>> keywords;
@@ -65,6 +215,11 @@ private:
      */
     const std::string m_source;
 
+    /**
+     * Context receiving scan errors.
+     */
+    Diagnostics& m_diagnostics;
+
     /**
      * List of scanned tokens.
      */
@@ -85,6 +240,16 @@ private:
      */
     std::size_t m_line = 1;
 
+    /**
+     * Position in the source code where the current line starts.
+     */
+    std::size_t m_lineStart = 0;
+
+    /**
+     * Column number where the current token starts.
+     */
+    std::size_t m_column = 1;
+
     /**
      * Scans a single token from the source code.
      */
@@ -142,45 +307,8 @@ private:
      */
     [[nodiscard]] char peek() const noexcept;
 
-    /**
-     * Peeks at the next character without advancing the scanner.
-     *
-     * @return The next character in the source code.
-     */
-    [[nodiscard]] char peekNext() const noexcept;
-
     /**
      * Checks if the scanner has reached the end of the source code.
      */
     [[nodiscard]] bool isAtEnd() const noexcept;
-
-    /**
-     * Checks if a character is a digit.
-     *
-     * @param c Character to check.
-     * @return True if the character is a digit, false otherwise.
-     */
-    [[nodiscard]] static constexpr bool isDigit(char c) noexcept {
-        return c >= '0' && c <= '9';
-    }
-
-    /**
-     * Checks if a character is an alphabetic letter or underscore.
-     *
-     * @param c Character to check
-     * @return True if the character is alphabetic or underscore, false otherwise.
-     */
-    [[nodiscard]] static constexpr bool isAlpha(char c) noexcept {
-        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
-    }
-
-    /**
-     * Checks if a character is alphanumeric (letter or digit).
-     *
-     * @param c Character to check
-     * @return True if the character is alphanumeric, false otherwise.
-     */
-    [[nodiscard]] static constexpr bool isAlphaNumeric(char c) noexcept {
-        return isAlpha(c) || isDigit(c);
-    }
 };
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "pool.h"
+#include "token.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Forward declarations.
+class Diagnostics;
+class Function;
+class Interpreter;
+class Message;
+class OutputSink;
+class Program;
+class RuntimeError;
+class Waiter;
+
+/**
+ * Runs the tasks a script spawns. Each task is a fiber with an interpreter and a heap of its own, running one
+ * function of the script on copies of its arguments; tasks share nothing but channels. A task blocked on a
+ * channel, however deep in the evaluation of its function, parks by switching back to the thread that ran it,
+ * which moves on to another task.
+ *
+ * Ready tasks run on a work-stealing pool with one worker per hardware thread, started by the first spawn. In
+ * deterministic mode there is no pool: the thread running the script runs the ready tasks itself, one at a time
+ * and in the order they became ready, whenever it blocks on a channel and once the script is done, so the
+ * output of a script is the same from run to run.
+ */
+class Scheduler {
+public:
+    /**
+     * Sets up the interpreter of a new task, as the one running the script is.
+     */
+    using Configure = std::function<void(Interpreter&)>;
+
+    /**
+     * Makes a scheduler the one of the scripts the current thread runs, for as long as it lives.
+     */
+    class Scope {
+    private:
+        /**
+         * The scheduler the thread had before.
+         */
+        Scheduler* m_previous;
+
+    public:
+        /**
+         * Constructs a scope.
+         *
+         * @param scheduler The scheduler.
+         */
+        explicit Scope(Scheduler& scheduler) noexcept;
+
+        /**
+         * Destructor. Restores the previous scheduler.
+         */
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    friend class Waiter;
+
+    /**
+     * A spawned task.
+     */
+    struct Task;
+
+    /**
+     * Sink receiving what a task prints.
+     */
+    class TaskSink;
+
+    /**
+     * Sink receiving the output of the script, written only by the thread running it.
+     */
+    OutputSink& m_output;
+
+    /**
+     * Sets up the interpreters of the tasks.
+     */
+    Configure m_configure;
+
+    /**
+     * Flag, whether tasks run one at a time on the thread running the script.
+     */
+    bool m_deterministic = false;
+
+    /**
+     * Guards the tasks, their output and errors, and the waits of the thread running the script.
+     */
+    std::mutex m_mutex;
+
+    /**
+     * Signals the thread running the script that it was woken, or that a task finished or blocked.
+     */
+    std::condition_variable m_changed;
+
+    /**
+     * Number of tasks, counting the thread running the script, that run or are ready to. None can wake another
+     * once it drops to 0, so the tasks left are blocked for good.
+     */
+    std::atomic<std::size_t> m_awake = 1;
+
+    /**
+     * Number of tasks spawned so far, numbering them.
+     */
+    std::uint64_t m_spawned = 0;
+
+    /**
+     * Unfinished tasks, in the order they were spawned.
+     */
+    std::map<std::uint64_t, std::unique_ptr<Task>> m_tasks;
+
+    /**
+     * Tasks ready to run, in the order they became ready, in deterministic mode.
+     */
+    std::deque<Task*> m_ready;
+
+    /**
+     * Output of the tasks not yet written to the output of the script.
+     */
+    std::string m_printed;
+
+    /**
+     * Runtime errors the tasks raised, not yet reported.
+     */
+    std::vector<RuntimeError> m_errors;
+
+    /**
+     * The pool running ready tasks, null until the first spawn and in deterministic mode. Declared last so its
+     * workers are joined before the rest is destroyed.
+     */
+    std::unique_ptr<WorkStealingPool> m_pool;
+
+public:
+    /**
+     * Constructs a scheduler, which starts no thread until a task is spawned.
+     *
+     * @param output Sink receiving the output of the script, which must outlive the scheduler.
+     * @param configure Sets up the interpreter of a new task.
+     */
+    Scheduler(OutputSink& output, Configure configure);
+
+    /**
+     * Destructor.
+     */
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    /**
+     * Get the scheduler of the scripts the current thread runs, or of the task it runs.
+     *
+     * @return The scheduler, or nullptr outside of a script.
+     */
+    [[nodiscard]] static Scheduler* current() noexcept;
+
+    /**
+     * Set whether tasks run one at a time on the thread running the script, in a reproducible order.
+     * Must be set before the first spawn.
+     *
+     * @param deterministic True for deterministic mode.
+     */
+    void setDeterministic(bool deterministic) noexcept {
+        m_deterministic = deterministic;
+    }
+
+    /**
+     * Spawn a task calling a function.
+     *
+     * @param program The program declaring the function, whose functions and classes the task declares too.
+     * @param function The function, which must capture no variable.
+     * @param paren The closing parenthesis of the spawned call, for error reporting.
+     * @param arguments The arguments, as many as the parameters.
+     */
+    void spawn(std::shared_ptr<const Program> program, const Function& function, const Token& paren,
+               std::vector<Message> arguments);
+
+    /**
+     * Wait until every task has finished, failing those blocked for good, then write their output and report
+     * their errors. Called by the thread running the script, once it is done.
+     *
+     * @param diagnostics Context receiving the runtime errors of the tasks.
+     */
+    void join(Diagnostics& diagnostics);
+
+private:
+    /**
+     * Entry of the fiber of a task.
+     *
+     * @param task The task.
+     */
+    static void start(void* task) noexcept;
+
+    /**
+     * Run a task to completion, on its fiber.
+     *
+     * @param task The task.
+     */
+    void run(Task& task) noexcept;
+
+    /**
+     * Run a task until it blocks or finishes, on the current thread.
+     *
+     * @param task The task.
+     */
+    void resume(Task& task);
+
+    /**
+     * Make a task ready to run.
+     *
+     * @param task The task.
+     */
+    void schedule(Task& task);
+
+    /**
+     * Block a task or the thread running the script until woken.
+     *
+     * @param lock Lock of the channel the waiter is registered with, held; held again on return.
+     * @param waiter The waiter.
+     * @return True once woken, false if every task is blocked, so none ever will.
+     */
+    bool park(std::unique_lock<std::mutex>& lock, Waiter& waiter);
+
+    /**
+     * Wake a blocked task or the thread running the script.
+     *
+     * @param waiter The waiter, no longer registered with its channel.
+     */
+    void wake(Waiter& waiter);
+
+    /**
+     * Write the output of the tasks to the output of the script. Only the thread running the script writes it.
+     */
+    void drain();
+};
+
+/**
+ * A task, or the thread running a script, blocked on a channel. It registers with the channel, under the lock
+ * of the channel, and whoever unregisters it wakes it.
+ */
+class Waiter {
+private:
+    friend class Scheduler;
+
+    /**
+     * Scheduler of the script, null outside of one.
+     */
+    Scheduler* m_scheduler;
+
+    /**
+     * The blocked task, null for the thread running the script.
+     */
+    Scheduler::Task* m_task;
+
+    /**
+     * Flag, whether the thread running the script was woken.
+     */
+    bool m_ready = false;
+
+public:
+    /**
+     * Constructs a waiter for the task or thread running.
+     */
+    Waiter() noexcept;
+
+    /**
+     * Block until woken.
+     *
+     * @param lock Lock of the channel the waiter is registered with, held; held again on return.
+     * @return True once woken, false if every task is blocked, so none ever will.
+     */
+    bool park(std::unique_lock<std::mutex>& lock);
+
+    /**
+     * Wake the waiter, once unregistered from its channel, with the lock of the channel held.
+     */
+    void wake();
+};
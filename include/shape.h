@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Hidden class of an instance: the names of its fields in the order they were added, each name's position
+ * being the offset of the field in the instance's dense field array. Instances of a class that add the same
+ * fields in the same order share a shape, so an inline cache keyed by shape knows where a field lives.
+ * Adding a field moves an instance to a child shape, reached through a transition the parent owns, so the
+ * class owning the root shape owns the whole tree.
+ */
+class Shape {
+private:
+    /**
+     * Identifier of the shape, never reused, so a cache keyed by it cannot confuse a dead shape with a new one.
+     */
+    std::uint64_t m_id;
+
+    /**
+     * Names of the fields, indexed by offset.
+     */
+    std::vector<std::string> m_fields;
+
+    /**
+     * Child shapes by the name of the field they add.
+     */
+    std::vector<std::pair<std::string, std::unique_ptr<Shape>>> m_transitions;
+
+public:
+    /**
+     * Constructs a shape.
+     *
+     * @param fields Names of the fields, indexed by offset.
+     */
+    explicit Shape(std::vector<std::string> fields = {}) : m_id(nextId()), m_fields(std::move(fields)) {}
+
+    /**
+     * Allocate an identifier for a shape or a class.
+     *
+     * @return An identifier never returned before, at least 1.
+     */
+    [[nodiscard]] static std::uint64_t nextId() noexcept {
+        static std::atomic<std::uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the identifier of the shape.
+     *
+     * @return The identifier.
+     */
+    [[nodiscard]] std::uint64_t id() const noexcept {
+        return m_id;
+    }
+
+    /**
+     * Get the number of fields.
+     *
+     * @return The number of fields.
+     */
+    [[nodiscard]] std::uint32_t size() const noexcept {
+        return static_cast<std::uint32_t>(m_fields.size());
+    }
+
+    /**
+     * Find the offset of a field.
+     *
+     * @param name The field name.
+     * @return The offset, or nothing if the shape has no such field.
+     */
+    [[nodiscard]] std::optional<std::uint32_t> find(std::string_view name) const noexcept;
+
+    /**
+     * Get the shape reached by adding a field, creating it on first use.
+     *
+     * @param name The name of the added field.
+     * @return The child shape.
+     */
+    [[nodiscard]] Shape& transition(std::string_view name);
+};
+
+/**
+ * Polymorphic inline cache of a property access site: the outcome of the last lookups, keyed by the shape
+ * (or, for `super`, the class) they were made for. Each entry is one atomic word, so a tree shared by
+ * interpreters on several threads stays consistent: a racing update can only replace a whole entry.
+ * Past WAYS shapes, the entries are replaced in turn and the site degrades to the uncached lookup.
+ */
+class InlineCache {
+public:
+    /**
+     * Number of shapes a site remembers.
+     */
+    static constexpr std::size_t WAYS = 4;
+
+    /**
+     * Kinds of cached outcomes.
+     */
+    enum class Kind : std::uint8_t {
+        // The property is a field at the cached offset.
+        FIELD,
+
+        // The property is the method at the cached index of the class's method table.
+        METHOD,
+
+        // Assigning the property adds a field at the cached offset, through the shape's transition.
+        TRANSITION,
+    };
+
+    /**
+     * A cached outcome.
+     */
+    struct Entry {
+        /**
+         * Kind of outcome.
+         */
+        Kind kind;
+
+        /**
+         * Offset of the field, or index of the method.
+         */
+        std::uint32_t index;
+    };
+
+private:
+    /**
+     * Bits of an entry word holding the index, below the kind and the key.
+     */
+    static constexpr int INDEX_BITS = 22;
+
+    /**
+     * Bits of an entry word holding the kind, below the key.
+     */
+    static constexpr int KIND_BITS = 2;
+
+    /**
+     * Cached entries, packed as key, kind and index. A zero word is empty, since keys start at 1.
+     */
+    mutable std::array<std::atomic<std::uint64_t>, WAYS> m_entries{};
+
+    /**
+     * Next entry to replace.
+     */
+    mutable std::atomic<std::uint8_t> m_next{0};
+
+public:
+    /**
+     * Find the cached outcome for a shape.
+     *
+     * @param key Identifier of the shape or class.
+     * @return The entry, or nothing on a miss.
+     */
+    [[nodiscard]] std::optional<Entry> find(std::uint64_t key) const noexcept {
+        for (const auto& entry : m_entries) {
+            auto word = entry.load(std::memory_order_relaxed);
+            if (word >> (KIND_BITS + INDEX_BITS) == key) {
+                return Entry{.kind = static_cast<Kind>((word >> INDEX_BITS) & ((1U << KIND_BITS) - 1)),
+                             .index = static_cast<std::uint32_t>(word & ((1U << INDEX_BITS) - 1))};
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * Remember the outcome of a lookup. Outcomes that do not fit an entry are not cached.
+     *
+     * @param key Identifier of the shape or class.
+     * @param entry The outcome.
+     */
+    void add(std::uint64_t key, Entry entry) const noexcept {
+        if (entry.index >> INDEX_BITS != 0 || key >> (64 - KIND_BITS - INDEX_BITS) != 0) {
+            return;
+        }
+
+        auto word = key << (KIND_BITS + INDEX_BITS) | static_cast<std::uint64_t>(entry.kind) << INDEX_BITS |
+                    entry.index;
+        m_entries[m_next.fetch_add(1, std::memory_order_relaxed) % WAYS].store(word, std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * Buffered output sink.
+ * Text accumulates in a reusable buffer and is handed to the destination only when the buffer fills up
+ * or at an explicit flush point, so printing many small results costs few writes and no allocations.
+ */
+class OutputSink {
+public:
+    /**
+     * Capacity of the buffer in bytes.
+     */
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * Maximum length of a formatted number, e.g. "-1.23457e-308".
+     */
+    static constexpr std::size_t NUMBER_SIZE = 32;
+
+private:
+    /**
+     * The buffer.
+     */
+    std::unique_ptr<char[]> m_buffer;
+
+    /**
+     * Number of bytes in the buffer.
+     */
+    std::size_t m_size = 0;
+
+public:
+    /**
+     * Constructs an empty sink.
+     */
+    OutputSink() : m_buffer(std::make_unique_for_overwrite<char[]>(BUFFER_SIZE)) {}
+
+    /**
+     * Destructor. Subclasses flush in their own destructor, while the destination still exists.
+     */
+    virtual ~OutputSink() = default;
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /**
+     * Write text.
+     *
+     * @param text The text to write.
+     */
+    void write(std::string_view text);
+
+    /**
+     * Write a single character.
+     *
+     * @param c The character to write.
+     */
+    void put(char c) {
+        if (m_size == BUFFER_SIZE) {
+            flush();
+        }
+        m_buffer[m_size++] = c;
+    }
+
+    /**
+     * Write a number, formatted as std::format("{:g}") would.
+     *
+     * @param value The number to write.
+     */
+    void writeNumber(double value);
+
+    /**
+     * Write a boolean as "true" or "false".
+     *
+     * @param value The boolean to write.
+     */
+    void writeBool(bool value) {
+        write(value ? "true" : "false");
+    }
+
+    /**
+     * Hand the buffered text to the destination.
+     */
+    void flush();
+
+    /**
+     * Format a number as std::format("{:g}") would, without allocating.
+     *
+     * @param out Receives the formatted number, at least NUMBER_SIZE bytes.
+     * @param value The number to format.
+     * @return The number of bytes written.
+     */
+    static std::size_t formatNumber(char* out, double value) noexcept;
+
+protected:
+    /**
+     * Deliver text to the destination.
+     *
+     * @param bytes The text to deliver.
+     */
+    virtual void drain(std::string_view bytes) = 0;
+};
+
+/**
+ * Output sink writing to a C stream, e.g. stdout.
+ */
+class FileSink : public OutputSink {
+private:
+    /**
+     * The destination stream.
+     */
+    std::FILE* m_file;
+
+public:
+    /**
+     * Constructs a sink writing to a stream.
+     *
+     * @param file The destination stream, which must outlive the sink.
+     */
+    explicit FileSink(std::FILE* file) : m_file(file) {}
+
+    /**
+     * Destructor. Flushes the buffered text.
+     */
+    ~FileSink() override {
+        flush();
+    }
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+protected:
+    /**
+     * Write text to the stream and flush it, so the text is ordered with other writers of the stream.
+     *
+     * @param bytes The text to deliver.
+     */
+    void drain(std::string_view bytes) override;
+};
+
+/**
+ * Output sink collecting text in memory.
+ */
+class StringSink : public OutputSink {
+private:
+    /**
+     * The collected text.
+     */
+    std::string m_text;
+
+public:
+    /**
+     * Constructs an empty sink.
+     */
+    StringSink() = default;
+
+    /**
+     * Flush and take the collected text, leaving the sink empty.
+     *
+     * @return The collected text.
+     */
+    [[nodiscard]] std::string take() {
+        flush();
+
+        return std::move(m_text);
+    }
+
+protected:
+    /**
+     * Append text to the collected text.
+     *
+     * @param bytes The text to deliver.
+     */
+    void drain(std::string_view bytes) override {
+        m_text.append(bytes);
+    }
+};
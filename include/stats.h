@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Metrics of one run of source code, returned by Tox::run for hosts to export.
+ * Collected on every run from counts the scanner, parser, interpreter and memory scopes keep anyway.
+ */
+struct RunStats {
+    /**
+     * Size of the source code in bytes.
+     */
+    std::size_t sourceBytes = 0;
+
+    /**
+     * Number of tokens, including the end-of-file token.
+     */
+    std::size_t tokens = 0;
+
+    /**
+     * Number of tree nodes created by the parser.
+     */
+    std::size_t nodes = 0;
+
+    /**
+     * Height of the evaluated tree, 0 if nothing was evaluated.
+     */
+    std::uint32_t depth = 0;
+
+    /**
+     * Time spent scanning.
+     */
+    std::chrono::nanoseconds scanTime{};
+
+    /**
+     * Time spent parsing.
+     */
+    std::chrono::nanoseconds parseTime{};
+
+    /**
+     * Time spent evaluating and printing the result.
+     */
+    std::chrono::nanoseconds evalTime{};
+
+    /**
+     * Number of allocations counted by the memory scopes of the three phases.
+     */
+    std::uint64_t allocations = 0;
+
+    /**
+     * Number of bytes allocated in the three phases.
+     */
+    std::uint64_t allocatedBytes = 0;
+
+    /**
+     * Number of syntax errors reported.
+     */
+    std::size_t syntaxErrors = 0;
+
+    /**
+     * Number of runtime errors reported.
+     */
+    std::size_t runtimeErrors = 0;
+};
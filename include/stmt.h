@@ -0,0 +1,1068 @@
+#pragma once
+
+#include "allocator.h"
+#include "ast.h"
+#include "token.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Forward declarations.
+class Block;
+class Class;
+class Expression;
+class Function;
+class If;
+class Print;
+class Return;
+class Spawn;
+class Var;
+class While;
+
+/**
+ * Statement Visitor interface for the Visitor pattern.
+ * This interface declares visit methods for each concrete statement type.
+ */
+class StmtVisitor {
+public:
+    /**
+     * Virtual destructor to ensure proper cleanup of derived classes.
+     */
+    virtual ~StmtVisitor() = default;
+
+    /**
+     * Visit methods for the block statement type.
+     *
+     * @param stmt The block statement to visit.
+     */
+    virtual void visitBlockStmt(const Block& stmt) = 0;
+
+    /**
+     * Visit methods for the class declaration type.
+     *
+     * @param stmt The class declaration to visit.
+     */
+    virtual void visitClassStmt(const Class& stmt) = 0;
+
+    /**
+     * Visit methods for the expression statement type.
+     *
+     * @param stmt The expression statement to visit.
+     */
+    virtual void visitExpressionStmt(const Expression& stmt) = 0;
+
+    /**
+     * Visit methods for the function declaration type.
+     *
+     * @param stmt The function declaration to visit.
+     */
+    virtual void visitFunctionStmt(const Function& stmt) = 0;
+
+    /**
+     * Visit methods for the if statement type.
+     *
+     * @param stmt The if statement to visit.
+     */
+    virtual void visitIfStmt(const If& stmt) = 0;
+
+    /**
+     * Visit methods for the print statement type.
+     *
+     * @param stmt The print statement to visit.
+     */
+    virtual void visitPrintStmt(const Print& stmt) = 0;
+
+    /**
+     * Visit methods for the return statement type.
+     *
+     * @param stmt The return statement to visit.
+     */
+    virtual void visitReturnStmt(const Return& stmt) = 0;
+
+    /**
+     * Visit methods for the spawn statement type.
+     *
+     * @param stmt The spawn statement to visit.
+     */
+    virtual void visitSpawnStmt(const Spawn& stmt) = 0;
+
+    /**
+     * Visit methods for the variable declaration type.
+     *
+     * @param stmt The variable declaration to visit.
+     */
+    virtual void visitVarStmt(const Var& stmt) = 0;
+
+    /**
+     * Visit methods for the while statement type.
+     *
+     * @param stmt The while statement to visit.
+     */
+    virtual void visitWhileStmt(const While& stmt) = 0;
+};
+
+/**
+ * Abstract base class for all statement types in the AST.
+ */
+class Stmt {
+private:
+    /**
+     * Number of nodes, statements and expressions, on the longest path from this node down to a leaf.
+     */
+    std::uint32_t m_height;
+
+protected:
+    /**
+     * Constructor.
+     *
+     * @param height Height of the node.
+     */
+    explicit Stmt(std::uint32_t height) noexcept : m_height(height) {}
+
+    /**
+     * Height of the tallest statement.
+     *
+     * @param statements The statements.
+     * @return The height, 0 if there are none.
+     */
+    [[nodiscard]] static std::uint32_t tallest(const std::vector<std::unique_ptr<Stmt>>& statements) noexcept {
+        std::uint32_t height = 0;
+        for (const auto& statement : statements) {
+            height = std::max(height, statement->height());
+        }
+
+        return height;
+    }
+
+public:
+    /**
+     * Virtual destructor to ensure proper cleanup of derived classes.
+     */
+    virtual ~Stmt() = default;
+
+    /**
+     * Allocate a node through the memory scope of the calling thread.
+     *
+     * @param size Size of the node in bytes.
+     * @return The storage.
+     * @throws std::bad_alloc if the allocation fails.
+     */
+    [[nodiscard]] static void* operator new(std::size_t size) {
+        return MemoryScope::allocate(size);
+    }
+
+    /**
+     * Deallocate a node through the resource it came from.
+     *
+     * @param block The storage.
+     */
+    static void operator delete(void* block) noexcept {
+        MemoryScope::deallocate(block);
+    }
+
+    /**
+     * Get the height of the node.
+     *
+     * @return The number of nodes on the longest path down to a leaf.
+     */
+    [[nodiscard]] std::uint32_t height() const noexcept {
+        return m_height;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    virtual void accept(StmtVisitor& visitor) const = 0;
+};
+
+/**
+ * Statement pointer type for managing statement objects.
+ */
+using StmtPtr = std::unique_ptr<Stmt>;
+
+/**
+ * Block statement class representing a braced list of statements with its own scope.
+ */
+class Block : public Stmt {
+private:
+    /**
+     * The statements of the block.
+     */
+    std::vector<StmtPtr> m_statements;
+
+public:
+    /**
+     * Constructor for the Block statement.
+     *
+     * @param statements The statements of the block.
+     */
+    explicit Block(std::vector<StmtPtr> statements)
+        : Stmt(1 + tallest(statements)), m_statements(std::move(statements)) {}
+
+    /**
+     * Get the statements of the block.
+     *
+     * @return The statements.
+     */
+    [[nodiscard]] const std::vector<StmtPtr>& statements() const noexcept {
+        return m_statements;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitBlockStmt(*this);
+    }
+};
+
+/**
+ * Expression statement class representing an expression evaluated for its effects.
+ */
+class Expression : public Stmt {
+private:
+    /**
+     * The expression.
+     */
+    ExprPtr m_expression;
+
+public:
+    /**
+     * Constructor for the Expression statement.
+     *
+     * @param expression The expression.
+     */
+    explicit Expression(ExprPtr expression) : Stmt(1 + expression->height()), m_expression(std::move(expression)) {}
+
+    /**
+     * Get the expression.
+     *
+     * @return The expression.
+     */
+    [[nodiscard]] const Expr& expression() const noexcept {
+        return *m_expression;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitExpressionStmt(*this);
+    }
+};
+
+/**
+ * A variable a function captures when its closure is created.
+ */
+struct Capture {
+    /**
+     * Flag, whether the variable is a local of the enclosing frame, else an upvalue of the enclosing closure.
+     */
+    bool local;
+
+    /**
+     * Slot of the local in the enclosing frame, or index of the upvalue of the enclosing closure.
+     */
+    std::uint32_t index;
+
+    /**
+     * Compare two captures.
+     *
+     * @param other The other capture.
+     * @return True if both capture the same variable.
+     */
+    [[nodiscard]] bool operator==(const Capture& other) const noexcept = default;
+};
+
+/**
+ * Function declaration class representing a `fun` statement or a method of a class.
+ * The resolver lays out its frame: the parameters take the first slots, in order, followed by its locals.
+ * A method has its receiver, `this`, in slot 0 before the parameters.
+ */
+class Function : public Stmt {
+public:
+    /**
+     * Kinds of functions.
+     */
+    enum class Kind : std::uint8_t {
+        // A `fun` declaration.
+        FUNCTION,
+
+        // A method of a class, called with a receiver.
+        METHOD,
+
+        // The `init` method of a class, which returns its receiver.
+        INITIALIZER,
+    };
+
+    /**
+     * Name of the method a call of a class runs on the new instance.
+     */
+    static constexpr std::string_view INITIALIZER = "init";
+
+private:
+    /**
+     * Name token of the function.
+     */
+    Token m_name;
+
+    /**
+     * Name tokens of the parameters.
+     */
+    std::vector<Token> m_params;
+
+    /**
+     * The statements of the body.
+     */
+    std::vector<StmtPtr> m_body;
+
+    /**
+     * Kind of function.
+     */
+    Kind m_kind;
+
+    /**
+     * Storage of the function name, set by the resolver.
+     */
+    mutable Binding m_binding;
+
+    /**
+     * Number of slots of a call frame, set by the resolver.
+     */
+    mutable std::uint32_t m_slots = 0;
+
+    /**
+     * Variables of the enclosing functions the body uses, in upvalue order, set by the resolver.
+     */
+    mutable std::vector<Capture> m_captures;
+
+    /**
+     * Slots of the receiver and parameters captured by inner functions, set by the resolver.
+     */
+    mutable std::vector<std::uint32_t> m_cells;
+
+public:
+    /**
+     * Constructor for the Function statement.
+     *
+     * @param name   The name token.
+     * @param params The parameter name tokens.
+     * @param body   The statements of the body.
+     * @param kind   Kind of function.
+     */
+    Function(Token name, std::vector<Token> params, std::vector<StmtPtr> body, Kind kind = Kind::FUNCTION)
+        : Stmt(1 + tallest(body)), m_name(std::move(name)), m_params(std::move(params)), m_body(std::move(body)),
+          m_kind(kind) {}
+
+    /**
+     * Get the name token.
+     *
+     * @return The name token.
+     */
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the parameters.
+     *
+     * @return The parameter name tokens.
+     */
+    [[nodiscard]] const std::vector<Token>& params() const noexcept {
+        return m_params;
+    }
+
+    /**
+     * Get the statements of the body.
+     *
+     * @return The statements.
+     */
+    [[nodiscard]] const std::vector<StmtPtr>& body() const noexcept {
+        return m_body;
+    }
+
+    /**
+     * Get the kind of function.
+     *
+     * @return The kind.
+     */
+    [[nodiscard]] Kind kind() const noexcept {
+        return m_kind;
+    }
+
+    /**
+     * Check whether a call passes a receiver in slot 0.
+     *
+     * @return True for methods and initializers.
+     */
+    [[nodiscard]] bool hasReceiver() const noexcept {
+        return m_kind != Kind::FUNCTION;
+    }
+
+    /**
+     * Get the storage of the function name.
+     *
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
+     */
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of the function name. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures the name.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Get the number of slots of a call frame.
+     *
+     * @return The number of slots, at least the number of parameters once resolved.
+     */
+    [[nodiscard]] std::uint32_t slots() const noexcept {
+        return m_slots;
+    }
+
+    /**
+     * Get the variables of the enclosing functions the body uses.
+     *
+     * @return The captures, in upvalue order.
+     */
+    [[nodiscard]] const std::vector<Capture>& captures() const noexcept {
+        return m_captures;
+    }
+
+    /**
+     * Get the slots of the receiver and parameters captured by inner functions, which a call moves into cells.
+     *
+     * @return The slots.
+     */
+    [[nodiscard]] const std::vector<std::uint32_t>& cells() const noexcept {
+        return m_cells;
+    }
+
+    /**
+     * Set the frame layout. Only the resolver calls this, before the tree is shared.
+     *
+     * @param slots Number of slots of a call frame.
+     * @param captures Variables of the enclosing functions the body uses, in upvalue order.
+     * @param cells Slots of the receiver and parameters captured by inner functions.
+     */
+    void layout(std::uint32_t slots, std::vector<Capture> captures, std::vector<std::uint32_t> cells) const {
+        m_slots = slots;
+        m_captures = std::move(captures);
+        m_cells = std::move(cells);
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitFunctionStmt(*this);
+    }
+};
+
+/**
+ * Class declaration class representing a `class` statement.
+ */
+class Class : public Stmt {
+private:
+    /**
+     * Name token of the class.
+     */
+    Token m_name;
+
+    /**
+     * The superclass, may be null.
+     */
+    std::unique_ptr<Variable> m_superclass;
+
+    /**
+     * The methods, in declaration order.
+     */
+    std::vector<std::unique_ptr<Function>> m_methods;
+
+    /**
+     * Storage of the class name, set by the resolver.
+     */
+    mutable Binding m_binding;
+
+    /**
+     * Height of the tallest method.
+     *
+     * @param methods The methods.
+     * @return The height, 0 if there are none.
+     */
+    [[nodiscard]] static std::uint32_t tallest(const std::vector<std::unique_ptr<Function>>& methods) noexcept {
+        std::uint32_t height = 0;
+        for (const auto& method : methods) {
+            height = std::max(height, method->height());
+        }
+
+        return height;
+    }
+
+public:
+    /**
+     * Constructor for the Class statement.
+     *
+     * @param name       The name token.
+     * @param superclass The superclass, may be null.
+     * @param methods    The methods.
+     */
+    Class(Token name, std::unique_ptr<Variable> superclass, std::vector<std::unique_ptr<Function>> methods)
+        : Stmt(1 + tallest(methods)), m_name(std::move(name)), m_superclass(std::move(superclass)),
+          m_methods(std::move(methods)) {}
+
+    /**
+     * Get the name token.
+     *
+     * @return The name token.
+     */
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the superclass.
+     *
+     * @return The superclass variable, or nullptr if the class has none.
+     */
+    [[nodiscard]] const Variable* superclass() const noexcept {
+        return m_superclass.get();
+    }
+
+    /**
+     * Get the methods.
+     *
+     * @return The method declarations, in declaration order.
+     */
+    [[nodiscard]] const std::vector<std::unique_ptr<Function>>& methods() const noexcept {
+        return m_methods;
+    }
+
+    /**
+     * Get the storage of the class name.
+     *
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
+     */
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of the class name. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures the name.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitClassStmt(*this);
+    }
+};
+
+/**
+ * If statement class representing a conditional branch.
+ */
+class If : public Stmt {
+private:
+    /**
+     * The `if` keyword.
+     */
+    Token m_keyword;
+
+    /**
+     * The condition.
+     */
+    ExprPtr m_condition;
+
+    /**
+     * Statement executed if the condition is truthy.
+     */
+    StmtPtr m_thenBranch;
+
+    /**
+     * Statement executed otherwise, may be null.
+     */
+    StmtPtr m_elseBranch;
+
+public:
+    /**
+     * Constructor for the If statement.
+     *
+     * @param keyword    The `if` keyword.
+     * @param condition  The condition.
+     * @param thenBranch Statement executed if the condition is truthy.
+     * @param elseBranch Statement executed otherwise, may be null.
+     */
+    If(Token keyword, ExprPtr condition, StmtPtr thenBranch, StmtPtr elseBranch)
+        : Stmt(1 + std::max({condition->height(), thenBranch->height(), elseBranch ? elseBranch->height() : 0})),
+          m_keyword(std::move(keyword)), m_condition(std::move(condition)), m_thenBranch(std::move(thenBranch)),
+          m_elseBranch(std::move(elseBranch)) {}
+
+    /**
+     * Get the `if` keyword.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the condition.
+     *
+     * @return The condition.
+     */
+    [[nodiscard]] const Expr& condition() const noexcept {
+        return *m_condition;
+    }
+
+    /**
+     * Get the statement executed if the condition is truthy.
+     *
+     * @return The statement.
+     */
+    [[nodiscard]] const Stmt& thenBranch() const noexcept {
+        return *m_thenBranch;
+    }
+
+    /**
+     * Get the statement executed if the condition is falsey.
+     *
+     * @return The statement, or nullptr if there is no else branch.
+     */
+    [[nodiscard]] const Stmt* elseBranch() const noexcept {
+        return m_elseBranch.get();
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitIfStmt(*this);
+    }
+};
+
+/**
+ * Print statement class representing an expression whose value is written to the output.
+ * A program ending in an expression without a semicolon prints it, as if it were a print statement.
+ */
+class Print : public Stmt {
+private:
+    /**
+     * The `print` keyword, or the first token of a trailing expression.
+     */
+    Token m_keyword;
+
+    /**
+     * The printed expression.
+     */
+    ExprPtr m_expression;
+
+public:
+    /**
+     * Constructor for the Print statement.
+     *
+     * @param keyword    The `print` keyword, or the first token of a trailing expression.
+     * @param expression The printed expression.
+     */
+    Print(Token keyword, ExprPtr expression)
+        : Stmt(1 + expression->height()), m_keyword(std::move(keyword)), m_expression(std::move(expression)) {}
+
+    /**
+     * Get the `print` keyword, or the first token of a trailing expression.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the printed expression.
+     *
+     * @return The expression.
+     */
+    [[nodiscard]] const Expr& expression() const noexcept {
+        return *m_expression;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitPrintStmt(*this);
+    }
+};
+
+/**
+ * Return statement class representing a `return` from the enclosing function.
+ */
+class Return : public Stmt {
+private:
+    /**
+     * The `return` keyword.
+     */
+    Token m_keyword;
+
+    /**
+     * The returned value, may be null for nil.
+     */
+    ExprPtr m_value;
+
+public:
+    /**
+     * Constructor for the Return statement.
+     *
+     * @param keyword The `return` keyword.
+     * @param value   The returned value, may be null.
+     */
+    Return(Token keyword, ExprPtr value)
+        : Stmt(1 + (value ? value->height() : 0)), m_keyword(std::move(keyword)), m_value(std::move(value)) {}
+
+    /**
+     * Get the `return` keyword.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the returned value.
+     *
+     * @return The value expression, or nullptr if the function returns nil.
+     */
+    [[nodiscard]] const Expr* value() const noexcept {
+        return m_value.get();
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitReturnStmt(*this);
+    }
+};
+
+/**
+ * Spawn statement class representing a `spawn` of a function call, which runs as a task of its own.
+ */
+class Spawn : public Stmt {
+private:
+    /**
+     * The `spawn` keyword.
+     */
+    Token m_keyword;
+
+    /**
+     * The spawned call.
+     */
+    ExprPtr m_call;
+
+public:
+    /**
+     * Constructor for the Spawn statement.
+     *
+     * @param keyword The `spawn` keyword.
+     * @param call    The spawned call, which must be a Call expression.
+     */
+    Spawn(Token keyword, ExprPtr call)
+        : Stmt(1 + call->height()), m_keyword(std::move(keyword)), m_call(std::move(call)) {}
+
+    /**
+     * Get the `spawn` keyword.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the spawned call.
+     *
+     * @return The call expression.
+     */
+    [[nodiscard]] const Call& call() const noexcept {
+        return static_cast<const Call&>(*m_call);
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitSpawnStmt(*this);
+    }
+};
+
+/**
+ * Variable declaration class representing a `var` statement.
+ */
+class Var : public Stmt {
+private:
+    /**
+     * Name token of the variable.
+     */
+    Token m_name;
+
+    /**
+     * The initializer, may be null for nil.
+     */
+    ExprPtr m_initializer;
+
+    /**
+     * Storage of the variable, set by the resolver.
+     */
+    mutable Binding m_binding;
+
+public:
+    /**
+     * Constructor for the Var statement.
+     *
+     * @param name        The name token.
+     * @param initializer The initializer, may be null.
+     */
+    Var(Token name, ExprPtr initializer)
+        : Stmt(1 + (initializer ? initializer->height() : 0)), m_name(std::move(name)),
+          m_initializer(std::move(initializer)) {}
+
+    /**
+     * Get the name token.
+     *
+     * @return The name token.
+     */
+    [[nodiscard]] const Token& name() const noexcept {
+        return m_name;
+    }
+
+    /**
+     * Get the initializer.
+     *
+     * @return The initializer, or nullptr if the variable starts out nil.
+     */
+    [[nodiscard]] const Expr* initializer() const noexcept {
+        return m_initializer.get();
+    }
+
+    /**
+     * Get the storage of the variable.
+     *
+     * @return The binding, UNRESOLVED unless the tree went through the resolver.
+     */
+    [[nodiscard]] const Binding& binding() const noexcept {
+        return m_binding;
+    }
+
+    /**
+     * Set the storage of the variable. Only the resolver calls this, before the tree is shared.
+     *
+     * @param binding The binding.
+     * @return The stored binding, which the resolver turns into a cell if a closure captures the variable.
+     */
+    Binding& bind(Binding binding) const noexcept {
+        m_binding = binding;
+        return m_binding;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitVarStmt(*this);
+    }
+};
+
+/**
+ * While statement class representing a loop. `for` loops are desugared into it by the parser.
+ */
+class While : public Stmt {
+private:
+    /**
+     * The `while` keyword, or the `for` keyword of a desugared for loop.
+     */
+    Token m_keyword;
+
+    /**
+     * The loop condition.
+     */
+    ExprPtr m_condition;
+
+    /**
+     * The loop body.
+     */
+    StmtPtr m_body;
+
+public:
+    /**
+     * Constructor for the While statement.
+     *
+     * @param keyword   The `while` or `for` keyword.
+     * @param condition The loop condition.
+     * @param body      The loop body.
+     */
+    While(Token keyword, ExprPtr condition, StmtPtr body)
+        : Stmt(1 + std::max(condition->height(), body->height())), m_keyword(std::move(keyword)),
+          m_condition(std::move(condition)), m_body(std::move(body)) {}
+
+    /**
+     * Get the `while` keyword, or the `for` keyword of a desugared for loop.
+     *
+     * @return The keyword token.
+     */
+    [[nodiscard]] const Token& keyword() const noexcept {
+        return m_keyword;
+    }
+
+    /**
+     * Get the loop condition.
+     *
+     * @return The condition.
+     */
+    [[nodiscard]] const Expr& condition() const noexcept {
+        return *m_condition;
+    }
+
+    /**
+     * Get the loop body.
+     *
+     * @return The body.
+     */
+    [[nodiscard]] const Stmt& body() const noexcept {
+        return *m_body;
+    }
+
+    /**
+     * Accept method for the Visitor pattern.
+     *
+     * @param visitor The statement visitor.
+     */
+    void accept(StmtVisitor& visitor) const override {
+        visitor.visitWhileStmt(*this);
+    }
+};
+
+/**
+ * A parsed script: its top-level statements, and the storage the resolver laid out for its variables.
+ */
+class Program {
+private:
+    /**
+     * The top-level statements.
+     */
+    std::vector<StmtPtr> m_statements;
+
+    /**
+     * Names of the global variables the program refers to, indexed by global slot.
+     */
+    std::vector<std::string> m_globals;
+
+    /**
+     * Number of local slots of the top-level frame.
+     */
+    std::uint32_t m_slots = 0;
+
+    /**
+     * Height of the tallest statement.
+     */
+    std::uint32_t m_height = 0;
+
+public:
+    /**
+     * Constructs an unresolved program.
+     *
+     * @param statements The top-level statements.
+     */
+    explicit Program(std::vector<StmtPtr> statements) : m_statements(std::move(statements)) {
+        for (const auto& statement : m_statements) {
+            m_height = std::max(m_height, statement->height());
+        }
+    }
+
+    /**
+     * Get the top-level statements.
+     *
+     * @return The statements.
+     */
+    [[nodiscard]] const std::vector<StmtPtr>& statements() const noexcept {
+        return m_statements;
+    }
+
+    /**
+     * Get the names of the global variables the program refers to.
+     *
+     * @return The names, indexed by global slot.
+     */
+    [[nodiscard]] const std::vector<std::string>& globals() const noexcept {
+        return m_globals;
+    }
+
+    /**
+     * Get the number of local slots of the top-level frame.
+     *
+     * @return The number of slots.
+     */
+    [[nodiscard]] std::uint32_t slots() const noexcept {
+        return m_slots;
+    }
+
+    /**
+     * Get the height of the program.
+     *
+     * @return The height of the tallest statement, 0 if there are none.
+     */
+    [[nodiscard]] std::uint32_t height() const noexcept {
+        return m_height;
+    }
+
+    /**
+     * Set the storage laid out by the resolver.
+     *
+     * @param globals Names of the global variables, indexed by global slot.
+     * @param slots Number of local slots of the top-level frame.
+     */
+    void layout(std::vector<std::string> globals, std::uint32_t slots) {
+        m_globals = std::move(globals);
+        m_slots = slots;
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "heap.h"
+#include "object.h"
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <utility>
+
+/**
+ * A string value. Strings are immutable, so values share them by pointer instead of copying the characters.
+ * Concatenating long strings makes a rope, a node pointing at both halves, so appending to a string in a loop
+ * costs O(1) instead of copying everything built so far. A rope flattens its characters on first use, when it
+ * is printed or compared, and then drops the halves.
+ */
+class String : public Object {
+public:
+    /**
+     * Length under which concatenating copies the characters into a flat string, cheaper than a rope node.
+     */
+    static constexpr std::size_t MIN_ROPE_LENGTH = 64;
+
+private:
+    /**
+     * The characters, empty until a rope is flattened.
+     */
+    mutable std::string m_value;
+
+    /**
+     * Left half of a rope not flattened yet, otherwise null.
+     */
+    mutable const String* m_left = nullptr;
+
+    /**
+     * Right half of a rope not flattened yet, otherwise null.
+     */
+    mutable const String* m_right = nullptr;
+
+    /**
+     * Number of characters.
+     */
+    std::size_t m_length;
+
+    /**
+     * Hash of the characters, 0 until computed.
+     */
+    mutable std::uint64_t m_hash = 0;
+
+public:
+    /**
+     * Constructs a flat string.
+     *
+     * @param value The characters.
+     */
+    explicit String(std::string value) : m_value(std::move(value)), m_length(m_value.size()) {}
+
+    /**
+     * Constructs a rope joining two strings of the same heap.
+     *
+     * @param left The first half.
+     * @param right The second half.
+     */
+    String(const String* left, const String* right)
+        : m_left(left), m_right(right), m_length(left->m_length + right->m_length) {}
+
+    /**
+     * Concatenate two strings, making a rope unless the result is short.
+     *
+     * @param heap The heap to allocate on.
+     * @param left The first string.
+     * @param right The second string.
+     * @return The concatenation, one of the operands if the other is empty.
+     */
+    [[nodiscard]] static String* concat(Heap& heap, String* left, String* right);
+
+    /**
+     * Concatenate several strings. Runs of short strings are copied into one buffer sized up front, so a chain
+     * of short strings costs a single allocation, while long strings are linked into ropes as by concat().
+     *
+     * @param heap The heap to allocate on.
+     * @param parts The strings, in order, each holding a String pointer.
+     * @return The concatenation.
+     */
+    [[nodiscard]] static String* join(Heap& heap, std::span<const std::any> parts);
+
+    /**
+     * Get the characters, flattening the string if it is a rope.
+     *
+     * @return The characters.
+     */
+    [[nodiscard]] const std::string& value() const {
+        if (m_left != nullptr) {
+            flatten();
+        }
+
+        return m_value;
+    }
+
+    /**
+     * Get the number of characters, without flattening.
+     *
+     * @return The length.
+     */
+    [[nodiscard]] std::size_t length() const noexcept {
+        return m_length;
+    }
+
+    /**
+     * Compare the characters of two strings, flattening them only if their lengths match.
+     *
+     * @param other The other string.
+     * @return True if both hold the same characters.
+     */
+    [[nodiscard]] bool equals(const String& other) const;
+
+    /**
+     * Hash the characters, flattening the string if it is a rope. The hash is computed once and cached, so
+     * looking a string up again, for instance as the key of a map, does not go over its characters.
+     *
+     * @return The hash, never 0.
+     */
+    [[nodiscard]] std::uint64_t hash() const {
+        if (m_hash == 0) {
+            auto hash = std::hash<std::string>{}(value());
+            m_hash = hash != 0 ? hash : 1;
+        }
+
+        return m_hash;
+    }
+
+    /**
+     * Mark the halves of a rope.
+     *
+     * @param heap The heap being collected.
+     */
+    void trace(Heap& heap) const override {
+        heap.mark(m_left);
+        heap.mark(m_right);
+    }
+
+    /**
+     * Get the memory the string holds.
+     *
+     * @return The size in bytes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept override {
+        return sizeof(String) + m_value.capacity();
+    }
+
+private:
+    /**
+     * Copy the characters of every leaf of the rope into one buffer and drop the halves. Walks an explicit
+     * stack, since a string built by appending in a loop is a rope as deep as the number of appends.
+     */
+    void flatten() const;
+};
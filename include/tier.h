@@ -0,0 +1,306 @@
+#pragma once
+
+#include "ast.h"
+#include "feedback.h"
+
+#include <any>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+// Forward declarations.
+class Interpreter;
+
+/**
+ * Compiled (closure) representation of an expression subtree.
+ * Produced by the ClosureCompiler and swapped into the AST once ready.
+ */
+class CompiledExpr {
+public:
+    /**
+     * Closure type evaluating the compiled subtree against an interpreter's state.
+     */
+    using Fn = std::function<std::any(Interpreter&)>;
+
+private:
+    /**
+     * The root closure of the compiled subtree.
+     */
+    Fn m_fn;
+
+public:
+    /**
+     * Constructs a compiled expression from its root closure.
+     *
+     * @param fn The root closure.
+     */
+    explicit CompiledExpr(Fn fn) : m_fn(std::move(fn)) {}
+
+    /**
+     * Evaluates the compiled subtree.
+     *
+     * @param interpreter The interpreter providing variables.
+     * @return The result of the evaluation as std::any.
+     */
+    [[nodiscard]] std::any operator()(Interpreter& interpreter) const {
+        return m_fn(interpreter);
+    }
+};
+
+/**
+ * Compiles an expression subtree into a tree of closures.
+ * Operators and literal values are resolved once at compile time, so evaluation
+ * skips the visitor dispatch and the per-node operator switch.
+ * With a type profile, operators that only ever saw one operand kind get a guarded fast path.
+ */
+class ClosureCompiler : public ExprVisitor {
+private:
+    /**
+     * Type feedback used to specialize operators, may be null.
+     */
+    const TypeProfile* m_profile;
+
+    /**
+     * The closure produced by the last visited expression.
+     */
+    CompiledExpr::Fn m_result;
+
+public:
+    /**
+     * Constructs a closure compiler.
+     *
+     * @param profile Type feedback used to specialize operators, may be null.
+     */
+    explicit ClosureCompiler(const TypeProfile* profile = nullptr) : m_profile(profile) {}
+
+    /**
+     * Compile an expression subtree.
+     *
+     * @param expr The expression to compile.
+     * @return The compiled expression.
+     */
+    [[nodiscard]] CompiledExpr::Fn compile(const Expr& expr) {
+        expr.accept(*this);
+
+        return std::move(m_result);
+    }
+
+private:
+    /**
+     * Visit method for the array literal expression type.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override;
+
+    /**
+     * Visit method for the assignment expression type.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override;
+
+    /**
+     * Visit method for the binary expression type.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override;
+
+    /**
+     * Visit method for the call expression type.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override;
+
+    /**
+     * Visit method for the property get expression type.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override;
+
+    /**
+     * Visit method for the grouping expression type.
+     *
+     * @param expr The grouping expression to visit.
+     */
+    void visitGroupingExpr(const Grouping& expr) override {
+        m_result = compile(expr.expression());
+    }
+
+    /**
+     * Visit method for the index expression type.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override;
+
+    /**
+     * Visit method for the literal expression type.
+     *
+     * @param expr The literal expression to visit.
+     */
+    void visitLiteralExpr(const Lit& expr) override;
+
+    /**
+     * Visit method for the logical expression type.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override;
+
+    /**
+     * Visit method for the property set expression type.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override;
+
+    /**
+     * Visit method for the element set expression type.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override;
+
+    /**
+     * Visit method for the super expression type.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override;
+
+    /**
+     * Visit method for the this expression type.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override {
+        m_result = variable(expr.keyword(), expr.binding());
+    }
+
+    /**
+     * Visit method for the unary expression type.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override;
+
+    /**
+     * Visit method for the variable expression type.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override {
+        m_result = variable(expr.name(), expr.binding());
+    }
+
+    /**
+     * Build a closure reading a variable, indexing the running frame directly for plain locals.
+     *
+     * @param name The name token of the variable, owned by the tree.
+     * @param binding The storage of the variable.
+     * @return The compiled closure.
+     */
+    [[nodiscard]] static CompiledExpr::Fn variable(const Token& name, const Binding& binding);
+
+    /**
+     * Build a closure applying a binary operator to two numbers, and through the interpreter to other operands.
+     *
+     * @param left The compiled left operand.
+     * @param right The compiled right operand.
+     * @param op The operator token for error reporting.
+     * @param fn The arithmetic or comparison function.
+     * @return The compiled closure.
+     */
+    template <typename Fn>
+    [[nodiscard]] static CompiledExpr::Fn numeric(CompiledExpr::Fn left, CompiledExpr::Fn right, const Token& op,
+                                                  Fn fn);
+
+    /**
+     * Build a closure concatenating a chain like `a + b + c + d` at once, if it has three operands or more and
+     * one of them is a string literal or its feedback saw strings. The strings of the chain wait on the value
+     * stack and are joined into a single allocation at the end, instead of one intermediate string per `+`.
+     * Chains of numbers still add up pairwise, and mixed operands raise the error of the first `+` whose
+     * operands differ, after the same operands were evaluated.
+     *
+     * @param expr The last `+` of the chain.
+     * @return The compiled closure, or an empty one if the chain is not worth fusing.
+     */
+    [[nodiscard]] CompiledExpr::Fn concatenation(const Binary& expr);
+
+    /**
+     * Get the type feedback for an operator.
+     *
+     * @param op The operator token.
+     * @return The observed operand kinds, or nullptr if none are known.
+     */
+    [[nodiscard]] const OperandTypes* feedback(const Token& op) const {
+        return m_profile != nullptr ? m_profile->lookup(op) : nullptr;
+    }
+};
+
+/**
+ * Background compiler promoting hot expression subtrees to the closure tier.
+ * The worker thread is started lazily on the first promotion, so cold code never pays for it.
+ */
+class TierCompiler {
+private:
+    /**
+     * Guards the job queue.
+     */
+    std::mutex m_mutex;
+
+    /**
+     * Signals the worker that a job is available.
+     */
+    std::condition_variable_any m_ready;
+
+    /**
+     * A pending compilation.
+     */
+    struct Job {
+        /**
+         * The subtree to compile, sharing ownership of the tree it belongs to.
+         */
+        std::shared_ptr<const Expr> expr;
+
+        /**
+         * Type feedback used to specialize the subtree, may be null.
+         */
+        std::shared_ptr<const TypeProfile> profile;
+    };
+
+    /**
+     * Pending compilations.
+     */
+    std::deque<Job> m_queue;
+
+    /**
+     * The worker thread. Declared last so it is joined before the queue is destroyed.
+     */
+    std::jthread m_worker;
+
+public:
+    /**
+     * Queue a subtree for background compilation.
+     *
+     * @param expr The subtree to compile, keeping its tree alive until compiled.
+     * @param profile Type feedback used to specialize the subtree, may be null.
+     */
+    void enqueue(std::shared_ptr<const Expr> expr, std::shared_ptr<const TypeProfile> profile);
+
+private:
+    /**
+     * Worker loop compiling queued subtrees until a stop is requested.
+     *
+     * @param stop The stop token of the worker thread.
+     */
+    void run(const std::stop_token& stop);
+};
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <variant>
 
 /**
@@ -13,6 +16,8 @@ enum class TokenType : std::uint8_t {
     RIGHT_PAREN,
     LEFT_BRACE,
     RIGHT_BRACE,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
     COMMA,
     DOT,
     MINUS,
@@ -48,6 +53,7 @@ enum class TokenType : std::uint8_t {
     OR,
     PRINT,
     RETURN,
+    SPAWN,
     SUPER,
     THIS,
     TRUE,
@@ -86,6 +92,11 @@ struct Token {
      */
     std::size_t line;
 
+    /**
+     * Column number where the token starts on its line.
+     */
+    std::size_t column;
+
     /**
      * Default constructor.
      *
@@ -93,8 +104,9 @@ struct Token {
      * @param lexeme Lexeme (text) of the token.
      * @param literal Literal value of the token.
      * @param line Line number where the token appears.
+     * @param column Column number where the token starts on its line.
      */
-    Token(TokenType type, std::string lexeme, Literal literal, std::size_t line);
+    Token(TokenType type, std::string lexeme, Literal literal, std::size_t line, std::size_t column);
 
     /**
      * Converts the token to a string representation.
@@ -103,3 +115,30 @@ struct Token {
      */
     [[nodiscard]] std::string toString() const;
 };
+
+/**
+ * Transparent hash functor for string_view lookups in unordered_map.
+ */
+struct StringHash {
+    using is_transparent = void;
+
+    /**
+     * Hash function for std::string_view.
+     *
+     * @param sv The string view to hash.
+     * @return The hash value.
+     */
+    [[nodiscard]] std::size_t operator()(std::string_view sv) const noexcept {
+        return std::hash<std::string_view>{}(sv);
+    }
+
+    /**
+     * Hash function for std::string.
+     *
+     * @param s The string to hash.
+     * @return The hash value.
+     */
+    [[nodiscard]] std::size_t operator()(const std::string& s) const noexcept {
+        return std::hash<std::string_view>{}(s);
+    }
+};
@@ -1,42 +1,142 @@
 #pragma once
 
-#include "token.h"
+#include "allocator.h"
+#include "diagnostics.h"
+#include "heap.h"
+#include "native.h"
+#include "sink.h"
+#include "stats.h"
 
-#include <cstddef>
+#include <any>
+#include <cstdint>
+#include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <ostream>
 #include <string>
 #include <string_view>
+#include <vector>
 
 // Forward declarations.
+class ExecutionProfile;
 class Interpreter;
-class RuntimeError;
+class Program;
+class Scheduler;
+class StackSampler;
+class TraceRecorder;
+class TypeProfile;
 
 /**
  * Tox interpreter.
+ * Each instance owns its diagnostics and interpreter state, so instances may run concurrently on different threads.
+ * A single instance must not be used by several threads at once.
  */
 class Tox {
 private:
     /**
-     * Flag, whether an error has occurred.
+     * Sink for standard output, owned when no sink is given.
      */
-    static bool hadError;
+    std::unique_ptr<OutputSink> m_ownedOutput;
 
     /**
-     * Flag, whether a runtime error has occurred.
+     * Sink receiving printed results, flushed after each file and REPL line.
      */
-    static bool hadRuntimeError;
+    OutputSink& m_output;
+
+    /**
+     * Error reporting context of this instance.
+     */
+    Diagnostics m_diagnostics;
 
     /**
      * The interpreter instance.
      */
     std::unique_ptr<Interpreter> m_interpreter;
 
+    /**
+     * Runs the tasks the scripts spawn, each on an interpreter set up as this instance's.
+     */
+    std::unique_ptr<Scheduler> m_scheduler;
+
+    /**
+     * Type feedback loaded from a previous run, may be null.
+     */
+    std::shared_ptr<const TypeProfile> m_profile;
+
+    /**
+     * Type feedback recorded by this instance, may be null.
+     */
+    std::shared_ptr<TypeProfile> m_recorder;
+
+    /**
+     * Execution counters, null unless profiling is enabled.
+     */
+    std::unique_ptr<ExecutionProfile> m_execution;
+
+    /**
+     * Sampling profiler, null unless sampling is enabled.
+     */
+    std::unique_ptr<StackSampler> m_sampler;
+
+    /**
+     * Maximum nesting depth set on the interpreter, 0 for the default.
+     */
+    std::uint32_t m_maxDepth = 0;
+
+    /**
+     * Growth factor set on the interpreter's heap.
+     */
+    double m_heapGrowth = Heap::DEFAULT_GROWTH;
+
+    /**
+     * Flag, whether the interpreter's heap collects after every allocation.
+     */
+    bool m_heapStress = false;
+
+    /**
+     * Native functions defined on this instance, defined again on a replaced interpreter.
+     */
+    std::vector<NativeFunction> m_natives;
+
+    /**
+     * Recorder receiving the phases of each run, may be null.
+     */
+    TraceRecorder* m_tracer = nullptr;
+
+    /**
+     * Path of the script being run, empty for source code given directly.
+     */
+    std::string m_script;
+
+    /**
+     * Resource allocating through the memory scopes of each phase, nullptr for malloc.
+     */
+    std::pmr::memory_resource* m_resource = nullptr;
+
+    /**
+     * Allocation counters of each phase.
+     */
+    MemoryStats m_memory;
+
+    /**
+     * Metrics of the last parse and of the evaluation that followed it.
+     */
+    RunStats m_stats;
+
 public:
     /**
-     * Constructs a new Tox interpreter.
+     * Constructs a new Tox interpreter printing to stdout and stderr.
      */
     Tox();
 
+    /**
+     * Constructs a new Tox interpreter.
+     *
+     * @param output Sink receiving printed results, which must outlive the instance.
+     * @param errors Stream receiving error messages, which must outlive the instance.
+     */
+    explicit Tox(OutputSink& output, std::ostream& errors = std::cerr);
+
     /**
      * Destructor.
      */
@@ -54,8 +154,72 @@ public:
      * Runs the given source code.
      *
      * @param src Source code to run.
+     * @return Metrics of the run.
+     */
+    RunStats run(const std::string& src);
+
+    /**
+     * Parses source code into a program and resolves its variables.
+     * The program is immutable and may be run by any number of instances, on any threads.
+     *
+     * @param src Source code to parse.
+     * @return The program, or nullptr if a syntax or resolution error was reported.
+     */
+    [[nodiscard]] std::shared_ptr<const Program> parse(const std::string& src);
+
+    /**
+     * Runs a parsed program.
+     *
+     * @param program The program to run, possibly shared with other instances, or nullptr to run nothing.
+     * @return Metrics of the last parse by this instance and of this evaluation.
+     */
+    RunStats run(std::shared_ptr<const Program> program);
+
+    /**
+     * Get the metrics of the last run, e.g. after runFile.
+     *
+     * @return Metrics of the last parse and of the evaluation that followed it.
+     */
+    [[nodiscard]] const RunStats& runStats() const noexcept {
+        return m_stats;
+    }
+
+    /**
+     * Get the error reporting context of this instance.
+     *
+     * @return The diagnostics.
+     */
+    [[nodiscard]] const Diagnostics& diagnostics() const noexcept {
+        return m_diagnostics;
+    }
+
+    /**
+     * Translates a source file to a standalone C++ translation unit and writes it to stdout.
+     * Only scripts made of a single expression, or a single print statement, can be translated.
+     *
+     * @param path Path to the source code file.
+     * @return Exit code (0 for success, non-zero for errors).
      */
-    void run(const std::string& src);
+    int emitCpp(const std::string& path);
+
+    /**
+     * Runs a program compiled by `tox --emit-cpp` and prints its result.
+     *
+     * @param program The compiled program, allocating its values on the heap it is given.
+     * @return Exit code (0 for success, non-zero for errors).
+     */
+    static int runCompiled(std::any (*program)(Heap&));
+
+    /**
+     * Get one of the native functions every script sees, for a program compiled by `tox --emit-cpp` to read the
+     * globals it uses once, before it starts.
+     *
+     * @param heap The heap of the program.
+     * @param name Name of the native function.
+     * @return The function, allocated on the heap.
+     * @throws std::out_of_range if no native function has the name.
+     */
+    [[nodiscard]] static std::any builtin(Heap& heap, std::string_view name);
 
     /**
      * Read-Eval-Print Loop (REPL) for Tox.
@@ -65,35 +229,167 @@ public:
     int repl();
 
     /**
-     * Reports an error at a specific line.
+     * Defines a C++ function as a global function of the scripts, e.g. `tox.define("clamp", &clamp)`.
+     * Arguments of the wrong type raise a runtime error; see NativeFunction for the supported types.
      *
-     * @param line Line number where the error occurred.
-     * @param msg Error message.
+     * @tparam R The return type.
+     * @tparam Args The parameter types.
+     * @param name Name of the global.
+     * @param function The function.
+     */
+    template <typename R, typename... Args> void define(std::string name, R (*function)(Args...)) {
+        defineNative(NativeFunction::bind(std::move(name), function));
+    }
+
+    /**
+     * Sets the maximum nesting depth of evaluated expressions; deeper nodes raise a runtime error.
      *
+     * @param depth The maximum depth.
      */
-    static void error(std::size_t line, std::string_view msg);
+    void setMaxDepth(std::uint32_t depth);
 
-    /*
-     * Reports an error at a specific token.
+    /**
+     * Sets how much the heap may grow between collections.
+     *
+     * @param growth Ratio between the heap size that triggers a collection and the size that survived the last
+     *               one, at least 1.
+     */
+    void setHeapGrowth(double growth);
+
+    /**
+     * Sets whether the heap collects at the first statement after every allocation, to test the collector.
+     *
+     * @param stress True to collect as often as possible.
+     */
+    void setHeapStress(bool stress);
+
+    /**
+     * Sets whether spawned tasks run one at a time on the thread running the script, in a reproducible order,
+     * instead of on a pool with one worker per hardware thread. Must be set before a script spawns a task.
+     *
+     * @param deterministic True for deterministic mode.
+     */
+    void setDeterministic(bool deterministic) noexcept;
+
+    /**
+     * Get the counters of the collections of the interpreter's heap.
+     *
+     * @return The counters.
+     */
+    [[nodiscard]] const HeapStats& heapStats() const noexcept;
+
+    /**
+     * Loads a type-feedback profile to pre-specialize evaluation.
+     *
+     * @param path Path to the profile file.
+     * @throws std::runtime_error if the profile cannot be read.
+     */
+    void loadProfile(const std::string& path);
+
+    /**
+     * Starts recording operand types, seeded with the loaded profile if any.
+     */
+    void recordProfile();
+
+    /**
+     * Writes the recorded type-feedback profile.
+     *
+     * @param path Path to the profile file.
+     * @throws std::runtime_error if the profile cannot be written.
+     */
+    void saveProfile(const std::string& path) const;
+
+    /**
+     * Starts counting and timing the phases, node kinds and operators of every following run.
+     * Replaces the interpreter with a profiling one, keeping its settings but not its globals.
+     * Cannot be combined with sampling.
+     *
+     * @throws std::logic_error if sampling is enabled.
+     */
+    void enableProfiling();
+
+    /**
+     * Starts sampling the operator stacks of every following run.
+     * Replaces the interpreter with a sampling one, keeping its settings but not its globals.
+     * Cannot be combined with profiling.
+     *
+     * @throws std::logic_error if profiling is enabled.
+     */
+    void enableSampling();
+
+    /**
+     * Writes the sampled stacks in the folded format read by flame graph tools.
+     *
+     * @param path Path to the output file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void saveSamples(const std::string& path) const;
+
+    /**
+     * Records a trace event for each file run and each scan, parse and evaluation phase.
+     *
+     * @param tracer The recorder, which must outlive the instance, or nullptr to stop tracing.
+     */
+    void setTracer(TraceRecorder* tracer) noexcept;
+
+    /**
+     * Sets the resource that scanning, parsing and evaluation allocate from, such as an arena or a pool.
+     * Parsed trees always allocate from it; tokens, values and strings only do in programs that route
+     * the global operator new through MemoryScope. Values sent between tasks are freed on another thread than
+     * the one that allocated them, which calls the resource from that thread, so a script spawning tasks needs a
+     * thread-safe resource such as std::pmr::synchronized_pool_resource.
+     *
+     * @param resource The resource, which must outlive every tree and value allocated from it, or nullptr for malloc.
+     */
+    void setMemoryResource(std::pmr::memory_resource* resource) noexcept {
+        m_resource = resource;
+    }
+
+    /**
+     * Get the allocation counters of each phase, accumulated over every run.
+     *
+     * @return The counters.
+     */
+    [[nodiscard]] const MemoryStats& memoryStats() const noexcept {
+        return m_memory;
+    }
+
+    /**
+     * Get the execution counters.
+     *
+     * @return The counters, or nullptr if profiling is not enabled.
+     */
+    [[nodiscard]] const ExecutionProfile* executionProfile() const noexcept {
+        return m_execution.get();
+    }
+
+private:
+    /**
+     * Defines the native functions every script sees: `clock()`; `array(n)`, `len(a)`, `sum(a)`, `dot(a, b)`,
+     * `min(a)` and `max(a)` over numeric arrays; `map()`, `has(m, k)`, `delete(m, k)`, `next(m, k)` and `len(m)`
+     * over maps; and `channel(n)`, `send(c, v)` and `recv(c)` between tasks.
+     */
+    void defineBuiltins();
+
+    /**
+     * Defines a native function on the interpreter and remembers it for the interpreters replacing it.
      *
-     * @param token Token where the error occurred.
-     * @param msg Error message.
+     * @param function The binding.
      */
-    static void error(const Token& token, std::string_view msg);
+    void defineNative(NativeFunction function);
 
     /**
-     * Reports a runtime error.
+     * Replaces the interpreter, applying the settings of this instance to the new one.
      *
-     * @param error The runtime error to report.
+     * @param interpreter The new interpreter.
      */
-    static void runtimeError(const RuntimeError& error);
+    void replaceInterpreter(std::unique_ptr<Interpreter> interpreter);
 
     /**
-     * Reports an error at a specific line and location.
+     * Applies the natives and settings of this instance to an interpreter: that of the scripts, or that of a task.
+     * Tasks do not record type feedback, which only the interpreter of the scripts does.
      *
-     * @param line Line number where the error occurred.
-     * @param where Location within the line.
-     * @param msg Error message.
+     * @param interpreter The interpreter.
      */
-    static void report(std::size_t line, std::string_view where, std::string_view msg);
+    void configure(Interpreter& interpreter) const;
 };
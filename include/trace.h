@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Collector of timed events, written in the Chrome trace-event format read by chrome://tracing and Perfetto.
+ * Each thread records into its own buffer, so concurrent runs only synchronize when a thread records its first event.
+ */
+class TraceRecorder {
+public:
+    /**
+     * Clock timing every event.
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * A numeric argument of an event.
+     */
+    struct Arg {
+        /**
+         * Name of the argument, a string literal.
+         */
+        std::string_view name;
+
+        /**
+         * Value of the argument.
+         */
+        std::uint64_t value;
+    };
+
+    /**
+     * A completed span of time on one thread.
+     */
+    struct Event {
+        /**
+         * Name of the event, a string literal.
+         */
+        std::string_view name;
+
+        /**
+         * Script the event belongs to, may be empty.
+         */
+        std::string file;
+
+        /**
+         * Start time.
+         */
+        Clock::time_point start;
+
+        /**
+         * Duration.
+         */
+        Clock::duration duration;
+
+        /**
+         * Numeric arguments.
+         */
+        std::vector<Arg> args;
+    };
+
+    /**
+     * Records an event spanning its own lifetime, if a recorder is given.
+     */
+    class Span {
+    private:
+        /**
+         * Recorder receiving the event, may be null.
+         */
+        TraceRecorder* m_recorder;
+
+        /**
+         * The event being timed.
+         */
+        Event m_event;
+
+    public:
+        /**
+         * Starts a span.
+         *
+         * @param recorder Recorder receiving the event, or nullptr to record nothing.
+         * @param name Name of the event, a string literal.
+         * @param file Script the event belongs to, may be empty.
+         */
+        Span(TraceRecorder* recorder, std::string_view name, std::string_view file);
+
+        /**
+         * Ends the span and records its event.
+         */
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        /**
+         * Add a numeric argument to the event.
+         *
+         * @param name Name of the argument, a string literal.
+         * @param value Value of the argument.
+         */
+        void arg(std::string_view name, std::uint64_t value) {
+            if (m_recorder != nullptr) {
+                m_event.args.push_back({.name = name, .value = value});
+            }
+        }
+    };
+
+private:
+    /**
+     * Events recorded by one thread.
+     */
+    struct Buffer {
+        /**
+         * Trace thread id, in order of the first event of each thread.
+         */
+        std::uint32_t thread;
+
+        /**
+         * The events.
+         */
+        std::vector<Event> events;
+    };
+
+    /**
+     * Identity of this recorder, never reused, so that a thread never writes to the buffer of a previous recorder.
+     */
+    std::uint64_t m_id;
+
+    /**
+     * Time the recorder was created, the origin of event timestamps.
+     */
+    Clock::time_point m_origin = Clock::now();
+
+    /**
+     * Guards the list of buffers.
+     */
+    mutable std::mutex m_mutex;
+
+    /**
+     * One buffer per recording thread.
+     */
+    std::vector<std::unique_ptr<Buffer>> m_buffers;
+
+public:
+    /**
+     * Constructs an empty recorder.
+     */
+    TraceRecorder();
+
+    /**
+     * Record an event on the calling thread.
+     *
+     * @param event The event.
+     */
+    void record(Event event);
+
+    /**
+     * Get the number of recorded events.
+     * Must not be called while other threads are recording.
+     *
+     * @return The number of events.
+     */
+    [[nodiscard]] std::size_t size() const;
+
+    /**
+     * Write the events as a JSON trace.
+     * Must not be called while other threads are recording.
+     *
+     * @param stream The stream to write to.
+     */
+    void write(std::ostream& stream) const;
+
+    /**
+     * Write the events as a JSON trace to a file.
+     * Must not be called while other threads are recording.
+     *
+     * @param path Path to the output file.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+private:
+    /**
+     * Get the buffer of the calling thread, registering it on first use.
+     *
+     * @return The buffer.
+     */
+    [[nodiscard]] Buffer& buffer();
+};
@@ -0,0 +1,146 @@
+#include "allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+/**
+ * Bookkeeping stored in front of every block.
+ */
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header {
+    /**
+     * Resource the block came from, nullptr for malloc.
+     */
+    std::pmr::memory_resource* resource;
+
+    /**
+     * Size requested by the caller.
+     */
+    std::size_t size;
+};
+
+/**
+ * The innermost scope of the calling thread.
+ */
+thread_local MemoryScope* t_scope = nullptr;
+
+/**
+ * Leaves every scope of the calling thread while a resource runs, so that its own allocations,
+ * which may go through the global operator new, are neither counted nor routed back to it.
+ */
+class Suspend {
+private:
+    /**
+     * The suspended scope.
+     */
+    MemoryScope* m_scope;
+
+public:
+    /**
+     * Suspends the innermost scope.
+     */
+    Suspend() noexcept : m_scope(std::exchange(t_scope, nullptr)) {}
+
+    /**
+     * Restores the innermost scope.
+     */
+    ~Suspend() {
+        t_scope = m_scope;
+    }
+
+    Suspend(const Suspend&) = delete;
+    Suspend& operator=(const Suspend&) = delete;
+};
+
+/**
+ * Write the counters of one phase as a table row.
+ *
+ * @param stream The stream to write to.
+ * @param phase Name of the phase.
+ * @param counters The counters.
+ */
+void printRow(std::ostream& stream, std::string_view phase, const MemoryCounters& counters) {
+    stream << std::format("{:<8} {:>12} {:>14} {:>12} {:>14} {:>14}\n", phase, counters.allocations, counters.bytes,
+                          counters.deallocations, counters.freed, counters.peak);
+}
+
+} // namespace
+
+void MemoryStats::print(std::ostream& stream) const {
+    stream << std::format("{:<8} {:>12} {:>14} {:>12} {:>14} {:>14}\n", "phase", "allocations", "bytes", "frees",
+                          "freed bytes", "peak bytes");
+    printRow(stream, "scan", scan);
+    printRow(stream, "parse", parse);
+    printRow(stream, "eval", eval);
+}
+
+MemoryScope::MemoryScope(std::pmr::memory_resource* resource, MemoryCounters* counters) noexcept
+    : m_resource(resource), m_counters(counters), m_previous(t_scope) {
+    if (m_resource == nullptr && m_previous != nullptr) {
+        m_resource = m_previous->m_resource;
+    }
+
+    t_scope = this;
+}
+
+MemoryScope::~MemoryScope() {
+    t_scope = m_previous;
+}
+
+[[nodiscard]] void* MemoryScope::allocate(std::size_t size) {
+    auto* scope = t_scope;
+    auto* resource = scope != nullptr ? scope->m_resource : nullptr;
+
+    void* block = nullptr;
+    if (resource == nullptr) {
+        block = std::malloc(sizeof(Header) + size);
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+    } else {
+        Suspend suspend;
+        block = resource->allocate(sizeof(Header) + size, alignof(Header));
+    }
+
+    auto* header = ::new (block) Header{.resource = resource, .size = size};
+
+    if (scope != nullptr && scope->m_counters != nullptr) {
+        auto& counters = *scope->m_counters;
+        counters.allocations++;
+        counters.bytes += size;
+
+        scope->m_live += static_cast<std::int64_t>(size);
+        counters.peak = std::max(counters.peak, static_cast<std::uint64_t>(std::max<std::int64_t>(scope->m_live, 0)));
+    }
+
+    return header + 1;
+}
+
+void MemoryScope::deallocate(void* block) noexcept {
+    if (block == nullptr) {
+        return;
+    }
+
+    auto* header = static_cast<Header*>(block) - 1;
+    auto* resource = header->resource;
+    auto size = header->size;
+
+    auto* scope = t_scope;
+    if (scope != nullptr && scope->m_counters != nullptr) {
+        scope->m_counters->deallocations++;
+        scope->m_counters->freed += size;
+        scope->m_live -= static_cast<std::int64_t>(size);
+    }
+
+    if (resource == nullptr) {
+        std::free(header);
+    } else {
+        Suspend suspend;
+        resource->deallocate(header, sizeof(Header) + size, alignof(Header));
+    }
+}
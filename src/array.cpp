@@ -0,0 +1,266 @@
+#include "array.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TOX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/**
+ * Number of doubles in an SSE2 register.
+ */
+constexpr std::size_t LANES = 2;
+
+/**
+ * Number of partial results a reduction keeps, each in its own register.
+ */
+constexpr std::size_t PARTIALS = 4;
+
+/**
+ * Addition, for sums and elementwise +.
+ */
+struct Add {
+    /**
+     * Result of a reduction over no element.
+     */
+    static constexpr double IDENTITY = 0.0;
+
+#ifdef TOX_SSE2
+    static __m128d vector(__m128d a, __m128d b) noexcept {
+        return _mm_add_pd(a, b);
+    }
+#endif
+
+    static double scalar(double a, double b) noexcept {
+        return a + b;
+    }
+};
+
+/**
+ * Subtraction, for elementwise -.
+ */
+struct Subtract {
+#ifdef TOX_SSE2
+    static __m128d vector(__m128d a, __m128d b) noexcept {
+        return _mm_sub_pd(a, b);
+    }
+#endif
+
+    static double scalar(double a, double b) noexcept {
+        return a - b;
+    }
+};
+
+/**
+ * Multiplication, for elementwise *.
+ */
+struct Multiply {
+#ifdef TOX_SSE2
+    static __m128d vector(__m128d a, __m128d b) noexcept {
+        return _mm_mul_pd(a, b);
+    }
+#endif
+
+    static double scalar(double a, double b) noexcept {
+        return a * b;
+    }
+};
+
+/**
+ * Division, for elementwise /.
+ */
+struct Divide {
+#ifdef TOX_SSE2
+    static __m128d vector(__m128d a, __m128d b) noexcept {
+        return _mm_div_pd(a, b);
+    }
+#endif
+
+    static double scalar(double a, double b) noexcept {
+        return a / b;
+    }
+};
+
+/**
+ * Minimum, for min. A NaN operand makes the result NaN, in the vector and the scalar form alike, so the result
+ * does not depend on where the NaN sits.
+ */
+struct Min {
+    /**
+     * Result of a reduction over no element.
+     */
+    static constexpr double IDENTITY = std::numeric_limits<double>::infinity();
+
+#ifdef TOX_SSE2
+    static __m128d vector(__m128d a, __m128d b) noexcept {
+        // minpd returns its second operand when either is NaN: replace such lanes with a NaN.
+        auto unordered = _mm_cmpunord_pd(a, b);
+        return _mm_or_pd(_mm_andnot_pd(unordered, _mm_min_pd(a, b)),
+                         _mm_and_pd(unordered, _mm_set1_pd(std::numeric_limits<double>::quiet_NaN())));
+    }
+#endif
+
+    static double scalar(double a, double b) noexcept {
+        if (std::isnan(a) || std::isnan(b)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return a < b ? a : b;
+    }
+};
+
+/**
+ * Maximum, for max. A NaN operand makes the result NaN, as for Min.
+ */
+struct Max {
+    /**
+     * Result of a reduction over no element.
+     */
+    static constexpr double IDENTITY = -std::numeric_limits<double>::infinity();
+
+#ifdef TOX_SSE2
+    static __m128d vector(__m128d a, __m128d b) noexcept {
+        auto unordered = _mm_cmpunord_pd(a, b);
+        return _mm_or_pd(_mm_andnot_pd(unordered, _mm_max_pd(a, b)),
+                         _mm_and_pd(unordered, _mm_set1_pd(std::numeric_limits<double>::quiet_NaN())));
+    }
+#endif
+
+    static double scalar(double a, double b) noexcept {
+        if (std::isnan(a) || std::isnan(b)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return a > b ? a : b;
+    }
+};
+
+/**
+ * Reduce elements with an associative operation.
+ *
+ * @tparam Op The operation.
+ * @param values The elements.
+ * @return The reduction, Op::IDENTITY for no element.
+ */
+template <typename Op> double reduce(std::span<const double> values) noexcept {
+    const auto* data = values.data();
+    std::size_t i = 0;
+    double result = Op::IDENTITY;
+
+#ifdef TOX_SSE2
+    __m128d partials[PARTIALS];
+    std::fill(std::begin(partials), std::end(partials), _mm_set1_pd(Op::IDENTITY));
+    for (; i + PARTIALS * LANES <= values.size(); i += PARTIALS * LANES) {
+        for (std::size_t p = 0; p < PARTIALS; p++) {
+            partials[p] = Op::vector(partials[p], _mm_loadu_pd(data + i + p * LANES));
+        }
+    }
+
+    auto folded = Op::vector(Op::vector(partials[0], partials[1]), Op::vector(partials[2], partials[3]));
+    result = Op::scalar(_mm_cvtsd_f64(folded), _mm_cvtsd_f64(_mm_unpackhi_pd(folded, folded)));
+#endif
+
+    for (; i < values.size(); i++) {
+        result = Op::scalar(result, data[i]);
+    }
+
+    return result;
+}
+
+/**
+ * Apply an operation to the elements of two vectors of the same length.
+ *
+ * @tparam Op The operation.
+ * @param left The first vector.
+ * @param right The second vector.
+ * @param result The results.
+ */
+template <typename Op>
+void elementwise(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept {
+    const auto* a = left.data();
+    const auto* b = right.data();
+    auto* out = result.data();
+    std::size_t i = 0;
+
+#ifdef TOX_SSE2
+    for (; i + LANES <= result.size(); i += LANES) {
+        _mm_storeu_pd(out + i, Op::vector(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+#endif
+
+    for (; i < result.size(); i++) {
+        out[i] = Op::scalar(a[i], b[i]);
+    }
+}
+
+} // namespace
+
+Array::Array(std::size_t length) : m_data(allocate(length)), m_length(length) {
+    std::fill_n(m_data.get(), m_length, 0.0);
+}
+
+Array::Array(std::span<const double> values) : m_data(allocate(values.size())), m_length(values.size()) {
+    std::ranges::copy(values, m_data.get());
+}
+
+[[nodiscard]] double* Array::allocate(std::size_t length) {
+    return static_cast<double*>(::operator new[](length * sizeof(double), std::align_val_t{ALIGNMENT}));
+}
+
+[[nodiscard]] double Array::sum(std::span<const double> values) noexcept {
+    return reduce<Add>(values);
+}
+
+[[nodiscard]] double Array::dot(std::span<const double> left, std::span<const double> right) noexcept {
+    const auto* a = left.data();
+    const auto* b = right.data();
+    std::size_t i = 0;
+    double result = 0.0;
+
+#ifdef TOX_SSE2
+    __m128d partials[PARTIALS];
+    std::fill(std::begin(partials), std::end(partials), _mm_setzero_pd());
+    for (; i + PARTIALS * LANES <= left.size(); i += PARTIALS * LANES) {
+        for (std::size_t p = 0; p < PARTIALS; p++) {
+            auto product = _mm_mul_pd(_mm_loadu_pd(a + i + p * LANES), _mm_loadu_pd(b + i + p * LANES));
+            partials[p] = _mm_add_pd(partials[p], product);
+        }
+    }
+
+    auto folded = _mm_add_pd(_mm_add_pd(partials[0], partials[1]), _mm_add_pd(partials[2], partials[3]));
+    result = _mm_cvtsd_f64(folded) + _mm_cvtsd_f64(_mm_unpackhi_pd(folded, folded));
+#endif
+
+    for (; i < left.size(); i++) {
+        result += a[i] * b[i];
+    }
+
+    return result;
+}
+
+[[nodiscard]] double Array::min(std::span<const double> values) noexcept {
+    return reduce<Min>(values);
+}
+
+[[nodiscard]] double Array::max(std::span<const double> values) noexcept {
+    return reduce<Max>(values);
+}
+
+void Array::add(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept {
+    elementwise<Add>(left, right, result);
+}
+
+void Array::subtract(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept {
+    elementwise<Subtract>(left, right, result);
+}
+
+void Array::multiply(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept {
+    elementwise<Multiply>(left, right, result);
+}
+
+void Array::divide(std::span<const double> left, std::span<const double> right, std::span<double> result) noexcept {
+    elementwise<Divide>(left, right, result);
+}
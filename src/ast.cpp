@@ -1,7 +1,50 @@
 #include "ast.h"
 
+#include "tier.h"
+
 #include <sstream>
 #include <string>
+#include <vector>
+
+TierState::TierState() = default;
+
+TierState::~TierState() = default;
+
+void TierState::publish(std::unique_ptr<const CompiledExpr> compiled) noexcept {
+    m_owned = std::move(compiled);
+    m_compiled.store(m_owned.get(), std::memory_order_release);
+}
+
+Call::Call(ExprPtr callee, Token paren, std::vector<ExprPtr> arguments)
+    : Expr(1 + tallest(*callee, arguments)), m_callee(std::move(callee)), m_paren(std::move(paren)),
+      m_arguments(std::move(arguments)), m_method(dynamic_cast<const Get*>(m_callee.get())),
+      m_superMethod(dynamic_cast<const Super*>(m_callee.get())) {}
+
+void Expr::dispose(std::unique_ptr<Expr> child) noexcept {
+    // Work list of the destruction in progress on this thread, if any.
+    thread_local std::vector<std::unique_ptr<Expr>>* pending = nullptr;
+
+    if (!child) {
+        return;
+    }
+    if (pending != nullptr) {
+        pending->push_back(std::move(child));
+
+        return;
+    }
+
+    std::vector<std::unique_ptr<Expr>> work;
+    work.push_back(std::move(child));
+
+    pending = &work;
+    while (!work.empty()) {
+        // Destroying the node defers its own children onto the work list.
+        auto next = std::move(work.back());
+        work.pop_back();
+        next.reset();
+    }
+    pending = nullptr;
+}
 
 [[nodiscard]] std::string ExprPrinter::print(const Expr& expr) {
     m_output.str("");
@@ -10,6 +53,23 @@
     return m_output.str();
 }
 
+void ExprPrinter::visitArrayLiteralExpr(const ArrayLit& expr) {
+    m_output << "(array";
+    for (const auto& element : expr.elements()) {
+        m_output << " ";
+        element->accept(*this);
+    }
+    m_output << ")";
+}
+
+void ExprPrinter::visitAssignExpr(const Assign& expr) {
+    m_output << "(= ";
+    m_output << expr.name().lexeme;
+    m_output << " ";
+    expr.value().accept(*this);
+    m_output << ")";
+}
+
 void ExprPrinter::visitBinaryExpr(const Binary& expr) {
     m_output << "(";
     m_output << expr.op().lexeme;
@@ -20,12 +80,36 @@ void ExprPrinter::visitBinaryExpr(const Binary& expr) {
     m_output << ")";
 }
 
+void ExprPrinter::visitCallExpr(const Call& expr) {
+    m_output << "(call ";
+    expr.callee().accept(*this);
+    for (const auto& argument : expr.arguments()) {
+        m_output << " ";
+        argument->accept(*this);
+    }
+    m_output << ")";
+}
+
+void ExprPrinter::visitGetExpr(const Get& expr) {
+    m_output << "(. ";
+    expr.object().accept(*this);
+    m_output << " " << expr.name().lexeme << ")";
+}
+
 void ExprPrinter::visitGroupingExpr(const Grouping& expr) {
     m_output << "(group ";
     expr.expression().accept(*this);
     m_output << ")";
 }
 
+void ExprPrinter::visitIndexExpr(const Index& expr) {
+    m_output << "(index ";
+    expr.object().accept(*this);
+    m_output << " ";
+    expr.index().accept(*this);
+    m_output << ")";
+}
+
 void ExprPrinter::visitLiteralExpr(const Lit& expr) {
     std::visit(
         [this](auto&& arg) {
@@ -43,6 +127,42 @@ void ExprPrinter::visitLiteralExpr(const Lit& expr) {
         expr.value());
 }
 
+void ExprPrinter::visitLogicalExpr(const Logical& expr) {
+    m_output << "(";
+    m_output << expr.op().lexeme;
+    m_output << " ";
+    expr.left().accept(*this);
+    m_output << " ";
+    expr.right().accept(*this);
+    m_output << ")";
+}
+
+void ExprPrinter::visitSetExpr(const Set& expr) {
+    m_output << "(= (. ";
+    expr.object().accept(*this);
+    m_output << " " << expr.name().lexeme << ") ";
+    expr.value().accept(*this);
+    m_output << ")";
+}
+
+void ExprPrinter::visitSetIndexExpr(const SetIndex& expr) {
+    m_output << "(= (index ";
+    expr.object().accept(*this);
+    m_output << " ";
+    expr.index().accept(*this);
+    m_output << ") ";
+    expr.value().accept(*this);
+    m_output << ")";
+}
+
+void ExprPrinter::visitSuperExpr(const Super& expr) {
+    m_output << "(super " << expr.method().lexeme << ")";
+}
+
+void ExprPrinter::visitThisExpr(const This& /*expr*/) {
+    m_output << "this";
+}
+
 void ExprPrinter::visitUnaryExpr(const Unary& expr) {
     m_output << "(";
     m_output << expr.op().lexeme;
@@ -50,3 +170,7 @@ void ExprPrinter::visitUnaryExpr(const Unary& expr) {
     expr.right().accept(*this);
     m_output << ")";
 }
+
+void ExprPrinter::visitVariableExpr(const Variable& expr) {
+    m_output << expr.name().lexeme;
+}
@@ -0,0 +1,457 @@
+#include "batch.h"
+
+#include "feedback.h"
+
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <variant>
+
+namespace {
+
+/**
+ * Apply a binary operator elementwise. At most one operand is a scalar, its pointer being null.
+ * Each case is a plain counted loop over contiguous arrays, which the compiler vectorizes.
+ *
+ * @param a The left operand values, or nullptr if it is the scalar sa.
+ * @param sa The left scalar operand.
+ * @param b The right operand values, or nullptr if it is the scalar sb.
+ * @param sb The right scalar operand.
+ * @param out The output values.
+ * @param n The number of values.
+ * @param op The operator function.
+ */
+template <typename T, typename R, typename Op>
+void apply(const T* a, T sa, const T* b, T sb, R* out, std::size_t n, Op op) {
+    if (a != nullptr && b != nullptr) {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = static_cast<R>(op(a[i], b[i]));
+        }
+    } else if (a != nullptr) {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = static_cast<R>(op(a[i], sb));
+        }
+    } else {
+        for (std::size_t i = 0; i < n; i++) {
+            out[i] = static_cast<R>(op(sa, b[i]));
+        }
+    }
+}
+
+} // namespace
+
+[[nodiscard]] std::any BatchResult::at(std::size_t row) const {
+    switch (m_kind) {
+    case Kind::NUMBER:
+        return m_numbers[row];
+    case Kind::BOOL:
+        return m_booleans[row] != 0;
+    default:
+        return m_constant;
+    }
+}
+
+[[nodiscard]] std::vector<std::uint32_t> BatchResult::selection() const {
+    std::vector<std::uint32_t> selection;
+
+    switch (m_kind) {
+    case Kind::BOOL: {
+        // Branch-free: always write the index, only advance past the selected ones.
+        selection.resize(m_rows);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < m_rows; i++) {
+            selection[count] = static_cast<std::uint32_t>(i);
+            count += m_booleans[i];
+        }
+        selection.resize(count);
+
+        break;
+    }
+    case Kind::NUMBER:
+        // Numbers are always truthy.
+        selection.resize(m_rows);
+        std::iota(selection.begin(), selection.end(), 0U);
+
+        break;
+    default:
+        if (Interpreter::isTruthy(m_constant)) {
+            selection.resize(m_rows);
+            std::iota(selection.begin(), selection.end(), 0U);
+        }
+
+        break;
+    }
+
+    return selection;
+}
+
+BatchProgram::BatchProgram(const Expr& expr, std::vector<std::string> columns) : m_columns(std::move(columns)) {
+    expr.accept(*this);
+}
+
+[[nodiscard]] BatchResult BatchProgram::run(std::span<const std::span<const double>> columns,
+                                            std::size_t rows) const {
+    if (columns.size() != m_columns.size()) {
+        throw std::invalid_argument(std::format("Expected {} columns, got {}.", m_columns.size(), columns.size()));
+    }
+    for (std::size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].size() < rows) {
+            throw std::invalid_argument(std::format("Column '{}' holds fewer than {} rows.", m_columns[i], rows));
+        }
+    }
+
+    if (rows > 0 && m_error) {
+        throw *m_error;
+    }
+
+    switch (m_result.shape) {
+    case Slot::Shape::SCALAR: {
+        BatchResult result(BatchResult::Kind::CONSTANT, rows);
+        result.m_constant = m_constants[m_result.index];
+
+        return result;
+    }
+    case Slot::Shape::COLUMN: {
+        BatchResult result(BatchResult::Kind::NUMBER, rows);
+        const auto& column = columns[m_result.index];
+        result.m_numbers.assign(column.begin(), column.begin() + static_cast<std::ptrdiff_t>(rows));
+
+        return result;
+    }
+    default:
+        break;
+    }
+
+    bool boolean = m_result.shape == Slot::Shape::BOOLEANS;
+    BatchResult result(boolean ? BatchResult::Kind::BOOL : BatchResult::Kind::NUMBER, rows);
+    if (boolean) {
+        result.m_booleans.resize(rows);
+    } else {
+        result.m_numbers.resize(rows);
+    }
+
+    // Registers are local, so one program can run on several threads at once.
+    std::vector<std::vector<double>> numbers(m_numberRegisters, std::vector<double>(BLOCK_SIZE));
+    std::vector<std::vector<std::uint8_t>> booleans(m_booleanRegisters, std::vector<std::uint8_t>(BLOCK_SIZE));
+
+    for (std::size_t offset = 0; offset < rows; offset += BLOCK_SIZE) {
+        auto n = std::min(BLOCK_SIZE, rows - offset);
+
+        auto numbersOf = [&](const Slot& slot) -> const double* {
+            switch (slot.shape) {
+            case Slot::Shape::COLUMN:
+                return columns[slot.index].data() + offset;
+            case Slot::Shape::NUMBERS:
+                return numbers[slot.index].data();
+            default:
+                return nullptr;
+            }
+        };
+        auto numberOf = [&](const Slot& slot) {
+            return slot.shape == Slot::Shape::SCALAR ? std::any_cast<double>(m_constants[slot.index]) : 0.0;
+        };
+        auto booleansOf = [&](const Slot& slot) -> const std::uint8_t* {
+            return slot.shape == Slot::Shape::BOOLEANS ? booleans[slot.index].data() : nullptr;
+        };
+        auto booleanOf = [&](const Slot& slot) -> std::uint8_t {
+            return slot.shape == Slot::Shape::SCALAR && std::any_cast<bool>(m_constants[slot.index]) ? 1 : 0;
+        };
+
+        for (const auto& instruction : m_code) {
+            const auto& left = instruction.left;
+            const auto& right = instruction.right;
+            const auto& target = instruction.target;
+            auto* out = target.shape == Slot::Shape::NUMBERS ? numbers[target.index].data() : nullptr;
+            auto* mask = target.shape == Slot::Shape::BOOLEANS ? booleans[target.index].data() : nullptr;
+
+            auto arithmetic = [&](auto op) {
+                apply(numbersOf(left), numberOf(left), numbersOf(right), numberOf(right), out, n, op);
+            };
+            auto compare = [&](auto op) {
+                apply(numbersOf(left), numberOf(left), numbersOf(right), numberOf(right), mask, n, op);
+            };
+
+            switch (instruction.op) {
+            case TokenType::PLUS:
+                arithmetic(std::plus<>{});
+                break;
+            case TokenType::MINUS:
+                if (instruction.unary) {
+                    const auto* values = numbersOf(right);
+                    for (std::size_t i = 0; i < n; i++) {
+                        out[i] = -values[i];
+                    }
+                } else {
+                    arithmetic(std::minus<>{});
+                }
+                break;
+            case TokenType::STAR:
+                arithmetic(std::multiplies<>{});
+                break;
+            case TokenType::SLASH:
+                arithmetic(std::divides<>{});
+                break;
+            case TokenType::GREATER:
+                compare(std::greater<>{});
+                break;
+            case TokenType::GREATER_EQUAL:
+                compare(std::greater_equal<>{});
+                break;
+            case TokenType::LESS:
+                compare(std::less<>{});
+                break;
+            case TokenType::LESS_EQUAL:
+                compare(std::less_equal<>{});
+                break;
+            case TokenType::BANG: {
+                const auto* values = booleansOf(right);
+                for (std::size_t i = 0; i < n; i++) {
+                    mask[i] = values[i] ^ 1U;
+                }
+                break;
+            }
+            case TokenType::AND:
+            case TokenType::OR: {
+                bool any = instruction.op == TokenType::OR;
+                apply(booleansOf(left), booleanOf(left), booleansOf(right), booleanOf(right), mask, n,
+                      [any](std::uint8_t a, std::uint8_t b) { return any ? a | b : a & b; });
+                break;
+            }
+            case TokenType::EQUAL_EQUAL:
+            case TokenType::BANG_EQUAL: {
+                bool negate = instruction.op == TokenType::BANG_EQUAL;
+                if (instruction.booleans) {
+                    apply(booleansOf(left), booleanOf(left), booleansOf(right), booleanOf(right), mask, n,
+                          [negate](std::uint8_t a, std::uint8_t b) { return (a == b) != negate; });
+                } else {
+                    compare([negate](double a, double b) { return (a == b) != negate; });
+                }
+                break;
+            }
+            default: // Unreachable.
+                break;
+            }
+        }
+
+        if (boolean) {
+            const auto& values = booleans[m_result.index];
+            std::copy_n(values.begin(), n, result.m_booleans.begin() + static_cast<std::ptrdiff_t>(offset));
+        } else {
+            const auto& values = numbers[m_result.index];
+            std::copy_n(values.begin(), n, result.m_numbers.begin() + static_cast<std::ptrdiff_t>(offset));
+        }
+    }
+
+    return result;
+}
+
+void BatchProgram::visitLiteralExpr(const Lit& expr) {
+    if (const auto* string = std::get_if<std::string>(&expr.value())) {
+        m_result = constant(m_heap.make<String>(*string));
+        return;
+    }
+
+    m_result = constant(std::visit([](auto&& v) -> std::any { return v; }, expr.value()));
+}
+
+void BatchProgram::visitVariableExpr(const Variable& expr) {
+    const auto& name = expr.name();
+    auto it = std::find(m_columns.begin(), m_columns.end(), name.lexeme);
+    if (it == m_columns.end()) {
+        m_result = fail(RuntimeError(name, std::format("Undefined variable '{}'.", name.lexeme)));
+
+        return;
+    }
+
+    m_result = {.shape = Slot::Shape::COLUMN, .index = static_cast<std::size_t>(it - m_columns.begin())};
+}
+
+void BatchProgram::visitLogicalExpr(const Logical& expr) {
+    expr.left().accept(*this);
+    auto left = m_result;
+
+    // The truthiness of constants and numbers is known, so only booleans are decided row by row.
+    if (left.shape != Slot::Shape::BOOLEANS) {
+        bool truthy = left.shape != Slot::Shape::SCALAR || Interpreter::isTruthy(m_constants[left.index]);
+        if (!expr.shortCircuits(truthy)) {
+            expr.right().accept(*this);
+        }
+
+        return;
+    }
+
+    expr.right().accept(*this);
+    auto right = m_result;
+
+    if (kindOf(right) != OperandTypes::BOOL) {
+        m_result = fail(RuntimeError(expr.op(), "Operands must both be booleans in batch evaluation."));
+
+        return;
+    }
+
+    m_result = emit(expr.op().type, left, right, Slot::Shape::BOOLEANS);
+}
+
+void BatchProgram::visitArrayLiteralExpr(const ArrayLit& expr) {
+    m_result = fail(RuntimeError(expr.bracket(), "Arrays are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitAssignExpr(const Assign& expr) {
+    m_result = fail(RuntimeError(expr.name(), "Assignment is not supported in batch evaluation."));
+}
+
+void BatchProgram::visitCallExpr(const Call& expr) {
+    m_result = fail(RuntimeError(expr.paren(), "Calls are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitGetExpr(const Get& expr) {
+    m_result = fail(RuntimeError(expr.name(), "Properties are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitIndexExpr(const Index& expr) {
+    m_result = fail(RuntimeError(expr.bracket(), "Arrays are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitSetExpr(const Set& expr) {
+    m_result = fail(RuntimeError(expr.name(), "Properties are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitSetIndexExpr(const SetIndex& expr) {
+    m_result = fail(RuntimeError(expr.bracket(), "Arrays are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitSuperExpr(const Super& expr) {
+    m_result = fail(RuntimeError(expr.keyword(), "Classes are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitThisExpr(const This& expr) {
+    m_result = fail(RuntimeError(expr.keyword(), "Classes are not supported in batch evaluation."));
+}
+
+void BatchProgram::visitUnaryExpr(const Unary& expr) {
+    expr.right().accept(*this);
+    auto right = m_result;
+    const auto& op = expr.op();
+
+    try {
+        if (right.shape == Slot::Shape::SCALAR) {
+            m_result = constant(Interpreter::unary(op, m_constants[right.index]));
+
+            return;
+        }
+
+        // Operand types are fixed per node, so one check stands in for every row.
+        auto kind = kindOf(right);
+        auto value = Interpreter::unary(op, sample(right));
+
+        if (op.type == TokenType::MINUS) {
+            m_result = emit(op.type, {}, right, Slot::Shape::NUMBERS);
+            m_code.back().unary = true;
+        } else if (op.type == TokenType::BANG && kind == OperandTypes::BOOL) {
+            m_result = emit(op.type, {}, right, Slot::Shape::BOOLEANS);
+            m_code.back().unary = true;
+        } else {
+            // Negated numbers: every number is truthy, so the value is the same for every row.
+            m_result = constant(std::move(value));
+        }
+    } catch (const RuntimeError& error) {
+        m_result = fail(error);
+    }
+}
+
+void BatchProgram::visitBinaryExpr(const Binary& expr) {
+    expr.left().accept(*this);
+    auto left = m_result;
+    expr.right().accept(*this);
+    auto right = m_result;
+    const auto& op = expr.op();
+
+    try {
+        if (left.shape == Slot::Shape::SCALAR && right.shape == Slot::Shape::SCALAR) {
+            m_result = constant(Interpreter::binary(m_heap, op, m_constants[left.index], m_constants[right.index]));
+
+            return;
+        }
+
+        // Operand types are fixed per node, so one check stands in for every row.
+        auto leftKind = kindOf(left);
+        auto rightKind = kindOf(right);
+        auto value = Interpreter::binary(m_heap, op, sample(left), sample(right));
+
+        switch (op.type) {
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::STAR:
+        case TokenType::SLASH:
+            m_result = emit(op.type, left, right, Slot::Shape::NUMBERS);
+            break;
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL:
+            m_result = emit(op.type, left, right, Slot::Shape::BOOLEANS);
+            break;
+        case TokenType::EQUAL_EQUAL:
+        case TokenType::BANG_EQUAL:
+            if (leftKind != rightKind) {
+                // Values of different types are never equal, whatever the row.
+                m_result = constant(std::move(value));
+            } else {
+                m_result = emit(op.type, left, right, Slot::Shape::BOOLEANS);
+                m_code.back().booleans = leftKind == OperandTypes::BOOL;
+            }
+            break;
+        default: // Unreachable.
+            m_result = constant(std::move(value));
+            break;
+        }
+    } catch (const RuntimeError& error) {
+        m_result = fail(error);
+    }
+}
+
+[[nodiscard]] BatchProgram::Slot BatchProgram::constant(std::any value) {
+    m_constants.push_back(std::move(value));
+
+    return {.shape = Slot::Shape::SCALAR, .index = m_constants.size() - 1};
+}
+
+[[nodiscard]] BatchProgram::Slot BatchProgram::emit(TokenType op, Slot left, Slot right, Slot::Shape shape) {
+    auto& count = shape == Slot::Shape::NUMBERS ? m_numberRegisters : m_booleanRegisters;
+    Slot target{.shape = shape, .index = count++};
+    m_code.push_back({.op = op, .left = left, .right = right, .target = target});
+
+    return target;
+}
+
+[[nodiscard]] BatchProgram::Slot BatchProgram::fail(const RuntimeError& error) {
+    if (!m_error) {
+        m_error = error;
+    }
+
+    return constant(std::monostate{});
+}
+
+[[nodiscard]] std::uint8_t BatchProgram::kindOf(const Slot& slot) const {
+    switch (slot.shape) {
+    case Slot::Shape::SCALAR:
+        return OperandTypes::kindOf(m_constants[slot.index]);
+    case Slot::Shape::BOOLEANS:
+        return OperandTypes::BOOL;
+    default:
+        return OperandTypes::NUMBER;
+    }
+}
+
+[[nodiscard]] std::any BatchProgram::sample(const Slot& slot) const {
+    switch (slot.shape) {
+    case Slot::Shape::SCALAR:
+        return m_constants[slot.index];
+    case Slot::Shape::BOOLEANS:
+        return false;
+    default:
+        return 0.0;
+    }
+}
@@ -0,0 +1,215 @@
+#include "channel.h"
+
+#include "array.h"
+#include "map.h"
+#include "native.h"
+#include "scheduler.h"
+#include "text.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+/**
+ * Error of a send or a receive that would block forever.
+ */
+constexpr const char* DEADLOCK = "Every task is blocked on a channel.";
+
+} // namespace
+
+[[nodiscard]] Message Message::pack(const std::any& value) {
+    std::vector<const Map*> open;
+    return pack(value, open);
+}
+
+[[nodiscard]] Message Message::pack(const std::any& value, std::vector<const Map*>& open) {
+    Message message;
+    if (const auto* number = std::any_cast<double>(&value)) {
+        message.m_value = *number;
+    } else if (const auto* boolean = std::any_cast<bool>(&value)) {
+        message.m_value = *boolean;
+    } else if (const auto* string = std::any_cast<String*>(&value)) {
+        message.m_value = (*string)->value();
+    } else if (const auto* array = std::any_cast<Array*>(&value)) {
+        auto values = std::as_const(**array).values();
+        message.m_value = std::vector<double>(values.begin(), values.end());
+    } else if (const auto* channel = std::any_cast<Channel*>(&value)) {
+        message.m_value = (*channel)->buffer();
+    } else if (const auto* map = std::any_cast<Map*>(&value)) {
+        if (std::ranges::find(open, *map) != open.end()) {
+            throw NativeError("Cannot send a map nested in itself.");
+        }
+
+        open.push_back(*map);
+        std::vector<Message> entries;
+        entries.reserve((*map)->length() * 2);
+        (*map)->forEach([&](const std::any& key, const std::any& item) {
+            entries.push_back(pack(key, open));
+            entries.push_back(pack(item, open));
+        });
+        open.pop_back();
+
+        message.m_value = std::move(entries);
+    } else if (value.type() != typeid(std::monostate)) {
+        throw NativeError("Only nil, booleans, numbers, strings, arrays, maps and channels can be sent to a task.");
+    }
+
+    return message;
+}
+
+[[nodiscard]] std::any Message::unpack(Heap& heap) const {
+    return std::visit(
+        [&](const auto& value) -> std::any {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::string>) {
+                return heap.make<String>(value);
+            } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+                return heap.make<Array>(std::span<const double>(value));
+            } else if constexpr (std::is_same_v<T, std::vector<Message>>) {
+                // Collection only runs between statements, so the new keys and values need no pinning.
+                auto* map = heap.make<Map>();
+                for (std::size_t i = 0; i < value.size(); i += 2) {
+                    map->set(heap, value[i].unpack(heap), value[i + 1].unpack(heap));
+                }
+                return map;
+            } else if constexpr (std::is_same_v<T, std::shared_ptr<ChannelBuffer>>) {
+                return heap.make<Channel>(value);
+            } else {
+                return value;
+            }
+        },
+        m_value);
+}
+
+ChannelBuffer::ChannelBuffer(std::size_t capacity)
+    : m_slots(std::make_unique<Slot[]>(capacity)), m_capacity(capacity) {
+    for (std::size_t i = 0; i < capacity; i++) {
+        m_slots[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+}
+
+void ChannelBuffer::send(Message message) {
+    while (!tryPush(message)) {
+        std::unique_lock lock(m_mutex);
+        Waiter waiter;
+        enlist(m_senders, m_sending, waiter);
+
+        // A receiver making room before we enlisted did not see us: retry before sleeping.
+        auto pushed = tryPush(message);
+        if (!pushed && !waiter.park(lock)) {
+            delist(m_senders, m_sending, waiter);
+            throw NativeError(DEADLOCK);
+        }
+
+        delist(m_senders, m_sending, waiter);
+        if (pushed) {
+            break;
+        }
+    }
+
+    wakeOne(m_receivers, m_receiving);
+}
+
+[[nodiscard]] Message ChannelBuffer::receive() {
+    Message message;
+    while (!tryPop(message)) {
+        std::unique_lock lock(m_mutex);
+        Waiter waiter;
+        enlist(m_receivers, m_receiving, waiter);
+
+        // A sender arriving before we enlisted did not see us: retry before sleeping.
+        auto popped = tryPop(message);
+        if (!popped && !waiter.park(lock)) {
+            delist(m_receivers, m_receiving, waiter);
+            throw NativeError(DEADLOCK);
+        }
+
+        delist(m_receivers, m_receiving, waiter);
+        if (popped) {
+            break;
+        }
+    }
+
+    wakeOne(m_senders, m_sending);
+    return message;
+}
+
+bool ChannelBuffer::tryPush(Message& message) noexcept {
+    auto position = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        auto& slot = m_slots[position % m_capacity];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        auto lag = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(2 * position);
+
+        if (lag == 0) {
+            if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.message = std::move(message);
+                slot.sequence.store(2 * position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (lag < 0) {
+            // The slot still holds the message of the previous lap: the ring is full.
+            return false;
+        } else {
+            position = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool ChannelBuffer::tryPop(Message& message) noexcept {
+    auto position = m_tail.load(std::memory_order_relaxed);
+    while (true) {
+        auto& slot = m_slots[position % m_capacity];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        auto lag = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(2 * position + 1);
+
+        if (lag == 0) {
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                message = std::exchange(slot.message, Message());
+                slot.sequence.store(2 * (position + m_capacity), std::memory_order_release);
+                return true;
+            }
+        } else if (lag < 0) {
+            // The slot is not written yet: the ring is empty.
+            return false;
+        } else {
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void ChannelBuffer::wakeOne(std::deque<Waiter*>& waiters, std::atomic<std::size_t>& count) {
+    // Pairs with the fence of enlist: either the waiter sees our progress when it retries, or we see it waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (count.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (waiters.empty()) {
+        return;
+    }
+
+    auto* waiter = waiters.front();
+    waiters.pop_front();
+    count.store(waiters.size(), std::memory_order_relaxed);
+    waiter->wake();
+}
+
+void ChannelBuffer::enlist(std::deque<Waiter*>& waiters, std::atomic<std::size_t>& count, Waiter& waiter) {
+    waiters.push_back(&waiter);
+    count.store(waiters.size(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ChannelBuffer::delist(std::deque<Waiter*>& waiters, std::atomic<std::size_t>& count, Waiter& waiter) {
+    // A waiter that was woken is no longer listed.
+    if (auto found = std::ranges::find(waiters, &waiter); found != waiters.end()) {
+        waiters.erase(found);
+        count.store(waiters.size(), std::memory_order_relaxed);
+    }
+}
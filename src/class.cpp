@@ -0,0 +1,40 @@
+#include "class.h"
+
+ClassObject::ClassObject(std::string name, ClassObject* superclass)
+    : m_id(Shape::nextId()), m_name(std::move(name)), m_superclass(superclass), m_shape(std::make_unique<Shape>()) {
+    if (m_superclass != nullptr) {
+        m_methods = m_superclass->m_methods;
+        m_index = m_superclass->m_index;
+        m_initializer = m_superclass->m_initializer;
+    }
+}
+
+void ClassObject::define(Closure* method) {
+    const auto& name = method->function().name().lexeme;
+    if (name == Function::INITIALIZER) {
+        m_initializer = method;
+    }
+
+    auto [it, inserted] = m_index.try_emplace(name, static_cast<std::uint32_t>(m_methods.size()));
+    if (inserted) {
+        m_methods.push_back(method);
+    } else {
+        m_methods[it->second] = method;
+    }
+}
+
+[[nodiscard]] std::optional<std::uint32_t> ClassObject::find(std::string_view name) const {
+    auto it = m_index.find(name);
+    if (it == m_index.end()) {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
+void ClassObject::trace(Heap& heap) const {
+    heap.mark(m_superclass);
+    for (const auto* method : m_methods) {
+        heap.mark(method);
+    }
+}
@@ -0,0 +1,11 @@
+#include "closure.h"
+
+#include "class.h"
+
+void Closure::trace(Heap& heap) const {
+    for (const auto* cell : m_upvalues) {
+        heap.mark(cell);
+    }
+
+    heap.mark(m_home);
+}
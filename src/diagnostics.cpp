@@ -0,0 +1,33 @@
+#include "diagnostics.h"
+
+#include "interpreter.h"
+
+#include <format>
+
+void Diagnostics::error(std::size_t line, std::string_view msg) {
+    report(line, "", msg);
+}
+
+void Diagnostics::error(const Token& token, std::string_view msg) {
+    if (token.type == TokenType::END_OF_FILE) {
+        report(token.line, " at end", msg);
+    } else {
+        report(token.line, std::format(" at '{}'", token.lexeme), msg);
+    }
+}
+
+void Diagnostics::runtimeError(const RuntimeError& error) {
+    // One insertion per message, to keep output from threads sharing the stream readable.
+    *m_stream << std::format("{}\n[line {}]\n", error.what(), error.token().line);
+
+    m_hadRuntimeError = true;
+    m_runtimeErrors++;
+}
+
+void Diagnostics::report(std::size_t line, std::string_view where, std::string_view msg) {
+    // One insertion per message, to keep output from threads sharing the stream readable.
+    *m_stream << std::format("[line {}] Error{}: {}\n", line, where, msg);
+
+    m_hadError = true;
+    m_errors++;
+}
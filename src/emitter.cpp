@@ -0,0 +1,265 @@
+#include "emitter.h"
+
+#include <algorithm>
+#include <format>
+#include <magic_enum.hpp>
+#include <string>
+#include <utility>
+#include <variant>
+
+[[nodiscard]] std::string CppEmitter::emit(const Expr& expr, std::string_view name) {
+    m_tokens.str("");
+    m_tokens.clear();
+    m_globals.str("");
+    m_globals.clear();
+    m_globalNames.clear();
+    m_body.str("");
+    m_body.clear();
+    m_tokenCount = 0;
+    m_valueCount = 0;
+
+    expr.accept(*this);
+
+    std::ostringstream output;
+    output << "// Generated by `tox --emit-cpp " << name << "`. Do not edit.\n";
+    output << "// Build: c++ -std=c++23 -I<tox>/include <this file> -L<tox>/lib -ltox_static\n\n";
+    output << "#include \"interpreter.h\"\n";
+    output << "#include \"tox.h\"\n\n";
+    output << "#include <any>\n";
+    output << "#include <array>\n";
+    output << "#include <string>\n";
+    output << "#include <variant>\n\n";
+    output << "namespace {\n\n";
+    output << m_tokens.str();
+    if (m_tokenCount > 0) {
+        output << "\n";
+    }
+    output << "std::any program(Heap& heap) {\n";
+    output << m_globals.str();
+    output << m_body.str();
+    output << "\n    return " << m_result << ";\n";
+    output << "}\n\n";
+    output << "} // namespace\n\n";
+    output << "int main() {\n";
+    output << "    return Tox::runCompiled(program);\n";
+    output << "}\n";
+
+    return output.str();
+}
+
+void CppEmitter::visitArrayLiteralExpr(const ArrayLit& expr) {
+    auto bracket = declareToken(expr.bracket());
+    auto array = std::format("v{}", m_valueCount++);
+    m_body << std::format("    Array& {} = *heap.make<Array>(std::size_t{{{}}});\n", array, expr.elements().size());
+
+    for (std::size_t i = 0; i < expr.elements().size(); i++) {
+        expr.elements()[i]->accept(*this);
+        m_body << std::format("    {}.values()[{}] = Interpreter::element({}, {});\n", array, i, bracket, m_result);
+    }
+
+    declareValue(std::format("&{}", array));
+}
+
+void CppEmitter::visitAssignExpr(const Assign& expr) {
+    expr.value().accept(*this);
+    if (const auto* global = this->global(expr.name().lexeme)) {
+        m_body << std::format("    {} = {};\n", *global, m_result);
+    } else {
+        declareUndefined(expr.name());
+    }
+}
+
+void CppEmitter::visitBinaryExpr(const Binary& expr) {
+    expr.left().accept(*this);
+    auto left = m_result;
+    expr.right().accept(*this);
+    auto right = m_result;
+
+    auto op = declareToken(expr.op());
+    declareValue(std::format("Interpreter::binary(heap, {}, {}, {})", op, left, right));
+}
+
+void CppEmitter::visitCallExpr(const Call& expr) {
+    expr.callee().accept(*this);
+    auto callee = m_result;
+
+    std::string arguments;
+    for (const auto& argument : expr.arguments()) {
+        argument->accept(*this);
+        arguments += arguments.empty() ? m_result : ", " + m_result;
+    }
+
+    auto paren = declareToken(expr.paren());
+    declareValue(std::format("Interpreter::callNative(heap, {}, {}, std::array<std::any, {}>{{{}}})", paren, callee,
+                             expr.arguments().size(), arguments));
+}
+
+void CppEmitter::visitGetExpr(const Get& expr) {
+    expr.object().accept(*this);
+
+    declareError(expr.name(), "Only instances have properties.");
+}
+
+void CppEmitter::visitGroupingExpr(const Grouping& expr) {
+    expr.expression().accept(*this);
+}
+
+void CppEmitter::visitIndexExpr(const Index& expr) {
+    expr.object().accept(*this);
+    auto object = m_result;
+    auto bracket = declareToken(expr.bracket());
+    m_body << std::format("    Interpreter::subscript({}, {});\n", bracket, object);
+
+    expr.index().accept(*this);
+    declareValue(std::format("Interpreter::load({}, {}, {})", bracket, object, m_result));
+}
+
+void CppEmitter::visitLiteralExpr(const Lit& expr) {
+    std::visit(
+        [this](auto&& arg) {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, std::monostate>) {
+                declareValue("std::monostate{}");
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                declareValue(std::format("heap.make<String>(std::string({}, {}))", quote(arg), arg.size()));
+            } else if constexpr (std::is_same_v<T, double>) {
+                // Shortest round-trip form, kept a floating literal so std::any holds a double.
+                auto number = std::format("{}", arg);
+                if (number.find_first_of(".e") == std::string::npos) {
+                    number += ".0";
+                }
+                declareValue(number);
+            } else if constexpr (std::is_same_v<T, bool>) {
+                declareValue(arg ? "true" : "false");
+            }
+        },
+        expr.value());
+}
+
+void CppEmitter::visitLogicalExpr(const Logical& expr) {
+    expr.left().accept(*this);
+    auto result = m_result;
+
+    // Emit the right operand on its own, to indent it into the block.
+    std::ostringstream body;
+    m_body.swap(body);
+    expr.right().accept(*this);
+    m_body.swap(body);
+
+    auto test = expr.op().type == TokenType::OR ? "!Interpreter::isTruthy" : "Interpreter::isTruthy";
+    m_body << std::format("    if ({}({})) {{\n", test, result);
+
+    std::istringstream lines(body.str());
+    for (std::string line; std::getline(lines, line);) {
+        m_body << "    " << line << '\n';
+    }
+
+    m_body << std::format("        {} = {};\n", result, m_result);
+    m_body << "    }\n";
+
+    m_result = result;
+}
+
+void CppEmitter::visitSetExpr(const Set& expr) {
+    expr.object().accept(*this);
+
+    declareError(expr.name(), "Only instances have fields.");
+}
+
+void CppEmitter::visitSetIndexExpr(const SetIndex& expr) {
+    expr.object().accept(*this);
+    auto object = m_result;
+    auto bracket = declareToken(expr.bracket());
+    m_body << std::format("    Interpreter::subscript({}, {});\n", bracket, object);
+
+    expr.index().accept(*this);
+    auto index = m_result;
+    m_body << std::format("    Interpreter::checkIndex({}, {}, {});\n", bracket, object, index);
+
+    expr.value().accept(*this);
+    declareValue(std::format("Interpreter::store(heap, {}, {}, {}, {})", bracket, object, index, m_result));
+}
+
+void CppEmitter::visitUnaryExpr(const Unary& expr) {
+    expr.right().accept(*this);
+    auto right = m_result;
+
+    auto op = declareToken(expr.op());
+    declareValue(std::format("Interpreter::unary({}, {})", op, right));
+}
+
+void CppEmitter::visitVariableExpr(const Variable& expr) {
+    if (const auto* global = this->global(expr.name().lexeme)) {
+        declareValue(*global);
+    } else {
+        declareUndefined(expr.name());
+    }
+}
+
+[[nodiscard]] const std::string* CppEmitter::global(const std::string& name) {
+    if (auto it = m_globalNames.find(name); it != m_globalNames.end()) {
+        return &it->second;
+    }
+    if (std::ranges::find(m_natives, name) == m_natives.end()) {
+        return nullptr;
+    }
+
+    auto variable = std::format("g{}", m_globalNames.size());
+    m_globals << std::format("    std::any {} = Tox::builtin(heap, {});\n", variable, quote(name));
+
+    return &m_globalNames.emplace(name, std::move(variable)).first->second;
+}
+
+[[nodiscard]] std::string CppEmitter::declareToken(const Token& token) {
+    auto name = std::format("op{}", m_tokenCount++);
+    m_tokens << std::format("const Token {}(TokenType::{}, {}, std::monostate{{}}, {}, {});\n", name,
+                            magic_enum::enum_name(token.type), quote(token.lexeme), token.line, token.column);
+
+    return name;
+}
+
+void CppEmitter::declareValue(std::string_view init) {
+    m_result = std::format("v{}", m_valueCount++);
+    m_body << std::format("    std::any {} = {};\n", m_result, init);
+}
+
+void CppEmitter::declareError(const Token& token, std::string_view message) {
+    auto name = declareToken(token);
+    declareValue(std::format("[]() -> std::any {{ throw RuntimeError({}, {}); }}()", name, quote(message)));
+}
+
+[[nodiscard]] std::string CppEmitter::quote(std::string_view value) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        switch (c) {
+        case '"':
+            quoted += "\\\"";
+            break;
+        case '\\':
+            quoted += "\\\\";
+            break;
+        case '\n':
+            quoted += "\\n";
+            break;
+        case '\r':
+            quoted += "\\r";
+            break;
+        case '\t':
+            quoted += "\\t";
+            break;
+        default: {
+            auto byte = static_cast<unsigned char>(c);
+            if (byte < 0x20 || byte >= 0x7f) {
+                // Octal escapes take at most three digits, so following characters are never absorbed.
+                quoted += std::format("\\{:03o}", byte);
+            } else {
+                quoted += c;
+            }
+            break;
+        }
+        }
+    }
+    quoted += '"';
+
+    return quoted;
+}
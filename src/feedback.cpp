@@ -0,0 +1,86 @@
+#include "feedback.h"
+
+#include "text.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+
+constexpr std::string_view PROFILE_HEADER = "tox-profile 1";
+
+[[nodiscard]] std::uint8_t OperandTypes::kindOf(const std::any& value) noexcept {
+    if (value.type() == typeid(double)) {
+        return NUMBER;
+    }
+    if (value.type() == typeid(String*)) {
+        return STRING;
+    }
+    if (value.type() == typeid(bool)) {
+        return BOOL;
+    }
+    if (value.type() == typeid(std::monostate)) {
+        return NIL;
+    }
+
+    return 0;
+}
+
+void TypeProfile::record(const Token& op, const std::any& right) {
+    m_nodes[{op.line, op.column}].right |= OperandTypes::kindOf(right);
+}
+
+void TypeProfile::record(const Token& op, const std::any& left, const std::any& right) {
+    auto& types = m_nodes[{op.line, op.column}];
+    types.left |= OperandTypes::kindOf(left);
+    types.right |= OperandTypes::kindOf(right);
+}
+
+[[nodiscard]] const OperandTypes* TypeProfile::lookup(const Token& op) const {
+    auto it = m_nodes.find({op.line, op.column});
+
+    return it != m_nodes.end() ? &it->second : nullptr;
+}
+
+void TypeProfile::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write profile: " + path);
+    }
+
+    file << PROFILE_HEADER << '\n';
+    for (const auto& [location, types] : m_nodes) {
+        file << location.first << ' ' << location.second << ' ' << +types.left << ' ' << +types.right << '\n';
+    }
+}
+
+[[nodiscard]] TypeProfile TypeProfile::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open profile: " + path);
+    }
+
+    std::string header;
+    if (!std::getline(file, header) || header != PROFILE_HEADER) {
+        throw std::runtime_error("Malformed profile: " + path);
+    }
+
+    TypeProfile profile;
+    std::size_t line = 0;
+    std::size_t column = 0;
+    unsigned left = 0;
+    unsigned right = 0;
+    while (file >> line >> column >> left >> right) {
+        profile.m_nodes[{line, column}] = {
+            .left = static_cast<std::uint8_t>(left),
+            .right = static_cast<std::uint8_t>(right),
+        };
+    }
+
+    if (!file.eof()) {
+        throw std::runtime_error("Malformed profile: " + path);
+    }
+
+    return profile;
+}
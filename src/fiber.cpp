@@ -0,0 +1,157 @@
+#include "fiber.h"
+
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define TOX_FIBER_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define TOX_FIBER_ASAN 1
+#endif
+#endif
+
+#ifdef TOX_FIBER_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef _WIN32
+/**
+ * Stack a new fiber commits up front, the rest of its reservation being committed as it grows.
+ */
+constexpr SIZE_T COMMITTED_STACK = 64 * 1024;
+#else
+/**
+ * The fiber being started on this thread, which makecontext cannot pass to its entry portably.
+ */
+thread_local Fiber* t_starting = nullptr;
+
+/**
+ * Tell AddressSanitizer the thread is about to switch stacks, so it does not mistake the other stack for an
+ * overflow of this one. Does nothing in other builds.
+ *
+ * @param fakeStack Receives the fake stack of the frames being left, null if they are left for good.
+ * @param bottom Lowest address of the stack switched to.
+ * @param size Size of the stack switched to.
+ */
+void startSwitch([[maybe_unused]] void** fakeStack, [[maybe_unused]] const void* bottom,
+                 [[maybe_unused]] std::size_t size) {
+#ifdef TOX_FIBER_ASAN
+    __sanitizer_start_switch_fiber(fakeStack, bottom, size);
+#endif
+}
+
+/**
+ * Tell AddressSanitizer a stack switch is done. Does nothing in other builds.
+ *
+ * @param fakeStack The fake stack saved when the frames now running were left, null if they never were.
+ * @param bottom Receives the lowest address of the stack switched from, may be null.
+ * @param size Receives the size of the stack switched from, may be null.
+ */
+void finishSwitch([[maybe_unused]] void* fakeStack, [[maybe_unused]] const void** bottom,
+                  [[maybe_unused]] std::size_t* size) {
+#ifdef TOX_FIBER_ASAN
+    __sanitizer_finish_switch_fiber(fakeStack, bottom, size);
+#endif
+}
+#endif
+
+} // namespace
+
+#ifdef _WIN32
+
+Fiber::Fiber(std::size_t stackSize, Entry entry, void* argument) : m_entry(entry), m_argument(argument) {
+    m_fiber = CreateFiberEx(
+        COMMITTED_STACK, stackSize, FIBER_FLAG_FLOAT_SWITCH,
+        [](void* fiber) { run(*static_cast<Fiber*>(fiber)); }, this);
+    if (m_fiber == nullptr) {
+        throw std::bad_alloc();
+    }
+}
+
+Fiber::~Fiber() {
+    DeleteFiber(m_fiber);
+}
+
+void Fiber::resume() {
+    if (!IsThreadAFiber()) {
+        ConvertThreadToFiber(nullptr);
+    }
+
+    m_caller = GetCurrentFiber();
+    SwitchToFiber(m_fiber);
+}
+
+void Fiber::suspend() {
+    SwitchToFiber(m_caller);
+}
+
+#else
+
+Fiber::Fiber(std::size_t stackSize, Entry entry, void* argument) : m_entry(entry), m_argument(argument) {
+    auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    m_stackSize = (stackSize + page - 1) / page * page + page;
+
+    // Reserve without committing; the lowest page stays inaccessible, so an overflow faults instead of
+    // overwriting whatever lies below.
+    m_stack = mmap(nullptr, m_stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (m_stack == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    mprotect(m_stack, page, PROT_NONE);
+
+    getcontext(&m_context);
+    m_context.uc_stack.ss_sp = m_stack;
+    m_context.uc_stack.ss_size = m_stackSize;
+    m_context.uc_link = nullptr;
+    makecontext(
+        &m_context,
+        [] {
+            auto& fiber = *t_starting;
+            finishSwitch(nullptr, &fiber.m_callerStack, &fiber.m_callerStackSize);
+            run(fiber);
+        },
+        0);
+}
+
+Fiber::~Fiber() {
+    munmap(m_stack, m_stackSize);
+}
+
+void Fiber::resume() {
+    t_starting = this;
+
+    void* fakeStack = nullptr;
+    startSwitch(&fakeStack, m_stack, m_stackSize);
+    swapcontext(&m_caller, &m_context);
+    finishSwitch(fakeStack, nullptr, nullptr);
+}
+
+void Fiber::suspend() {
+    // A fiber that is done is never resumed, so its frames are left for good.
+    void* fakeStack = nullptr;
+    startSwitch(m_done ? nullptr : &fakeStack, m_callerStack, m_callerStackSize);
+    swapcontext(&m_context, &m_caller);
+    finishSwitch(fakeStack, &m_callerStack, &m_callerStackSize);
+}
+
+#endif
+
+void Fiber::run(Fiber& fiber) noexcept {
+    fiber.m_entry(fiber.m_argument);
+    fiber.m_done = true;
+
+    // Never resumed again: the owner frees the stack once it sees the fiber is done.
+    while (true) {
+        fiber.suspend();
+    }
+}
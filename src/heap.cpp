@@ -0,0 +1,99 @@
+#include "heap.h"
+
+#include "array.h"
+#include "channel.h"
+#include "class.h"
+#include "closure.h"
+#include "map.h"
+#include "native.h"
+#include "text.h"
+
+#include <algorithm>
+#include <format>
+
+void HeapStats::print(std::ostream& stream) const {
+    using std::chrono::duration;
+
+    stream << std::format("{:<12} {:>10} {:>12} {:>12} {:>14} {:>14} {:>12} {:>12}\n", "heap", "collections",
+                          "allocated", "freed", "live bytes", "peak bytes", "pause ms", "max ms");
+    stream << std::format("{:<12} {:>10} {:>12} {:>12} {:>14} {:>14} {:>12.3f} {:>12.3f}\n", "objects", collections,
+                          allocated, freed, liveBytes, peakBytes, duration<double, std::milli>(pause).count(),
+                          duration<double, std::milli>(maxPause).count());
+}
+
+Heap::~Heap() {
+    while (m_objects != nullptr) {
+        delete std::exchange(m_objects, m_objects->m_next);
+    }
+}
+
+[[nodiscard]] const Object* Heap::object(const std::any& value) {
+    if (const auto* string = std::any_cast<String*>(&value)) {
+        return *string;
+    }
+    if (const auto* closure = std::any_cast<Closure*>(&value)) {
+        return *closure;
+    }
+    if (const auto* instance = std::any_cast<Instance*>(&value)) {
+        return *instance;
+    }
+    if (const auto* klass = std::any_cast<ClassObject*>(&value)) {
+        return *klass;
+    }
+    if (const auto* bound = std::any_cast<BoundMethod*>(&value)) {
+        return *bound;
+    }
+    if (const auto* cell = std::any_cast<Cell*>(&value)) {
+        return *cell;
+    }
+    if (const auto* native = std::any_cast<Native*>(&value)) {
+        return *native;
+    }
+    if (const auto* array = std::any_cast<Array*>(&value)) {
+        return *array;
+    }
+    if (const auto* map = std::any_cast<Map*>(&value)) {
+        return *map;
+    }
+    if (const auto* channel = std::any_cast<Channel*>(&value)) {
+        return *channel;
+    }
+
+    return nullptr;
+}
+
+void Heap::trace() {
+    while (!m_gray.empty()) {
+        const auto* object = m_gray.back();
+        m_gray.pop_back();
+        object->trace(*this);
+    }
+}
+
+void Heap::sweep(std::chrono::nanoseconds marking) {
+    auto start = std::chrono::steady_clock::now();
+    m_stats.peakBytes = std::max(m_stats.peakBytes, m_bytes);
+
+    std::size_t live = 0;
+    auto** link = &m_objects;
+    while (auto* object = *link) {
+        if (object->m_marked) {
+            object->m_marked = false;
+            live += object->size();
+            link = &object->m_next;
+        } else {
+            *link = object->m_next;
+            delete object;
+            m_stats.freed++;
+        }
+    }
+
+    m_bytes = live;
+    m_threshold = threshold(live);
+
+    auto pause = marking + (std::chrono::steady_clock::now() - start);
+    m_stats.collections++;
+    m_stats.liveBytes = live;
+    m_stats.pause += pause;
+    m_stats.maxPause = std::max(m_stats.maxPause, pause);
+}
@@ -1,114 +1,1460 @@
 #include "interpreter.h"
 
-#include "tox.h"
+#include "scheduler.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <format>
-#include <print>
+#include <new>
+#include <span>
+#include <utility>
 #include <variant>
+#include <vector>
+
+namespace {
+
+/**
+ * Tree walker keeping pending nodes and intermediate values on heap-allocated stacks,
+ * so its native stack use does not grow with the height of the tree.
+ * Each visit advances the node on top of the stack by one step.
+ */
+class StackWalker : public ExprVisitor {
+private:
+    /**
+     * A node being evaluated.
+     */
+    struct Frame {
+        /**
+         * The node.
+         */
+        const Expr* expr;
+
+        /**
+         * Operator token of the node, set on its first step, for error reporting.
+         */
+        const Token* op = nullptr;
+
+        /**
+         * Number of steps taken so far.
+         */
+        std::uint32_t stage = 0;
+    };
+
+    /**
+     * The interpreter evaluating short subtrees.
+     */
+    Interpreter& m_interpreter;
+
+    /**
+     * Profile receiving observed operand types, may be null.
+     */
+    TypeProfile* m_recorder;
+
+    /**
+     * Maximum nesting depth.
+     */
+    std::uint32_t m_maxDepth;
+
+    /**
+     * Pending nodes, innermost last. The size is the depth of the innermost node.
+     */
+    std::vector<Frame> m_frames;
+
+    /**
+     * Operand values of the pending nodes.
+     */
+    std::vector<std::any> m_values;
+
+public:
+    /**
+     * Constructs a walker.
+     *
+     * @param interpreter The interpreter evaluating short subtrees.
+     * @param recorder Profile receiving observed operand types, may be null.
+     * @param maxDepth Maximum nesting depth.
+     */
+    StackWalker(Interpreter& interpreter, TypeProfile* recorder, std::uint32_t maxDepth)
+        : m_interpreter(interpreter), m_recorder(recorder), m_maxDepth(maxDepth) {}
+
+    /**
+     * Evaluate a tree.
+     *
+     * @param root The root of the tree.
+     * @return The result of the evaluation.
+     */
+    [[nodiscard]] std::any run(const Expr& root) {
+        m_frames.push_back({.expr = &root});
+        while (!m_frames.empty()) {
+            m_frames.back().expr->accept(*this);
+        }
+
+        return std::move(m_values.back());
+    }
+
+    /**
+     * Get the operand values of the pending nodes.
+     *
+     * @return The values.
+     */
+    [[nodiscard]] const std::vector<std::any>& values() const noexcept {
+        return m_values;
+    }
+
+    /**
+     * Step an array literal expression: evaluate each element, checking the previous one is a number, then make
+     * the array of them.
+     *
+     * @param expr The array literal expression to visit.
+     */
+    void visitArrayLiteralExpr(const ArrayLit& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.bracket();
+
+        const auto& elements = expr.elements();
+        auto stage = frame.stage++;
+        if (stage > 0) {
+            (void)Interpreter::element(expr.bracket(), m_values.back());
+        }
+        if (stage < elements.size()) {
+            descend(*elements[stage]);
+            return;
+        }
+
+        auto first = m_values.end() - static_cast<std::ptrdiff_t>(elements.size());
+        auto* array = m_interpreter.heap().make<Array>(elements.size());
+        std::ranges::transform(first, m_values.end(), array->values().begin(),
+                               [](const std::any& value) { return std::any_cast<double>(value); });
+        m_values.erase(first, m_values.end());
+
+        m_frames.pop_back();
+        m_values.emplace_back(array);
+    }
+
+    /**
+     * Step an assignment expression: evaluate the value, then store it, leaving it as the result.
+     *
+     * @param expr The assignment expression to visit.
+     */
+    void visitAssignExpr(const Assign& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.name();
+
+        if (frame.stage++ == 0) {
+            descend(expr.value());
+            return;
+        }
+
+        m_frames.pop_back();
+        m_interpreter.assign(expr.name(), expr.binding(), m_values.back());
+    }
+
+    /**
+     * Step a binary expression: evaluate the left operand, then the right one, then apply the operator.
+     *
+     * @param expr The binary expression to visit.
+     */
+    void visitBinaryExpr(const Binary& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.op();
+
+        switch (frame.stage++) {
+        case 0:
+            descend(expr.left());
+            break;
+        case 1:
+            descend(expr.right());
+            break;
+        default: {
+            auto right = pop();
+            auto left = pop();
+            if (m_recorder != nullptr) {
+                m_recorder->record(expr.op(), left, right);
+            }
+
+            m_frames.pop_back();
+            m_values.push_back(Interpreter::binary(m_interpreter.heap(), expr.op(), left, right));
+            break;
+        }
+        }
+    }
+
+    /**
+     * Step a call expression: evaluate the callee, then each argument, then push the callee with the receiver
+     * it expects and the arguments, and call.
+     *
+     * @param expr The call expression to visit.
+     */
+    void visitCallExpr(const Call& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.paren();
+
+        const auto& arguments = expr.arguments();
+        auto stage = frame.stage++;
+        if (stage == 0) {
+            descend(expr.callee());
+            return;
+        }
+        if (stage <= arguments.size()) {
+            descend(*arguments[stage - 1]);
+            return;
+        }
+
+        auto first = m_values.end() - static_cast<std::ptrdiff_t>(arguments.size());
+        m_interpreter.pushCallee(expr.paren(), *(first - 1));
+        for (auto argument = first; argument != m_values.end(); ++argument) {
+            m_interpreter.push(expr.paren(), std::move(*argument));
+        }
+        m_values.erase(first, m_values.end());
+
+        auto callee = pop();
+        m_frames.pop_back();
+        m_values.push_back(m_interpreter.call(expr.paren(), callee, static_cast<std::uint32_t>(arguments.size())));
+    }
+
+    /**
+     * Step a property get expression: evaluate the object, then read the property.
+     *
+     * @param expr The property get expression to visit.
+     */
+    void visitGetExpr(const Get& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.name();
+
+        if (frame.stage++ == 0) {
+            descend(expr.object());
+            return;
+        }
+
+        auto object = pop();
+        m_frames.pop_back();
+        m_values.push_back(m_interpreter.property(expr, object));
+    }
+
+    /**
+     * Step a grouping expression: evaluate the contained expression, whose value becomes the result.
+     *
+     * @param expr The grouping expression to visit.
+     */
+    void visitGroupingExpr(const Grouping& expr) override {
+        if (m_frames.back().stage++ == 0) {
+            descend(expr.expression());
+        } else {
+            m_frames.pop_back();
+        }
+    }
+
+    /**
+     * Step an index expression: evaluate the object, check it is an array or a map, evaluate the index, then read
+     * the element or the value of the key.
+     *
+     * @param expr The index expression to visit.
+     */
+    void visitIndexExpr(const Index& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.bracket();
+
+        switch (frame.stage++) {
+        case 0:
+            descend(expr.object());
+            break;
+        case 1:
+            Interpreter::subscript(expr.bracket(), m_values.back());
+            descend(expr.index());
+            break;
+        default: {
+            auto index = pop();
+            auto object = pop();
+
+            m_frames.pop_back();
+            m_values.push_back(Interpreter::load(expr.bracket(), object, index));
+            break;
+        }
+        }
+    }
+
+    /**
+     * Step a literal expression.
+     *
+     * @param expr The literal expression to visit.
+     */
+    void visitLiteralExpr(const Lit& expr) override {
+        m_frames.pop_back();
+        m_values.push_back(m_interpreter.eval(expr));
+    }
+
+    /**
+     * Step a logical expression: evaluate the left operand, then the right one unless the left one decides.
+     *
+     * @param expr The logical expression to visit.
+     */
+    void visitLogicalExpr(const Logical& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.op();
+
+        switch (frame.stage++) {
+        case 0:
+            descend(expr.left());
+            break;
+        case 1:
+            if (expr.shortCircuits(Interpreter::isTruthy(m_values.back()))) {
+                m_frames.pop_back();
+            } else {
+                m_values.pop_back();
+                descend(expr.right());
+            }
+            break;
+        default:
+            m_frames.pop_back();
+            break;
+        }
+    }
+
+    /**
+     * Step a property set expression: evaluate the object, check it is an instance, evaluate the value,
+     * then store it, leaving it as the result.
+     *
+     * @param expr The property set expression to visit.
+     */
+    void visitSetExpr(const Set& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.name();
+
+        switch (frame.stage++) {
+        case 0:
+            descend(expr.object());
+            break;
+        case 1:
+            (void)Interpreter::fields(expr, m_values.back());
+            descend(expr.value());
+            break;
+        default: {
+            auto value = pop();
+            auto object = pop();
+            Interpreter::setField(expr, Interpreter::fields(expr, object), value);
+
+            m_frames.pop_back();
+            m_values.push_back(std::move(value));
+            break;
+        }
+        }
+    }
+
+    /**
+     * Step an element set expression: evaluate the object, check it is an array or a map, evaluate the index,
+     * check it is valid, evaluate the value, then store it, leaving it as the result.
+     *
+     * @param expr The element set expression to visit.
+     */
+    void visitSetIndexExpr(const SetIndex& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.bracket();
+
+        switch (frame.stage++) {
+        case 0:
+            descend(expr.object());
+            break;
+        case 1:
+            Interpreter::subscript(expr.bracket(), m_values.back());
+            descend(expr.index());
+            break;
+        case 2:
+            Interpreter::checkIndex(expr.bracket(), *(m_values.end() - 2), m_values.back());
+            descend(expr.value());
+            break;
+        default: {
+            auto value = pop();
+            auto index = pop();
+            auto object = pop();
+
+            auto result = Interpreter::store(m_interpreter.heap(), expr.bracket(), object, index, std::move(value));
+
+            m_frames.pop_back();
+            m_values.push_back(std::move(result));
+            break;
+        }
+        }
+    }
+
+    /**
+     * Step a super expression.
+     *
+     * @param expr The super expression to visit.
+     */
+    void visitSuperExpr(const Super& expr) override {
+        m_frames.pop_back();
+        m_values.push_back(m_interpreter.eval(expr));
+    }
+
+    /**
+     * Step a this expression.
+     *
+     * @param expr The this expression to visit.
+     */
+    void visitThisExpr(const This& expr) override {
+        m_frames.pop_back();
+        m_values.push_back(m_interpreter.eval(expr));
+    }
+
+    /**
+     * Step a unary expression: evaluate the operand, then apply the operator.
+     *
+     * @param expr The unary expression to visit.
+     */
+    void visitUnaryExpr(const Unary& expr) override {
+        auto& frame = m_frames.back();
+        frame.op = &expr.op();
+
+        if (frame.stage++ == 0) {
+            descend(expr.right());
+            return;
+        }
+
+        auto right = pop();
+        if (m_recorder != nullptr) {
+            m_recorder->record(expr.op(), right);
+        }
+
+        m_frames.pop_back();
+        m_values.push_back(Interpreter::unary(expr.op(), right));
+    }
+
+    /**
+     * Step a variable expression.
+     *
+     * @param expr The variable expression to visit.
+     */
+    void visitVariableExpr(const Variable& expr) override {
+        m_frames.pop_back();
+        m_values.push_back(m_interpreter.eval(expr));
+    }
+
+private:
+    /**
+     * Evaluate a child of the innermost node: by recursion if it is short enough to stay within both
+     * the recursion height and the depth limit, otherwise by pushing it onto the stack.
+     *
+     * @param child The child to evaluate.
+     * @throws RuntimeError if the child would be nested deeper than the maximum depth.
+     */
+    void descend(const Expr& child) {
+        auto depth = m_frames.size();
+        if (child.height() <= Interpreter::RECURSION_HEIGHT && depth + child.height() <= m_maxDepth) {
+            m_values.push_back(m_interpreter.eval(child));
+            return;
+        }
+
+        if (depth >= m_maxDepth) {
+            throw RuntimeError(innermostOperator(),
+                               std::format("Expression nesting exceeds the depth limit of {}.", m_maxDepth));
+        }
+
+        m_frames.push_back({.expr = &child});
+    }
+
+    /**
+     * Pop the last operand value.
+     *
+     * @return The value.
+     */
+    [[nodiscard]] std::any pop() {
+        auto value = std::move(m_values.back());
+        m_values.pop_back();
+
+        return value;
+    }
+
+    /**
+     * Find the operator token of the innermost pending node that has one.
+     *
+     * @return The token, or an end-of-file token if only groupings are pending.
+     */
+    [[nodiscard]] Token innermostOperator() const {
+        for (auto frame = m_frames.rbegin(); frame != m_frames.rend(); ++frame) {
+            if (frame->op != nullptr) {
+                return *frame->op;
+            }
+        }
+
+        return {TokenType::END_OF_FILE, "", std::monostate{}, 0, 0};
+    }
+};
+
+/**
+ * Compiles the expressions of every statement of a program against a type profile before it runs.
+ */
+class Precompiler : public StmtVisitor {
+private:
+    /**
+     * The compiler.
+     */
+    ClosureCompiler m_compiler;
+
+public:
+    /**
+     * Constructs a precompiler.
+     *
+     * @param profile Type feedback used to specialize operators.
+     */
+    explicit Precompiler(const TypeProfile* profile) : m_compiler(profile) {}
+
+    /**
+     * Compile the expressions of a block statement.
+     *
+     * @param stmt The block statement to visit.
+     */
+    void visitBlockStmt(const Block& stmt) override {
+        for (const auto& statement : stmt.statements()) {
+            statement->accept(*this);
+        }
+    }
+
+    /**
+     * Compile the bodies of the methods of a class declaration.
+     *
+     * @param stmt The class declaration to visit.
+     */
+    void visitClassStmt(const Class& stmt) override {
+        for (const auto& method : stmt.methods()) {
+            method->accept(*this);
+        }
+    }
+
+    /**
+     * Compile the expression of an expression statement.
+     *
+     * @param stmt The expression statement to visit.
+     */
+    void visitExpressionStmt(const Expression& stmt) override {
+        compile(stmt.expression());
+    }
+
+    /**
+     * Compile the body of a function declaration.
+     *
+     * @param stmt The function declaration to visit.
+     */
+    void visitFunctionStmt(const Function& stmt) override {
+        for (const auto& statement : stmt.body()) {
+            statement->accept(*this);
+        }
+    }
+
+    /**
+     * Compile the condition and branches of an if statement.
+     *
+     * @param stmt The if statement to visit.
+     */
+    void visitIfStmt(const If& stmt) override {
+        compile(stmt.condition());
+        stmt.thenBranch().accept(*this);
+        if (const auto* elseBranch = stmt.elseBranch()) {
+            elseBranch->accept(*this);
+        }
+    }
+
+    /**
+     * Compile the expression of a print statement.
+     *
+     * @param stmt The print statement to visit.
+     */
+    void visitPrintStmt(const Print& stmt) override {
+        compile(stmt.expression());
+    }
+
+    /**
+     * Compile the value of a return statement.
+     *
+     * @param stmt The return statement to visit.
+     */
+    void visitReturnStmt(const Return& stmt) override {
+        if (const auto* value = stmt.value()) {
+            compile(*value);
+        }
+    }
+
+    /**
+     * Compile the callee and arguments of a spawn statement, which are evaluated but not called.
+     *
+     * @param stmt The spawn statement to visit.
+     */
+    void visitSpawnStmt(const Spawn& stmt) override {
+        compile(stmt.call().callee());
+        for (const auto& argument : stmt.call().arguments()) {
+            compile(*argument);
+        }
+    }
+
+    /**
+     * Compile the initializer of a variable declaration.
+     *
+     * @param stmt The variable declaration to visit.
+     */
+    void visitVarStmt(const Var& stmt) override {
+        if (const auto* initializer = stmt.initializer()) {
+            compile(*initializer);
+        }
+    }
+
+    /**
+     * Compile the condition and body of a while statement.
+     *
+     * @param stmt The while statement to visit.
+     */
+    void visitWhileStmt(const While& stmt) override {
+        compile(stmt.condition());
+        stmt.body().accept(*this);
+    }
+
+private:
+    /**
+     * Compile an expression, unless it is too tall or already claimed.
+     *
+     * @param expr The expression.
+     */
+    void compile(const Expr& expr) {
+        if (expr.height() <= Interpreter::RECURSION_HEIGHT && expr.tier().tryQueue()) {
+            expr.tier().publish(std::make_unique<const CompiledExpr>(m_compiler.compile(expr)));
+        }
+    }
+};
+
+/**
+ * Apply an arithmetic operator to two arrays element by element.
+ *
+ * @param heap Heap receiving the result.
+ * @param op The operator token, PLUS, MINUS, STAR or SLASH.
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return A new array of the results.
+ * @throws RuntimeError if the arrays have different lengths.
+ */
+[[nodiscard]] Array* elementwise(Heap& heap, const Token& op, const Array& left, const Array& right) {
+    if (left.length() != right.length()) {
+        throw RuntimeError(op, "Arrays must have the same length.");
+    }
+
+    auto* result = heap.make<Array>(left.length());
+    switch (op.type) {
+    case TokenType::PLUS:
+        Array::add(left.values(), right.values(), result->values());
+        break;
+    case TokenType::MINUS:
+        Array::subtract(left.values(), right.values(), result->values());
+        break;
+    case TokenType::STAR:
+        Array::multiply(left.values(), right.values(), result->values());
+        break;
+    default:
+        Array::divide(left.values(), right.values(), result->values());
+        break;
+    }
+
+    return result;
+}
+
+/**
+ * Write a map as `{key: value, ...}`, in insertion order. A map nested in itself is written as `{...}`.
+ *
+ * @param sink The sink to write to.
+ * @param map The map.
+ * @param open The maps being written, enclosing this one.
+ */
+void writeMap(OutputSink& sink, const Map& map, std::vector<const Map*>& open) {
+    if (std::ranges::find(open, &map) != open.end()) {
+        sink.write("{...}");
+        return;
+    }
+
+    open.push_back(&map);
+    sink.put('{');
+
+    auto first = true;
+    auto item = [&](const std::any& value) {
+        if (const auto* nested = std::any_cast<Map*>(&value)) {
+            writeMap(sink, **nested, open);
+        } else {
+            Interpreter::write(sink, value);
+        }
+    };
+    map.forEach([&](const std::any& key, const std::any& value) {
+        sink.write(std::exchange(first, false) ? "" : ", ");
+        item(key);
+        sink.write(": ");
+        item(value);
+    });
+
+    sink.put('}');
+    open.pop_back();
+}
+
+} // namespace
 
 void Interpreter::interpret(const Expr& expr) {
+    limitNativeStack();
+
     try {
         auto value = eval(expr);
-        std::println("{}", stringify(value));
+        write(m_output, value);
+        m_output.put('\n');
     } catch (const RuntimeError& error) {
-        Tox::runtimeError(error);
+        unwind();
+        m_diagnostics.runtimeError(error);
+    }
+}
+
+void Interpreter::interpret(std::shared_ptr<const Program> program) {
+    enter(std::move(program));
+
+    // Known operand types let us specialize right away instead of warming up first.
+    if (m_profile && !m_recorder && m_tierThreshold != 0) {
+        Precompiler precompiler(m_profile.get());
+        for (const auto& statement : m_root->statements()) {
+            statement->accept(precompiler);
+        }
     }
+
+    try {
+        for (const auto& statement : m_root->statements()) {
+            execute(*statement);
+        }
+    } catch (const RuntimeError& error) {
+        unwind();
+        m_diagnostics.runtimeError(error);
+    } catch (...) {
+        unwind();
+        leave();
+        throw;
+    }
+
+    leave();
+}
+
+void Interpreter::interpret(std::shared_ptr<const Program> program, const Function& function, const Token& paren,
+                            std::span<const Message> arguments) {
+    enter(std::move(program));
+
+    try {
+        // Only the declarations of functions and classes run, so that the function finds what it calls.
+        for (const auto& statement : m_root->statements()) {
+            if (dynamic_cast<const Function*>(statement.get()) != nullptr ||
+                dynamic_cast<const Class*>(statement.get()) != nullptr) {
+                execute(*statement);
+            }
+        }
+
+        auto* closure = m_heap.make<Closure>(m_root, function, m_programGlobals, std::vector<Cell*>{}, nullptr);
+        push(paren, closure);
+        for (const auto& argument : arguments) {
+            push(paren, argument.unpack(m_heap));
+        }
+
+        (void)call(paren, *closure, static_cast<std::uint32_t>(arguments.size()));
+    } catch (...) {
+        unwind();
+        leave();
+        throw;
+    }
+
+    leave();
+}
+
+void Interpreter::enter(std::shared_ptr<const Program> program) {
+    m_root = std::move(program);
+
+    auto globals = std::make_shared<GlobalSlots>();
+    for (const auto& name : m_root->globals()) {
+        globals->push_back(&m_globals[name]);
+    }
+    m_programGlobals = std::move(globals);
+    m_globalSlots = m_programGlobals.get();
+
+    // The program's frame holds every block local, even past STACK_SLOTS, which only bounds the calls above it.
+    m_stack.resize(std::max<std::size_t>(m_stack.size(), m_root->slots()));
+    std::fill_n(m_stack.begin(), m_root->slots(), std::any{});
+    m_base = 0;
+    m_top = m_root->slots();
+    limitNativeStack();
+}
+
+void Interpreter::leave() noexcept {
+    std::fill_n(m_stack.begin(), m_top, std::any{});
+    m_top = 0;
+    m_globalSlots = nullptr;
+    m_programGlobals.reset();
+    m_root.reset();
+}
+
+void Interpreter::grow(const Token& paren, std::size_t slots) {
+    if (slots > STACK_SLOTS) {
+        throw RuntimeError(paren, "Stack overflow.");
+    }
+
+    m_stack.resize(std::min<std::size_t>(std::max(slots, 2 * m_stack.size()), STACK_SLOTS));
+}
+
+void Interpreter::pushCallee(const Token& paren, const std::any& callee) {
+    push(paren, callee);
+
+    if (const auto* bound = std::any_cast<BoundMethod*>(&callee)) {
+        push(paren, (*bound)->receiver());
+    } else if (const auto* klass = std::any_cast<ClassObject*>(&callee)) {
+        push(paren, m_heap.make<Instance>(*klass));
+    }
+}
+
+[[nodiscard]] const Closure* Interpreter::prepareInvoke(const Get& expr, const Token& paren, std::any& object) {
+    const auto* instance = std::any_cast<Instance*>(&object);
+    if (instance == nullptr) {
+        throw RuntimeError(expr.name(), "Only instances have properties.");
+    }
+
+    auto entry = findProperty(expr.cache(), expr.name(), **instance);
+    if (entry.kind == InlineCache::Kind::METHOD) {
+        // The class stays reachable during the call: the receiver on the stack refers to it.
+        const auto* method = (*instance)->klass().method(entry.index);
+        push(paren, std::move(object));
+
+        return method;
+    }
+
+    object = std::any((*instance)->field(entry.index));
+    pushCallee(paren, object);
+
+    return nullptr;
+}
+
+[[nodiscard]] const Closure& Interpreter::prepareInvoke(const Super& expr, const Token& paren) {
+    const auto* method = superMethod(expr);
+    push(paren, variable(expr.keyword(), expr.binding()));
+
+    return *method;
+}
+
+[[nodiscard]] std::any Interpreter::call(const Token& paren, const std::any& callee, std::uint32_t arity) {
+    std::any result;
+    if (const auto* closure = std::any_cast<Closure*>(&callee)) {
+        result = call(paren, **closure, arity);
+    } else if (const auto* bound = std::any_cast<BoundMethod*>(&callee)) {
+        result = call(paren, (*bound)->method(), arity);
+    } else if (const auto* native = std::any_cast<Native*>(&callee)) {
+        result = call(paren, (*native)->function(), arity);
+    } else if (const auto* klass = std::any_cast<ClassObject*>(&callee)) {
+        if (const auto* initializer = (*klass)->initializer()) {
+            result = call(paren, *initializer, arity);
+        } else if (arity != 0) {
+            throw RuntimeError(paren, std::format("Expected 0 arguments but got {}.", arity));
+        } else {
+            result = std::move(m_stack[--m_top]);
+        }
+    } else {
+        throw RuntimeError(paren, "Can only call functions and classes.");
+    }
+
+    // Pop the callee pushCallee pushed.
+    m_top--;
+
+    return result;
+}
+
+[[nodiscard]] std::any Interpreter::call(const Token& paren, const NativeFunction& function, std::uint32_t arity) {
+    auto result = callNative(m_heap, paren, function, std::span(m_stack).subspan(m_top - arity, arity));
+    m_top -= arity;
+
+    return result;
+}
+
+[[nodiscard]] std::any Interpreter::callNative(Heap& heap, const Token& paren, const NativeFunction& function,
+                                               std::span<const std::any> arguments) {
+    if (arguments.size() != function.arity) {
+        throw RuntimeError(paren, std::format("Expected {} arguments but got {}.", function.arity, arguments.size()));
+    }
+
+    try {
+        return function.thunk(heap, paren, function, arguments);
+    } catch (const NativeError& error) {
+        throw RuntimeError(paren, error.what());
+    } catch (const std::bad_alloc&) {
+        // A native asked for more memory than there is: fail the script, not the process.
+        throw RuntimeError(paren, "Out of memory.");
+    }
+}
+
+[[nodiscard]] std::any Interpreter::callNative(Heap& heap, const Token& paren, const std::any& callee,
+                                               std::span<const std::any> arguments) {
+    const auto* native = std::any_cast<Native*>(&callee);
+    if (native == nullptr) {
+        throw RuntimeError(paren, "Can only call functions and classes.");
+    }
+
+    return callNative(heap, paren, (*native)->function(), arguments);
+}
+
+[[nodiscard]] std::any Interpreter::call(const Token& paren, const Closure& closure, std::uint32_t arity) {
+    const auto& function = closure.function();
+    if (arity != function.params().size()) {
+        throw RuntimeError(paren, std::format("Expected {} arguments but got {}.", function.params().size(), arity));
+    }
+
+    auto base = m_top - arity - (function.hasReceiver() ? 1 : 0);
+    char marker = 0;
+    if (m_calls == MAX_CALLS || reinterpret_cast<std::uintptr_t>(&marker) < m_stackLimit) {
+        throw RuntimeError(paren, "Stack overflow.");
+    }
+    if (base + function.slots() > m_stack.size()) {
+        grow(paren, base + function.slots());
+    }
+
+    // An initializer returns its receiver, which slot 0 may be about to box.
+    std::any receiver;
+    if (function.kind() == Function::Kind::INITIALIZER) {
+        receiver = m_stack[base];
+    }
+
+    // The receiver and arguments already fill the first slots. Only the captured ones move, into cells.
+    for (auto slot : function.cells()) {
+        auto& param = m_stack[base + slot];
+        param = m_heap.make<Cell>(std::move(param));
+    }
+
+    // The other slots still hold values of finished frames, which the collector may have freed.
+    std::fill(m_stack.begin() + m_top, m_stack.begin() + base + function.slots(), std::any{});
+
+    const auto* caller = m_closure;
+    auto callerBase = m_base;
+    const auto* callerGlobals = m_globalSlots;
+
+    m_closure = &closure;
+    m_base = base;
+    m_top = base + function.slots();
+    m_globalSlots = m_closure->globals().get();
+    m_calls++;
+
+    for (const auto& statement : function.body()) {
+        execute(*statement);
+        if (m_returning) {
+            break;
+        }
+    }
+
+    std::any result = std::monostate{};
+    if (m_returning) {
+        result = std::move(m_returnValue);
+        m_returning = false;
+    }
+    if (function.kind() == Function::Kind::INITIALIZER) {
+        result = std::move(receiver);
+    }
+
+    m_closure = caller;
+    m_base = callerBase;
+    m_top = base;
+    m_globalSlots = callerGlobals;
+    m_calls--;
+
+    return result;
+}
+
+[[nodiscard]] std::any Interpreter::property(const Get& expr, const std::any& object) {
+    const auto* instance = std::any_cast<Instance*>(&object);
+    if (instance == nullptr) {
+        throw RuntimeError(expr.name(), "Only instances have properties.");
+    }
+
+    auto entry = findProperty(expr.cache(), expr.name(), **instance);
+    if (entry.kind == InlineCache::Kind::FIELD) {
+        return (*instance)->field(entry.index);
+    }
+
+    return m_heap.make<BoundMethod>(*instance, (*instance)->klass().method(entry.index));
+}
+
+[[nodiscard]] Instance& Interpreter::fields(const Set& expr, const std::any& object) {
+    const auto* instance = std::any_cast<Instance*>(&object);
+    if (instance == nullptr) {
+        throw RuntimeError(expr.name(), "Only instances have fields.");
+    }
+
+    return **instance;
+}
+
+void Interpreter::setField(const Set& expr, Instance& instance, std::any value) {
+    const auto& name = expr.name().lexeme;
+    auto& shape = instance.shape();
+
+    auto entry = expr.cache().find(shape.id());
+    if (!entry) {
+        auto offset = shape.find(name);
+        entry = offset ? InlineCache::Entry{.kind = InlineCache::Kind::FIELD, .index = *offset}
+                       : InlineCache::Entry{.kind = InlineCache::Kind::TRANSITION, .index = shape.size()};
+        expr.cache().add(shape.id(), *entry);
+    }
+
+    if (entry->kind == InlineCache::Kind::FIELD) {
+        instance.field(entry->index) = std::move(value);
+    } else {
+        instance.add(shape.transition(name), std::move(value));
+    }
+}
+
+void Interpreter::subscript(const Token& bracket, const std::any& object) {
+    if (object.type() != typeid(Array*) && object.type() != typeid(Map*)) {
+        throw RuntimeError(bracket, "Only arrays and maps can be indexed.");
+    }
+}
+
+void Interpreter::checkIndex(const Token& bracket, const std::any& object, const std::any& index) {
+    if (const auto* array = std::any_cast<Array*>(&object)) {
+        (void)offset(bracket, **array, index);
+    } else if (!Map::hashable(index)) {
+        throw RuntimeError(bracket, "Map keys must not be nil or NaN.");
+    }
+}
+
+[[nodiscard]] std::any Interpreter::load(const Token& bracket, const std::any& object, const std::any& index) {
+    if (const auto* array = std::any_cast<Array*>(&object)) {
+        return (*array)->values()[offset(bracket, **array, index)];
+    }
+
+    const auto* value = std::any_cast<Map*>(object)->get(index);
+    return value != nullptr ? *value : std::any(std::monostate{});
+}
+
+std::any Interpreter::store(Heap& heap, const Token& bracket, const std::any& object, const std::any& index,
+                            std::any value) {
+    if (const auto* array = std::any_cast<Array*>(&object)) {
+        auto number = element(bracket, value);
+        (*array)->values()[offset(bracket, **array, index)] = number;
+        return number;
+    }
+
+    std::any_cast<Map*>(object)->set(heap, index, value);
+    return value;
+}
+
+[[nodiscard]] std::size_t Interpreter::offset(const Token& bracket, const Array& array, const std::any& index) {
+    const auto* number = std::any_cast<double>(&index);
+    if (number == nullptr || std::trunc(*number) != *number) {
+        throw RuntimeError(bracket, "Index must be an integer.");
+    }
+    if (*number < 0 || *number >= static_cast<double>(array.length())) {
+        throw RuntimeError(bracket, "Index out of bounds.");
+    }
+
+    return static_cast<std::size_t>(*number);
+}
+
+[[nodiscard]] Closure* Interpreter::superMethod(const Super& expr) const {
+    // Methods and the functions nested in them know their class; the resolver rejects `super` anywhere else.
+    if (m_closure == nullptr || m_closure->home() == nullptr) {
+        throw RuntimeError(expr.keyword(), "Can't use 'super' outside of a class.");
+    }
+
+    const auto& home = *m_closure->home();
+    const auto& superclass = *home.superclass();
+
+    auto entry = expr.cache().find(home.id());
+    if (!entry) {
+        auto index = superclass.find(expr.method().lexeme);
+        if (!index) {
+            throw RuntimeError(expr.method(), std::format("Undefined property '{}'.", expr.method().lexeme));
+        }
+
+        entry = InlineCache::Entry{.kind = InlineCache::Kind::METHOD, .index = *index};
+        expr.cache().add(home.id(), *entry);
+    }
+
+    return superclass.method(entry->index);
+}
+
+[[nodiscard]] std::any Interpreter::boundSuperMethod(const Super& expr) {
+    auto* method = superMethod(expr);
+    const auto& receiver = variable(expr.keyword(), expr.binding());
+
+    return m_heap.make<BoundMethod>(*std::any_cast<Instance*>(&receiver), method);
+}
+
+[[nodiscard]] InlineCache::Entry Interpreter::findProperty(const InlineCache& cache, const Token& name,
+                                                           const Instance& instance) {
+    const auto& shape = instance.shape();
+    if (auto entry = cache.find(shape.id())) {
+        return *entry;
+    }
+
+    // Fields shadow methods.
+    InlineCache::Entry entry{};
+    if (auto offset = shape.find(name.lexeme)) {
+        entry = {.kind = InlineCache::Kind::FIELD, .index = *offset};
+    } else if (auto index = instance.klass().find(name.lexeme)) {
+        entry = {.kind = InlineCache::Kind::METHOD, .index = *index};
+    } else {
+        throw RuntimeError(name, std::format("Undefined property '{}'.", name.lexeme));
+    }
+
+    cache.add(shape.id(), entry);
+    return entry;
+}
+
+void Interpreter::promote(const Expr& expr) {
+    // The subtree belongs to the program declaring the running closure, if any, which may be an earlier one.
+    const auto& owner = m_closure != nullptr ? m_closure->program() : m_root;
+
+    // Tall subtrees would make the compiler and the compiled closures recurse just as deep.
+    if (!owner || m_recorder || expr.height() > RECURSION_HEIGHT || !expr.tier().tryQueue()) {
+        return;
+    }
+
+    // Share ownership of the whole tree, so the subtree outlives its compilation.
+    m_tierCompiler.enqueue(std::shared_ptr<const Expr>(owner, &expr), m_profile);
+}
+
+[[nodiscard]] std::any Interpreter::evalDeep(const Expr& expr) {
+    StackWalker walker(*this, m_recorder.get(), m_maxDepth);
+
+    m_operandStacks.push_back(&walker.values());
+    try {
+        auto result = walker.run(expr);
+        m_operandStacks.pop_back();
+
+        return result;
+    } catch (...) {
+        m_operandStacks.pop_back();
+        throw;
+    }
+}
+
+void Interpreter::visitIfStmt(const If& stmt) {
+    if (isTruthy(eval(stmt.condition()))) {
+        execute(stmt.thenBranch());
+    } else if (const auto* elseBranch = stmt.elseBranch()) {
+        execute(*elseBranch);
+    }
+}
+
+void Interpreter::visitPrintStmt(const Print& stmt) {
+    auto value = eval(stmt.expression());
+    write(m_output, value);
+    m_output.put('\n');
+}
+
+void Interpreter::visitSpawnStmt(const Spawn& stmt) {
+    auto* scheduler = Scheduler::current();
+    if (scheduler == nullptr) {
+        throw RuntimeError(stmt.keyword(), "Can only spawn tasks from a script.");
+    }
+
+    // The callee and arguments stay on the stack, reachable, until they are copied.
+    const auto& call = stmt.call();
+    const auto& paren = call.paren();
+    auto base = m_top;
+    push(paren, eval(call.callee()));
+    for (const auto& argument : call.arguments()) {
+        push(paren, eval(*argument));
+    }
+
+    const auto* closure = std::any_cast<Closure*>(&m_stack[base]);
+    if (closure == nullptr) {
+        throw RuntimeError(paren, "Can only spawn functions.");
+    }
+
+    const auto& function = (*closure)->function();
+    if (!function.captures().empty()) {
+        throw RuntimeError(paren, "Can only spawn functions that capture no local variables.");
+    }
+
+    auto arity = m_top - base - 1;
+    if (arity != function.params().size()) {
+        throw RuntimeError(paren, std::format("Expected {} arguments but got {}.", function.params().size(), arity));
+    }
+
+    std::vector<Message> arguments;
+    arguments.reserve(arity);
+    try {
+        for (auto slot = base + 1; slot < m_top; slot++) {
+            arguments.push_back(Message::pack(m_stack[slot]));
+        }
+    } catch (const NativeError& error) {
+        throw RuntimeError(paren, error.what());
+    }
+
+    auto program = (*closure)->program();
+    m_top = base;
+    scheduler->spawn(std::move(program), function, paren, std::move(arguments));
+}
+
+void Interpreter::visitClassStmt(const Class& stmt) {
+    ClassObject* superclass = nullptr;
+    if (const auto* variable = stmt.superclass()) {
+        auto value = eval(*variable);
+        const auto* klass = std::any_cast<ClassObject*>(&value);
+        if (klass == nullptr) {
+            throw RuntimeError(variable->name(), "Superclass must be a class.");
+        }
+
+        superclass = *klass;
+    }
+
+    // As for functions, the cell comes first, so that methods capturing the class name see the class.
+    const auto& binding = stmt.binding();
+    Cell* cell = nullptr;
+    if (binding.kind == Binding::Kind::CELL) {
+        cell = m_heap.make<Cell>(std::monostate{});
+        m_stack[m_base + binding.slot] = cell;
+    }
+
+    auto* klass = m_heap.make<ClassObject>(stmt.name().lexeme, superclass);
+    for (const auto& method : stmt.methods()) {
+        klass->define(closure(*method, klass));
+    }
+
+    if (cell != nullptr) {
+        cell->value() = klass;
+    } else {
+        declare(stmt.name(), binding, klass);
+    }
+}
+
+void Interpreter::visitFunctionStmt(const Function& stmt) {
+    const auto* home = m_closure != nullptr ? m_closure->home() : nullptr;
+
+    const auto& binding = stmt.binding();
+    if (binding.kind != Binding::Kind::CELL) {
+        declare(stmt.name(), binding, closure(stmt, home));
+        return;
+    }
+
+    // The cell comes first, so that a local function capturing its own name sees itself.
+    auto* cell = m_heap.make<Cell>(std::monostate{});
+    m_stack[m_base + binding.slot] = cell;
+    cell->value() = closure(stmt, home);
+}
+
+void Interpreter::visitVarStmt(const Var& stmt) {
+    std::any value = std::monostate{};
+    if (const auto* initializer = stmt.initializer()) {
+        value = eval(*initializer);
+    }
+
+    declare(stmt.name(), stmt.binding(), std::move(value));
+}
+
+void Interpreter::visitArrayLiteralExpr(const ArrayLit& expr) {
+    auto* array = m_heap.make<Array>(expr.elements().size());
+    auto pinned = pin(expr.bracket(), array);
+    auto values = array->values();
+    for (std::size_t i = 0; i < values.size(); i++) {
+        values[i] = element(expr.bracket(), eval(*expr.elements()[i]));
+    }
+    unpin(pinned);
+
+    m_result = array;
 }
 
 void Interpreter::visitLiteralExpr(const Lit& expr) {
+    if (const auto* string = std::get_if<std::string>(&expr.value())) {
+        m_result = m_heap.make<String>(*string);
+        return;
+    }
+
     m_result = std::visit([](auto&& v) -> std::any { return v; }, expr.value());
 }
 
 void Interpreter::visitUnaryExpr(const Unary& expr) {
     auto right = eval(expr.right());
 
-    switch (expr.op().type) {
-    case TokenType::MINUS: {
-        checkNumberOperand(expr.op(), right);
-        auto value = std::any_cast<double>(right);
-        m_result = -value;
+    if (m_recorder) {
+        m_recorder->record(expr.op(), right);
+    }
 
-        break;
+    m_result = unary(expr.op(), right);
+}
+
+void Interpreter::visitBinaryExpr(const Binary& expr) {
+    auto left = eval(expr.left());
+    auto pinned = pin(expr.op(), left);
+    auto right = eval(expr.right());
+    unpin(pinned);
+
+    if (m_recorder) {
+        m_recorder->record(expr.op(), left, right);
     }
-    case TokenType::BANG: {
-        m_result = !isTruthy(right);
 
-        break;
+    m_result = binary(m_heap, expr.op(), left, right);
+}
+
+void Interpreter::visitCallExpr(const Call& expr) {
+    const auto& paren = expr.paren();
+    auto arity = static_cast<std::uint32_t>(expr.arguments().size());
+
+    // Methods called right away are not bound, their receiver goes straight to the stack.
+    std::any callee;
+    const Closure* method = nullptr;
+    if (const auto* get = expr.method()) {
+        callee = eval(get->object());
+        method = prepareInvoke(*get, paren, callee);
+    } else if (const auto* super = expr.superMethod()) {
+        method = &prepareInvoke(*super, paren);
+    } else {
+        callee = eval(expr.callee());
+        pushCallee(paren, callee);
     }
-    default: // Unreachable.
-        m_result = std::monostate{};
 
+    for (const auto& argument : expr.arguments()) {
+        push(paren, eval(*argument));
+    }
+
+    m_result = method != nullptr ? call(paren, *method, arity) : call(paren, callee, arity);
+}
+
+void Interpreter::declare(const Token& name, const Binding& binding, std::any value) {
+    switch (binding.kind) {
+    case Binding::Kind::LOCAL:
+        m_stack[m_base + binding.slot] = std::move(value);
+        break;
+    case Binding::Kind::CELL:
+        m_stack[m_base + binding.slot] = m_heap.make<Cell>(std::move(value));
+        break;
+    case Binding::Kind::GLOBAL:
+        *(*m_globalSlots)[binding.slot] = std::move(value);
+        break;
+    default:
+        define(name.lexeme, std::move(value));
         break;
     }
 }
 
-void Interpreter::visitBinaryExpr(const Binary& expr) {
-    auto left = eval(expr.left());
-    auto right = eval(expr.right());
+[[nodiscard]] Closure* Interpreter::closure(const Function& stmt, const ClassObject* home) {
+    std::vector<Cell*> upvalues;
+    upvalues.reserve(stmt.captures().size());
+    for (const auto& capture : stmt.captures()) {
+        upvalues.push_back(capture.local ? *std::any_cast<Cell*>(&m_stack[m_base + capture.index])
+                                         : m_closure->upvalue(capture.index));
+    }
 
-    switch (expr.op().type) {
-    case TokenType::PLUS: {
-        if (left.type() == typeid(double) && right.type() == typeid(double)) {
-            m_result = std::any_cast<double>(left) + std::any_cast<double>(right);
-        } else if (left.type() == typeid(std::string) && right.type() == typeid(std::string)) {
-            m_result = std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
-        } else {
-            throw RuntimeError(expr.op(), "Operands must be two numbers or two strings.");
+    // The running code may belong to a closure declared by an earlier program, as on the lines of the REPL.
+    const auto& program = m_closure != nullptr ? m_closure->program() : m_root;
+    const auto& globals = m_closure != nullptr ? m_closure->globals() : m_programGlobals;
+
+    return m_heap.make<Closure>(program, stmt, globals, std::move(upvalues), home);
+}
+
+void Interpreter::collect() {
+    m_heap.collect([this](Heap& heap) {
+        for (std::uint32_t slot = 0; slot < m_top; slot++) {
+            heap.mark(m_stack[slot]);
+        }
+        for (const auto& [name, value] : m_globals) {
+            heap.mark(value);
+        }
+        for (const auto* values : m_operandStacks) {
+            for (const auto& value : *values) {
+                heap.mark(value);
+            }
         }
 
-        break;
+        heap.mark(m_result);
+        heap.mark(m_returnValue);
+        heap.mark(m_closure);
+    });
+}
+
+void Interpreter::unwind() noexcept {
+    m_closure = nullptr;
+    m_base = 0;
+    m_top = m_root ? m_root->slots() : 0;
+    m_calls = 0;
+    m_globalSlots = m_programGlobals.get();
+    m_returning = false;
+}
+
+[[nodiscard]] const std::any& Interpreter::lookup(const Token& name) const {
+    if (auto it = m_globals.find(name.lexeme); it != m_globals.end() && it->second.has_value()) {
+        return it->second;
+    }
+
+    throw undefined(name);
+}
+
+[[nodiscard]] std::any& Interpreter::lookup(const Token& name) {
+    if (auto it = m_globals.find(name.lexeme); it != m_globals.end() && it->second.has_value()) {
+        return it->second;
+    }
+
+    throw undefined(name);
+}
+
+[[nodiscard]] RuntimeError Interpreter::undefined(const Token& name) {
+    return {name, std::format("Undefined variable '{}'.", name.lexeme)};
+}
+
+[[nodiscard]] std::any Interpreter::unary(const Token& op, const std::any& right) {
+    switch (op.type) {
+    case TokenType::MINUS:
+        checkNumberOperand(op, right);
+
+        return -std::any_cast<double>(right);
+    case TokenType::BANG:
+        return !isTruthy(right);
+    default: // Unreachable.
+        return std::monostate{};
     }
+}
+
+[[nodiscard]] std::any Interpreter::binary(Heap& heap, const Token& op, const std::any& left,
+                                           const std::any& right) {
+    // Arithmetic on two arrays applies element by element.
+    if (const auto* a = std::any_cast<Array*>(&left)) {
+        const auto* b = std::any_cast<Array*>(&right);
+        if (b != nullptr && (op.type == TokenType::PLUS || op.type == TokenType::MINUS || op.type == TokenType::STAR ||
+                             op.type == TokenType::SLASH)) {
+            return elementwise(heap, op, **a, **b);
+        }
+    }
+
+    switch (op.type) {
+    case TokenType::PLUS:
+        if (left.type() == typeid(double) && right.type() == typeid(double)) {
+            return std::any_cast<double>(left) + std::any_cast<double>(right);
+        }
+        if (left.type() == typeid(String*) && right.type() == typeid(String*)) {
+            return String::concat(heap, std::any_cast<String*>(left), std::any_cast<String*>(right));
+        }
+
+        throw RuntimeError(op, "Operands must be two numbers or two strings.");
     case TokenType::MINUS:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) - std::any_cast<double>(right);
+        checkNumberOperands(op, left, right);
 
-        break;
+        return std::any_cast<double>(left) - std::any_cast<double>(right);
     case TokenType::STAR:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) * std::any_cast<double>(right);
+        checkNumberOperands(op, left, right);
 
-        break;
+        return std::any_cast<double>(left) * std::any_cast<double>(right);
     case TokenType::SLASH:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) / std::any_cast<double>(right);
-
-        break;
+        checkNumberOperands(op, left, right);
 
+        return std::any_cast<double>(left) / std::any_cast<double>(right);
     case TokenType::GREATER:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) > std::any_cast<double>(right);
-
-        break;
+        checkNumberOperands(op, left, right);
 
+        return std::any_cast<double>(left) > std::any_cast<double>(right);
     case TokenType::GREATER_EQUAL:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) >= std::any_cast<double>(right);
-
-        break;
+        checkNumberOperands(op, left, right);
 
+        return std::any_cast<double>(left) >= std::any_cast<double>(right);
     case TokenType::LESS:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) < std::any_cast<double>(right);
-
-        break;
+        checkNumberOperands(op, left, right);
 
+        return std::any_cast<double>(left) < std::any_cast<double>(right);
     case TokenType::LESS_EQUAL:
-        checkNumberOperands(expr.op(), left, right);
-        m_result = std::any_cast<double>(left) <= std::any_cast<double>(right);
-
-        break;
+        checkNumberOperands(op, left, right);
 
+        return std::any_cast<double>(left) <= std::any_cast<double>(right);
     case TokenType::BANG_EQUAL:
-        m_result = !isEqual(left, right);
-
-        break;
+        return !isEqual(left, right);
     case TokenType::EQUAL_EQUAL:
-        m_result = isEqual(left, right);
-
-        break;
-    default:
-        // Handle error for unsupported binary operator
-        break;
+        return isEqual(left, right);
+    default: // Unreachable.
+        return std::monostate{};
     }
 }
 
@@ -160,8 +1506,32 @@ void Interpreter::visitBinaryExpr(const Binary& expr) {
     if (a.type() == typeid(bool)) {
         return std::any_cast<bool>(a) == std::any_cast<bool>(b);
     }
-    if (a.type() == typeid(std::string)) {
-        return std::any_cast<std::string>(a) == std::any_cast<std::string>(b);
+    if (a.type() == typeid(String*)) {
+        return std::any_cast<String*>(a)->equals(*std::any_cast<String*>(b));
+    }
+    if (a.type() == typeid(Closure*)) {
+        return std::any_cast<Closure*>(a) == std::any_cast<Closure*>(b);
+    }
+    if (a.type() == typeid(Instance*)) {
+        return std::any_cast<Instance*>(a) == std::any_cast<Instance*>(b);
+    }
+    if (a.type() == typeid(ClassObject*)) {
+        return std::any_cast<ClassObject*>(a) == std::any_cast<ClassObject*>(b);
+    }
+    if (a.type() == typeid(BoundMethod*)) {
+        return std::any_cast<BoundMethod*>(a) == std::any_cast<BoundMethod*>(b);
+    }
+    if (a.type() == typeid(Native*)) {
+        return std::any_cast<Native*>(a) == std::any_cast<Native*>(b);
+    }
+    if (a.type() == typeid(Array*)) {
+        return std::any_cast<Array*>(a) == std::any_cast<Array*>(b);
+    }
+    if (a.type() == typeid(Map*)) {
+        return std::any_cast<Map*>(a) == std::any_cast<Map*>(b);
+    }
+    if (a.type() == typeid(Channel*)) {
+        return std::any_cast<Channel*>(a) == std::any_cast<Channel*>(b);
     }
 
     // Unknown type - can't compare
@@ -173,14 +1543,95 @@ void Interpreter::visitBinaryExpr(const Binary& expr) {
         return "nil";
     }
     if (value.type() == typeid(double)) {
-        return std::format("{:g}", std::any_cast<double>(value));
+        char buffer[OutputSink::NUMBER_SIZE];
+
+        return {buffer, OutputSink::formatNumber(buffer, std::any_cast<double>(value))};
     }
     if (value.type() == typeid(bool)) {
         return std::any_cast<bool>(value) ? "true" : "false";
     }
-    if (value.type() == typeid(std::string)) {
-        return std::any_cast<std::string>(value);
+    if (const auto* string = std::any_cast<String*>(&value)) {
+        return (*string)->value();
+    }
+    if (const auto* closure = std::any_cast<Closure*>(&value)) {
+        return std::format("<fn {}>", (*closure)->function().name().lexeme);
+    }
+    if (const auto* instance = std::any_cast<Instance*>(&value)) {
+        return std::format("{} instance", (*instance)->klass().name());
+    }
+    if (const auto* klass = std::any_cast<ClassObject*>(&value)) {
+        return (*klass)->name();
+    }
+    if (const auto* bound = std::any_cast<BoundMethod*>(&value)) {
+        return std::format("<fn {}>", (*bound)->method().function().name().lexeme);
+    }
+    if (const auto* native = std::any_cast<Native*>(&value)) {
+        return std::format("<native fn {}>", (*native)->function().name);
+    }
+    if (const auto* array = std::any_cast<Array*>(&value)) {
+        std::string text = "[";
+        auto values = (*array)->values();
+        for (std::size_t i = 0; i < values.size(); i++) {
+            char buffer[OutputSink::NUMBER_SIZE];
+            text.append(i > 0 ? ", " : "").append(buffer, OutputSink::formatNumber(buffer, values[i]));
+        }
+
+        return text + "]";
+    }
+    if (value.type() == typeid(Map*)) {
+        StringSink sink;
+        write(sink, value);
+        return sink.take();
+    }
+    if (value.type() == typeid(Channel*)) {
+        return "<channel>";
     }
 
     return "unknown";
 }
+
+void Interpreter::write(OutputSink& sink, const std::any& value) {
+    if (const auto* number = std::any_cast<double>(&value)) {
+        sink.writeNumber(*number);
+    } else if (const auto* boolean = std::any_cast<bool>(&value)) {
+        sink.writeBool(*boolean);
+    } else if (const auto* string = std::any_cast<String*>(&value)) {
+        sink.write((*string)->value());
+    } else if (value.type() == typeid(std::monostate)) {
+        sink.write("nil");
+    } else if (const auto* closure = std::any_cast<Closure*>(&value)) {
+        sink.write("<fn ");
+        sink.write((*closure)->function().name().lexeme);
+        sink.put('>');
+    } else if (const auto* instance = std::any_cast<Instance*>(&value)) {
+        sink.write((*instance)->klass().name());
+        sink.write(" instance");
+    } else if (const auto* klass = std::any_cast<ClassObject*>(&value)) {
+        sink.write((*klass)->name());
+    } else if (const auto* bound = std::any_cast<BoundMethod*>(&value)) {
+        sink.write("<fn ");
+        sink.write((*bound)->method().function().name().lexeme);
+        sink.put('>');
+    } else if (const auto* native = std::any_cast<Native*>(&value)) {
+        sink.write("<native fn ");
+        sink.write((*native)->function().name);
+        sink.put('>');
+    } else if (const auto* array = std::any_cast<Array*>(&value)) {
+        sink.put('[');
+        auto values = (*array)->values();
+        for (std::size_t i = 0; i < values.size(); i++) {
+            if (i > 0) {
+                sink.write(", ");
+            }
+            sink.writeNumber(values[i]);
+        }
+        sink.put(']');
+    } else if (const auto* map = std::any_cast<Map*>(&value)) {
+        std::vector<const Map*> open;
+        writeMap(sink, **map, open);
+    } else if (value.type() == typeid(Channel*)) {
+        sink.write("<channel>");
+    } else {
+        sink.write("unknown");
+    }
+}
@@ -1,6 +1,112 @@
+#include "allocator.h"
+#include "profiler.h"
+#include "runner.h"
 #include "tox.h"
+#include "trace.h"
 
 #include <CLI/CLI.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <print>
+#include <string>
+#include <vector>
+
+// Route every allocation of the executable through the memory scope of the running phase, for --mem-stats. This
+// costs each allocation a 16-byte header and a thread-local lookup, with or without --mem-stats.
+void* operator new(std::size_t size) {
+    return MemoryScope::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return MemoryScope::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+    try {
+        return MemoryScope::allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& /*tag*/) noexcept {
+    try {
+        return MemoryScope::allocate(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* block) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete[](void* block) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete(void* block, std::size_t /*size*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete[](void* block, std::size_t /*size*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete(void* block, const std::nothrow_t& /*tag*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t& /*tag*/) noexcept {
+    MemoryScope::deallocate(block);
+}
+
+namespace {
+
+// Exit code for a profile, sample, trace or script list that cannot be read or written, as sysexits' EX_IOERR.
+constexpr int EXIT_IO_ERROR = 74;
+
+/**
+ * Runs scripts concurrently, then prints their output in order and a throughput summary.
+ *
+ * @param scripts Paths of the scripts.
+ * @param jobs Number of scripts run at once, 0 for one per hardware thread.
+ * @param maxDepth Maximum nesting depth of evaluated expressions, 0 for the default.
+ * @param tracer Recorder receiving the phases of each script, may be null.
+ * @return 0 if every script succeeded, otherwise the highest exit code.
+ */
+int runScripts(const std::vector<std::string>& scripts, std::size_t jobs, std::uint32_t maxDepth,
+               TraceRecorder* tracer) {
+    ScriptRunner runner(jobs);
+    runner.setMaxDepth(maxDepth);
+    runner.setTracer(tracer);
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = runner.run(scripts);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::size_t failed = 0;
+    for (const auto& result : results) {
+        std::print("{}", result.output);
+        std::print(stderr, "{}", result.errors);
+
+        if (result.exitCode != 0) {
+            failed++;
+        }
+    }
+
+    std::println(stderr, "Ran {} scripts ({} failed) in {:.3f}s on {} threads: {:.0f} scripts/s", results.size(),
+                 failed, elapsed.count(), runner.jobs(), static_cast<double>(results.size()) / elapsed.count());
+
+    return ScriptRunner::exitCode(results);
+}
+
+} // namespace
 
 /**
  * Main entry point.
@@ -8,15 +114,160 @@
 int main(int argc, char* argv[]) {
     CLI::App app{"Tox - A typed Lox implementation"};
 
-    std::string script;
-    app.add_option("script", script, "Script file to run")->check(CLI::ExistingFile);
+    std::vector<std::string> scripts;
+    app.add_option("scripts", scripts, "Script files to run")->check(CLI::ExistingFile);
+
+    std::size_t jobs = 0;
+    auto* jobsOption =
+        app.add_option("-j,--jobs", jobs, "Run the scripts concurrently on N threads (0: one per hardware thread)");
+
+    std::string list;
+    app.add_option("--list", list, "File naming scripts to run concurrently, one per line")
+        ->check(CLI::ExistingFile);
+
+    std::string profileIn;
+    app.add_option("--profile-in", profileIn, "Type-feedback profile to pre-specialize from")
+        ->check(CLI::ExistingFile);
+
+    std::string profileOut;
+    app.add_option("--profile-out", profileOut, "Write observed operand types to a profile file");
+
+    std::uint32_t maxDepth = 0;
+    app.add_option("--max-depth", maxDepth, "Maximum nesting depth of evaluated expressions")
+        ->check(CLI::PositiveNumber);
+
+    bool profile = false;
+    app.add_flag("--profile", profile, "Print execution counts and timings per phase, node kind and operator at exit");
+
+    std::string sample;
+    app.add_option("--sample", sample, "Sample the evaluated operators and write folded stacks for flame graphs");
+
+    std::string trace;
+    app.add_option("--trace", trace, "Write a Chrome trace of each script's scan, parse and eval phases");
+
+    bool memStats = false;
+    app.add_flag("--mem-stats", memStats,
+                 "Print allocation counts, bytes and peaks per phase at exit (counting costs even without it)");
+
+    double gcGrowth = 0;
+    app.add_option("--gc-growth", gcGrowth, "Heap growth factor between collections (default 2)")
+        ->check(CLI::PositiveNumber);
+
+    bool gcStress = false;
+    app.add_flag("--gc-stress", gcStress,
+                 "Collect the heap at every statement after an allocation, to test the collector");
+
+    bool gcStats = false;
+    app.add_flag("--gc-stats", gcStats, "Print collection counts, live and peak heap bytes and pauses at exit");
+
+    bool deterministic = false;
+    app.add_flag("--deterministic", deterministic,
+                 "Run spawned tasks one at a time on the main thread, in a reproducible order");
+
+    bool emitCpp = false;
+    app.add_flag("--emit-cpp", emitCpp,
+                 "Translate a script made of a single expression to C++ and write it to stdout");
 
     CLI11_PARSE(app, argc, argv);
 
-    Tox tox;
-    if (!script.empty()) {
-        return tox.runFile(script);
-    }
+    // Profiles, samples and traces that cannot be read or written, and unreadable script lists, end the run.
+    try {
+        std::unique_ptr<TraceRecorder> tracer;
+        if (!trace.empty()) {
+            tracer = std::make_unique<TraceRecorder>();
+        }
 
-    return tox.repl();
+        if (jobsOption->count() > 0 || !list.empty() || scripts.size() > 1) {
+            if (emitCpp || profile || memStats || !sample.empty() || !profileIn.empty() || !profileOut.empty() ||
+                gcGrowth > 0 || gcStress || gcStats || deterministic) {
+                std::println(stderr, "--emit-cpp, profiles, sampling, memory statistics, heap options and "
+                                     "--deterministic require a single script");
+
+                return 2;
+            }
+
+            if (!list.empty()) {
+                auto listed = ScriptRunner::readList(list);
+                scripts.insert(scripts.end(), listed.begin(), listed.end());
+            }
+
+            int code = runScripts(scripts, jobs, maxDepth, tracer.get());
+            if (tracer) {
+                tracer->save(trace);
+            }
+
+            return code;
+        }
+
+        std::string script = scripts.empty() ? "" : scripts.front();
+
+        if (profile && !sample.empty()) {
+            std::println(stderr, "--profile and --sample cannot be combined");
+
+            return 2;
+        }
+
+        Tox tox;
+        if (emitCpp) {
+            if (script.empty()) {
+                std::println(stderr, "--emit-cpp requires a script");
+
+                return 2;
+            }
+
+            return tox.emitCpp(script);
+        }
+
+        if (profile) {
+            tox.enableProfiling();
+        }
+        if (!sample.empty()) {
+            tox.enableSampling();
+        }
+        if (maxDepth > 0) {
+            tox.setMaxDepth(maxDepth);
+        }
+        if (gcGrowth > 0) {
+            tox.setHeapGrowth(gcGrowth);
+        }
+        tox.setHeapStress(gcStress);
+        tox.setDeterministic(deterministic);
+        tox.setTracer(tracer.get());
+        if (!profileIn.empty()) {
+            tox.loadProfile(profileIn);
+        }
+        if (!profileOut.empty()) {
+            tox.recordProfile();
+        }
+
+        int code = !script.empty() ? tox.runFile(script) : tox.repl();
+
+        if (!profileOut.empty()) {
+            tox.saveProfile(profileOut);
+        }
+        if (!sample.empty()) {
+            tox.saveSamples(sample);
+        }
+        if (tracer) {
+            tracer->save(trace);
+        }
+        if (const auto* execution = tox.executionProfile()) {
+            std::cerr << '\n';
+            execution->print(std::cerr);
+        }
+        if (memStats) {
+            std::cerr << '\n';
+            tox.memoryStats().print(std::cerr);
+        }
+        if (gcStats) {
+            std::cerr << '\n';
+            tox.heapStats().print(std::cerr);
+        }
+
+        return code;
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+
+        return EXIT_IO_ERROR;
+    }
 }
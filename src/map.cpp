@@ -0,0 +1,311 @@
+#include "map.h"
+
+#include "text.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <typeinfo>
+#include <variant>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TOX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/**
+ * Control byte of a slot never used, which ends a probe.
+ */
+constexpr std::int8_t EMPTY = -128;
+
+/**
+ * Control byte of a slot whose key was deleted, which a probe goes past.
+ */
+constexpr std::int8_t DELETED = -2;
+
+/**
+ * Number of bits of the hash a control byte holds. The others select the first group of a probe.
+ */
+constexpr std::uint64_t CONTROL_BITS = 7;
+
+/**
+ * Mask of the bits of the hash a control byte holds.
+ */
+constexpr std::uint64_t CONTROL_MASK = (std::uint64_t{1} << CONTROL_BITS) - 1;
+
+/**
+ * Maximum load of the table, in eighths: slots holding a key or a tombstone before it is rebuilt.
+ */
+constexpr std::size_t MAX_LOAD = 7;
+
+/**
+ * Mix the bits of a word so that each bit of the result depends on all of them, with the finalizer of
+ * MurmurHash3. Numbers that differ only in their high bits, such as consecutive integers, then spread over
+ * both the groups and the control bytes.
+ *
+ * @param bits The word.
+ * @return The mixed word.
+ */
+constexpr std::uint64_t mix(std::uint64_t bits) noexcept {
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+
+    return bits;
+}
+
+/**
+ * Get the control byte of a key.
+ *
+ * @param hash Hash of the key.
+ * @return The low bits of the hash.
+ */
+constexpr std::int8_t tag(std::uint64_t hash) noexcept {
+    return static_cast<std::int8_t>(hash & CONTROL_MASK);
+}
+
+/**
+ * Find the slots of a group whose control byte is a given one.
+ *
+ * @param group The control bytes of the group.
+ * @param byte The control byte to look for.
+ * @return A mask with bit i set if slot i of the group matches.
+ */
+std::uint32_t match(const std::int8_t* group, std::int8_t byte) noexcept {
+#ifdef TOX_SSE2
+    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte))));
+#else
+    std::uint32_t bits = 0;
+    for (std::size_t i = 0; i < Map::GROUP_WIDTH; i++) {
+        bits |= static_cast<std::uint32_t>(group[i] == byte) << i;
+    }
+
+    return bits;
+#endif
+}
+
+/**
+ * Find the free slots of a group, empty or deleted, the only ones whose control byte has its high bit set.
+ *
+ * @param group The control bytes of the group.
+ * @return A mask with bit i set if slot i of the group is free.
+ */
+std::uint32_t matchFree(const std::int8_t* group) noexcept {
+#ifdef TOX_SSE2
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+#else
+    std::uint32_t bits = 0;
+    for (std::size_t i = 0; i < Map::GROUP_WIDTH; i++) {
+        bits |= static_cast<std::uint32_t>(group[i] < 0) << i;
+    }
+
+    return bits;
+#endif
+}
+
+/**
+ * Compare two keys as `==` does.
+ *
+ * @param a The first key.
+ * @param b The second key.
+ * @return True if the keys are equal.
+ */
+bool same(const std::any& a, const std::any& b) {
+    if (a.type() != b.type()) {
+        return false;
+    }
+    if (const auto* number = std::any_cast<double>(&a)) {
+        return *number == std::any_cast<double>(b);
+    }
+    if (const auto* boolean = std::any_cast<bool>(&a)) {
+        return *boolean == std::any_cast<bool>(b);
+    }
+    if (const auto* string = std::any_cast<String*>(&a)) {
+        return (*string)->equals(*std::any_cast<String*>(b));
+    }
+
+    return Heap::object(a) == Heap::object(b);
+}
+
+} // namespace
+
+[[nodiscard]] bool Map::hashable(const std::any& key) noexcept {
+    if (const auto* number = std::any_cast<double>(&key)) {
+        return !std::isnan(*number);
+    }
+
+    return key.has_value() && key.type() != typeid(std::monostate);
+}
+
+[[nodiscard]] std::uint64_t Map::hash(const std::any& key) {
+    if (const auto* number = std::any_cast<double>(&key)) {
+        return mix(std::bit_cast<std::uint64_t>(*number == 0 ? 0.0 : *number));
+    }
+    if (const auto* string = std::any_cast<String*>(&key)) {
+        return (*string)->hash();
+    }
+    if (const auto* boolean = std::any_cast<bool>(&key)) {
+        return mix(*boolean ? 2 : 1);
+    }
+
+    return mix(reinterpret_cast<std::uintptr_t>(Heap::object(key)));
+}
+
+[[nodiscard]] const std::any* Map::get(const std::any& key) const {
+    if (!hashable(key)) {
+        return nullptr;
+    }
+
+    auto slot = find(key, hash(key));
+    return slot < slots() ? &m_entries[entry(slot)].value : nullptr;
+}
+
+void Map::set(Heap& heap, const std::any& key, std::any value) {
+    auto hash = Map::hash(key);
+    if (auto slot = find(key, hash); slot < slots()) {
+        m_entries[entry(slot)].value = std::move(value);
+        return;
+    }
+
+    auto before = size();
+
+    // Tombstones still hold their slot, so every entry counts against the load.
+    if ((m_entries.size() + 1) * 8 > slots() * MAX_LOAD) {
+        rehash();
+    }
+
+    auto slot = vacancy(hash);
+    control(slot) = tag(hash);
+    entry(slot) = static_cast<std::uint32_t>(m_entries.size());
+    m_entries.push_back(Entry{.key = key, .value = std::move(value)});
+    m_length++;
+
+    if (auto after = size(); after > before) {
+        heap.account(after - before);
+    }
+}
+
+bool Map::remove(const std::any& key) {
+    if (!hashable(key)) {
+        return false;
+    }
+
+    auto slot = find(key, hash(key));
+    if (slot == slots()) {
+        return false;
+    }
+
+    auto& removed = m_entries[entry(slot)];
+    m_removed = std::move(removed.key);
+    m_afterRemoved = entry(slot) + 1;
+    removed.key.reset();
+    removed.value.reset();
+    control(slot) = DELETED;
+    m_length--;
+
+    return true;
+}
+
+[[nodiscard]] std::optional<std::any> Map::next(const std::any& key) const {
+    std::size_t position = 0;
+    if (key.type() != typeid(std::monostate)) {
+        auto slot = hashable(key) ? find(key, hash(key)) : slots();
+        if (slot < slots()) {
+            position = entry(slot) + 1;
+        } else if (m_removed.has_value() && same(m_removed, key)) {
+            position = m_afterRemoved;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    for (; position < m_entries.size(); position++) {
+        if (m_entries[position].key.has_value()) {
+            return m_entries[position].key;
+        }
+    }
+
+    return std::any(std::monostate{});
+}
+
+void Map::trace(Heap& heap) const {
+    forEach([&](const std::any& key, const std::any& value) {
+        heap.mark(key);
+        heap.mark(value);
+    });
+
+    // next() compares against the key last deleted, which must not be freed meanwhile.
+    if (m_removed.has_value()) {
+        heap.mark(m_removed);
+    }
+}
+
+[[nodiscard]] std::size_t Map::find(const std::any& key, std::uint64_t hash) const {
+    if (m_groups.empty()) {
+        return 0;
+    }
+
+    // Triangular steps over a power of two of groups visit every group.
+    const auto mask = m_groups.size() - 1;
+    auto index = (hash >> CONTROL_BITS) & mask;
+    for (std::size_t step = 1;; step++) {
+        const auto& group = m_groups[index];
+        for (auto bits = match(group.control, tag(hash)); bits != 0; bits &= bits - 1) {
+            auto lane = static_cast<std::size_t>(std::countr_zero(bits));
+            const auto& entry = m_entries[group.entries[lane]];
+            if (same(entry.key, key)) {
+                return index * GROUP_WIDTH + lane;
+            }
+        }
+
+        // A key is never placed past an empty slot of its probe.
+        if (match(group.control, EMPTY) != 0) {
+            return slots();
+        }
+
+        index = (index + step) & mask;
+    }
+}
+
+[[nodiscard]] std::size_t Map::vacancy(std::uint64_t hash) const {
+    const auto mask = m_groups.size() - 1;
+    auto index = (hash >> CONTROL_BITS) & mask;
+    for (std::size_t step = 1;; step++) {
+        if (auto bits = matchFree(m_groups[index].control); bits != 0) {
+            return index * GROUP_WIDTH + static_cast<std::size_t>(std::countr_zero(bits));
+        }
+
+        index = (index + step) & mask;
+    }
+}
+
+void Map::rehash() {
+    auto live = [](const Entry& entry) { return entry.key.has_value(); };
+
+    // The entries before the last deleted key move down by the holes among them.
+    m_afterRemoved = static_cast<std::size_t>(
+        std::count_if(m_entries.begin(), m_entries.begin() + static_cast<std::ptrdiff_t>(m_afterRemoved), live));
+    std::erase_if(m_entries, [&](const Entry& entry) { return !live(entry); });
+
+    // Leave the table less than half full, so it takes as many new keys as it holds before the next rebuild.
+    std::size_t groups = 1;
+    while (groups * GROUP_WIDTH * MAX_LOAD < m_length * 16) {
+        groups *= 2;
+    }
+
+    Group empty;
+    std::ranges::fill(empty.control, EMPTY);
+    m_groups.assign(groups, empty);
+    m_entries.reserve(slots() * MAX_LOAD / 8);
+    for (std::size_t i = 0; i < m_entries.size(); i++) {
+        auto hash = Map::hash(m_entries[i].key);
+        auto slot = vacancy(hash);
+        control(slot) = tag(hash);
+        entry(slot) = static_cast<std::uint32_t>(i);
+    }
+}
@@ -0,0 +1,9 @@
+#include "native.h"
+
+#include "interpreter.h"
+
+#include <format>
+
+void NativeFunction::mismatch(const Token& paren, std::size_t index, std::string_view kind) const {
+    throw RuntimeError(paren, std::format("Argument {} of {} must be {}.", index + 1, name, kind));
+}
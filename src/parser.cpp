@@ -1,7 +1,5 @@
 #include "parser.h"
 
-#include "tox.h"
-
 [[nodiscard]] ExprPtr Parser::parse() {
     try {
         return expression();
@@ -10,6 +8,21 @@
     }
 }
 
+[[nodiscard]] std::unique_ptr<Program> Parser::parseProgram() {
+    std::vector<StmtPtr> statements;
+    while (!isAtEnd()) {
+        if (auto statement = declaration()) {
+            statements.push_back(std::move(statement));
+        }
+    }
+
+    if (m_diagnostics.hadError()) {
+        return nullptr;
+    }
+
+    return std::make_unique<Program>(std::move(statements));
+}
+
 const Token& Parser::consume(TokenType type, const std::string& msg) {
     if (check(type)) {
         return advance();
@@ -19,18 +32,315 @@ const Token& Parser::consume(TokenType type, const std::string& msg) {
 }
 
 ParseError Parser::error(const Token& token, const std::string& msg) {
-    Tox::error(token, msg);
+    m_diagnostics.error(token, msg);
 
     return ParseError(msg);
 }
 
+StmtPtr Parser::declaration() {
+    auto nesting = m_nesting;
+
+    try {
+        if (match(TokenType::VAR)) {
+            return varDeclaration();
+        }
+        if (match(TokenType::CLASS)) {
+            return classDeclaration();
+        }
+        if (match(TokenType::FUN)) {
+            return function(Function::Kind::FUNCTION);
+        }
+
+        return statement();
+    } catch (const ParseError& error) {
+        m_nesting = nesting;
+        synchronize();
+
+        return nullptr;
+    }
+}
+
+StmtPtr Parser::varDeclaration() {
+    auto name = consume(TokenType::IDENTIFIER, "Expect variable name.");
+
+    ExprPtr initializer;
+    if (match(TokenType::EQUAL)) {
+        initializer = expression();
+    }
+
+    consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
+    return make<Var>(std::move(name), std::move(initializer));
+}
+
+StmtPtr Parser::classDeclaration() {
+    auto name = consume(TokenType::IDENTIFIER, "Expect class name.");
+
+    std::unique_ptr<Variable> superclass;
+    if (match(TokenType::LESS)) {
+        superclass = make<Variable>(consume(TokenType::IDENTIFIER, "Expect superclass name."));
+    }
+
+    consume(TokenType::LEFT_BRACE, "Expect '{' before class body.");
+    std::vector<std::unique_ptr<Function>> methods;
+    while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
+        auto kind = peek().lexeme == Function::INITIALIZER ? Function::Kind::INITIALIZER : Function::Kind::METHOD;
+        methods.push_back(function(kind));
+    }
+    consume(TokenType::RIGHT_BRACE, "Expect '}' after class body.");
+
+    return make<Class>(std::move(name), std::move(superclass), std::move(methods));
+}
+
+std::unique_ptr<Function> Parser::function(Function::Kind kind) {
+    const std::string what = kind == Function::Kind::FUNCTION ? "function" : "method";
+    auto name = consume(TokenType::IDENTIFIER, "Expect " + what + " name.");
+
+    consume(TokenType::LEFT_PAREN, "Expect '(' after " + what + " name.");
+    std::vector<Token> params;
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            if (params.size() == MAX_ARGUMENTS) {
+                // Report without throwing: the parser is not confused, so there is nothing to synchronize.
+                error(peek(), "Can't have more than 255 parameters.");
+            }
+
+            params.push_back(consume(TokenType::IDENTIFIER, "Expect parameter name."));
+        } while (match(TokenType::COMMA));
+    }
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after parameters.");
+
+    consume(TokenType::LEFT_BRACE, "Expect '{' before " + what + " body.");
+    auto body = block();
+    return make<Function>(std::move(name), std::move(params), std::move(body), kind);
+}
+
+StmtPtr Parser::statement() {
+    if (match(TokenType::PRINT)) {
+        auto keyword = previous();
+        auto value = expression();
+        consume(TokenType::SEMICOLON, "Expect ';' after value.");
+        return make<Print>(std::move(keyword), std::move(value));
+    }
+    if (match(TokenType::LEFT_BRACE)) {
+        return make<Block>(block());
+    }
+    if (match(TokenType::IF)) {
+        return ifStatement();
+    }
+    if (match(TokenType::WHILE)) {
+        return whileStatement();
+    }
+    if (match(TokenType::FOR)) {
+        return forStatement();
+    }
+    if (match(TokenType::RETURN)) {
+        return returnStatement();
+    }
+    if (match(TokenType::SPAWN)) {
+        return spawnStatement();
+    }
+
+    return expressionStatement();
+}
+
+StmtPtr Parser::nested(const Token& token) {
+    if (m_nesting == MAX_NESTING) {
+        throw error(token, "Statement nested too deeply.");
+    }
+
+    m_nesting++;
+    auto stmt = statement();
+    m_nesting--;
+
+    return stmt;
+}
+
+std::vector<StmtPtr> Parser::block() {
+    if (m_nesting == MAX_NESTING) {
+        throw error(previous(), "Statement nested too deeply.");
+    }
+
+    m_nesting++;
+    std::vector<StmtPtr> statements;
+    while (!check(TokenType::RIGHT_BRACE) && !isAtEnd()) {
+        if (auto statement = declaration()) {
+            statements.push_back(std::move(statement));
+        }
+    }
+    m_nesting--;
+
+    consume(TokenType::RIGHT_BRACE, "Expect '}' after block.");
+    return statements;
+}
+
+StmtPtr Parser::ifStatement() {
+    auto keyword = previous();
+    consume(TokenType::LEFT_PAREN, "Expect '(' after 'if'.");
+    auto condition = expression();
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after if condition.");
+
+    auto thenBranch = nested(keyword);
+    StmtPtr elseBranch;
+    if (match(TokenType::ELSE)) {
+        elseBranch = nested(keyword);
+    }
+
+    return make<If>(std::move(keyword), std::move(condition), std::move(thenBranch), std::move(elseBranch));
+}
+
+StmtPtr Parser::whileStatement() {
+    auto keyword = previous();
+    consume(TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
+    auto condition = expression();
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after condition.");
+
+    auto body = nested(keyword);
+    return make<While>(std::move(keyword), std::move(condition), std::move(body));
+}
+
+StmtPtr Parser::forStatement() {
+    auto keyword = previous();
+    consume(TokenType::LEFT_PAREN, "Expect '(' after 'for'.");
+
+    StmtPtr initializer;
+    if (match(TokenType::VAR)) {
+        initializer = varDeclaration();
+    } else if (!match(TokenType::SEMICOLON)) {
+        auto expr = expression();
+        consume(TokenType::SEMICOLON, "Expect ';' after loop initializer.");
+        initializer = make<Expression>(std::move(expr));
+    }
+
+    ExprPtr condition;
+    if (!check(TokenType::SEMICOLON)) {
+        condition = expression();
+    }
+    consume(TokenType::SEMICOLON, "Expect ';' after loop condition.");
+
+    ExprPtr increment;
+    if (!check(TokenType::RIGHT_PAREN)) {
+        increment = expression();
+    }
+    consume(TokenType::RIGHT_PAREN, "Expect ')' after for clauses.");
+
+    // for (initializer; condition; increment) body => { initializer; while (condition) { body; increment; } }
+    auto body = nested(keyword);
+    if (increment) {
+        std::vector<StmtPtr> statements;
+        statements.push_back(std::move(body));
+        statements.push_back(make<Expression>(std::move(increment)));
+        body = make<Block>(std::move(statements));
+    }
+
+    if (!condition) {
+        condition = make<Lit>(Literal(true));
+    }
+    body = make<While>(std::move(keyword), std::move(condition), std::move(body));
+
+    if (initializer) {
+        std::vector<StmtPtr> statements;
+        statements.push_back(std::move(initializer));
+        statements.push_back(std::move(body));
+        body = make<Block>(std::move(statements));
+    }
+
+    return body;
+}
+
+StmtPtr Parser::returnStatement() {
+    auto keyword = previous();
+
+    ExprPtr value;
+    if (!check(TokenType::SEMICOLON)) {
+        value = expression();
+    }
+
+    consume(TokenType::SEMICOLON, "Expect ';' after return value.");
+    return make<Return>(std::move(keyword), std::move(value));
+}
+
+StmtPtr Parser::spawnStatement() {
+    auto keyword = previous();
+
+    auto call = expression();
+    if (dynamic_cast<const Call*>(call.get()) == nullptr) {
+        throw error(keyword, "Expect a function call after 'spawn'.");
+    }
+
+    consume(TokenType::SEMICOLON, "Expect ';' after spawned call.");
+    return make<Spawn>(std::move(keyword), std::move(call));
+}
+
+StmtPtr Parser::expressionStatement() {
+    auto start = peek();
+    auto expr = expression();
+
+    // A program ending in a bare expression prints its value.
+    if (m_nesting == 0 && isAtEnd()) {
+        return make<Print>(std::move(start), std::move(expr));
+    }
+
+    consume(TokenType::SEMICOLON, "Expect ';' after expression.");
+    return make<Expression>(std::move(expr));
+}
+
+ExprPtr Parser::assignment() {
+    // Collect the targets of a chain like `a = b = c` in a loop rather than recursing, as for unary operators.
+    std::vector<std::pair<ExprPtr, Token>> targets;
+    auto expr = logicalOr();
+    while (match(TokenType::EQUAL)) {
+        targets.emplace_back(std::move(expr), previous());
+        expr = logicalOr();
+    }
+
+    for (auto target = targets.rbegin(); target != targets.rend(); ++target) {
+        if (const auto* variable = dynamic_cast<const Variable*>(target->first.get())) {
+            expr = make<Assign>(variable->name(), std::move(expr));
+        } else if (auto* get = dynamic_cast<Get*>(target->first.get())) {
+            expr = make<Set>(get->releaseObject(), get->name(), std::move(expr));
+        } else if (auto* index = dynamic_cast<Index*>(target->first.get())) {
+            auto object = index->releaseObject();
+            expr = make<SetIndex>(std::move(object), index->bracket(), index->releaseIndex(), std::move(expr));
+        } else {
+            // Report without throwing: the parser is not confused, so there is nothing to synchronize.
+            error(target->second, "Invalid assignment target.");
+        }
+    }
+
+    return expr;
+}
+
+ExprPtr Parser::logicalOr() {
+    auto expr = logicalAnd();
+
+    while (match(TokenType::OR)) {
+        auto op = previous();
+        auto right = logicalAnd();
+        expr = make<Logical>(std::move(expr), std::move(op), std::move(right));
+    }
+
+    return expr;
+}
+
+ExprPtr Parser::logicalAnd() {
+    auto expr = equality();
+
+    while (match(TokenType::AND)) {
+        auto op = previous();
+        auto right = equality();
+        expr = make<Logical>(std::move(expr), std::move(op), std::move(right));
+    }
+
+    return expr;
+}
+
 ExprPtr Parser::equality() {
     auto expr = comparison();
 
-    while (match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL)) {
+    while (matchAny(EQUALITY_OPERATORS)) {
         auto op = previous();
         auto right = comparison();
-        expr = std::make_unique<Binary>(std::move(expr), std::move(op), std::move(right));
+        expr = make<Binary>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
@@ -39,10 +349,10 @@ ExprPtr Parser::equality() {
 ExprPtr Parser::comparison() {
     auto expr = term();
 
-    while (match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL)) {
+    while (matchAny(COMPARISON_OPERATORS)) {
         auto op = previous();
         auto right = term();
-        expr = std::make_unique<Binary>(std::move(expr), std::move(op), std::move(right));
+        expr = make<Binary>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
@@ -51,10 +361,10 @@ ExprPtr Parser::comparison() {
 ExprPtr Parser::term() {
     auto expr = factor();
 
-    while (match(TokenType::MINUS, TokenType::PLUS)) {
+    while (matchAny(TERM_OPERATORS)) {
         auto op = previous();
         auto right = factor();
-        expr = std::make_unique<Binary>(std::move(expr), std::move(op), std::move(right));
+        expr = make<Binary>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
@@ -63,42 +373,141 @@ ExprPtr Parser::term() {
 ExprPtr Parser::factor() {
     auto expr = unary();
 
-    while (match(TokenType::SLASH, TokenType::STAR)) {
+    while (matchAny(FACTOR_OPERATORS)) {
         auto op = previous();
         auto right = unary();
-        expr = std::make_unique<Binary>(std::move(expr), std::move(op), std::move(right));
+        expr = make<Binary>(std::move(expr), std::move(op), std::move(right));
     }
 
     return expr;
 }
 
 ExprPtr Parser::unary() {
-    if (match(TokenType::BANG, TokenType::MINUS)) {
-        auto op = previous();
-        auto right = unary();
-        return std::make_unique<Unary>(std::move(op), std::move(right));
+    // Collect prefix operators in a loop rather than recursing, so long chains cannot overflow the stack.
+    std::vector<Token> ops;
+    while (matchAny(UNARY_OPERATORS)) {
+        ops.push_back(previous());
+    }
+
+    auto expr = call();
+    for (auto op = ops.rbegin(); op != ops.rend(); ++op) {
+        expr = make<Unary>(std::move(*op), std::move(expr));
+    }
+
+    return expr;
+}
+
+ExprPtr Parser::call() {
+    auto expr = primary();
+
+    while (match(TokenType::LEFT_PAREN, TokenType::LEFT_BRACKET, TokenType::DOT)) {
+        if (previous().type == TokenType::LEFT_PAREN) {
+            expr = finishCall(std::move(expr));
+        } else if (previous().type == TokenType::LEFT_BRACKET) {
+            expr = finishIndex(std::move(expr));
+        } else {
+            auto name = consume(TokenType::IDENTIFIER, "Expect property name after '.'.");
+            expr = make<Get>(std::move(expr), std::move(name));
+        }
+    }
+
+    return expr;
+}
+
+ExprPtr Parser::finishCall(ExprPtr callee) {
+    // Arguments are parsed by recursion, like parenthesized expressions.
+    if (m_nesting == MAX_NESTING) {
+        throw error(previous(), "Expression nested too deeply.");
+    }
+
+    m_nesting++;
+    std::vector<ExprPtr> arguments;
+    if (!check(TokenType::RIGHT_PAREN)) {
+        do {
+            if (arguments.size() == MAX_ARGUMENTS) {
+                error(peek(), "Can't have more than 255 arguments.");
+            }
+
+            arguments.push_back(expression());
+        } while (match(TokenType::COMMA));
+    }
+    m_nesting--;
+
+    auto paren = consume(TokenType::RIGHT_PAREN, "Expect ')' after arguments.");
+    return make<Call>(std::move(callee), std::move(paren), std::move(arguments));
+}
+
+ExprPtr Parser::finishIndex(ExprPtr object) {
+    if (m_nesting == MAX_NESTING) {
+        throw error(previous(), "Expression nested too deeply.");
+    }
+
+    m_nesting++;
+    auto index = expression();
+    m_nesting--;
+
+    auto bracket = consume(TokenType::RIGHT_BRACKET, "Expect ']' after index.");
+    return make<Index>(std::move(object), std::move(bracket), std::move(index));
+}
+
+ExprPtr Parser::arrayLiteral() {
+    auto bracket = previous();
+    if (m_nesting == MAX_NESTING) {
+        throw error(bracket, "Expression nested too deeply.");
+    }
+
+    m_nesting++;
+    std::vector<ExprPtr> elements;
+    if (!check(TokenType::RIGHT_BRACKET)) {
+        do {
+            elements.push_back(expression());
+        } while (match(TokenType::COMMA));
     }
+    m_nesting--;
 
-    return primary();
+    consume(TokenType::RIGHT_BRACKET, "Expect ']' after array elements.");
+    return make<ArrayLit>(std::move(bracket), std::move(elements));
 }
 
 ExprPtr Parser::primary() {
     if (match(TokenType::FALSE)) {
-        return std::make_unique<Lit>(Literal(false));
+        return make<Lit>(Literal(false));
     }
     if (match(TokenType::TRUE)) {
-        return std::make_unique<Lit>(Literal(true));
+        return make<Lit>(Literal(true));
     }
     if (match(TokenType::NIL)) {
-        return std::make_unique<Lit>(Literal(std::monostate{}));
+        return make<Lit>(Literal(std::monostate{}));
     }
     if (match(TokenType::NUMBER, TokenType::STRING)) {
-        return std::make_unique<Lit>(previous().literal);
+        return make<Lit>(previous().literal);
+    }
+    if (match(TokenType::THIS)) {
+        return make<This>(previous());
+    }
+    if (match(TokenType::SUPER)) {
+        auto keyword = previous();
+        consume(TokenType::DOT, "Expect '.' after 'super'.");
+        auto method = consume(TokenType::IDENTIFIER, "Expect superclass method name.");
+        return make<Super>(std::move(keyword), std::move(method));
+    }
+    if (match(TokenType::IDENTIFIER)) {
+        return make<Variable>(previous());
     }
     if (match(TokenType::LEFT_PAREN)) {
+        if (m_nesting == MAX_NESTING) {
+            throw error(previous(), "Expression nested too deeply.");
+        }
+
+        m_nesting++;
         auto expr = expression();
+        m_nesting--;
+
         consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
-        return std::make_unique<Grouping>(std::move(expr));
+        return make<Grouping>(std::move(expr));
+    }
+    if (match(TokenType::LEFT_BRACKET)) {
+        return arrayLiteral();
     }
 
     throw error(peek(), "Expect expression.");
@@ -121,6 +530,7 @@ void Parser::synchronize() {
         case TokenType::WHILE:
         case TokenType::PRINT:
         case TokenType::RETURN:
+        case TokenType::SPAWN:
             return;
         default:
             break;
@@ -0,0 +1,108 @@
+#include "pool.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * The pool the current thread works for, if any.
+ */
+thread_local const WorkStealingPool* t_pool = nullptr;
+
+/**
+ * Index of the current worker's queue in its pool.
+ */
+thread_local std::size_t t_index = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < threads; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < threads; i++) {
+        m_workers.emplace_back([this, i](std::stop_token stop) { work(stop, i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    for (auto& worker : m_workers) {
+        worker.request_stop();
+    }
+    m_ready.notify_all();
+}
+
+void WorkStealingPool::submit(Task task) {
+    m_pending++;
+
+    auto index = t_pool == this ? t_index : m_next++ % m_queues.size();
+    {
+        // Count the task before a worker can see it, so take() never decrements the count below zero.
+        std::lock_guard lock(m_queues[index]->mutex);
+        m_queued++;
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // Notifying under the lock orders the count update before a worker's check, so the wake-up cannot be lost.
+    std::lock_guard lock(m_mutex);
+    m_ready.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+}
+
+void WorkStealingPool::work(std::stop_token stop, std::size_t index) {
+    t_pool = this;
+    t_index = index;
+
+    Task task;
+    while (true) {
+        if (take(index, task)) {
+            task();
+            task = nullptr;
+
+            if (--m_pending == 0) {
+                std::lock_guard lock(m_mutex);
+                m_idle.notify_all();
+            }
+
+            continue;
+        }
+
+        std::unique_lock lock(m_mutex);
+        if (!m_ready.wait(lock, stop, [this] { return m_queued > 0; })) {
+            // Stop requested with nothing left to run.
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::take(std::size_t index, Task& task) {
+    auto count = m_queues.size();
+    for (std::size_t i = 0; i < count; i++) {
+        auto& queue = *m_queues[(index + i) % count];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        m_queued--;
+
+        return true;
+    }
+
+    return false;
+}
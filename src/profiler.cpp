@@ -0,0 +1,187 @@
+#include "profiler.h"
+
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+/**
+ * A counter with its name, for sorting.
+ */
+using Row = std::pair<std::string_view, ExecutionProfile::Counter>;
+
+/**
+ * Convert a duration to milliseconds.
+ *
+ * @param duration The duration.
+ * @return The duration in milliseconds.
+ */
+double milliseconds(ExecutionProfile::Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/**
+ * Write a table of counters sorted by descending time, skipping counters that never fired.
+ *
+ * @param stream The stream to write to.
+ * @param title Heading of the name column.
+ * @param rows The counters.
+ */
+void printTable(std::ostream& stream, std::string_view title, std::vector<Row> rows) {
+    std::erase_if(rows, [](const Row& row) { return row.second.count == 0; });
+    std::ranges::stable_sort(rows, [](const Row& a, const Row& b) { return a.second.time > b.second.time; });
+
+    ExecutionProfile::Clock::duration total{};
+    for (const auto& row : rows) {
+        total += row.second.time;
+    }
+
+    stream << std::format("{:<16} {:>14} {:>12} {:>7} {:>10}\n", title, "count", "self ms", "self %", "ns/call");
+    for (const auto& [name, counter] : rows) {
+        double share = total.count() > 0 ? 100.0 * static_cast<double>(counter.time.count()) /
+                                               static_cast<double>(total.count())
+                                         : 0.0;
+        double perCall = std::chrono::duration<double, std::nano>(counter.time).count() /
+                         static_cast<double>(counter.count);
+
+        stream << std::format("{:<16} {:>14} {:>12.3f} {:>6.1f}% {:>10.1f}\n", name, counter.count,
+                              milliseconds(counter.time), share, perCall);
+    }
+}
+
+} // namespace
+
+void ExecutionProfile::print(std::ostream& stream) const {
+    std::string report = "Execution profile\n";
+    for (auto step : magic_enum::enum_values<Phase>()) {
+        report += std::format("{:<16} {:>12.3f} ms\n", magic_enum::enum_name(step), milliseconds(phase(step).time));
+    }
+    stream << report << '\n';
+
+    std::vector<Row> nodes;
+    for (auto kind : magic_enum::enum_values<Node>()) {
+        nodes.emplace_back(magic_enum::enum_name(kind), node(kind));
+    }
+    printTable(stream, "node", std::move(nodes));
+    stream << '\n';
+
+    std::vector<Row> operators;
+    for (auto type : magic_enum::enum_values<TokenType>()) {
+        operators.emplace_back(magic_enum::enum_name(type), op(type));
+    }
+    printTable(stream, "operator", std::move(operators));
+
+    stream << std::format("\nruntime errors: {}\n", m_runtimeErrors);
+}
+
+template <typename F>
+void ProfilingInterpreter::measure(ExecutionProfile::Node node, const Token* op, F&& evaluate) {
+    auto start = ExecutionProfile::Clock::now();
+    m_children.emplace_back();
+
+    auto finish = [&] {
+        auto elapsed = ExecutionProfile::Clock::now() - start;
+        auto self = elapsed - m_children.back();
+        m_children.pop_back();
+
+        m_profile.addNode(node, self);
+        if (op != nullptr) {
+            m_profile.addOperator(op->type, self);
+        }
+
+        if (m_children.empty()) {
+            m_lastError = nullptr;
+        } else {
+            m_children.back() += elapsed;
+        }
+    };
+
+    try {
+        std::forward<F>(evaluate)();
+    } catch (const RuntimeError& error) {
+        // The same error unwinds through every enclosing node; count it where it was thrown.
+        if (&error != m_lastError) {
+            m_lastError = &error;
+            m_profile.addRuntimeError();
+        }
+
+        finish();
+        throw;
+    } catch (...) {
+        finish();
+        throw;
+    }
+
+    finish();
+}
+
+void ProfilingInterpreter::visitArrayLiteralExpr(const ArrayLit& expr) {
+    measure(ExecutionProfile::Node::ARRAY, nullptr, [&] { Interpreter::visitArrayLiteralExpr(expr); });
+}
+
+void ProfilingInterpreter::visitAssignExpr(const Assign& expr) {
+    measure(ExecutionProfile::Node::ASSIGN, nullptr, [&] { Interpreter::visitAssignExpr(expr); });
+}
+
+void ProfilingInterpreter::visitBinaryExpr(const Binary& expr) {
+    measure(ExecutionProfile::Node::BINARY, &expr.op(), [&] { Interpreter::visitBinaryExpr(expr); });
+}
+
+void ProfilingInterpreter::visitCallExpr(const Call& expr) {
+    measure(ExecutionProfile::Node::CALL, nullptr, [&] { Interpreter::visitCallExpr(expr); });
+}
+
+void ProfilingInterpreter::visitGetExpr(const Get& expr) {
+    measure(ExecutionProfile::Node::GET, nullptr, [&] { Interpreter::visitGetExpr(expr); });
+}
+
+void ProfilingInterpreter::visitGroupingExpr(const Grouping& expr) {
+    measure(ExecutionProfile::Node::GROUPING, nullptr, [&] { Interpreter::visitGroupingExpr(expr); });
+}
+
+void ProfilingInterpreter::visitIndexExpr(const Index& expr) {
+    measure(ExecutionProfile::Node::INDEX, nullptr, [&] { Interpreter::visitIndexExpr(expr); });
+}
+
+void ProfilingInterpreter::visitLiteralExpr(const Lit& expr) {
+    measure(ExecutionProfile::Node::LITERAL, nullptr, [&] { Interpreter::visitLiteralExpr(expr); });
+}
+
+void ProfilingInterpreter::visitLogicalExpr(const Logical& expr) {
+    measure(ExecutionProfile::Node::LOGICAL, &expr.op(), [&] { Interpreter::visitLogicalExpr(expr); });
+}
+
+void ProfilingInterpreter::visitSetExpr(const Set& expr) {
+    measure(ExecutionProfile::Node::SET, nullptr, [&] { Interpreter::visitSetExpr(expr); });
+}
+
+void ProfilingInterpreter::visitSetIndexExpr(const SetIndex& expr) {
+    measure(ExecutionProfile::Node::SET_INDEX, nullptr, [&] { Interpreter::visitSetIndexExpr(expr); });
+}
+
+void ProfilingInterpreter::visitSuperExpr(const Super& expr) {
+    measure(ExecutionProfile::Node::SUPER, nullptr, [&] { Interpreter::visitSuperExpr(expr); });
+}
+
+void ProfilingInterpreter::visitThisExpr(const This& expr) {
+    measure(ExecutionProfile::Node::THIS, nullptr, [&] { Interpreter::visitThisExpr(expr); });
+}
+
+void ProfilingInterpreter::visitUnaryExpr(const Unary& expr) {
+    measure(ExecutionProfile::Node::UNARY, &expr.op(), [&] { Interpreter::visitUnaryExpr(expr); });
+}
+
+void ProfilingInterpreter::visitVariableExpr(const Variable& expr) {
+    measure(ExecutionProfile::Node::VARIABLE, nullptr, [&] { Interpreter::visitVariableExpr(expr); });
+}
+
+[[nodiscard]] std::any ProfilingInterpreter::evalDeep(const Expr& expr) {
+    std::any result;
+    measure(ExecutionProfile::Node::DEEP_WALK, nullptr, [&] { result = Interpreter::evalDeep(expr); });
+
+    return result;
+}
@@ -0,0 +1,274 @@
+#include "resolver.h"
+
+#include <algorithm>
+#include <utility>
+
+void Resolver::resolve(Program& program) {
+    m_frames.assign(1, Frame{});
+
+    for (const auto& statement : program.statements()) {
+        resolve(*statement);
+    }
+
+    program.layout(std::move(m_globals), m_frames.front().slots);
+
+    m_globalSlots.clear();
+    m_globals.clear();
+    m_frames.clear();
+}
+
+void Resolver::resolve(const Expr& expr) {
+    // Visits push the children of a node instead of recursing. References are resolved against
+    // scopes that do not change within an expression, so the visiting order does not matter.
+    m_pending.push_back(&expr);
+    while (!m_pending.empty()) {
+        const auto* next = m_pending.back();
+        m_pending.pop_back();
+        next->accept(*this);
+    }
+}
+
+void Resolver::reference(const Token& name, Binding& binding, bool reading) {
+    for (auto scope = m_scopes.size(); scope-- > 0;) {
+        auto it = m_scopes[scope].find(name.lexeme);
+        if (it == m_scopes[scope].end()) {
+            continue;
+        }
+
+        auto& local = it->second;
+        if (reading && !local.defined) {
+            m_diagnostics.error(name, "Can't read local variable in its own initializer.");
+        }
+
+        auto frame = m_frames.size() - 1;
+        auto owner = frameOf(scope);
+        if (owner == frame) {
+            binding = {.kind = Binding::Kind::LOCAL, .depth = 0, .slot = local.slot};
+            local.uses.push_back(&binding);
+            return;
+        }
+
+        local.captured = true;
+        binding = {.kind = Binding::Kind::UPVALUE,
+                   .depth = static_cast<std::uint32_t>(frame - owner),
+                   .slot = capture(frame, owner, local.slot)};
+        return;
+    }
+
+    binding = global(name.lexeme);
+}
+
+[[nodiscard]] Binding Resolver::global(const std::string& name) {
+    auto [it, inserted] = m_globalSlots.try_emplace(name, static_cast<std::uint32_t>(m_globals.size()));
+    if (inserted) {
+        m_globals.push_back(name);
+    }
+
+    return {.kind = Binding::Kind::GLOBAL, .depth = 0, .slot = it->second};
+}
+
+Resolver::Local& Resolver::declare(const Token& name, bool defined) {
+    auto& scope = m_scopes.back();
+    if (scope.contains(name.lexeme)) {
+        m_diagnostics.error(name, "Already a variable with this name in this scope.");
+    }
+
+    auto& frame = m_frames.back();
+    auto slot = frame.nextSlot++;
+    frame.slots = std::max(frame.slots, frame.nextSlot);
+
+    auto local = Local{.slot = slot, .defined = defined, .captured = false, .uses = {}};
+    return scope.insert_or_assign(name.lexeme, std::move(local)).first->second;
+}
+
+[[nodiscard]] std::uint32_t Resolver::capture(std::size_t frame, std::size_t owner, std::uint32_t slot) {
+    // The function right inside the owner captures its local, deeper ones an upvalue of their parent.
+    auto wanted = frame - 1 == owner ? Capture{.local = true, .index = slot}
+                                     : Capture{.local = false, .index = capture(frame - 1, owner, slot)};
+
+    auto& captures = m_frames[frame].captures;
+    auto it = std::find(captures.begin(), captures.end(), wanted);
+    if (it == captures.end()) {
+        it = captures.insert(captures.end(), wanted);
+    }
+
+    return static_cast<std::uint32_t>(it - captures.begin());
+}
+
+[[nodiscard]] std::size_t Resolver::frameOf(std::size_t scope) const noexcept {
+    auto frame = m_frames.size() - 1;
+    while (m_frames[frame].scopes > scope) {
+        frame--;
+    }
+
+    return frame;
+}
+
+void Resolver::endScope() {
+    for (auto& [name, local] : m_scopes.back()) {
+        if (!local.captured) {
+            continue;
+        }
+
+        for (auto* use : local.uses) {
+            use->kind = Binding::Kind::CELL;
+        }
+    }
+
+    m_scopes.pop_back();
+}
+
+void Resolver::visitBlockStmt(const Block& stmt) {
+    auto nextSlot = m_frames.back().nextSlot;
+    m_scopes.emplace_back();
+
+    for (const auto& statement : stmt.statements()) {
+        resolve(*statement);
+    }
+
+    // Later sibling blocks reuse the slots of this one.
+    endScope();
+    m_frames.back().nextSlot = nextSlot;
+}
+
+void Resolver::visitClassStmt(const Class& stmt) {
+    // The name is defined before the methods are resolved, so they can refer to their class.
+    if (m_scopes.empty()) {
+        stmt.bind(global(stmt.name().lexeme));
+    } else {
+        auto& local = declare(stmt.name(), true);
+        local.uses.push_back(&stmt.bind({.kind = Binding::Kind::LOCAL, .depth = 0, .slot = local.slot}));
+    }
+
+    if (const auto* superclass = stmt.superclass()) {
+        if (superclass->name().lexeme == stmt.name().lexeme) {
+            m_diagnostics.error(superclass->name(), "A class can't inherit from itself.");
+        }
+
+        resolve(*superclass);
+    }
+
+    auto enclosing = m_class;
+    m_class = stmt.superclass() != nullptr ? ClassKind::SUBCLASS : ClassKind::CLASS;
+    for (const auto& method : stmt.methods()) {
+        function(*method);
+    }
+    m_class = enclosing;
+}
+
+void Resolver::visitFunctionStmt(const Function& stmt) {
+    // The name is defined before the body is resolved, so the function can call itself.
+    if (m_scopes.empty()) {
+        stmt.bind(global(stmt.name().lexeme));
+    } else {
+        auto& local = declare(stmt.name(), true);
+        local.uses.push_back(&stmt.bind({.kind = Binding::Kind::LOCAL, .depth = 0, .slot = local.slot}));
+    }
+
+    function(stmt);
+}
+
+void Resolver::function(const Function& stmt) {
+    m_frames.push_back({.scopes = m_scopes.size(), .nextSlot = 0, .slots = 0, .captures = {}, .kind = stmt.kind()});
+    m_scopes.emplace_back();
+
+    // The receiver and the parameters take the first slots of the frame, where a call leaves them.
+    std::vector<const Local*> params;
+    if (stmt.hasReceiver()) {
+        auto receiver = stmt.name();
+        receiver.type = TokenType::THIS;
+        receiver.lexeme = "this";
+        params.push_back(&declare(receiver, true));
+    }
+    for (const auto& param : stmt.params()) {
+        params.push_back(&declare(param, true));
+    }
+    for (const auto& statement : stmt.body()) {
+        resolve(*statement);
+    }
+
+    std::vector<std::uint32_t> cells;
+    for (const auto* local : params) {
+        if (local->captured) {
+            cells.push_back(local->slot);
+        }
+    }
+
+    endScope();
+    auto frame = std::move(m_frames.back());
+    m_frames.pop_back();
+
+    stmt.layout(frame.slots, std::move(frame.captures), std::move(cells));
+}
+
+void Resolver::visitIfStmt(const If& stmt) {
+    resolve(stmt.condition());
+    resolve(stmt.thenBranch());
+    if (const auto* elseBranch = stmt.elseBranch()) {
+        resolve(*elseBranch);
+    }
+}
+
+void Resolver::visitReturnStmt(const Return& stmt) {
+    if (m_frames.size() == 1) {
+        m_diagnostics.error(stmt.keyword(), "Can't return from top-level code.");
+    }
+
+    if (const auto* value = stmt.value()) {
+        if (m_frames.back().kind == Function::Kind::INITIALIZER) {
+            m_diagnostics.error(stmt.keyword(), "Can't return a value from an initializer.");
+        }
+
+        resolve(*value);
+    }
+}
+
+void Resolver::visitVarStmt(const Var& stmt) {
+    const auto& name = stmt.name();
+
+    if (m_scopes.empty()) {
+        if (const auto* initializer = stmt.initializer()) {
+            resolve(*initializer);
+        }
+
+        stmt.bind(global(name.lexeme));
+
+        return;
+    }
+
+    // Declared but undefined while its initializer is resolved, so the initializer cannot read it.
+    auto& local = declare(name, false);
+    if (const auto* initializer = stmt.initializer()) {
+        resolve(*initializer);
+    }
+
+    local.defined = true;
+    local.uses.push_back(&stmt.bind({.kind = Binding::Kind::LOCAL, .depth = 0, .slot = local.slot}));
+}
+
+void Resolver::visitAssignExpr(const Assign& expr) {
+    m_pending.push_back(&expr.value());
+    reference(expr.name(), expr.bind({}), false);
+}
+
+void Resolver::visitSuperExpr(const Super& expr) {
+    if (m_class == ClassKind::NONE) {
+        m_diagnostics.error(expr.keyword(), "Can't use 'super' outside of a class.");
+    } else if (m_class == ClassKind::CLASS) {
+        m_diagnostics.error(expr.keyword(), "Can't use 'super' in a class with no superclass.");
+    } else {
+        // The method is bound to the receiver of the running method.
+        auto receiver = expr.keyword();
+        receiver.lexeme = "this";
+        reference(receiver, expr.bind({}), true);
+    }
+}
+
+void Resolver::visitThisExpr(const This& expr) {
+    if (m_class == ClassKind::NONE) {
+        m_diagnostics.error(expr.keyword(), "Can't use 'this' outside of a class.");
+        return;
+    }
+
+    reference(expr.keyword(), expr.bind({}), true);
+}
@@ -0,0 +1,75 @@
+#include "runner.h"
+
+#include "tox.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// Exit code for a script that cannot be read, as sysexits' EX_NOINPUT.
+constexpr int EXIT_NO_INPUT = 66;
+
+[[nodiscard]] std::vector<ScriptResult> ScriptRunner::run(const std::vector<std::string>& paths) {
+    std::vector<ScriptResult> results(paths.size());
+
+    // Each task owns its result slot, so no synchronization is needed beyond waiting for the pool.
+    for (std::size_t i = 0; i < paths.size(); i++) {
+        m_pool.submit([this, &result = results[i], &path = paths[i]] {
+            StringSink output;
+            std::ostringstream errors;
+
+            result.path = path;
+            try {
+                Tox tox(output, errors);
+                if (m_maxDepth > 0) {
+                    tox.setMaxDepth(m_maxDepth);
+                }
+                tox.setTracer(m_tracer);
+                result.exitCode = tox.runFile(path);
+            } catch (const std::exception& error) {
+                errors << error.what() << '\n';
+                result.exitCode = EXIT_NO_INPUT;
+            }
+
+            result.output = output.take();
+            result.errors = std::move(errors).str();
+        });
+    }
+
+    m_pool.wait();
+
+    return results;
+}
+
+[[nodiscard]] std::vector<std::string> ScriptRunner::readList(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    std::vector<std::string> paths;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        paths.push_back(std::move(line));
+    }
+
+    return paths;
+}
+
+[[nodiscard]] int ScriptRunner::exitCode(const std::vector<ScriptResult>& results) {
+    int code = 0;
+    for (const auto& result : results) {
+        code = std::max(code, result.exitCode);
+    }
+
+    return code;
+}
@@ -0,0 +1,115 @@
+#include "sampler.h"
+
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <stop_token>
+
+StackSampler::StackSampler(std::chrono::microseconds interval)
+    : m_timer([this, interval](const std::stop_token& stop) {
+          while (!stop.stop_requested()) {
+              std::this_thread::sleep_for(interval);
+              m_ticks.fetch_add(1, std::memory_order_relaxed);
+          }
+      }) {}
+
+void StackSampler::charge(std::span<const Token* const> frames) {
+    auto ticks = m_ticks.load(std::memory_order_relaxed);
+
+    std::string stack;
+    for (const auto* frame : frames) {
+        if (!stack.empty()) {
+            stack += ';';
+        }
+
+        stack += frame != nullptr ? std::format("{} line {}", frame->lexeme, frame->line) : "<deep walk>";
+    }
+
+    m_stacks[stack] += ticks - m_seen;
+    m_seen = ticks;
+}
+
+[[nodiscard]] std::uint64_t StackSampler::samples() const noexcept {
+    return std::accumulate(m_stacks.begin(), m_stacks.end(), std::uint64_t{0},
+                           [](std::uint64_t total, const auto& entry) { return total + entry.second; });
+}
+
+void StackSampler::write(std::ostream& stream) const {
+    for (const auto& [stack, count] : m_stacks) {
+        stream << stack << ' ' << count << '\n';
+    }
+}
+
+void StackSampler::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write samples: " + path);
+    }
+
+    write(file);
+}
+
+template <typename F>
+void SamplingInterpreter::track(const Token* op, F&& evaluate) {
+    sample();
+    m_frames.push_back(op);
+
+    try {
+        std::forward<F>(evaluate)();
+    } catch (...) {
+        m_frames.pop_back();
+        throw;
+    }
+
+    sample();
+    m_frames.pop_back();
+}
+
+void SamplingInterpreter::sample() {
+    if (!m_sampler.due()) {
+        return;
+    }
+
+    if (m_frames.empty()) {
+        m_sampler.discard();
+    } else {
+        m_sampler.charge(m_frames);
+    }
+}
+
+void SamplingInterpreter::visitIfStmt(const If& stmt) {
+    track(&stmt.keyword(), [&] { Interpreter::visitIfStmt(stmt); });
+}
+
+void SamplingInterpreter::visitPrintStmt(const Print& stmt) {
+    track(&stmt.keyword(), [&] { Interpreter::visitPrintStmt(stmt); });
+}
+
+void SamplingInterpreter::visitWhileStmt(const While& stmt) {
+    track(&stmt.keyword(), [&] { Interpreter::visitWhileStmt(stmt); });
+}
+
+void SamplingInterpreter::visitBinaryExpr(const Binary& expr) {
+    track(&expr.op(), [&] { Interpreter::visitBinaryExpr(expr); });
+}
+
+void SamplingInterpreter::visitCallExpr(const Call& expr) {
+    const auto* variable = dynamic_cast<const Variable*>(&expr.callee());
+    track(variable != nullptr ? &variable->name() : &expr.paren(), [&] { Interpreter::visitCallExpr(expr); });
+}
+
+void SamplingInterpreter::visitLogicalExpr(const Logical& expr) {
+    track(&expr.op(), [&] { Interpreter::visitLogicalExpr(expr); });
+}
+
+void SamplingInterpreter::visitUnaryExpr(const Unary& expr) {
+    track(&expr.op(), [&] { Interpreter::visitUnaryExpr(expr); });
+}
+
+[[nodiscard]] std::any SamplingInterpreter::evalDeep(const Expr& expr) {
+    std::any result;
+    track(nullptr, [&] { result = Interpreter::evalDeep(expr); });
+
+    return result;
+}
@@ -1,86 +1,41 @@
 #include "scanner.h"
 
-#include "tox.h"
-
 #include <charconv>
 #include <string_view>
 
-Scanner::Scanner(std::string source) : m_source(std::move(source)) {}
+Scanner::Scanner(std::string source, Diagnostics& diagnostics)
+    : m_source(std::move(source)), m_diagnostics(diagnostics) {}
 
 [[nodiscard]] std::vector<Token> Scanner::scanTokens() {
     while (!isAtEnd()) {
         m_start = m_current;
+        m_column = m_start - m_lineStart + 1;
         scanToken();
     }
 
-    m_tokens.emplace_back(TokenType::END_OF_FILE, "", std::monostate{}, m_line);
+    m_tokens.emplace_back(TokenType::END_OF_FILE, "", std::monostate{}, m_line, m_current - m_lineStart + 1);
     return m_tokens;
 }
 
-const std::unordered_map<std::string, TokenType, StringHash, std::equal_to<>> Scanner::keywords = {
-    {"and", TokenType::AND},   {"class", TokenType::CLASS}, {"else", TokenType::ELSE},     {"false", TokenType::FALSE},
-    {"for", TokenType::FOR},   {"fun", TokenType::FUN},     {"if", TokenType::IF},         {"nil", TokenType::NIL},
-    {"or", TokenType::OR},     {"print", TokenType::PRINT}, {"return", TokenType::RETURN}, {"super", TokenType::SUPER},
-    {"this", TokenType::THIS}, {"true", TokenType::TRUE},   {"var", TokenType::VAR},       {"while", TokenType::WHILE},
-};
+const std::unordered_map<std::string, TokenType, StringHash, std::equal_to<>> Scanner::keywords(KEYWORDS.begin(),
+                                                                                            KEYWORDS.end());
 
 void Scanner::scanToken() {
     char c = advance();
+    if (auto token = punctuation(c, peek())) {
+        m_current += token->length - 1;
+        addToken(token->type);
+
+        return;
+    }
+
     switch (c) {
-    case '(':
-        addToken(TokenType::LEFT_PAREN);
-        break;
-    case ')':
-        addToken(TokenType::RIGHT_PAREN);
-        break;
-    case '{':
-        addToken(TokenType::LEFT_BRACE);
-        break;
-    case '}':
-        addToken(TokenType::RIGHT_BRACE);
-        break;
-    case ',':
-        addToken(TokenType::COMMA);
-        break;
-    case '.':
-        addToken(TokenType::DOT);
-        break;
-    case '-':
-        addToken(TokenType::MINUS);
-        break;
-    case '+':
-        addToken(TokenType::PLUS);
-        break;
-    case ';':
-        addToken(TokenType::SEMICOLON);
-        break;
-    case '*':
-        addToken(TokenType::STAR);
-        break;
-    case '!':
-        addToken(match('=') ? TokenType::BANG_EQUAL : TokenType::BANG);
-        break;
-    case '=':
-        addToken(match('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL);
-        break;
-    case '<':
-        addToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
-        break;
-    case '>':
-        addToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER);
-        break;
-    case '/': {
-        if (match('/')) {
-            // A comment goes until the end of the line.
-            while (peek() != '\n' && !isAtEnd()) {
-                advance();
-            }
-        } else {
-            addToken(TokenType::SLASH);
+    case '/':
+        // Not punctuation, so a comment, which goes until the end of the line.
+        while (peek() != '\n' && !isAtEnd()) {
+            advance();
         }
-
         break;
-    }
     case ' ':
     case '\r':
     case '\t':
@@ -88,6 +43,7 @@ void Scanner::scanToken() {
         break;
     case '\n':
         m_line++;
+        m_lineStart = m_current;
         break;
     case '"':
         string();
@@ -98,7 +54,7 @@ void Scanner::scanToken() {
         } else if (isAlpha(c)) {
             identifier();
         } else {
-            Tox::error(m_line, "Unexpected character.");
+            m_diagnostics.error(m_line, "Unexpected character.");
         }
         break;
     }
@@ -111,20 +67,21 @@ void Scanner::addToken(TokenType type) {
 
 void Scanner::addToken(TokenType type, const Literal& literal) {
     std::string text = m_source.substr(m_start, m_current - m_start);
-    m_tokens.emplace_back(type, text, literal, m_line);
+    m_tokens.emplace_back(type, text, literal, m_line, m_column);
 }
 
 void Scanner::string() {
     while (peek() != '"' && !isAtEnd()) {
         if (peek() == '\n') {
             m_line++;
+            m_lineStart = m_current + 1;
         }
 
         advance();
     }
 
     if (isAtEnd()) {
-        Tox::error(m_line, "Unterminated string.");
+        m_diagnostics.error(m_line, "Unterminated string.");
 
         return;
     }
@@ -138,18 +95,7 @@ void Scanner::string() {
 }
 
 void Scanner::number() {
-    while (isDigit(peek())) {
-        advance();
-    }
-
-    if (peek() == '.' && isDigit(peekNext())) {
-        // Consume the "."
-        advance();
-
-        while (isDigit(peek())) {
-            advance();
-        }
-    }
+    m_current = numberEnd(m_source, m_current);
 
     double value = 0.0;
     std::from_chars(m_source.data() + m_start, m_source.data() + m_current, value);
@@ -157,9 +103,7 @@ void Scanner::number() {
 }
 
 void Scanner::identifier() {
-    while (isAlphaNumeric(peek())) {
-        advance();
-    }
+    m_current = identifierEnd(m_source, m_current);
 
     std::string_view text(m_source.data() + m_start, m_current - m_start);
     TokenType type = keywords.contains(text) ? keywords.find(text)->second : TokenType::IDENTIFIER;
@@ -192,14 +136,6 @@ char Scanner::peek() const noexcept {
     return m_source[m_current];
 }
 
-char Scanner::peekNext() const noexcept {
-    if (m_current + 1 >= m_source.length()) {
-        return '\0';
-    }
-
-    return m_source[m_current + 1];
-}
-
 bool Scanner::isAtEnd() const noexcept {
     return m_current >= m_source.length();
 }
@@ -0,0 +1,335 @@
+#include "scheduler.h"
+
+#include "channel.h"
+#include "diagnostics.h"
+#include "fiber.h"
+#include "interpreter.h"
+#include "sink.h"
+
+#include <exception>
+#include <utility>
+
+namespace {
+
+/**
+ * Stack reserved for each task: the native stack the calls of a program may use, plus as much again for the
+ * frames below them and the trees a frame may still recurse into past its last check.
+ */
+constexpr std::size_t TASK_STACK_SIZE = 2 * Interpreter::NATIVE_STACK_SIZE;
+
+/**
+ * The scheduler of the script the current thread runs, or of the task it runs.
+ */
+thread_local Scheduler* t_scheduler = nullptr;
+
+/**
+ * The task the current thread runs, null on the thread running the script and between tasks.
+ */
+thread_local void* t_task = nullptr;
+
+} // namespace
+
+struct Scheduler::Task {
+    /**
+     * The program declaring the function.
+     */
+    std::shared_ptr<const Program> program;
+
+    /**
+     * The function the task calls.
+     */
+    const Function& function;
+
+    /**
+     * The closing parenthesis of the spawned call.
+     */
+    Token paren;
+
+    /**
+     * The arguments, unpacked on the heap of the task when it starts.
+     */
+    std::vector<Message> arguments;
+
+    /**
+     * The fiber running the task.
+     */
+    Fiber fiber;
+
+    /**
+     * The sink receiving what the task prints, flushed whenever it blocks, null unless it runs.
+     */
+    OutputSink* output = nullptr;
+
+    /**
+     * Lock of the channel the task blocked on, which the thread it switched back to releases.
+     */
+    std::mutex* held = nullptr;
+
+    /**
+     * Flag, whether the task was resumed because every task is blocked.
+     */
+    bool deadlocked = false;
+
+    /**
+     * Constructs a task, which runs nothing until resumed.
+     *
+     * @param program The program declaring the function.
+     * @param function The function.
+     * @param paren The closing parenthesis of the spawned call.
+     * @param arguments The arguments.
+     */
+    Task(std::shared_ptr<const Program> program, const Function& function, Token paren,
+         std::vector<Message> arguments)
+        : program(std::move(program)), function(function), paren(std::move(paren)), arguments(std::move(arguments)),
+          fiber(TASK_STACK_SIZE, &Scheduler::start, this) {}
+};
+
+class Scheduler::TaskSink : public OutputSink {
+private:
+    /**
+     * The scheduler collecting the output.
+     */
+    Scheduler& m_scheduler;
+
+public:
+    /**
+     * Constructs a sink.
+     *
+     * @param scheduler The scheduler collecting the output.
+     */
+    explicit TaskSink(Scheduler& scheduler) : m_scheduler(scheduler) {}
+
+    /**
+     * Destructor.
+     */
+    ~TaskSink() override {
+        flush();
+    }
+
+    TaskSink(const TaskSink&) = delete;
+    TaskSink& operator=(const TaskSink&) = delete;
+
+protected:
+    /**
+     * Append the bytes to the output of the tasks, which the thread running the script writes out.
+     *
+     * @param bytes The bytes.
+     */
+    void drain(std::string_view bytes) override {
+        std::lock_guard lock(m_scheduler.m_mutex);
+        m_scheduler.m_printed.append(bytes);
+    }
+};
+
+Scheduler::Scope::Scope(Scheduler& scheduler) noexcept : m_previous(std::exchange(t_scheduler, &scheduler)) {}
+
+Scheduler::Scope::~Scope() {
+    t_scheduler = m_previous;
+}
+
+Scheduler::Scheduler(OutputSink& output, Configure configure) : m_output(output), m_configure(std::move(configure)) {}
+
+Scheduler::~Scheduler() = default;
+
+[[nodiscard]] Scheduler* Scheduler::current() noexcept {
+    return t_scheduler;
+}
+
+void Scheduler::spawn(std::shared_ptr<const Program> program, const Function& function, const Token& paren,
+                      std::vector<Message> arguments) {
+    auto task = std::make_unique<Task>(std::move(program), function, paren, std::move(arguments));
+    auto& spawned = *task;
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_deterministic && !m_pool) {
+            m_pool = std::make_unique<WorkStealingPool>();
+        }
+        m_tasks.emplace(m_spawned++, std::move(task));
+    }
+
+    m_awake++;
+    schedule(spawned);
+}
+
+void Scheduler::join(Diagnostics& diagnostics) {
+    if (m_deterministic) {
+        while (!m_ready.empty()) {
+            auto* task = m_ready.front();
+            m_ready.pop_front();
+            resume(*task);
+        }
+    } else {
+        std::unique_lock lock(m_mutex);
+        m_awake--;
+        m_changed.wait(lock, [this] { return m_tasks.empty() || m_awake == 0; });
+        m_awake++;
+    }
+
+    // The tasks left wait for each other, or for the script: fail them, in the order they were spawned.
+    while (true) {
+        Task* task = nullptr;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_tasks.empty()) {
+                break;
+            }
+            task = m_tasks.begin()->second.get();
+        }
+
+        task->deadlocked = true;
+        m_awake++;
+        resume(*task);
+    }
+
+    drain();
+    for (const auto& error : m_errors) {
+        diagnostics.runtimeError(error);
+    }
+    m_errors.clear();
+}
+
+void Scheduler::start(void* task) noexcept {
+    auto& running = *static_cast<Task*>(task);
+    t_scheduler->run(running);
+}
+
+void Scheduler::run(Task& task) noexcept {
+    try {
+        TaskSink output(*this);
+        Diagnostics diagnostics;
+        Interpreter interpreter(diagnostics, output);
+        m_configure(interpreter);
+
+        task.output = &output;
+        try {
+            interpreter.interpret(task.program, task.function, task.paren, task.arguments);
+        } catch (const RuntimeError& error) {
+            std::lock_guard lock(m_mutex);
+            m_errors.push_back(error);
+        }
+        task.output = nullptr;
+    } catch (const std::exception& error) {
+        std::lock_guard lock(m_mutex);
+        m_errors.emplace_back(task.paren, error.what());
+    }
+}
+
+void Scheduler::resume(Task& task) {
+    auto* scheduler = std::exchange(t_scheduler, this);
+    auto* caller = std::exchange(t_task, &task);
+    task.fiber.resume();
+    t_task = caller;
+    t_scheduler = scheduler;
+
+    if (task.fiber.done()) {
+        std::lock_guard lock(m_mutex);
+        for (auto entry = m_tasks.begin(); entry != m_tasks.end(); ++entry) {
+            if (entry->second.get() == &task) {
+                m_tasks.erase(entry);
+                break;
+            }
+        }
+        m_awake--;
+        m_changed.notify_all();
+
+        return;
+    }
+
+    // The task blocked: let it be woken, now that it no longer runs. It may be resumed elsewhere right away.
+    std::exchange(task.held, nullptr)->unlock();
+    if (--m_awake == 0) {
+        std::lock_guard lock(m_mutex);
+        m_changed.notify_all();
+    }
+}
+
+void Scheduler::schedule(Task& task) {
+    if (m_pool) {
+        m_pool->submit([this, &task] { resume(task); });
+    } else {
+        m_ready.push_back(&task);
+    }
+}
+
+bool Scheduler::park(std::unique_lock<std::mutex>& lock, Waiter& waiter) {
+    if (auto* task = waiter.m_task) {
+        if (task->deadlocked) {
+            return false;
+        }
+
+        task->output->flush();
+        auto* mutex = lock.release();
+        task->held = mutex;
+        task->fiber.suspend();
+        lock = std::unique_lock(*mutex);
+
+        return !task->deadlocked;
+    }
+
+    // The thread running the script: let the tasks run meanwhile.
+    m_output.flush();
+    lock.unlock();
+
+    auto woken = true;
+    if (m_deterministic) {
+        while (!waiter.m_ready && woken) {
+            if (m_ready.empty()) {
+                woken = false;
+                break;
+            }
+
+            auto* task = m_ready.front();
+            m_ready.pop_front();
+            resume(*task);
+        }
+    } else {
+        std::unique_lock guard(m_mutex);
+        m_awake--;
+        m_changed.wait(guard, [&] { return waiter.m_ready || m_awake == 0; });
+        if (!waiter.m_ready) {
+            m_awake++;
+            woken = false;
+        }
+    }
+
+    drain();
+    lock.lock();
+
+    return woken;
+}
+
+void Scheduler::wake(Waiter& waiter) {
+    m_awake++;
+    if (auto* task = waiter.m_task) {
+        schedule(*task);
+        return;
+    }
+
+    std::unique_lock lock(m_mutex, std::defer_lock);
+    if (!m_deterministic) {
+        lock.lock();
+    }
+    waiter.m_ready = true;
+    m_changed.notify_all();
+}
+
+void Scheduler::drain() {
+    std::string printed;
+    {
+        std::lock_guard lock(m_mutex);
+        printed.swap(m_printed);
+    }
+
+    m_output.write(printed);
+}
+
+Waiter::Waiter() noexcept : m_scheduler(t_scheduler), m_task(static_cast<Scheduler::Task*>(t_task)) {}
+
+bool Waiter::park(std::unique_lock<std::mutex>& lock) {
+    // Outside of a script, no task can wake the thread.
+    return m_scheduler != nullptr && m_scheduler->park(lock, *this);
+}
+
+void Waiter::wake() {
+    m_scheduler->wake(*this);
+}
@@ -0,0 +1,26 @@
+#include "shape.h"
+
+#include <algorithm>
+
+[[nodiscard]] std::optional<std::uint32_t> Shape::find(std::string_view name) const noexcept {
+    // Fields are few, and this only runs on cache misses, so a scan beats hashing.
+    auto it = std::find(m_fields.begin(), m_fields.end(), name);
+    if (it == m_fields.end()) {
+        return std::nullopt;
+    }
+
+    return static_cast<std::uint32_t>(it - m_fields.begin());
+}
+
+[[nodiscard]] Shape& Shape::transition(std::string_view name) {
+    for (const auto& [field, child] : m_transitions) {
+        if (field == name) {
+            return *child;
+        }
+    }
+
+    auto fields = m_fields;
+    fields.emplace_back(name);
+
+    return *m_transitions.emplace_back(std::string(name), std::make_unique<Shape>(std::move(fields))).second;
+}
@@ -0,0 +1,49 @@
+#include "sink.h"
+
+#include <charconv>
+#include <cstring>
+
+void OutputSink::write(std::string_view text) {
+    if (text.size() > BUFFER_SIZE - m_size) {
+        flush();
+
+        // Too large to buffer: hand it over directly instead of copying it in pieces.
+        if (text.size() >= BUFFER_SIZE) {
+            drain(text);
+
+            return;
+        }
+    }
+
+    std::memcpy(m_buffer.get() + m_size, text.data(), text.size());
+    m_size += text.size();
+}
+
+void OutputSink::writeNumber(double value) {
+    if (BUFFER_SIZE - m_size < NUMBER_SIZE) {
+        flush();
+    }
+
+    m_size += formatNumber(m_buffer.get() + m_size, value);
+}
+
+void OutputSink::flush() {
+    if (m_size == 0) {
+        return;
+    }
+
+    drain({m_buffer.get(), m_size});
+    m_size = 0;
+}
+
+std::size_t OutputSink::formatNumber(char* out, double value) noexcept {
+    // std::format("{:g}") is specified as std::to_chars in general format with precision 6.
+    auto result = std::to_chars(out, out + NUMBER_SIZE, value, std::chars_format::general, 6);
+
+    return static_cast<std::size_t>(result.ptr - out);
+}
+
+void FileSink::drain(std::string_view bytes) {
+    std::fwrite(bytes.data(), 1, bytes.size(), m_file);
+    std::fflush(m_file);
+}
@@ -0,0 +1,75 @@
+#include "text.h"
+
+#include <vector>
+
+[[nodiscard]] String* String::concat(Heap& heap, String* left, String* right) {
+    if (left->m_length == 0) {
+        return right;
+    }
+    if (right->m_length == 0) {
+        return left;
+    }
+    if (left->m_length + right->m_length < MIN_ROPE_LENGTH) {
+        return heap.make<String>(left->value() + right->value());
+    }
+
+    return heap.make<String>(left, right);
+}
+
+[[nodiscard]] String* String::join(Heap& heap, std::span<const std::any> parts) {
+    String* result = nullptr;
+    auto append = [&](String* part) { result = result != nullptr ? concat(heap, result, part) : part; };
+
+    std::size_t next = 0;
+    while (next < parts.size()) {
+        auto* part = std::any_cast<String*>(parts[next]);
+        if (part->m_length >= MIN_ROPE_LENGTH) {
+            append(part);
+            next++;
+            continue;
+        }
+
+        // Size the run of short strings first, then copy it into a single buffer.
+        auto end = next;
+        std::size_t length = 0;
+        for (; end < parts.size() && std::any_cast<String*>(parts[end])->m_length < MIN_ROPE_LENGTH; end++) {
+            length += std::any_cast<String*>(parts[end])->m_length;
+        }
+
+        std::string chars;
+        chars.reserve(length);
+        for (; next < end; next++) {
+            chars += std::any_cast<String*>(parts[next])->value();
+        }
+
+        append(heap.make<String>(std::move(chars)));
+    }
+
+    return result;
+}
+
+[[nodiscard]] bool String::equals(const String& other) const {
+    return this == &other || (m_length == other.m_length && value() == other.value());
+}
+
+void String::flatten() const {
+    std::string chars;
+    chars.reserve(m_length);
+
+    std::vector<const String*> pending{m_right, m_left};
+    while (!pending.empty()) {
+        const auto* part = pending.back();
+        pending.pop_back();
+
+        if (part->m_left == nullptr) {
+            chars += part->m_value;
+        } else {
+            pending.push_back(part->m_right);
+            pending.push_back(part->m_left);
+        }
+    }
+
+    m_value = std::move(chars);
+    m_left = nullptr;
+    m_right = nullptr;
+}
@@ -0,0 +1,461 @@
+#include "tier.h"
+
+#include "interpreter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+template <typename Fn>
+CompiledExpr::Fn ClosureCompiler::numeric(CompiledExpr::Fn left, CompiledExpr::Fn right, const Token& op, Fn fn) {
+    // Operands other than two numbers go through the interpreter, which applies arithmetic to two arrays and
+    // raises the error otherwise. The left operand may be an array, so it stays pinned while the right one runs.
+    return [left = std::move(left), right = std::move(right), &op, fn](Interpreter& interpreter) -> std::any {
+        auto a = left(interpreter);
+        auto pinned = interpreter.pin(op, a);
+        auto b = right(interpreter);
+        interpreter.unpin(pinned);
+
+        const auto* x = std::any_cast<double>(&a);
+        const auto* y = std::any_cast<double>(&b);
+        if (x != nullptr && y != nullptr) {
+            return fn(*x, *y);
+        }
+
+        return Interpreter::binary(interpreter.m_heap, op, a, b);
+    };
+}
+
+void ClosureCompiler::visitLiteralExpr(const Lit& expr) {
+    // Strings belong to the heap of the interpreter running the code, so each evaluation makes its own.
+    if (const auto* string = std::get_if<std::string>(&expr.value())) {
+        m_result = [string](Interpreter& interpreter) -> std::any { return interpreter.m_heap.make<String>(*string); };
+        return;
+    }
+
+    auto value = std::visit([](auto&& v) -> std::any { return v; }, expr.value());
+
+    m_result = [value = std::move(value)](Interpreter& /*interpreter*/) { return value; };
+}
+
+void ClosureCompiler::visitUnaryExpr(const Unary& expr) {
+    auto right = compile(expr.right());
+    const auto& op = expr.op();
+
+    switch (op.type) {
+    case TokenType::MINUS:
+        m_result = [right = std::move(right), &op](Interpreter& interpreter) -> std::any {
+            auto value = right(interpreter);
+            Interpreter::checkNumberOperand(op, value);
+
+            return -std::any_cast<double>(value);
+        };
+
+        break;
+    case TokenType::BANG:
+        if (const auto* types = feedback(op); types != nullptr && types->right == OperandTypes::BOOL) {
+            m_result = [right = std::move(right)](Interpreter& interpreter) -> std::any {
+                auto value = right(interpreter);
+                if (const auto* b = std::any_cast<bool>(&value)) {
+                    return !*b;
+                }
+
+                return !Interpreter::isTruthy(value);
+            };
+        } else {
+            m_result = [right = std::move(right)](Interpreter& interpreter) -> std::any {
+                return !Interpreter::isTruthy(right(interpreter));
+            };
+        }
+
+        break;
+    default: // Unreachable.
+        m_result = [right = std::move(right)](Interpreter& interpreter) -> std::any {
+            (void)right(interpreter);
+
+            return std::monostate{};
+        };
+
+        break;
+    }
+}
+
+[[nodiscard]] CompiledExpr::Fn ClosureCompiler::variable(const Token& name, const Binding& binding) {
+    switch (binding.kind) {
+    case Binding::Kind::LOCAL:
+        return [slot = binding.slot](Interpreter& interpreter) -> std::any {
+            return interpreter.m_stack[interpreter.m_base + slot];
+        };
+    case Binding::Kind::CELL:
+    case Binding::Kind::UPVALUE:
+    case Binding::Kind::GLOBAL:
+        return [&name, binding](Interpreter& interpreter) -> std::any { return interpreter.variable(name, binding); };
+    default:
+        return [&name](Interpreter& interpreter) -> std::any { return interpreter.lookup(name); };
+    }
+}
+
+void ClosureCompiler::visitArrayLiteralExpr(const ArrayLit& expr) {
+    std::vector<CompiledExpr::Fn> elements;
+    elements.reserve(expr.elements().size());
+    for (const auto& element : expr.elements()) {
+        elements.push_back(compile(*element));
+    }
+
+    m_result = [elements = std::move(elements), &expr](Interpreter& interpreter) -> std::any {
+        auto* array = interpreter.m_heap.make<Array>(elements.size());
+        auto pinned = interpreter.pin(expr.bracket(), array);
+        auto values = array->values();
+        for (std::size_t i = 0; i < values.size(); i++) {
+            values[i] = Interpreter::element(expr.bracket(), elements[i](interpreter));
+        }
+        interpreter.unpin(pinned);
+
+        return array;
+    };
+}
+
+void ClosureCompiler::visitAssignExpr(const Assign& expr) {
+    auto value = compile(expr.value());
+
+    m_result = [value = std::move(value), &name = expr.name(), binding = expr.binding()](
+                   Interpreter& interpreter) -> std::any {
+        auto result = value(interpreter);
+        interpreter.assign(name, binding, result);
+
+        return result;
+    };
+}
+
+void ClosureCompiler::visitLogicalExpr(const Logical& expr) {
+    auto left = compile(expr.left());
+    auto right = compile(expr.right());
+
+    m_result = [left = std::move(left), right = std::move(right), &expr](Interpreter& interpreter) -> std::any {
+        auto value = left(interpreter);
+        if (expr.shortCircuits(Interpreter::isTruthy(value))) {
+            return value;
+        }
+
+        return right(interpreter);
+    };
+}
+
+void ClosureCompiler::visitCallExpr(const Call& expr) {
+    std::vector<CompiledExpr::Fn> arguments;
+    arguments.reserve(expr.arguments().size());
+    for (const auto& argument : expr.arguments()) {
+        arguments.push_back(compile(*argument));
+    }
+
+    const auto& paren = expr.paren();
+    auto push = [arguments = std::move(arguments), &paren](Interpreter& interpreter) {
+        for (const auto& argument : arguments) {
+            interpreter.push(paren, argument(interpreter));
+        }
+
+        return static_cast<std::uint32_t>(arguments.size());
+    };
+
+    // Methods called right away are not bound, their receiver goes straight to the stack.
+    if (const auto* get = expr.method()) {
+        m_result = [object = compile(get->object()), push = std::move(push), get,
+                    &paren](Interpreter& interpreter) -> std::any {
+            auto callee = object(interpreter);
+            const auto* method = interpreter.prepareInvoke(*get, paren, callee);
+            auto arity = push(interpreter);
+
+            return method != nullptr ? interpreter.call(paren, *method, arity) : interpreter.call(paren, callee, arity);
+        };
+    } else if (const auto* super = expr.superMethod()) {
+        m_result = [push = std::move(push), super, &paren](Interpreter& interpreter) -> std::any {
+            const auto& method = interpreter.prepareInvoke(*super, paren);
+
+            return interpreter.call(paren, method, push(interpreter));
+        };
+    } else {
+        m_result = [callee = compile(expr.callee()), push = std::move(push),
+                    &paren](Interpreter& interpreter) -> std::any {
+            auto function = callee(interpreter);
+            interpreter.pushCallee(paren, function);
+
+            return interpreter.call(paren, function, push(interpreter));
+        };
+    }
+}
+
+void ClosureCompiler::visitGetExpr(const Get& expr) {
+    m_result = [object = compile(expr.object()), &expr](Interpreter& interpreter) -> std::any {
+        return interpreter.property(expr, object(interpreter));
+    };
+}
+
+void ClosureCompiler::visitIndexExpr(const Index& expr) {
+    m_result = [object = compile(expr.object()), index = compile(expr.index()),
+                &expr](Interpreter& interpreter) -> std::any {
+        auto target = object(interpreter);
+        Interpreter::subscript(expr.bracket(), target);
+        auto pinned = interpreter.pin(expr.bracket(), target);
+        auto key = index(interpreter);
+        interpreter.unpin(pinned);
+
+        return Interpreter::load(expr.bracket(), target, key);
+    };
+}
+
+void ClosureCompiler::visitSetExpr(const Set& expr) {
+    m_result = [object = compile(expr.object()), value = compile(expr.value()),
+                &expr](Interpreter& interpreter) -> std::any {
+        auto target = object(interpreter);
+        auto& instance = Interpreter::fields(expr, target);
+        auto pinned = interpreter.pin(expr.name(), target);
+        auto result = value(interpreter);
+        interpreter.unpin(pinned);
+        Interpreter::setField(expr, instance, result);
+
+        return result;
+    };
+}
+
+void ClosureCompiler::visitSetIndexExpr(const SetIndex& expr) {
+    m_result = [object = compile(expr.object()), index = compile(expr.index()), value = compile(expr.value()),
+                &expr](Interpreter& interpreter) -> std::any {
+        auto target = object(interpreter);
+        Interpreter::subscript(expr.bracket(), target);
+        auto pinned = interpreter.pin(expr.bracket(), target);
+        auto key = index(interpreter);
+        Interpreter::checkIndex(expr.bracket(), target, key);
+        auto pinnedKey = interpreter.pin(expr.bracket(), key);
+        auto result = value(interpreter);
+        interpreter.unpin(pinnedKey);
+        interpreter.unpin(pinned);
+
+        return Interpreter::store(interpreter.m_heap, expr.bracket(), target, key, std::move(result));
+    };
+}
+
+void ClosureCompiler::visitSuperExpr(const Super& expr) {
+    m_result = [&expr](Interpreter& interpreter) -> std::any { return interpreter.boundSuperMethod(expr); };
+}
+
+[[nodiscard]] CompiledExpr::Fn ClosureCompiler::concatenation(const Binary& expr) {
+    // Walk down the left spine of `+`, collecting the operators from the last to the first.
+    std::vector<const Binary*> chain;
+    const Expr* first = &expr;
+    for (const auto* binary = &expr; binary != nullptr && binary->op().type == TokenType::PLUS;
+         binary = dynamic_cast<const Binary*>(first)) {
+        chain.push_back(binary);
+        first = &binary->left();
+    }
+    if (chain.size() < 2) {
+        return {};
+    }
+
+    auto isString = [](const Expr& operand) {
+        const auto* literal = dynamic_cast<const Lit*>(&operand);
+        return literal != nullptr && std::holds_alternative<std::string>(literal->value());
+    };
+    auto strings = isString(*first) || std::ranges::any_of(chain, [&](const Binary* binary) {
+        const auto* types = feedback(binary->op());
+        return isString(binary->right()) || (types != nullptr && ((types->left | types->right) & OperandTypes::STRING));
+    });
+    if (!strings) {
+        return {};
+    }
+
+    std::vector<CompiledExpr::Fn> operands{compile(*first)};
+    std::vector<const Token*> ops;
+    for (const auto* binary : std::views::reverse(chain)) {
+        operands.push_back(compile(binary->right()));
+        ops.push_back(&binary->op());
+    }
+
+    return [operands = std::move(operands), ops = std::move(ops)](Interpreter& interpreter) -> std::any {
+        auto value = operands.front()(interpreter);
+
+        // Chains that do not start with a string apply `+` pairwise. The running value may be an array, so it
+        // stays pinned while the next operand runs.
+        if (value.type() != typeid(String*)) {
+            for (std::size_t i = 1; i < operands.size(); i++) {
+                auto pinned = interpreter.pin(*ops[i - 1], value);
+                auto next = operands[i](interpreter);
+                interpreter.unpin(pinned);
+                value = Interpreter::binary(interpreter.m_heap, *ops[i - 1], value, next);
+            }
+
+            return value;
+        }
+
+        // The strings wait on the value stack, which keeps them alive while the next operands run.
+        auto base = interpreter.m_top;
+        interpreter.push(*ops.front(), std::move(value));
+        for (std::size_t i = 1; i < operands.size(); i++) {
+            auto next = operands[i](interpreter);
+            if (next.type() != typeid(String*)) {
+                auto last = interpreter.m_stack[interpreter.m_top - 1];
+                interpreter.m_top = base;
+
+                return Interpreter::binary(interpreter.m_heap, *ops[i - 1], last, next);
+            }
+
+            interpreter.push(*ops[i - 1], std::move(next));
+        }
+
+        auto parts = std::span(interpreter.m_stack).subspan(base, interpreter.m_top - base);
+        auto* result = String::join(interpreter.m_heap, parts);
+        interpreter.m_top = base;
+
+        return result;
+    };
+}
+
+void ClosureCompiler::visitBinaryExpr(const Binary& expr) {
+    if (expr.op().type == TokenType::PLUS) {
+        if (auto fused = concatenation(expr)) {
+            m_result = std::move(fused);
+            return;
+        }
+    }
+
+    auto left = compile(expr.left());
+    auto right = compile(expr.right());
+    const auto& op = expr.op();
+    const auto* types = feedback(op);
+
+    switch (op.type) {
+    case TokenType::PLUS:
+        if (types != nullptr && types->both(OperandTypes::STRING)) {
+            m_result = [left = std::move(left), right = std::move(right), &op](Interpreter& interpreter) -> std::any {
+                auto a = left(interpreter);
+                auto pinned = interpreter.pin(op, a);
+                auto b = right(interpreter);
+                interpreter.unpin(pinned);
+
+                const auto* x = std::any_cast<String*>(&a);
+                const auto* y = std::any_cast<String*>(&b);
+                if (x != nullptr && y != nullptr) {
+                    return String::concat(interpreter.m_heap, *x, *y);
+                }
+
+                return Interpreter::binary(interpreter.m_heap, op, a, b);
+            };
+        } else {
+            m_result = [left = std::move(left), right = std::move(right), &op](Interpreter& interpreter) -> std::any {
+                auto a = left(interpreter);
+                auto pinned = interpreter.pin(op, a);
+                auto b = right(interpreter);
+                interpreter.unpin(pinned);
+
+                return Interpreter::binary(interpreter.m_heap, op, a, b);
+            };
+        }
+
+        break;
+    case TokenType::MINUS:
+        m_result = numeric(std::move(left), std::move(right), op, std::minus<>{});
+
+        break;
+    case TokenType::STAR:
+        m_result = numeric(std::move(left), std::move(right), op, std::multiplies<>{});
+
+        break;
+    case TokenType::SLASH:
+        m_result = numeric(std::move(left), std::move(right), op, std::divides<>{});
+
+        break;
+    case TokenType::GREATER:
+        m_result = numeric(std::move(left), std::move(right), op, std::greater<>{});
+
+        break;
+    case TokenType::GREATER_EQUAL:
+        m_result = numeric(std::move(left), std::move(right), op, std::greater_equal<>{});
+
+        break;
+    case TokenType::LESS:
+        m_result = numeric(std::move(left), std::move(right), op, std::less<>{});
+
+        break;
+    case TokenType::LESS_EQUAL:
+        m_result = numeric(std::move(left), std::move(right), op, std::less_equal<>{});
+
+        break;
+    case TokenType::BANG_EQUAL:
+    case TokenType::EQUAL_EQUAL: {
+        bool negate = op.type == TokenType::BANG_EQUAL;
+        if (types != nullptr && types->both(OperandTypes::NUMBER)) {
+            m_result = [left = std::move(left), right = std::move(right), &op,
+                        negate](Interpreter& interpreter) -> std::any {
+                auto a = left(interpreter);
+                auto pinned = interpreter.pin(op, a);
+                auto b = right(interpreter);
+                interpreter.unpin(pinned);
+
+                const auto* x = std::any_cast<double>(&a);
+                const auto* y = std::any_cast<double>(&b);
+                if (x != nullptr && y != nullptr) {
+                    return (*x == *y) != negate;
+                }
+
+                return Interpreter::isEqual(a, b) != negate;
+            };
+        } else {
+            m_result = [left = std::move(left), right = std::move(right), &op,
+                        negate](Interpreter& interpreter) -> std::any {
+                auto a = left(interpreter);
+                auto pinned = interpreter.pin(op, a);
+                auto b = right(interpreter);
+                interpreter.unpin(pinned);
+
+                return Interpreter::isEqual(a, b) != negate;
+            };
+        }
+
+        break;
+    }
+    default: // Unreachable.
+        m_result = [left = std::move(left), right = std::move(right)](Interpreter& interpreter) -> std::any {
+            (void)left(interpreter);
+            (void)right(interpreter);
+
+            return std::monostate{};
+        };
+
+        break;
+    }
+}
+
+void TierCompiler::enqueue(std::shared_ptr<const Expr> expr, std::shared_ptr<const TypeProfile> profile) {
+    {
+        std::scoped_lock lock(m_mutex);
+        m_queue.push_back({.expr = std::move(expr), .profile = std::move(profile)});
+    }
+
+    if (!m_worker.joinable()) {
+        m_worker = std::jthread([this](const std::stop_token& stop) { run(stop); });
+    }
+
+    m_ready.notify_one();
+}
+
+void TierCompiler::run(const std::stop_token& stop) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_ready.wait(lock, stop, [this] { return !m_queue.empty(); })) {
+                return;
+            }
+
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        ClosureCompiler compiler(job.profile.get());
+        job.expr->tier().publish(std::make_unique<const CompiledExpr>(compiler.compile(*job.expr)));
+    }
+}
@@ -3,8 +3,8 @@
 #include <format>
 #include <magic_enum.hpp>
 
-Token::Token(TokenType type, std::string lexeme, Literal literal, std::size_t line)
-    : type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line) {}
+Token::Token(TokenType type, std::string lexeme, Literal literal, std::size_t line, std::size_t column)
+    : type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line), column(column) {}
 
 std::string Token::toString() const {
     auto lit = std::visit(
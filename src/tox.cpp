@@ -1,29 +1,51 @@
 #include "tox.h"
 
+#include "array.h"
+#include "channel.h"
+#include "emitter.h"
+#include "feedback.h"
 #include "interpreter.h"
+#include "map.h"
 #include "parser.h"
+#include "profiler.h"
+#include "resolver.h"
+#include "sampler.h"
 #include "scanner.h"
+#include "scheduler.h"
+#include "trace.h"
 
+#include <any>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <ctime>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <print>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 constexpr int EXIT_SUCCESS_CODE = 0;
 constexpr int EXIT_SYNTAX_ERROR = 65;
 constexpr int EXIT_RUNTIME_ERROR = 70;
 
-bool Tox::hadError = false;
-bool Tox::hadRuntimeError = false;
+namespace {
 
-Tox::Tox() : m_interpreter(std::make_unique<Interpreter>()) {}
-
-Tox::~Tox() = default;
-
-int Tox::runFile(const std::string& path) {
+/**
+ * Reads a whole source file.
+ *
+ * @param path Path to the source code file.
+ * @return The file contents.
+ * @throws std::runtime_error if the file cannot be opened.
+ */
+std::string readFile(const std::string& path) {
     std::ifstream file(path);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file: " + path);
@@ -31,34 +53,425 @@ int Tox::runFile(const std::string& path) {
 
     std::stringstream buffer;
     buffer << file.rdbuf();
-    auto src = buffer.str();
 
-    run(src);
+    return buffer.str();
+}
+
+/**
+ * The `clock()` native of Lox: processor time used by the program.
+ *
+ * @return The time in seconds.
+ */
+double processTime() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Thunk of the `array(n)` native: a new array of n zeros. The array is allocated on the heap of the interpreter
+ * and zeroed there once, rather than built as a vector the binding would copy, so it is a thunk of its own.
+ *
+ * @param heap The heap to allocate the array on.
+ * @param paren The closing parenthesis of the call, for error reporting.
+ * @param function The binding.
+ * @param arguments The length.
+ * @return The array.
+ * @throws RuntimeError if the length is not a non-negative integer.
+ * @throws NativeError if the length exceeds Array::MAX_LENGTH.
+ */
+std::any makeArray(Heap& heap, const Token& paren, const NativeFunction& function,
+                   std::span<const std::any> arguments) {
+    const auto* length = std::any_cast<double>(&arguments[0]);
+    if (length == nullptr || std::trunc(*length) != *length || *length < 0) {
+        function.mismatch(paren, 0, "an integer");
+    }
+    if (*length > static_cast<double>(Array::MAX_LENGTH)) {
+        throw NativeError(std::format("Array length must be at most {}.", Array::MAX_LENGTH));
+    }
+
+    return heap.make<Array>(static_cast<std::size_t>(*length));
+}
+
+/**
+ * The `len(x)` native: number of elements of an array or of keys of a map.
+ *
+ * @param value The array or the map.
+ * @return The length.
+ * @throws NativeError if the value is neither an array nor a map.
+ */
+double length(std::any value) {
+    if (const auto* array = std::any_cast<Array*>(&value)) {
+        return static_cast<double>((*array)->length());
+    }
+    if (const auto* map = std::any_cast<Map*>(&value)) {
+        return static_cast<double>((*map)->length());
+    }
+
+    throw NativeError("Only arrays and maps have a length.");
+}
+
+/**
+ * The `dot(a, b)` native: dot product of two arrays of the same length.
+ *
+ * @param left The first array.
+ * @param right The second array.
+ * @return The sum of the products of their elements.
+ * @throws NativeError if the arrays have different lengths.
+ */
+double dot(std::span<const double> left, std::span<const double> right) {
+    if (left.size() != right.size()) {
+        throw NativeError("Arrays must have the same length.");
+    }
+
+    return Array::dot(left, right);
+}
+
+/**
+ * The `min(a)` native: smallest element of an array, NaN if any element is NaN.
+ *
+ * @param values The array.
+ * @return The smallest element.
+ * @throws NativeError if the array is empty.
+ */
+double smallest(std::span<const double> values) {
+    if (values.empty()) {
+        throw NativeError("Cannot take the minimum of an empty array.");
+    }
+
+    return Array::min(values);
+}
+
+/**
+ * The `max(a)` native: largest element of an array, NaN if any element is NaN.
+ *
+ * @param values The array.
+ * @return The largest element.
+ * @throws NativeError if the array is empty.
+ */
+double largest(std::span<const double> values) {
+    if (values.empty()) {
+        throw NativeError("Cannot take the maximum of an empty array.");
+    }
+
+    return Array::max(values);
+}
+
+/**
+ * Thunk of the `map()` native: a new empty map. It allocates on the heap of the interpreter, which bound C++
+ * functions have no access to, so it is a thunk of its own.
+ *
+ * @param heap The heap to allocate the map on.
+ * @return The map.
+ */
+std::any makeMap(Heap& heap, const Token& /*paren*/, const NativeFunction& /*function*/,
+                 std::span<const std::any> /*arguments*/) {
+    return heap.make<Map>();
+}
+
+/**
+ * The `has(m, k)` native: whether a map has a key.
+ *
+ * @param map The map.
+ * @param key The key.
+ * @return True if the map has the key.
+ */
+bool has(Map* map, std::any key) {
+    return map->get(key) != nullptr;
+}
+
+/**
+ * The `delete(m, k)` native: delete a key of a map and its value.
+ *
+ * @param map The map.
+ * @param key The key.
+ * @return True if the map had the key.
+ */
+bool erase(Map* map, std::any key) {
+    return map->remove(key);
+}
+
+/**
+ * The `next(m, k)` native: the key following another in insertion order, to iterate over a map with
+ * `for (var k = next(m, nil); k != nil; k = next(m, k))`. The body may delete k, so the same loop drains a map.
+ *
+ * @param map The map.
+ * @param key The previous key, or nil for the first one.
+ * @return The following key, or nil after the last one.
+ * @throws NativeError if the map has no such previous key, nor last deleted it.
+ */
+std::any following(Map* map, std::any key) {
+    auto next = map->next(key);
+    if (!next) {
+        throw NativeError("Key not found in map.");
+    }
+
+    return *std::move(next);
+}
 
-    if (hadError) {
+/**
+ * Thunk of the `channel(n)` native: a new channel holding up to n messages. It allocates on the heap of the
+ * interpreter, so it is a thunk of its own.
+ *
+ * @param heap The heap to allocate the channel on.
+ * @param arguments The capacity.
+ * @return The channel.
+ * @throws NativeError if the capacity is not an integer from 1 to ChannelBuffer::MAX_CAPACITY.
+ */
+std::any makeChannel(Heap& heap, const Token& /*paren*/, const NativeFunction& /*function*/,
+                     std::span<const std::any> arguments) {
+    const auto* capacity = std::any_cast<double>(&arguments[0]);
+    if (capacity == nullptr || std::trunc(*capacity) != *capacity || *capacity < 1 ||
+        *capacity > static_cast<double>(ChannelBuffer::MAX_CAPACITY)) {
+        throw NativeError(
+            std::format("Channel capacity must be an integer from 1 to {}.", ChannelBuffer::MAX_CAPACITY));
+    }
+
+    return heap.make<Channel>(std::make_shared<ChannelBuffer>(static_cast<std::size_t>(*capacity)));
+}
+
+/**
+ * The `send(c, v)` native: send a copy of a value to a channel, blocking while it is full.
+ *
+ * @param channel The channel.
+ * @param value The value.
+ * @throws NativeError if the value cannot be sent, or every task is blocked.
+ */
+void send(Channel* channel, std::any value) {
+    channel->buffer()->send(Message::pack(value));
+}
+
+/**
+ * Thunk of the `recv(c)` native: the oldest value sent to a channel, blocking while it is empty. The value is
+ * rebuilt on the heap of the interpreter, so it is a thunk of its own.
+ *
+ * @param heap The heap to rebuild the value on.
+ * @param paren The closing parenthesis of the call, for error reporting.
+ * @param function The binding.
+ * @param arguments The channel.
+ * @return The value.
+ * @throws RuntimeError if the argument is not a channel.
+ * @throws NativeError if every task is blocked.
+ */
+std::any receive(Heap& heap, const Token& paren, const NativeFunction& function,
+                 std::span<const std::any> arguments) {
+    const auto* channel = std::any_cast<Channel*>(&arguments[0]);
+    if (channel == nullptr) {
+        function.mismatch(paren, 0, "a channel");
+    }
+
+    return (*channel)->buffer()->receive().unpack(heap);
+}
+
+/**
+ * The native functions every script sees, and the only globals of programs translated by `tox --emit-cpp`.
+ *
+ * @return The bindings.
+ */
+const std::vector<NativeFunction>& builtins() {
+    static const std::vector<NativeFunction> natives = {
+        NativeFunction::bind("clock", &processTime),
+        {.name = "array", .arity = 1, .thunk = &makeArray, .function = nullptr},
+        NativeFunction::bind("len", &length),
+        NativeFunction::bind("sum", &Array::sum),
+        NativeFunction::bind("dot", &dot),
+        NativeFunction::bind("min", &smallest),
+        NativeFunction::bind("max", &largest),
+        {.name = "map", .arity = 0, .thunk = &makeMap, .function = nullptr},
+        NativeFunction::bind("has", &has),
+        NativeFunction::bind("delete", &erase),
+        NativeFunction::bind("next", &following),
+        {.name = "channel", .arity = 1, .thunk = &makeChannel, .function = nullptr},
+        NativeFunction::bind("send", &send),
+        {.name = "recv", .arity = 1, .thunk = &receive, .function = nullptr},
+    };
+
+    return natives;
+}
+
+} // namespace
+
+Tox::Tox()
+    : m_ownedOutput(std::make_unique<FileSink>(stdout)), m_output(*m_ownedOutput),
+      m_interpreter(std::make_unique<Interpreter>(m_diagnostics, m_output)),
+      m_scheduler(std::make_unique<Scheduler>(m_output, [this](Interpreter& task) { configure(task); })) {
+    defineBuiltins();
+}
+
+Tox::Tox(OutputSink& output, std::ostream& errors)
+    : m_output(output), m_diagnostics(errors), m_interpreter(std::make_unique<Interpreter>(m_diagnostics, m_output)),
+      m_scheduler(std::make_unique<Scheduler>(m_output, [this](Interpreter& task) { configure(task); })) {
+    defineBuiltins();
+}
+
+Tox::~Tox() = default;
+
+int Tox::runFile(const std::string& path) {
+    m_diagnostics.reset();
+    m_script = path;
+
+    {
+        TraceRecorder::Span span(m_tracer, "run", m_script);
+        auto src = readFile(path);
+        span.arg("bytes", src.size());
+
+        run(src);
+        m_output.flush();
+    }
+
+    if (m_diagnostics.hadError()) {
         return EXIT_SYNTAX_ERROR;
     }
 
-    if (hadRuntimeError) {
+    if (m_diagnostics.hadRuntimeError()) {
         return EXIT_RUNTIME_ERROR;
     }
 
     return EXIT_SUCCESS_CODE;
 }
 
-void Tox::run(const std::string& src) {
-    // Scan the source code into tokens.
-    Scanner scanner(src);
-    auto tokens = scanner.scanTokens();
+RunStats Tox::run(const std::string& src) {
+    return run(parse(src));
+}
 
-    Parser parser = Parser(tokens);
-    auto expr = parser.parse();
+[[nodiscard]] std::shared_ptr<const Program> Tox::parse(const std::string& src) {
+    m_stats = RunStats{.sourceBytes = src.size()};
 
-    if (hadError) {
-        return;
+    auto errors = m_diagnostics.errors();
+    auto allocations = m_memory.scan.allocations + m_memory.parse.allocations;
+    auto bytes = m_memory.scan.bytes + m_memory.parse.bytes;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Token> tokens;
+    {
+        TraceRecorder::Span span(m_tracer, "scan", m_script);
+        MemoryScope scope(m_resource, &m_memory.scan);
+
+        // Scan the source code into tokens.
+        Scanner scanner(src, m_diagnostics);
+        tokens = scanner.scanTokens();
+        m_stats.tokens = tokens.size();
+
+        span.arg("bytes", src.size());
+        span.arg("tokens", tokens.size());
     }
 
-    m_interpreter->interpret(*expr);
+    auto scanned = std::chrono::steady_clock::now();
+
+    std::shared_ptr<Program> program;
+    {
+        TraceRecorder::Span span(m_tracer, "parse", m_script);
+        MemoryScope scope(m_resource, &m_memory.parse);
+        span.arg("tokens", tokens.size());
+
+        Parser parser = Parser(std::move(tokens), m_diagnostics);
+        program = parser.parseProgram();
+        m_stats.nodes = parser.nodes();
+
+        if (program) {
+            Resolver resolver(m_diagnostics);
+            resolver.resolve(*program);
+        }
+
+        span.arg("nodes", parser.nodes());
+    }
+
+    m_stats.scanTime = scanned - start;
+    m_stats.parseTime = std::chrono::steady_clock::now() - scanned;
+    m_stats.syntaxErrors = m_diagnostics.errors() - errors;
+    m_stats.allocations = m_memory.scan.allocations + m_memory.parse.allocations - allocations;
+    m_stats.allocatedBytes = m_memory.scan.bytes + m_memory.parse.bytes - bytes;
+
+    if (m_execution) {
+        m_execution->addPhase(ExecutionProfile::Phase::SCAN, m_stats.scanTime);
+        m_execution->addPhase(ExecutionProfile::Phase::PARSE, m_stats.parseTime);
+    }
+
+    if (m_diagnostics.hadError()) {
+        return nullptr;
+    }
+
+    return program;
+}
+
+RunStats Tox::run(std::shared_ptr<const Program> program) {
+    if (!program) {
+        return m_stats;
+    }
+
+    auto errors = m_diagnostics.runtimeErrors();
+    auto allocations = m_memory.eval.allocations;
+    auto bytes = m_memory.eval.bytes;
+    auto start = std::chrono::steady_clock::now();
+
+    m_stats.depth = program->height();
+    {
+        TraceRecorder::Span span(m_tracer, "eval", m_script);
+        MemoryScope scope(m_resource, &m_memory.eval);
+        span.arg("height", program->height());
+
+        Scheduler::Scope tasks(*m_scheduler);
+        m_interpreter->interpret(std::move(program));
+        m_scheduler->join(m_diagnostics);
+    }
+
+    m_stats.evalTime = std::chrono::steady_clock::now() - start;
+    m_stats.runtimeErrors = m_diagnostics.runtimeErrors() - errors;
+    m_stats.allocations += m_memory.eval.allocations - allocations;
+    m_stats.allocatedBytes += m_memory.eval.bytes - bytes;
+
+    if (m_execution) {
+        m_execution->addPhase(ExecutionProfile::Phase::EVAL, m_stats.evalTime);
+    }
+
+    return m_stats;
+}
+
+int Tox::emitCpp(const std::string& path) {
+    auto program = parse(readFile(path));
+    if (!program) {
+        return EXIT_SYNTAX_ERROR;
+    }
+
+    const auto& statements = program->statements();
+    const auto* print = statements.size() == 1 ? dynamic_cast<const Print*>(statements.front().get()) : nullptr;
+    if (print == nullptr) {
+        std::println(stderr, "--emit-cpp requires a script made of a single expression");
+
+        return EXIT_SYNTAX_ERROR;
+    }
+
+    std::vector<std::string> natives;
+    for (const auto& function : builtins()) {
+        natives.push_back(function.name);
+    }
+
+    CppEmitter emitter(std::move(natives));
+    std::print("{}", emitter.emit(print->expression(), path));
+
+    return EXIT_SUCCESS_CODE;
+}
+
+int Tox::runCompiled(std::any (*program)(Heap&)) {
+    try {
+        Heap heap;
+        std::println("{}", Interpreter::stringify(program(heap)));
+    } catch (const RuntimeError& error) {
+        Diagnostics diagnostics;
+        diagnostics.runtimeError(error);
+
+        return EXIT_RUNTIME_ERROR;
+    }
+
+    return EXIT_SUCCESS_CODE;
+}
+
+[[nodiscard]] std::any Tox::builtin(Heap& heap, std::string_view name) {
+    for (const auto& function : builtins()) {
+        if (function.name == name) {
+            return heap.make<Native>(function);
+        }
+    }
+
+    throw std::out_of_range(std::format("No native function named '{}'", name));
 }
 
 int Tox::repl() {
@@ -84,31 +497,113 @@ int Tox::repl() {
         }
 
         run(line);
+        m_output.flush();
 
-        hadError = false;
+        m_diagnostics.reset();
     }
 
     return EXIT_SUCCESS_CODE;
 }
 
-void Tox::error(std::size_t line, std::string_view msg) {
-    report(line, "", msg);
+void Tox::setMaxDepth(std::uint32_t depth) {
+    m_maxDepth = depth;
+    m_interpreter->setMaxDepth(depth);
+}
+
+void Tox::setHeapGrowth(double growth) {
+    m_heapGrowth = growth;
+    m_interpreter->heap().setGrowth(growth);
+}
+
+void Tox::setHeapStress(bool stress) {
+    m_heapStress = stress;
+    m_interpreter->heap().setStress(stress);
+}
+
+[[nodiscard]] const HeapStats& Tox::heapStats() const noexcept {
+    return m_interpreter->heap().stats();
+}
+
+void Tox::loadProfile(const std::string& path) {
+    m_profile = std::make_shared<const TypeProfile>(TypeProfile::load(path));
+    m_interpreter->setTypeProfile(m_profile);
+}
+
+void Tox::recordProfile() {
+    m_recorder = m_profile ? std::make_shared<TypeProfile>(*m_profile) : std::make_shared<TypeProfile>();
+    m_interpreter->recordTypes(m_recorder);
+}
+
+void Tox::saveProfile(const std::string& path) const {
+    if (m_recorder) {
+        m_recorder->save(path);
+    }
+}
+
+void Tox::enableProfiling() {
+    if (m_execution) {
+        return;
+    }
+    if (m_sampler) {
+        throw std::logic_error("Profiling cannot be combined with sampling");
+    }
+
+    m_execution = std::make_unique<ExecutionProfile>();
+    replaceInterpreter(std::make_unique<ProfilingInterpreter>(m_diagnostics, m_output, *m_execution));
+}
+
+void Tox::enableSampling() {
+    if (m_sampler) {
+        return;
+    }
+    if (m_execution) {
+        throw std::logic_error("Sampling cannot be combined with profiling");
+    }
+
+    m_sampler = std::make_unique<StackSampler>();
+    replaceInterpreter(std::make_unique<SamplingInterpreter>(m_diagnostics, m_output, *m_sampler));
 }
 
-void Tox::error(const Token& token, std::string_view msg) {
-    if (token.type == TokenType::END_OF_FILE) {
-        report(token.line, " at end", msg);
-    } else {
-        report(token.line, std::format(" at '{}'", token.lexeme), msg);
+void Tox::saveSamples(const std::string& path) const {
+    if (m_sampler) {
+        m_sampler->save(path);
     }
 }
 
-void Tox::runtimeError(const RuntimeError& error) {
-    std::println(stderr, "{}\n[line {}]", error.what(), error.token().line);
+void Tox::defineBuiltins() {
+    for (const auto& function : builtins()) {
+        defineNative(function);
+    }
+}
+
+void Tox::defineNative(NativeFunction function) {
+    m_interpreter->defineNative(function);
+    m_natives.push_back(std::move(function));
+}
+
+void Tox::replaceInterpreter(std::unique_ptr<Interpreter> interpreter) {
+    m_interpreter = std::move(interpreter);
+    configure(*m_interpreter);
+    m_interpreter->recordTypes(m_recorder);
+}
+
+void Tox::configure(Interpreter& interpreter) const {
+    for (const auto& function : m_natives) {
+        interpreter.defineNative(function);
+    }
+
+    interpreter.setTypeProfile(m_profile);
+    if (m_maxDepth > 0) {
+        interpreter.setMaxDepth(m_maxDepth);
+    }
+    interpreter.heap().setGrowth(m_heapGrowth);
+    interpreter.heap().setStress(m_heapStress);
+}
 
-    hadRuntimeError = true;
+void Tox::setDeterministic(bool deterministic) noexcept {
+    m_scheduler->setDeterministic(deterministic);
 }
 
-void Tox::report(std::size_t line, std::string_view where, std::string_view msg) {
-    std::println(stderr, "[line {}] Error{}: {}", line, where, msg);
+void Tox::setTracer(TraceRecorder* tracer) noexcept {
+    m_tracer = tracer;
 }
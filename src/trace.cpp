@@ -0,0 +1,154 @@
+#include "trace.h"
+
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/**
+ * Source of recorder identities.
+ */
+std::atomic<std::uint64_t> nextId{1};
+
+/**
+ * Convert a time point to microseconds since an origin.
+ *
+ * @param origin The origin.
+ * @param time The time point.
+ * @return The offset in microseconds.
+ */
+double microseconds(TraceRecorder::Clock::time_point origin, TraceRecorder::Clock::time_point time) {
+    return std::chrono::duration<double, std::micro>(time - origin).count();
+}
+
+/**
+ * Quote a string as a JSON string literal.
+ *
+ * @param text The string.
+ * @return The literal.
+ */
+std::string quote(std::string_view text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            quoted += "\\\"";
+            break;
+        case '\\':
+            quoted += "\\\\";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                quoted += std::format("\\u{:04x}", static_cast<unsigned>(c));
+            } else {
+                quoted += c;
+            }
+        }
+    }
+    quoted += '"';
+
+    return quoted;
+}
+
+} // namespace
+
+TraceRecorder::Span::Span(TraceRecorder* recorder, std::string_view name, std::string_view file)
+    : m_recorder(recorder) {
+    if (m_recorder != nullptr) {
+        m_event.name = name;
+        m_event.file = file;
+        m_event.start = Clock::now();
+    }
+}
+
+TraceRecorder::Span::~Span() {
+    if (m_recorder != nullptr) {
+        m_event.duration = Clock::now() - m_event.start;
+        m_recorder->record(std::move(m_event));
+    }
+}
+
+TraceRecorder::TraceRecorder() : m_id(nextId.fetch_add(1, std::memory_order_relaxed)) {}
+
+void TraceRecorder::record(Event event) {
+    buffer().events.push_back(std::move(event));
+}
+
+[[nodiscard]] TraceRecorder::Buffer& TraceRecorder::buffer() {
+    thread_local std::uint64_t owner = 0;
+    thread_local Buffer* local = nullptr;
+
+    if (owner != m_id) {
+        std::lock_guard lock(m_mutex);
+        auto thread = static_cast<std::uint32_t>(m_buffers.size() + 1);
+        local = m_buffers.emplace_back(std::make_unique<Buffer>(Buffer{.thread = thread, .events = {}})).get();
+        owner = m_id;
+    }
+
+    return *local;
+}
+
+[[nodiscard]] std::size_t TraceRecorder::size() const {
+    std::lock_guard lock(m_mutex);
+
+    std::size_t events = 0;
+    for (const auto& buffer : m_buffers) {
+        events += buffer->events.size();
+    }
+
+    return events;
+}
+
+void TraceRecorder::write(std::ostream& stream) const {
+    std::lock_guard lock(m_mutex);
+
+    stream << "{\"traceEvents\":[\n";
+
+    bool first = true;
+    auto separate = [&] {
+        if (!first) {
+            stream << ",\n";
+        }
+        first = false;
+    };
+
+    for (const auto& buffer : m_buffers) {
+        separate();
+        stream << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"thread {}"}}}})",
+                              buffer->thread, buffer->thread);
+
+        for (const auto& event : buffer->events) {
+            separate();
+            stream << std::format(R"({{"name":{},"cat":"tox","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},)",
+                                  quote(event.name), buffer->thread, microseconds(m_origin, event.start),
+                                  std::chrono::duration<double, std::micro>(event.duration).count());
+            stream << "\"args\":{";
+
+            std::string_view comma;
+            if (!event.file.empty()) {
+                stream << "\"file\":" << quote(event.file);
+                comma = ",";
+            }
+            for (const auto& arg : event.args) {
+                stream << comma << quote(arg.name) << ':' << arg.value;
+                comma = ",";
+            }
+
+            stream << "}}";
+        }
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void TraceRecorder::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write trace: " + path);
+    }
+
+    write(file);
+}
@@ -0,0 +1,37 @@
+# Runs a script on the interpreter and its translation to C++, failing unless both print the same output, report the
+# same errors with the same line numbers and exit with the same code.
+#
+# Usage: cmake -DTOX=<tox> -DCOMPILED=<compiled script> -DSCRIPT=<script.tox> -P compare.cmake
+
+execute_process(
+    COMMAND ${TOX} ${SCRIPT}
+    OUTPUT_VARIABLE interpreted_output
+    ERROR_VARIABLE interpreted_errors
+    RESULT_VARIABLE interpreted_result
+)
+
+execute_process(
+    COMMAND ${COMPILED}
+    OUTPUT_VARIABLE compiled_output
+    ERROR_VARIABLE compiled_errors
+    RESULT_VARIABLE compiled_result
+)
+
+if(NOT interpreted_output STREQUAL compiled_output)
+    message(FATAL_ERROR "Output differs for ${SCRIPT}\n"
+                        "interpreted:\n${interpreted_output}${interpreted_errors}\n"
+                        "compiled:\n${compiled_output}${compiled_errors}")
+endif()
+
+if(NOT interpreted_result STREQUAL compiled_result)
+    message(FATAL_ERROR "Exit code differs for ${SCRIPT}: interpreted ${interpreted_result}, "
+                        "compiled ${compiled_result}\n"
+                        "interpreted:\n${interpreted_errors}\n"
+                        "compiled:\n${compiled_errors}")
+endif()
+
+if(NOT interpreted_errors STREQUAL compiled_errors)
+    message(FATAL_ERROR "Errors differ for ${SCRIPT}\n"
+                        "interpreted:\n${interpreted_errors}\n"
+                        "compiled:\n${compiled_errors}")
+endif()
@@ -0,0 +1,28 @@
+#include "consteval.h"
+
+#include <limits>
+
+// Every assertion is checked while this file compiles; the executable only exists so CTest can run it.
+
+static_assert(tox::constEval("(1 + 2) * 3").asNumber() == 9);
+static_assert(tox::constEval("10 / 4 - 0.5").asNumber() == 2);
+static_assert(tox::constEval("-(2 * 3) + 1").asNumber() == -5);
+static_assert(tox::constEval("0.1 + 0.2").asNumber() == 0.1 + 0.2);
+static_assert(tox::constEval("1 / 0").asNumber() == std::numeric_limits<double>::infinity());
+
+static_assert(tox::constEval("1 < 2").asBool());
+static_assert(!tox::constEval("2 <= 1").asBool());
+static_assert(tox::constEval("3 >= 3 == true").asBool());
+static_assert(tox::constEval("\"con\" + \"cat\" == \"concat\"").asBool());
+static_assert(tox::constEval("\"a\" != \"b\"").asBool());
+static_assert(tox::constEval("nil == nil").asBool());
+static_assert(!tox::constEval("nil == false").asBool());
+static_assert(tox::constEval("!nil").asBool());
+static_assert(!tox::constEval("!0").asBool());
+
+static_assert(tox::constEval("nil").isNil());
+static_assert(tox::constEval("// a comment\n(1)").kind() == tox::ConstValue::Kind::NUMBER);
+
+int main() {
+    return 0;
+}
@@ -0,0 +1,9 @@
+#include "consteval.h"
+
+// Must not compile: a runtime error in the snippet is not a constant expression. Built only by the test that
+// expects its build to fail.
+static_assert(tox::constEval("1 + \"one\"").asNumber() == 0);
+
+int main() {
+    return 0;
+}
@@ -0,0 +1,15 @@
+# Translates a script with `tox --emit-cpp`, failing the build step if the translation does.
+#
+# Usage: cmake -DTOX=<tox> -DSCRIPT=<script.tox> -DUNIT=<unit.cpp> -P emit.cmake
+
+execute_process(
+    COMMAND ${TOX} --emit-cpp ${SCRIPT}
+    OUTPUT_FILE ${UNIT}
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE result
+)
+
+if(NOT result EQUAL 0)
+    file(REMOVE ${UNIT})
+    message(FATAL_ERROR "tox --emit-cpp ${SCRIPT} failed (${result}):\n${errors}")
+endif()